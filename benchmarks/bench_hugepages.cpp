@@ -0,0 +1,198 @@
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <cstring>
+#include <iomanip>
+#include <iostream>
+#include <linux/perf_event.h>
+#include <memory>
+#include <random>
+#include <sstream>
+#include <string>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#include <vector>
+
+#include "actor.h"
+#include "event_loop.h"
+#include "huge_pages.h"
+#include "logging.h"
+#include "message.h"
+#include "tool_util.h"
+
+/**
+ * bench_hugepages - 邮箱和消息负载放在大页上时的TLB缺失
+ *
+ * 向--actors个Actor随机投递共--messages条消息（全部留在邮箱中），再用一个worker全部处理完，
+ * 分别测量投递和处理两个阶段的耗时和dTLB读缺失（perf_event_open，只统计用户态）。
+ * 对比默认堆，以及每个worker一个以HugePageArena为上游的池（OFF、TRANSPARENT、EXPLICIT）。
+ * 没有权限打开性能计数器时（perf_event_paranoid过高、容器限制）缺失数显示为n/a。
+ * EXPLICIT需要预留大页（/proc/sys/vm/nr_hugepages），没有时退回TRANSPARENT，huge_MB列反映实际情况。
+ *
+ * 用法：bench_hugepages [--actors N] [--messages N] [--seed N]
+ */
+
+namespace {
+    // 进程内（含之后创建的线程）用户态的一个硬件计数器
+    class PerfCounter {
+    public:
+        PerfCounter(uint32_t type, uint64_t config) {
+            perf_event_attr attr;
+            std::memset(&attr, 0, sizeof(attr));
+            attr.size = sizeof(attr);
+            attr.type = type;
+            attr.config = config;
+            attr.disabled = 1;
+            attr.inherit = 1;
+            attr.exclude_kernel = 1;
+            attr.exclude_hv = 1;
+            fd_ = static_cast<int>(::syscall(SYS_perf_event_open, &attr, 0, -1, -1, 0));
+        }
+
+        ~PerfCounter() {
+            if (fd_ >= 0) {
+                ::close(fd_);
+            }
+        }
+
+        bool valid() const { return fd_ >= 0; }
+
+        void start() {
+            if (fd_ >= 0) {
+                ::ioctl(fd_, PERF_EVENT_IOC_RESET, 0);
+                ::ioctl(fd_, PERF_EVENT_IOC_ENABLE, 0);
+            }
+        }
+
+        uint64_t stop() {
+            uint64_t value = 0;
+            if (fd_ >= 0) {
+                ::ioctl(fd_, PERF_EVENT_IOC_DISABLE, 0);
+                if (::read(fd_, &value, sizeof(value)) != sizeof(value)) {
+                    value = 0;
+                }
+            }
+            return value;
+        }
+
+    private:
+        int fd_ = -1;
+    };
+
+    class Sink : public Actor {
+    public:
+        Sink(const std::string& name, std::weak_ptr<EventLoop> event_loop) : Actor(name, event_loop) {
+            register_handler("work", [this](const Message& msg) { total_ += msg.get_payload_value<int64_t>("n"); });
+        }
+
+        int64_t total_ = 0;
+    };
+
+    struct Phase {
+        double ns_per_message = 0;
+        uint64_t dtlb_misses = 0;
+    };
+
+    struct Result {
+        Phase deliver;
+        Phase process;
+        size_t huge_bytes = 0;
+    };
+
+    Result run(size_t actor_count, size_t messages, uint64_t seed, std::shared_ptr<std::pmr::memory_resource> pool,
+               const HugePageArena* arena, PerfCounter& dtlb) {
+        auto event_loop = std::make_shared<EventLoop>();
+        if (pool) {
+            event_loop->set_memory_resources({pool});
+        }
+        std::vector<std::shared_ptr<Sink>> actors;
+        for (size_t i = 0; i < actor_count; ++i) {
+            auto actor = std::make_shared<Sink>("sink-" + std::to_string(i), event_loop);
+            event_loop->register_actor(actor);
+            actors.push_back(actor);
+        }
+        event_loop->run_until_idle();
+
+        std::mt19937_64 rng(seed);
+        std::vector<uint32_t> targets(messages);
+        for (auto& target : targets) {
+            target = static_cast<uint32_t>(rng() % actor_count);
+        }
+
+        Result result;
+        auto measure = [&](Phase& phase, const auto& body) {
+            auto started = std::chrono::steady_clock::now();
+            dtlb.start();
+            body();
+            phase.dtlb_misses = dtlb.stop();
+            double elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - started).count();
+            phase.ns_per_message = elapsed * 1e9 / static_cast<double>(messages);
+        };
+        measure(result.deliver, [&]() {
+            for (size_t i = 0; i < messages; ++i) {
+                const auto& actor = actors[targets[i]];
+                event_loop->deliver_message(
+                    Message("work", "bench", actor->get_id(), {{"n", static_cast<int64_t>(i)}}));
+            }
+        });
+        measure(result.process, [&]() { event_loop->run_until_idle(); });
+        result.huge_bytes = arena ? arena->huge_bytes() : 0;
+        return result;
+    }
+}
+
+int main(int argc, char* argv[]) {
+    auto options = tool_util::parse_options(argc, argv, {"help"});
+    if (options.has("help")) {
+        std::cerr << "usage: bench_hugepages [--actors N] [--messages N] [--seed N]" << std::endl;
+        return 0;
+    }
+    size_t actor_count = static_cast<size_t>(std::max<int64_t>(1, options.get_int("actors", 256)));
+    size_t messages = static_cast<size_t>(std::max<int64_t>(1, options.get_int("messages", 500000)));
+    uint64_t seed = static_cast<uint64_t>(options.get_int("seed", 0));
+
+    set_log_level(LogLevel::OFF);
+
+    PerfCounter dtlb(PERF_TYPE_HW_CACHE, PERF_COUNT_HW_CACHE_DTLB | (PERF_COUNT_HW_CACHE_OP_READ << 8) |
+                                             (PERF_COUNT_HW_CACHE_RESULT_MISS << 16));
+    if (!dtlb.valid()) {
+        std::cerr << "dTLB counter unavailable: " << std::strerror(errno) << std::endl;
+    }
+
+    std::cout << "actors " << actor_count << ", messages " << messages << "\n"
+              << std::left << std::setw(14) << "resource" << std::right << std::setw(10) << "huge_MB" << std::setw(14)
+              << "deliver_ns" << std::setw(16) << "deliver_miss/K" << std::setw(14) << "process_ns" << std::setw(16)
+              << "process_miss/K" << "\n";
+    auto report = [&](const char* name, const Result& result) {
+        auto misses = [&](const Phase& phase) {
+            if (!dtlb.valid()) {
+                return std::string("n/a");
+            }
+            std::ostringstream text;
+            text << std::fixed << std::setprecision(1)
+                 << static_cast<double>(phase.dtlb_misses) * 1000.0 / static_cast<double>(messages);
+            return text.str();
+        };
+        std::cout << std::fixed << std::setprecision(1) << std::left << std::setw(14) << name << std::right
+                  << std::setw(10) << static_cast<double>(result.huge_bytes) / (1024.0 * 1024.0) << std::setw(14)
+                  << result.deliver.ns_per_message << std::setw(16) << misses(result.deliver) << std::setw(14)
+                  << result.process.ns_per_message << std::setw(16) << misses(result.process) << std::endl;
+    };
+
+    report("heap", run(actor_count, messages, seed, nullptr, nullptr, dtlb));
+    const std::pair<const char*, HugePageMode> modes[] = {
+        {"pool-4k", HugePageMode::OFF},
+        {"pool-thp", HugePageMode::TRANSPARENT},
+        {"pool-hugetlb", HugePageMode::EXPLICIT},
+    };
+    for (const auto& [name, mode] : modes) {
+        // 池和上游在这里分别构造，才能读到上游的大页统计
+        auto arena = std::make_shared<HugePageArena>(mode);
+        auto pool = std::shared_ptr<std::pmr::memory_resource>(
+            new std::pmr::synchronized_pool_resource(arena.get()),
+            [arena](std::pmr::memory_resource* resource) { delete resource; });
+        report(name, run(actor_count, messages, seed, pool, arena.get(), dtlb));
+    }
+    return 0;
+}
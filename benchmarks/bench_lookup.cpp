@@ -0,0 +1,110 @@
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <random>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+#include "flat_hash_map.h"
+#include "tool_util.h"
+
+/**
+ * bench_lookup - Actor注册表和处理函数表这类映射的查找开销
+ *
+ * 构造--entries个UUID长度的字符串键（以及同样数量的整数键），按随机顺序查找--lookups次，比较：
+ * std::unordered_map用std::string查找、用string_view查找（需要先构造临时的std::string），
+ * 以及FlatHashMap用string_view直接查找；整数键比较两种映射。输出每次查找的纳秒数。
+ *
+ * 用法：bench_lookup [--entries N] [--lookups N] [--seed N]
+ */
+
+namespace {
+    double seconds_since(std::chrono::steady_clock::time_point started) {
+        return std::chrono::duration<double>(std::chrono::steady_clock::now() - started).count();
+    }
+
+    // 对keys中按order的顺序逐个调用lookup，返回每次查找的纳秒数
+    template <typename Keys, typename Lookup>
+    double run(const Keys& keys, const std::vector<uint32_t>& order, Lookup lookup) {
+        uint64_t checksum = 0;
+        auto started = std::chrono::steady_clock::now();
+        for (uint32_t index : order) {
+            checksum += lookup(keys[index]);
+        }
+        double ns = seconds_since(started) * 1e9 / static_cast<double>(order.size());
+        if (checksum != order.size()) {
+            std::abort();
+        }
+        return ns;
+    }
+}
+
+int main(int argc, char* argv[]) {
+    auto options = tool_util::parse_options(argc, argv, {"help"});
+    if (options.has("help")) {
+        std::cerr << "usage: bench_lookup [--entries N] [--lookups N] [--seed N]" << std::endl;
+        return 0;
+    }
+    size_t entries = static_cast<size_t>(std::max<int64_t>(1, options.get_int("entries", 1000000)));
+    size_t lookups = static_cast<size_t>(std::max<int64_t>(1, options.get_int("lookups", 5000000)));
+    uint64_t seed = static_cast<uint64_t>(options.get_int("seed", 0));
+
+    std::mt19937_64 rng(seed);
+    std::vector<std::string> ids;
+    std::vector<uint64_t> serials;
+    ids.reserve(entries);
+    serials.reserve(entries);
+    const char* digits = "0123456789abcdef";
+    for (size_t i = 0; i < entries; ++i) {
+        std::string id(36, '-');
+        for (size_t j = 0; j < id.size(); ++j) {
+            if (j != 8 && j != 13 && j != 18 && j != 23) {
+                id[j] = digits[rng() & 15];
+            }
+        }
+        ids.push_back(std::move(id));
+        serials.push_back(rng());
+    }
+    std::vector<uint32_t> order(lookups);
+    for (auto& index : order) {
+        index = static_cast<uint32_t>(rng() % entries);
+    }
+    // 调用方手里通常只有string_view（解析出的帧、字符串字面量）
+    std::vector<std::string_view> views(ids.begin(), ids.end());
+
+    std::unordered_map<std::string, uint32_t> std_strings;
+    FlatHashMap<std::string, uint32_t, StringHash, std::equal_to<>> flat_strings;
+    std::unordered_map<uint64_t, uint32_t> std_integers;
+    FlatHashMap<uint64_t, uint32_t> flat_integers;
+    for (size_t i = 0; i < entries; ++i) {
+        std_strings.emplace(ids[i], 1);
+        flat_strings.try_emplace(ids[i], 1);
+        std_integers.emplace(serials[i], 1);
+        flat_integers.try_emplace(serials[i], 1);
+    }
+
+    std::cout << "entries " << entries << ", lookups " << lookups << "\n"
+              << std::left << std::setw(10) << "key" << std::setw(28) << "map" << std::right << std::setw(12)
+              << "ns/lookup" << "\n";
+    auto report = [](const char* key, const char* map, double ns) {
+        std::cout << std::fixed << std::setprecision(1) << std::left << std::setw(10) << key << std::setw(28) << map
+                  << std::right << std::setw(12) << ns << std::endl;
+    };
+
+    report("string", "unordered_map(string)",
+           run(ids, order, [&](const std::string& id) { return std_strings.find(id)->second; }));
+    report("string", "unordered_map(string_view)", run(views, order, [&](std::string_view id) {
+               return std_strings.find(std::string(id))->second;
+           }));
+    report("string", "flat(string_view)",
+           run(views, order, [&](std::string_view id) { return flat_strings.find(id)->second; }));
+    report("integer", "unordered_map",
+           run(serials, order, [&](uint64_t serial) { return std_integers.find(serial)->second; }));
+    report("integer", "flat", run(serials, order, [&](uint64_t serial) { return flat_integers.find(serial)->second; }));
+    return 0;
+}
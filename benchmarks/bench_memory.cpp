@@ -0,0 +1,153 @@
+#include <algorithm>
+#include <any>
+#include <chrono>
+#include <functional>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <memory_resource>
+#include <string>
+#include <vector>
+
+#include "actor.h"
+#include "event_loop.h"
+#include "logging.h"
+#include "message.h"
+#include "scratch_arena.h"
+#include "tool_util.h"
+
+/**
+ * bench_memory - 消息负载和邮箱使用不同std::pmr::memory_resource时的开销
+ *
+ * 1. payload：在调用线程上反复构造并销毁带4个负载项的消息，比较默认堆、
+ *    unsynchronized_pool_resource、每--reset条消息release()一次的monotonic_buffer_resource，
+ *    以及每条消息reset()一次的ScratchArena（处理函数中Actor::scratch_arena()的用法）；
+ * 2. actors：--pairs对Actor在--workers个worker上互相发送共--messages条消息，
+ *    比较默认堆和每个worker一个synchronized_pool_resource（EventLoop::set_memory_resources）。
+ * 输出每条消息的纳秒数。
+ *
+ * 用法：bench_memory [--messages N] [--workers N] [--pairs N] [--reset N]
+ */
+
+namespace {
+    // 来回传递计数的Actor，收到的计数为0时停止
+    class Bouncer : public Actor {
+    public:
+        Bouncer(const std::string& name, std::weak_ptr<EventLoop> event_loop) : Actor(name, event_loop) {
+            register_handler("ball", [this](const Message& msg) {
+                int64_t left = msg.get_payload_value<int64_t>("left");
+                if (left > 0) {
+                    send(peer_, Message("ball", id_, peer_,
+                                        {{"left", left - 1},
+                                         {"account", std::string("acct-1042")},
+                                         {"amount", 12.5},
+                                         {"note", std::string("transfer between accounts of one customer")}}));
+                }
+            });
+        }
+
+        void set_peer(const std::string& peer) { peer_ = peer; }
+
+    private:
+        std::string peer_;
+    };
+
+    double seconds_since(std::chrono::steady_clock::time_point started) {
+        return std::chrono::duration<double>(std::chrono::steady_clock::now() - started).count();
+    }
+
+    // 在resource上构造和销毁messages条消息，每reset条调用一次after_batch，返回每条消息的纳秒数
+    double run_payload(std::pmr::memory_resource* resource, size_t messages, size_t reset,
+                       const std::function<void()>& after_batch) {
+        const std::string note = "transfer between accounts of one customer";
+        auto started = std::chrono::steady_clock::now();
+        for (size_t i = 0; i < messages; ++i) {
+            Message::Payload payload(resource);
+            payload["left"] = static_cast<int64_t>(i);
+            payload["account"] = std::string("acct-1042");
+            payload["amount"] = 12.5;
+            payload["note"] = note;
+            Message message("ball", "bench", "sink", std::move(payload));
+            if (message.get_pmr_payload().size() != 4) {
+                std::abort();
+            }
+            if (after_batch && (i + 1) % reset == 0) {
+                after_batch();
+            }
+        }
+        return seconds_since(started) * 1e9 / static_cast<double>(messages);
+    }
+
+    double run_actors(size_t messages, size_t workers, size_t pairs, bool pooled) {
+        auto event_loop = std::make_shared<EventLoop>();
+        event_loop->set_worker_count(workers);
+        if (pooled) {
+            std::vector<std::shared_ptr<std::pmr::memory_resource>> resources;
+            for (size_t i = 0; i < workers; ++i) {
+                resources.push_back(std::make_shared<std::pmr::synchronized_pool_resource>());
+            }
+            event_loop->set_memory_resources(std::move(resources));
+        }
+
+        std::vector<std::shared_ptr<Bouncer>> actors;
+        for (size_t i = 0; i < pairs * 2; ++i) {
+            auto actor = std::make_shared<Bouncer>("bouncer-" + std::to_string(i), event_loop);
+            event_loop->register_actor(actor);
+            actors.push_back(actor);
+        }
+        for (size_t i = 0; i < pairs * 2; i += 2) {
+            actors[i]->set_peer(actors[i + 1]->get_id());
+            actors[i + 1]->set_peer(actors[i]->get_id());
+        }
+        event_loop->run_until_idle();
+
+        int64_t per_pair = static_cast<int64_t>(std::max<size_t>(1, messages / pairs));
+        auto started = std::chrono::steady_clock::now();
+        for (size_t i = 0; i < pairs * 2; i += 2) {
+            event_loop->deliver_message(Message("ball", "bench", actors[i]->get_id(), {{"left", per_pair - 1}}));
+        }
+        size_t processed = event_loop->run_until_idle();
+        return seconds_since(started) * 1e9 / static_cast<double>(std::max<size_t>(1, processed));
+    }
+}
+
+int main(int argc, char* argv[]) {
+    auto options = tool_util::parse_options(argc, argv, {"help"});
+    if (options.has("help")) {
+        std::cerr << "usage: bench_memory [--messages N] [--workers N] [--pairs N] [--reset N]" << std::endl;
+        return 0;
+    }
+    size_t messages = static_cast<size_t>(std::max<int64_t>(1, options.get_int("messages", 1000000)));
+    size_t workers = static_cast<size_t>(std::max<int64_t>(1, options.get_int("workers", 2)));
+    size_t pairs = static_cast<size_t>(std::max<int64_t>(1, options.get_int("pairs", 8)));
+    size_t reset = static_cast<size_t>(std::max<int64_t>(1, options.get_int("reset", 256)));
+
+    set_log_level(LogLevel::OFF);
+
+    std::cout << std::fixed << std::setprecision(1) << "messages " << messages << ", workers " << workers
+              << ", pairs " << pairs << "\n"
+              << std::left << std::setw(10) << "bench" << std::setw(14) << "resource" << std::right
+              << std::setw(10) << "ns/msg" << "\n";
+    auto report = [](const char* bench, const char* resource, double ns) {
+        std::cout << std::left << std::setw(10) << bench << std::setw(14) << resource << std::right << std::setw(10)
+                  << ns << std::endl;
+    };
+
+    report("payload", "heap", run_payload(std::pmr::new_delete_resource(), messages, reset, nullptr));
+    {
+        std::pmr::unsynchronized_pool_resource pool;
+        report("payload", "pool", run_payload(&pool, messages, reset, nullptr));
+    }
+    {
+        std::pmr::monotonic_buffer_resource arena(64 * 1024);
+        report("payload", "monotonic", run_payload(&arena, messages, reset, [&arena]() { arena.release(); }));
+    }
+    {
+        ScratchArena arena;
+        report("payload", "scratch", run_payload(&arena, messages, 1, [&arena]() { arena.reset(); }));
+    }
+
+    report("actors", "heap", run_actors(messages, workers, pairs, false));
+    report("actors", "worker-pool", run_actors(messages, workers, pairs, true));
+    return 0;
+}
@@ -0,0 +1,178 @@
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "histogram.h"
+#include "logging.h"
+#include "message.h"
+#include "remote.h"
+#include "tool_util.h"
+
+/**
+ * bench_remote - 回环地址上远程传输的批量发送和压缩：吞吐量与延迟的权衡
+ *
+ * 对每个批次窗口（--windows，微秒，逗号分隔）分别测量：
+ * 1. 吞吐量：尽快发送--messages条消息，输出每秒消息数、每次系统调用发出的消息数和线上字节数；
+ * 2. 延迟：以--rate条/秒的速率发送--latency-messages条消息，输出从send()到接收方端点回调的单程延迟。
+ * 加上--compress时每个窗口再测一遍开启压缩（compress_bytes为4096）的情况。
+ * 负载是--payload字节的JSON风格文本，每条消息相同，开启压缩时的线上字节数是压缩效果的上限。
+ *
+ * 用法：bench_remote [--messages N] [--latency-messages N] [--rate N] [--payload BYTES]
+ *                    [--windows 0,20,100,500] [--compress]
+ */
+
+namespace {
+    int64_t now_ns() {
+        return std::chrono::duration_cast<std::chrono::nanoseconds>(
+                   std::chrono::steady_clock::now().time_since_epoch())
+            .count();
+    }
+
+    std::vector<int64_t> parse_list(const std::string& text) {
+        std::vector<int64_t> values;
+        std::stringstream stream(text);
+        std::string item;
+        while (std::getline(stream, item, ',')) {
+            if (!item.empty()) {
+                values.push_back(std::strtoll(item.c_str(), nullptr, 10));
+            }
+        }
+        return values;
+    }
+
+    std::string make_payload(size_t bytes) {
+        std::string text;
+        for (int i = 0; text.size() < bytes; ++i) {
+            text += "{\"account\":\"acct-" + std::to_string(i % 97) + "\",\"op\":\"deposit\",\"amount\":" +
+                    std::to_string(i * 7) + "}";
+        }
+        text.resize(bytes);
+        return text;
+    }
+
+    struct Result {
+        double throughput = 0;
+        double messages_per_write = 0;
+        double wire_bytes_per_message = 0;
+        int64_t p50_ns = 0;
+        int64_t p99_ns = 0;
+        int64_t p999_ns = 0;
+    };
+
+    // 发送直到被接受（本地队列满时让出CPU等待I/O线程发送）
+    void send_all(RemoteTransport& sender, const std::string& node, const Message& message) {
+        while (!sender.send(node, message)) {
+            std::this_thread::yield();
+        }
+    }
+
+    Result run(const RemoteOptions& options, size_t messages, size_t latency_messages, double rate,
+               const std::string& payload) {
+        RemoteTransport receiver(std::weak_ptr<EventLoop>{});
+        std::atomic<size_t> received{0};
+        LatencyHistogram latency;
+        std::atomic<bool> measuring{false};
+        receiver.add_endpoint("sink", [&](const Message& message) {
+            if (measuring.load(std::memory_order_relaxed)) {
+                latency.record(now_ns() - message.get_payload_value<int64_t>("sent"));
+            }
+            received.fetch_add(1, std::memory_order_relaxed);
+        });
+        RemoteTransport sender(std::weak_ptr<EventLoop>{}, options);
+        const std::string& node = receiver.address();
+        auto wait_for = [&](size_t count) {
+            while (received.load(std::memory_order_relaxed) < count) {
+                std::this_thread::sleep_for(std::chrono::microseconds(50));
+            }
+        };
+
+        // 预热：建立连接
+        send_all(sender, node, Message("warmup", "bench", "sink", {{"sent", now_ns()}}));
+        wait_for(1);
+
+        Result result;
+        uint64_t writes_before = sender.write_calls();
+        uint64_t bytes_before = sender.bytes_sent();
+        auto started = std::chrono::steady_clock::now();
+        for (size_t i = 0; i < messages; ++i) {
+            send_all(sender, node, Message("data", "bench", "sink", {{"sent", now_ns()}, {"data", payload}}));
+        }
+        wait_for(1 + messages);
+        double elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - started).count();
+        result.throughput = static_cast<double>(messages) / elapsed;
+        uint64_t writes = std::max<uint64_t>(1, sender.write_calls() - writes_before);
+        result.messages_per_write = static_cast<double>(messages) / static_cast<double>(writes);
+        result.wire_bytes_per_message =
+            static_cast<double>(sender.bytes_sent() - bytes_before) / static_cast<double>(messages);
+
+        // 按固定速率发送，测量单程延迟
+        measuring = true;
+        size_t base = received.load();
+        auto interval = std::chrono::nanoseconds(static_cast<int64_t>(1e9 / rate));
+        auto next = std::chrono::steady_clock::now();
+        for (size_t i = 0; i < latency_messages; ++i) {
+            while (std::chrono::steady_clock::now() < next) {
+                std::this_thread::yield();
+            }
+            next += interval;
+            send_all(sender, node, Message("data", "bench", "sink", {{"sent", now_ns()}, {"data", payload}}));
+        }
+        wait_for(base + latency_messages);
+        result.p50_ns = latency.value_at_percentile(50);
+        result.p99_ns = latency.value_at_percentile(99);
+        result.p999_ns = latency.value_at_percentile(99.9);
+
+        sender.stop();
+        receiver.stop();
+        return result;
+    }
+}
+
+int main(int argc, char* argv[]) {
+    auto options = tool_util::parse_options(argc, argv, {"help", "compress"});
+    if (options.has("help")) {
+        std::cerr << "usage: bench_remote [--messages N] [--latency-messages N] [--rate N] [--payload BYTES]"
+                     " [--windows 0,20,100,500] [--compress]"
+                  << std::endl;
+        return 0;
+    }
+    size_t messages = static_cast<size_t>(std::max<int64_t>(1, options.get_int("messages", 200000)));
+    size_t latency_messages = static_cast<size_t>(std::max<int64_t>(1, options.get_int("latency-messages", 20000)));
+    double rate = std::max(1.0, options.get_double("rate", 50000));
+    std::string payload = make_payload(static_cast<size_t>(std::max<int64_t>(0, options.get_int("payload", 64))));
+    std::vector<int64_t> windows = parse_list(options.get("windows", "0,20,100,500"));
+
+    set_log_level(LogLevel::OFF);
+
+    std::cout << "messages " << messages << ", payload " << payload.size() << " bytes, latency at " << rate
+              << " msg/s\n"
+              << std::left << std::setw(10) << "window_us" << std::setw(10) << "compress" << std::right
+              << std::setw(14) << "msgs/s" << std::setw(12) << "msgs/write" << std::setw(12) << "wire_B/msg"
+              << std::setw(10) << "p50_us" << std::setw(10) << "p99_us" << std::setw(11) << "p99.9_us" << "\n";
+    for (int64_t window : windows) {
+        for (bool compress : {false, true}) {
+            if (compress && !options.has("compress")) {
+                continue;
+            }
+            RemoteOptions remote;
+            remote.batch_window = std::chrono::microseconds(std::max<int64_t>(0, window));
+            remote.compress_bytes = compress ? 4096 : 0;
+            Result result = run(remote, messages, latency_messages, rate, payload);
+            std::cout << std::fixed << std::setprecision(1) << std::left << std::setw(10) << window << std::setw(10)
+                      << (compress ? "lz4" : "off") << std::right << std::setw(14) << std::setprecision(0)
+                      << result.throughput << std::setw(12) << std::setprecision(1) << result.messages_per_write
+                      << std::setw(12) << result.wire_bytes_per_message << std::setw(10)
+                      << static_cast<double>(result.p50_ns) / 1e3 << std::setw(10)
+                      << static_cast<double>(result.p99_ns) / 1e3 << std::setw(11)
+                      << static_cast<double>(result.p999_ns) / 1e3 << std::endl;
+        }
+    }
+    return 0;
+}
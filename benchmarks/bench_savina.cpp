@@ -0,0 +1,847 @@
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <fstream>
+#include <functional>
+#include <iostream>
+#include <memory>
+#include <random>
+#include <sstream>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "actor.h"
+#include "event_loop.h"
+#include "logging.h"
+#include "message.h"
+#include "scheduler.h"
+#include "tool_util.h"
+
+/**
+ * bench_savina - Savina基准测试套件的actor-cpp实现
+ *
+ * 实现ping-pong、counting、fork-join throughput、thread ring、chameneos、big、
+ * concurrent dictionary和bank transaction八个基准，消息流程与Savina原版一致，
+ * 结果以JSON输出，便于和其他Actor运行时对比。
+ * 每次迭代使用新的EventLoop，计时从注入第一条消息开始，到事件循环空闲为止，不包含Actor创建。
+ *
+ * 用法：bench_savina [--bench a,b,...] [--scheduler NAME] [--workers N] [--iterations N]
+ *                    [--warmup N] [--scale X] [--seed N] [--output 文件]
+ */
+
+namespace {
+
+// 基准Actor的公共部分
+class BenchActor : public Actor {
+public:
+    BenchActor(const std::string& name, std::weak_ptr<EventLoop> event_loop)
+        : Actor(name, event_loop) {}
+
+protected:
+    void tell(const std::string& target, const std::string& type,
+              Message::Payload payload = {}) {
+        send(target, Message(type, id_, target, std::move(payload)));
+    }
+};
+
+struct BenchConfig {
+    std::string scheduler = "round-robin";
+    size_t workers = 1;
+    double scale = 1.0;
+    uint64_t seed = 0;
+
+    // 按比例缩放的消息数量，至少为1
+    int64_t scaled(int64_t value) const {
+        return std::max<int64_t>(1, static_cast<int64_t>(static_cast<double>(value) * scale));
+    }
+};
+
+// 一次迭代的结果
+struct IterationResult {
+    int64_t elapsed_ns = 0;
+    size_t messages = 0;
+    bool valid = true;
+};
+
+// 一个基准：参数描述和单次迭代的实现
+struct Benchmark {
+    std::string name;
+    std::function<std::map<std::string, int64_t>(const BenchConfig&)> params;
+    std::function<IterationResult(const BenchConfig&)> run;
+};
+
+std::shared_ptr<EventLoop> make_event_loop(const BenchConfig& config) {
+    auto event_loop = std::make_shared<EventLoop>();
+    event_loop->set_worker_count(config.workers);
+    event_loop->set_scheduler(create_scheduler(config.scheduler, config.seed));
+    return event_loop;
+}
+
+// 启动已注册的Actor，注入初始消息并运行到空闲，返回计时结果
+IterationResult measure(const std::shared_ptr<EventLoop>& event_loop, const std::function<void()>& seed) {
+    event_loop->run_until_idle();
+
+    IterationResult result;
+    auto start = std::chrono::steady_clock::now();
+    seed();
+    result.messages = event_loop->run_until_idle();
+    result.elapsed_ns = std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now() - start).count();
+    return result;
+}
+
+// ---------------------------------------------------------------- ping-pong
+
+class PongActor : public BenchActor {
+public:
+    PongActor(const std::string& name, std::weak_ptr<EventLoop> event_loop)
+        : BenchActor(name, event_loop) {
+        register_handler("ping", [this](const Message& msg) {
+            tell(msg.get_sender_id(), "pong");
+        });
+    }
+};
+
+class PingActor : public BenchActor {
+public:
+    PingActor(const std::string& name, std::weak_ptr<EventLoop> event_loop, int64_t pings)
+        : BenchActor(name, event_loop), remaining_(pings) {
+        register_handler("start", [this](const Message&) {
+            tell(pong_, "ping");
+            --remaining_;
+        });
+        register_handler("pong", [this](const Message&) {
+            ++received_;
+            if (remaining_ > 0) {
+                tell(pong_, "ping");
+                --remaining_;
+            }
+        });
+    }
+
+    void set_pong(const std::string& pong) { pong_ = pong; }
+    int64_t received() const { return received_; }
+
+private:
+    std::string pong_;
+    int64_t remaining_;
+    int64_t received_ = 0;
+};
+
+IterationResult run_ping_pong(const BenchConfig& config) {
+    int64_t pings = config.scaled(40000);
+    auto event_loop = make_event_loop(config);
+    auto ping = std::make_shared<PingActor>("ping", event_loop, pings);
+    auto pong = std::make_shared<PongActor>("pong", event_loop);
+    ping->set_pong(pong->get_id());
+    event_loop->register_actor(ping);
+    event_loop->register_actor(pong);
+
+    auto result = measure(event_loop, [&]() {
+        event_loop->deliver_message(Message("start", "bench", ping->get_id()));
+    });
+    result.valid = ping->received() == pings;
+    return result;
+}
+
+// ---------------------------------------------------------------- counting
+
+class CountingActor : public BenchActor {
+public:
+    CountingActor(const std::string& name, std::weak_ptr<EventLoop> event_loop)
+        : BenchActor(name, event_loop) {
+        register_handler("increment", [this](const Message&) {
+            ++count_;
+        });
+        register_handler("retrieve", [this](const Message& msg) {
+            Message::Payload payload;
+            payload["count"] = count_;
+            tell(msg.get_sender_id(), "result", payload);
+        });
+    }
+
+private:
+    int64_t count_ = 0;
+};
+
+class ProducerActor : public BenchActor {
+public:
+    ProducerActor(const std::string& name, std::weak_ptr<EventLoop> event_loop, int64_t count)
+        : BenchActor(name, event_loop), count_(count) {
+        register_handler("start", [this](const Message&) {
+            for (int64_t i = 0; i < count_; ++i) {
+                tell(counter_, "increment");
+            }
+            tell(counter_, "retrieve");
+        });
+        register_handler("result", [this](const Message& msg) {
+            result_ = msg.get_payload_value<int64_t>("count");
+        });
+    }
+
+    void set_counter(const std::string& counter) { counter_ = counter; }
+    int64_t result() const { return result_; }
+
+private:
+    std::string counter_;
+    int64_t count_;
+    int64_t result_ = -1;
+};
+
+IterationResult run_counting(const BenchConfig& config) {
+    int64_t count = config.scaled(100000);
+    auto event_loop = make_event_loop(config);
+    auto producer = std::make_shared<ProducerActor>("producer", event_loop, count);
+    auto counter = std::make_shared<CountingActor>("counter", event_loop);
+    producer->set_counter(counter->get_id());
+    event_loop->register_actor(producer);
+    event_loop->register_actor(counter);
+
+    auto result = measure(event_loop, [&]() {
+        event_loop->deliver_message(Message("start", "bench", producer->get_id()));
+    });
+    result.valid = producer->result() == count;
+    return result;
+}
+
+// ---------------------------------------------------------------- fork-join throughput
+
+class ThroughputActor : public BenchActor {
+public:
+    ThroughputActor(const std::string& name, std::weak_ptr<EventLoop> event_loop)
+        : BenchActor(name, event_loop) {
+        register_handler("work", [this](const Message&) {
+            // Savina中每条消息做一次少量浮点计算
+            double value = std::sin(37.2 + static_cast<double>(processed_));
+            sink_ += value * value;
+            ++processed_;
+        });
+    }
+
+    int64_t processed() const { return processed_; }
+
+private:
+    int64_t processed_ = 0;
+    double sink_ = 0;
+};
+
+IterationResult run_fork_join_throughput(const BenchConfig& config) {
+    const size_t actor_count = 16;
+    int64_t per_actor = config.scaled(5000);
+    auto event_loop = make_event_loop(config);
+    std::vector<std::shared_ptr<ThroughputActor>> actors;
+    for (size_t i = 0; i < actor_count; ++i) {
+        actors.push_back(std::make_shared<ThroughputActor>("throughput" + std::to_string(i), event_loop));
+        event_loop->register_actor(actors.back());
+    }
+
+    auto result = measure(event_loop, [&]() {
+        for (int64_t m = 0; m < per_actor; ++m) {
+            for (const auto& actor : actors) {
+                event_loop->deliver_message(Message("work", "bench", actor->get_id()));
+            }
+        }
+    });
+    for (const auto& actor : actors) {
+        result.valid = result.valid && actor->processed() == per_actor;
+    }
+    return result;
+}
+
+// ---------------------------------------------------------------- thread ring
+
+class RingNodeActor : public BenchActor {
+public:
+    RingNodeActor(const std::string& name, std::weak_ptr<EventLoop> event_loop, int64_t& finished_hops)
+        : BenchActor(name, event_loop), finished_hops_(finished_hops) {
+        register_handler("token", [this](const Message& msg) {
+            auto hops = msg.get_payload_value<int64_t>("hops");
+            if (hops == 0) {
+                finished_hops_ = hops;
+                return;
+            }
+            Message::Payload payload;
+            payload["hops"] = hops - 1;
+            tell(next_, "token", payload);
+        });
+    }
+
+    void set_next(const std::string& next) { next_ = next; }
+
+private:
+    std::string next_;
+    int64_t& finished_hops_;
+};
+
+IterationResult run_thread_ring(const BenchConfig& config) {
+    const size_t ring_size = 100;
+    int64_t hops = config.scaled(100000);
+    int64_t finished_hops = -1;
+    auto event_loop = make_event_loop(config);
+    std::vector<std::shared_ptr<RingNodeActor>> ring;
+    for (size_t i = 0; i < ring_size; ++i) {
+        ring.push_back(std::make_shared<RingNodeActor>("ring" + std::to_string(i), event_loop, finished_hops));
+    }
+    for (size_t i = 0; i < ring_size; ++i) {
+        ring[i]->set_next(ring[(i + 1) % ring_size]->get_id());
+        event_loop->register_actor(ring[i]);
+    }
+
+    auto result = measure(event_loop, [&]() {
+        Message::Payload payload;
+        payload["hops"] = hops;
+        event_loop->deliver_message(Message("token", "bench", ring.front()->get_id(), payload));
+    });
+    result.valid = finished_hops == 0 && static_cast<int64_t>(result.messages) == hops + 1;
+    return result;
+}
+
+// ---------------------------------------------------------------- chameneos
+
+enum Color { BLUE = 0, RED = 1, YELLOW = 2 };
+
+int complement(int a, int b) {
+    if (a == b) {
+        return a;
+    }
+    return 3 - a - b;
+}
+
+class MallActor : public BenchActor {
+public:
+    MallActor(const std::string& name, std::weak_ptr<EventLoop> event_loop, int64_t meetings)
+        : BenchActor(name, event_loop), remaining_(meetings) {
+        register_handler("meet", [this](const Message& msg) {
+            if (remaining_ == 0) {
+                tell(msg.get_sender_id(), "exit");
+                return;
+            }
+            if (waiting_.empty()) {
+                waiting_ = msg.get_sender_id();
+                waiting_color_ = msg.get_payload_value<int>("color");
+                return;
+            }
+
+            // 两只变色龙相遇，互相告知对方的颜色
+            Message::Payload to_first;
+            to_first["color"] = msg.get_payload_value<int>("color");
+            Message::Payload to_second;
+            to_second["color"] = waiting_color_;
+            tell(waiting_, "mate", to_first);
+            tell(msg.get_sender_id(), "mate", to_second);
+            waiting_.clear();
+            --remaining_;
+            ++meetings_;
+        });
+    }
+
+    int64_t meetings() const { return meetings_; }
+
+private:
+    int64_t remaining_;
+    int64_t meetings_ = 0;
+    std::string waiting_;
+    int waiting_color_ = BLUE;
+};
+
+class ChameneoActor : public BenchActor {
+public:
+    ChameneoActor(const std::string& name, std::weak_ptr<EventLoop> event_loop, int color)
+        : BenchActor(name, event_loop), color_(color) {
+        register_handler("start", [this](const Message&) {
+            request_meeting();
+        });
+        register_handler("mate", [this](const Message& msg) {
+            color_ = complement(color_, msg.get_payload_value<int>("color"));
+            ++meetings_;
+            request_meeting();
+        });
+        register_handler("exit", [](const Message&) {});
+    }
+
+    void set_mall(const std::string& mall) { mall_ = mall; }
+    int64_t meetings() const { return meetings_; }
+
+private:
+    void request_meeting() {
+        Message::Payload payload;
+        payload["color"] = color_;
+        tell(mall_, "meet", payload);
+    }
+
+    std::string mall_;
+    int color_;
+    int64_t meetings_ = 0;
+};
+
+IterationResult run_chameneos(const BenchConfig& config) {
+    const size_t chameneo_count = 20;
+    int64_t meetings = config.scaled(20000);
+    auto event_loop = make_event_loop(config);
+    auto mall = std::make_shared<MallActor>("mall", event_loop, meetings);
+    event_loop->register_actor(mall);
+    std::vector<std::shared_ptr<ChameneoActor>> chameneos;
+    for (size_t i = 0; i < chameneo_count; ++i) {
+        chameneos.push_back(std::make_shared<ChameneoActor>("chameneo" + std::to_string(i), event_loop,
+                                                            static_cast<int>(i % 3)));
+        chameneos.back()->set_mall(mall->get_id());
+        event_loop->register_actor(chameneos.back());
+    }
+
+    auto result = measure(event_loop, [&]() {
+        for (const auto& chameneo : chameneos) {
+            event_loop->deliver_message(Message("start", "bench", chameneo->get_id()));
+        }
+    });
+
+    // 相遇次数用完后最多剩下一只变色龙在商场等待，不影响计数
+    int64_t total = 0;
+    for (const auto& chameneo : chameneos) {
+        total += chameneo->meetings();
+    }
+    result.valid = mall->meetings() == meetings && total == 2 * meetings;
+    return result;
+}
+
+// ---------------------------------------------------------------- big
+
+class BigActor : public BenchActor {
+public:
+    BigActor(const std::string& name, std::weak_ptr<EventLoop> event_loop, int64_t pings, uint64_t seed)
+        : BenchActor(name, event_loop), remaining_(pings), rng_(seed) {
+        register_handler("start", [this](const Message&) {
+            send_ping();
+        });
+        register_handler("ping", [this](const Message& msg) {
+            tell(msg.get_sender_id(), "pong");
+        });
+        register_handler("pong", [this](const Message&) {
+            if (remaining_ > 0) {
+                send_ping();
+            } else {
+                tell(sink_, "done");
+            }
+        });
+    }
+
+    void set_neighbors(std::vector<std::string> neighbors, const std::string& sink) {
+        neighbors_ = std::move(neighbors);
+        sink_ = sink;
+    }
+
+private:
+    void send_ping() {
+        --remaining_;
+        tell(neighbors_[rng_() % neighbors_.size()], "ping");
+    }
+
+    int64_t remaining_;
+    std::mt19937_64 rng_;
+    std::vector<std::string> neighbors_;
+    std::string sink_;
+};
+
+class SinkActor : public BenchActor {
+public:
+    SinkActor(const std::string& name, std::weak_ptr<EventLoop> event_loop)
+        : BenchActor(name, event_loop) {
+        register_handler("done", [this](const Message&) {
+            ++done_;
+        });
+    }
+
+    int64_t done() const { return done_; }
+
+private:
+    int64_t done_ = 0;
+};
+
+IterationResult run_big(const BenchConfig& config) {
+    const size_t actor_count = 32;
+    int64_t pings = config.scaled(2000);
+    auto event_loop = make_event_loop(config);
+    auto sink = std::make_shared<SinkActor>("sink", event_loop);
+    event_loop->register_actor(sink);
+
+    std::vector<std::shared_ptr<BigActor>> actors;
+    std::vector<std::string> ids;
+    for (size_t i = 0; i < actor_count; ++i) {
+        actors.push_back(std::make_shared<BigActor>("big" + std::to_string(i), event_loop, pings, config.seed + i));
+        ids.push_back(actors.back()->get_id());
+    }
+    for (const auto& actor : actors) {
+        actor->set_neighbors(ids, sink->get_id());
+        event_loop->register_actor(actor);
+    }
+
+    auto result = measure(event_loop, [&]() {
+        for (const auto& actor : actors) {
+            event_loop->deliver_message(Message("start", "bench", actor->get_id()));
+        }
+    });
+    result.valid = sink->done() == static_cast<int64_t>(actor_count);
+    return result;
+}
+
+// ---------------------------------------------------------------- concurrent dictionary
+
+class DictionaryActor : public BenchActor {
+public:
+    DictionaryActor(const std::string& name, std::weak_ptr<EventLoop> event_loop)
+        : BenchActor(name, event_loop) {
+        register_handler("write", [this](const Message& msg) {
+            auto key = msg.get_payload_value<int64_t>("key");
+            data_[key] = msg.get_payload_value<int64_t>("value");
+            reply(msg, key);
+        });
+        register_handler("read", [this](const Message& msg) {
+            reply(msg, msg.get_payload_value<int64_t>("key"));
+        });
+    }
+
+private:
+    void reply(const Message& msg, int64_t key) {
+        Message::Payload payload;
+        auto it = data_.find(key);
+        payload["value"] = it != data_.end() ? it->second : int64_t(-1);
+        tell(msg.get_sender_id(), "reply", payload);
+    }
+
+    std::unordered_map<int64_t, int64_t> data_;
+};
+
+class DictionaryWorker : public BenchActor {
+public:
+    DictionaryWorker(const std::string& name, std::weak_ptr<EventLoop> event_loop, int64_t requests,
+                     int write_percent, uint64_t seed)
+        : BenchActor(name, event_loop), remaining_(requests), write_percent_(write_percent), rng_(seed) {
+        register_handler("start", [this](const Message&) {
+            next_request();
+        });
+        register_handler("reply", [this](const Message&) {
+            ++replies_;
+            next_request();
+        });
+    }
+
+    void set_dictionary(const std::string& dictionary) { dictionary_ = dictionary; }
+    int64_t replies() const { return replies_; }
+
+private:
+    void next_request() {
+        if (remaining_ == 0) {
+            return;
+        }
+        --remaining_;
+
+        Message::Payload payload;
+        payload["key"] = static_cast<int64_t>(rng_() % 4096);
+        if (static_cast<int>(rng_() % 100) < write_percent_) {
+            payload["value"] = static_cast<int64_t>(rng_() % 1000000);
+            tell(dictionary_, "write", payload);
+        } else {
+            tell(dictionary_, "read", payload);
+        }
+    }
+
+    int64_t remaining_;
+    int write_percent_;
+    std::mt19937_64 rng_;
+    std::string dictionary_;
+    int64_t replies_ = 0;
+};
+
+IterationResult run_concurrent_dictionary(const BenchConfig& config) {
+    const size_t worker_count = 16;
+    const int write_percent = 10;
+    int64_t requests = config.scaled(2000);
+    auto event_loop = make_event_loop(config);
+    auto dictionary = std::make_shared<DictionaryActor>("dictionary", event_loop);
+    event_loop->register_actor(dictionary);
+    std::vector<std::shared_ptr<DictionaryWorker>> workers;
+    for (size_t i = 0; i < worker_count; ++i) {
+        workers.push_back(std::make_shared<DictionaryWorker>("dictworker" + std::to_string(i), event_loop,
+                                                             requests, write_percent, config.seed + i));
+        workers.back()->set_dictionary(dictionary->get_id());
+        event_loop->register_actor(workers.back());
+    }
+
+    auto result = measure(event_loop, [&]() {
+        for (const auto& worker : workers) {
+            event_loop->deliver_message(Message("start", "bench", worker->get_id()));
+        }
+    });
+    for (const auto& worker : workers) {
+        result.valid = result.valid && worker->replies() == requests;
+    }
+    return result;
+}
+
+// ---------------------------------------------------------------- bank transaction
+
+class AccountActor : public BenchActor {
+public:
+    AccountActor(const std::string& name, std::weak_ptr<EventLoop> event_loop, int64_t balance)
+        : BenchActor(name, event_loop), balance_(balance) {
+        // 作为转出方：扣款后通知转入方
+        register_handler("debit", [this](const Message& msg) {
+            auto amount = msg.get_payload_value<int64_t>("amount");
+            balance_ -= amount;
+            Message::Payload payload;
+            payload["amount"] = amount;
+            payload["teller"] = msg.get_sender_id();
+            tell(msg.get_payload_value<std::string>("destination"), "credit", payload);
+        });
+        // 作为转入方：入账后回复柜员
+        register_handler("credit", [this](const Message& msg) {
+            balance_ += msg.get_payload_value<int64_t>("amount");
+            tell(msg.get_payload_value<std::string>("teller"), "reply");
+        });
+    }
+
+    int64_t balance() const { return balance_; }
+
+private:
+    int64_t balance_;
+};
+
+class TellerActor : public BenchActor {
+public:
+    TellerActor(const std::string& name, std::weak_ptr<EventLoop> event_loop, int64_t transactions, uint64_t seed)
+        : BenchActor(name, event_loop), transactions_(transactions), rng_(seed) {
+        register_handler("start", [this](const Message&) {
+            for (int64_t i = 0; i < transactions_; ++i) {
+                size_t source = rng_() % accounts_.size();
+                size_t destination = rng_() % accounts_.size();
+                if (destination == source) {
+                    destination = (destination + 1) % accounts_.size();
+                }
+                Message::Payload payload;
+                payload["amount"] = static_cast<int64_t>(rng_() % 1000);
+                payload["destination"] = accounts_[destination];
+                tell(accounts_[source], "debit", payload);
+            }
+        });
+        register_handler("reply", [this](const Message&) {
+            ++completed_;
+        });
+    }
+
+    void set_accounts(std::vector<std::string> accounts) { accounts_ = std::move(accounts); }
+    int64_t completed() const { return completed_; }
+
+private:
+    int64_t transactions_;
+    std::mt19937_64 rng_;
+    std::vector<std::string> accounts_;
+    int64_t completed_ = 0;
+};
+
+IterationResult run_bank_transaction(const BenchConfig& config) {
+    const size_t account_count = 100;
+    const int64_t initial_balance = 1000000;
+    int64_t transactions = config.scaled(20000);
+    auto event_loop = make_event_loop(config);
+    auto teller = std::make_shared<TellerActor>("teller", event_loop, transactions, config.seed);
+    event_loop->register_actor(teller);
+    std::vector<std::shared_ptr<AccountActor>> accounts;
+    std::vector<std::string> ids;
+    for (size_t i = 0; i < account_count; ++i) {
+        accounts.push_back(std::make_shared<AccountActor>("account" + std::to_string(i), event_loop, initial_balance));
+        ids.push_back(accounts.back()->get_id());
+        event_loop->register_actor(accounts.back());
+    }
+    teller->set_accounts(ids);
+
+    auto result = measure(event_loop, [&]() {
+        event_loop->deliver_message(Message("start", "bench", teller->get_id()));
+    });
+
+    // 转账不改变总余额
+    int64_t total = 0;
+    for (const auto& account : accounts) {
+        total += account->balance();
+    }
+    result.valid = teller->completed() == transactions &&
+                   total == initial_balance * static_cast<int64_t>(account_count);
+    return result;
+}
+
+// ---------------------------------------------------------------- 驱动
+
+std::vector<Benchmark> all_benchmarks() {
+    return {
+        {"ping-pong", [](const BenchConfig& c) { return std::map<std::string, int64_t>{{"pings", c.scaled(40000)}}; },
+         run_ping_pong},
+        {"counting", [](const BenchConfig& c) { return std::map<std::string, int64_t>{{"messages", c.scaled(100000)}}; },
+         run_counting},
+        {"fork-join-throughput",
+         [](const BenchConfig& c) {
+             return std::map<std::string, int64_t>{{"actors", 16}, {"messages_per_actor", c.scaled(5000)}};
+         },
+         run_fork_join_throughput},
+        {"thread-ring",
+         [](const BenchConfig& c) { return std::map<std::string, int64_t>{{"actors", 100}, {"hops", c.scaled(100000)}}; },
+         run_thread_ring},
+        {"chameneos",
+         [](const BenchConfig& c) {
+             return std::map<std::string, int64_t>{{"chameneos", 20}, {"meetings", c.scaled(20000)}};
+         },
+         run_chameneos},
+        {"big",
+         [](const BenchConfig& c) { return std::map<std::string, int64_t>{{"actors", 32}, {"pings", c.scaled(2000)}}; },
+         run_big},
+        {"concurrent-dictionary",
+         [](const BenchConfig& c) {
+             return std::map<std::string, int64_t>{
+                 {"workers", 16}, {"requests_per_worker", c.scaled(2000)}, {"write_percent", 10}};
+         },
+         run_concurrent_dictionary},
+        {"bank-transaction",
+         [](const BenchConfig& c) {
+             return std::map<std::string, int64_t>{{"accounts", 100}, {"transactions", c.scaled(20000)}};
+         },
+         run_bank_transaction},
+    };
+}
+
+std::vector<std::string> split(const std::string& text, char separator) {
+    std::vector<std::string> parts;
+    std::stringstream stream(text);
+    std::string part;
+    while (std::getline(stream, part, separator)) {
+        if (!part.empty()) {
+            parts.push_back(part);
+        }
+    }
+    return parts;
+}
+
+void print_usage() {
+    std::cerr << "usage: bench_savina [--bench a,b,...] [--scheduler NAME] [--workers N] [--iterations N]\n"
+                 "                    [--warmup N] [--scale X] [--seed N] [--output FILE] [--list]"
+              << std::endl;
+}
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+    auto options = tool_util::parse_options(argc, argv, {"list", "help"});
+    if (options.has("help") || !options.positional.empty()) {
+        print_usage();
+        return options.has("help") ? 0 : 1;
+    }
+
+    auto benchmarks = all_benchmarks();
+    if (options.has("list")) {
+        for (const auto& benchmark : benchmarks) {
+            std::cout << benchmark.name << "\n";
+        }
+        return 0;
+    }
+
+    BenchConfig config;
+    config.scheduler = options.get("scheduler", config.scheduler);
+    config.workers = static_cast<size_t>(std::max<int64_t>(1, options.get_int("workers", 1)));
+    config.scale = options.get_double("scale", 1.0);
+    config.seed = static_cast<uint64_t>(options.get_int("seed", 0));
+    int64_t iterations = std::max<int64_t>(1, options.get_int("iterations", 3));
+    int64_t warmup = std::max<int64_t>(0, options.get_int("warmup", 1));
+
+    if (!create_scheduler(config.scheduler)) {
+        std::cerr << "Unknown scheduler: " << config.scheduler << std::endl;
+        return 1;
+    }
+
+    std::vector<Benchmark> selected;
+    if (options.has("bench")) {
+        for (const auto& name : split(options.get("bench", ""), ',')) {
+            auto it = std::find_if(benchmarks.begin(), benchmarks.end(),
+                                   [&name](const Benchmark& b) { return b.name == name; });
+            if (it == benchmarks.end()) {
+                std::cerr << "Unknown benchmark: " << name << std::endl;
+                return 1;
+            }
+            selected.push_back(*it);
+        }
+    } else {
+        selected = benchmarks;
+    }
+
+    set_log_level(LogLevel::WARN);
+
+    std::ostringstream json;
+    json << "{\n"
+         << "  \"suite\": \"savina\",\n"
+         << "  \"runtime\": \"actor-cpp\",\n"
+         << "  \"scheduler\": \"" << config.scheduler << "\",\n"
+         << "  \"workers\": " << config.workers << ",\n"
+         << "  \"scale\": " << config.scale << ",\n"
+         << "  \"iterations\": " << iterations << ",\n"
+         << "  \"warmup\": " << warmup << ",\n"
+         << "  \"results\": [";
+
+    bool all_valid = true;
+    for (size_t b = 0; b < selected.size(); ++b) {
+        const auto& benchmark = selected[b];
+        for (int64_t i = 0; i < warmup; ++i) {
+            benchmark.run(config);
+        }
+
+        std::vector<int64_t> times;
+        size_t messages = 0;
+        bool valid = true;
+        for (int64_t i = 0; i < iterations; ++i) {
+            auto result = benchmark.run(config);
+            times.push_back(result.elapsed_ns);
+            messages = result.messages;
+            valid = valid && result.valid;
+        }
+        std::sort(times.begin(), times.end());
+        all_valid = all_valid && valid;
+
+        double mean = 0;
+        for (int64_t t : times) {
+            mean += static_cast<double>(t);
+        }
+        mean /= static_cast<double>(times.size());
+        int64_t median = tool_util::percentile(times, 0.5);
+        double throughput = median > 0 ? static_cast<double>(messages) * 1e9 / static_cast<double>(median) : 0;
+
+        std::cerr << benchmark.name << ": " << median / 1000000.0 << " ms median, "
+                  << static_cast<int64_t>(throughput) << " msg/s" << (valid ? "" : " (INVALID)") << std::endl;
+
+        json << (b == 0 ? "\n" : ",\n")
+             << "    {\n"
+             << "      \"name\": \"" << benchmark.name << "\",\n"
+             << "      \"params\": {";
+        auto params = benchmark.params(config);
+        size_t p = 0;
+        for (const auto& [key, value] : params) {
+            json << (p++ == 0 ? "" : ", ") << "\"" << key << "\": " << value;
+        }
+        json << "},\n"
+             << "      \"messages\": " << messages << ",\n"
+             << "      \"valid\": " << (valid ? "true" : "false") << ",\n"
+             << "      \"min_ms\": " << times.front() / 1e6 << ",\n"
+             << "      \"median_ms\": " << median / 1e6 << ",\n"
+             << "      \"mean_ms\": " << mean / 1e6 << ",\n"
+             << "      \"max_ms\": " << times.back() / 1e6 << ",\n"
+             << "      \"throughput_msgs_per_sec\": " << static_cast<int64_t>(throughput) << "\n"
+             << "    }";
+    }
+    json << "\n  ]\n}\n";
+
+    if (options.has("output")) {
+        std::ofstream out(options.get("output", ""));
+        if (!out) {
+            std::cerr << "Cannot open output file: " << options.get("output", "") << std::endl;
+            return 1;
+        }
+        out << json.str();
+    } else {
+        std::cout << json.str();
+    }
+    return all_valid ? 0 : 2;
+}
@@ -0,0 +1,96 @@
+#include <algorithm>
+#include <chrono>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <random>
+#include <vector>
+
+#include "actor.h"
+#include "event_loop.h"
+#include "huge_pages.h"
+#include "introspection.h"
+#include "logging.h"
+#include "message.h"
+#include "tool_util.h"
+
+/**
+ * bench_snapshot - 测量EventLoop::snapshot在大量Actor下的耗时
+ *
+ * 注册--actors个Actor（不运行事件循环，直接启动），随机挑选--backlogged个Actor放入若干条消息，
+ * 然后重复拍摄快照并取前--top个，输出每次拍摄耗时的最小值、中位数和最大值。
+ * --huge-pages transparent|explicit让统计槽位的块从大页分配（ActorStatsTable::set_huge_pages）。
+ *
+ * 用法：bench_snapshot [--actors N] [--backlogged N] [--top N] [--iterations N] [--seed N]
+ *                      [--huge-pages off|transparent|explicit]
+ */
+
+int main(int argc, char* argv[]) {
+    auto options = tool_util::parse_options(argc, argv, {"help"});
+    if (options.has("help")) {
+        std::cerr << "usage: bench_snapshot [--actors N] [--backlogged N] [--top N] [--iterations N] [--seed N]"
+                     " [--huge-pages off|transparent|explicit]"
+                  << std::endl;
+        return 0;
+    }
+    size_t actor_count = static_cast<size_t>(std::max<int64_t>(1, options.get_int("actors", 1000000)));
+    size_t backlogged = static_cast<size_t>(std::max<int64_t>(0, options.get_int("backlogged", 1000)));
+    size_t top = static_cast<size_t>(std::max<int64_t>(0, options.get_int("top", 20)));
+    int64_t iterations = std::max<int64_t>(1, options.get_int("iterations", 10));
+    std::mt19937_64 rng(static_cast<uint64_t>(options.get_int("seed", 0)));
+
+    std::string huge_pages = options.get("huge-pages", "off");
+    if (huge_pages == "transparent") {
+        ActorStatsTable::set_huge_pages(HugePageMode::TRANSPARENT);
+    } else if (huge_pages == "explicit") {
+        ActorStatsTable::set_huge_pages(HugePageMode::EXPLICIT);
+    } else if (huge_pages != "off") {
+        std::cerr << "unknown --huge-pages mode: " << huge_pages << std::endl;
+        return 1;
+    }
+
+    set_log_level(LogLevel::OFF);
+
+    auto event_loop = std::make_shared<EventLoop>();
+    std::vector<std::shared_ptr<Actor>> actors;
+    actors.reserve(actor_count);
+    auto build_started = std::chrono::steady_clock::now();
+    for (size_t i = 0; i < actor_count; ++i) {
+        auto actor = std::make_shared<Actor>("actor" + std::to_string(i), event_loop);
+        event_loop->register_actor(actor);
+        actor->initialize();
+        actor->start();
+        actors.push_back(std::move(actor));
+    }
+    for (size_t i = 0; i < backlogged; ++i) {
+        auto& actor = actors[rng() % actors.size()];
+        size_t messages = 1 + rng() % 64;
+        for (size_t m = 0; m < messages; ++m) {
+            auto priority = static_cast<Message::Priority>(rng() % 4);
+            actor->receive(Message("work", "bench", actor->get_id(), {}, priority));
+        }
+    }
+    double build_s = std::chrono::duration<double>(std::chrono::steady_clock::now() - build_started).count();
+
+    std::vector<int64_t> samples;
+    uint64_t backlog = 0;
+    for (int64_t i = 0; i < iterations; ++i) {
+        SystemSnapshot snapshot = event_loop->snapshot(top, SnapshotOrder::BACKLOG);
+        samples.push_back(snapshot.scan_ns);
+        backlog = snapshot.total_backlog;
+    }
+    std::sort(samples.begin(), samples.end());
+
+    std::cout << std::fixed << std::setprecision(2)
+              << "actors " << actor_count << " (built in " << build_s << " s), backlog " << backlog << ", top "
+              << top << "\n"
+              << "snapshot ms: min " << static_cast<double>(samples.front()) / 1e6
+              << ", median " << static_cast<double>(tool_util::percentile(samples, 0.5)) / 1e6
+              << ", max " << static_cast<double>(samples.back()) / 1e6 << std::endl;
+
+    // 邮箱中的消息计入在途消息，析构前先丢弃
+    for (auto& actor : actors) {
+        actor->discard_messages();
+    }
+    return 0;
+}
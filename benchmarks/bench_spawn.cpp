@@ -0,0 +1,135 @@
+#include <algorithm>
+#include <chrono>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "actor.h"
+#include "event_loop.h"
+#include "logging.h"
+#include "message.h"
+#include "tool_util.h"
+
+/**
+ * bench_spawn - 创建Actor的开销
+ *
+ * 1. construct：--threads个线程并发构造共--actors个Actor（ID生成、统计槽位、邮箱），构造后立即销毁；
+ * 2. register：单线程构造--actors个Actor并注册到事件循环，最后一起移除；
+ * 3. start / first：注册--actors个Actor后，start为第一次运行事件循环（启动）的耗时，first为之后向其中
+ *    均匀分布的--active个各投递一条消息并运行到静默的耗时；比较启动时初始化全部Actor（eager）和
+ *    延迟到第一条消息时才启动（lazy，EventLoop::set_lazy_start）。
+ * 输出每个注册的Actor的纳秒数。
+ *
+ * 用法：bench_spawn [--actors N] [--threads N] [--active N]
+ */
+
+namespace {
+    class Idle : public Actor {
+    public:
+        Idle(const std::string& name, std::weak_ptr<EventLoop> event_loop) : Actor(name, event_loop) {
+            register_handler("ping", [](const Message&) {});
+        }
+    };
+
+    double seconds_since(std::chrono::steady_clock::time_point started) {
+        return std::chrono::duration<double>(std::chrono::steady_clock::now() - started).count();
+    }
+
+    double run_construct(size_t actors, size_t threads) {
+        auto event_loop = std::make_shared<EventLoop>();
+        size_t per_thread = std::max<size_t>(1, actors / threads);
+        std::vector<std::thread> workers;
+        auto started = std::chrono::steady_clock::now();
+        for (size_t t = 0; t < threads; ++t) {
+            workers.emplace_back([&event_loop, per_thread]() {
+                for (size_t i = 0; i < per_thread; ++i) {
+                    Idle actor("idle", event_loop);
+                }
+            });
+        }
+        for (auto& worker : workers) {
+            worker.join();
+        }
+        return seconds_since(started) * 1e9 / static_cast<double>(per_thread * threads);
+    }
+
+    double run_register(size_t actors) {
+        auto event_loop = std::make_shared<EventLoop>();
+        std::vector<std::string> ids;
+        ids.reserve(actors);
+        auto started = std::chrono::steady_clock::now();
+        for (size_t i = 0; i < actors; ++i) {
+            auto actor = std::make_shared<Idle>("idle", event_loop);
+            event_loop->register_actor(actor);
+            ids.push_back(actor->get_id());
+        }
+        double ns = seconds_since(started) * 1e9 / static_cast<double>(actors);
+        for (const auto& id : ids) {
+            event_loop->remove_actor(id);
+        }
+        return ns;
+    }
+
+    struct Startup {
+        double start_ns = 0;
+        double first_ns = 0;
+    };
+
+    Startup run_startup(size_t actors, size_t active, bool lazy) {
+        auto event_loop = std::make_shared<EventLoop>();
+        event_loop->set_lazy_start(lazy);
+        std::vector<std::shared_ptr<Idle>> registered;
+        registered.reserve(actors);
+        for (size_t i = 0; i < actors; ++i) {
+            auto actor = std::make_shared<Idle>("idle", event_loop);
+            event_loop->register_actor(actor);
+            registered.push_back(actor);
+        }
+        Startup result;
+        auto started = std::chrono::steady_clock::now();
+        event_loop->run_until_idle();
+        result.start_ns = seconds_since(started) * 1e9 / static_cast<double>(actors);
+
+        size_t stride = std::max<size_t>(1, actors / active);
+        started = std::chrono::steady_clock::now();
+        for (size_t i = 0; i < actors; i += stride) {
+            event_loop->deliver_message(Message("ping", "bench", registered[i]->get_id()));
+        }
+        event_loop->run_until_idle();
+        result.first_ns = seconds_since(started) * 1e9 / static_cast<double>(actors);
+        return result;
+    }
+}
+
+int main(int argc, char* argv[]) {
+    auto options = tool_util::parse_options(argc, argv, {"help"});
+    if (options.has("help")) {
+        std::cerr << "usage: bench_spawn [--actors N] [--threads N] [--active N]" << std::endl;
+        return 0;
+    }
+    size_t actors = static_cast<size_t>(std::max<int64_t>(1, options.get_int("actors", 200000)));
+    size_t threads = static_cast<size_t>(std::max<int64_t>(1, options.get_int("threads", 4)));
+    size_t active = static_cast<size_t>(std::max<int64_t>(1, options.get_int("active", 10)));
+
+    set_log_level(LogLevel::OFF);
+
+    std::cout << std::fixed << std::setprecision(1) << "actors " << actors << ", threads " << threads << ", active "
+              << active << "\n"
+              << std::left << std::setw(12) << "bench" << std::right << std::setw(12) << "ns/actor" << "\n";
+    std::cout << std::left << std::setw(12) << "construct" << std::right << std::setw(12)
+              << run_construct(actors, threads) << std::endl;
+    std::cout << std::left << std::setw(12) << "register" << std::right << std::setw(12) << run_register(actors)
+              << std::endl;
+    for (bool lazy : {false, true}) {
+        Startup startup = run_startup(actors, active, lazy);
+        std::string mode = lazy ? "lazy" : "eager";
+        std::cout << std::left << std::setw(12) << "start-" + mode << std::right << std::setw(12) << startup.start_ns
+                  << "\n"
+                  << std::left << std::setw(12) << "first-" + mode << std::right << std::setw(12) << startup.first_ns
+                  << std::endl;
+    }
+    return 0;
+}
@@ -10,6 +10,7 @@
 #include "event_loop.h"
 #include "message.h"
 #include "scheduler.h"
+#include "trace.h"
 
 // 自定义Actor类
 class PingActor : public Actor {
@@ -94,10 +95,15 @@ private:
     }
 };
 
-int main() {
+int main(int argc, char* argv[]) {
     // 创建事件循环
     auto event_loop = std::make_shared<EventLoop>();
     
+    // 可选：把消息轨迹录制到文件，之后可以用actor_replay回放
+    if (argc > 1) {
+        event_loop->set_trace_recorder(std::make_shared<TraceRecorder>(argv[1]));
+    }
+    
     // 创建两个PingActor
     auto actor1 = std::make_shared<PingActor>("Actor1", event_loop);
     auto actor2 = std::make_shared<PingActor>("Actor2", event_loop);
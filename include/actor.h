@@ -1,14 +1,25 @@
 #pragma once
 
+#include <deque>
 #include <memory>
+#include <memory_resource>
 #include <string>
 #include <queue>
-#include <unordered_map>
 #include <functional>
 #include <atomic>
+#include <mutex>
+#include "actor_stats.h"
+#include "flat_hash_map.h"
 #include "message.h"
+#include "run_queue.h"
+#include "scratch_arena.h"
 
 class EventLoop;
+class TerminationDetector;
+class TraceRecorder;
+class SpanCollector;
+struct ActorMetrics;
+struct SharedActorSlot;
 
 /**
  * @brief Actor类 - Actor模型的基本单元
@@ -18,6 +29,9 @@ class EventLoop;
  * 2. 创建新的Actor
  * 3. 向其他Actor发送消息
  * 4. 更新自己的内部状态
+ *
+ * 邮箱从构造时事件循环为这个Actor所在worker指定的内存资源分配（见EventLoop::set_memory_resources），
+ * 进入邮箱的消息负载也改由这个资源分配。
  */
 class Actor : public std::enable_shared_from_this<Actor>
 {
@@ -36,7 +50,7 @@ public:
     };
 
     explicit Actor(std::string name, std::weak_ptr<EventLoop> event_loop);
-    virtual ~Actor() = default;
+    virtual ~Actor();
 
     // 初始化Actor（设置初始状态和注册基本消息处理器）
     virtual void initialize();
@@ -50,8 +64,11 @@ public:
     // 立即停止Actor（丢弃所有未处理消息）
     virtual void stop_immediately();
 
-    // 接收消息（将消息放入队列）
-    void receive(Message message);
+    // 接收消息（将消息放入队列），返回消息是否被接受
+    bool receive(Message message);
+
+    // 丢弃队列中所有未处理的消息，返回被丢弃的消息数量
+    size_t discard_messages();
 
     // 处理队列中的下一条消息
     bool process_next_message();
@@ -71,8 +88,69 @@ public:
     // 获取Actor的名称
     const std::string &get_name() const { return name_; }
 
+    // 获取Actor的序号（进程内按创建顺序单调递增）
+    uint64_t get_serial() const { return serial_; }
+
+    // 邮箱使用的内存资源
+    std::pmr::memory_resource *mailbox_resource() const;
+
+    // 关联事件循环的静默检测器（由EventLoop在注册/移除时调用）
+    void attach_termination_detector(std::shared_ptr<TerminationDetector> detector);
+
+    // 关联事件循环的就绪队列（由EventLoop在注册/移除时调用）：邮箱从空变为非空时把自己放入所在worker的队列
+    void attach_run_queues(std::shared_ptr<RunQueues> queues);
+
+    // 邮箱已空（或已不再关联就绪队列）时清除就绪标记并返回true，调用者随后把它从就绪队列中移除
+    bool try_unschedule();
+
+    // 关联消息轨迹记录器（为空时不记录）
+    void attach_trace_recorder(std::shared_ptr<TraceRecorder> recorder);
+
+    // 关联span缓冲区（为空时不创建span，但仍会传播追踪上下文）
+    void attach_span_collector(std::shared_ptr<SpanCollector> collector);
+
+    // 当前线程正在处理的消息的追踪上下文（span_id为本次处理的span），不在处理函数中时valid()为false
+    static const TraceContext &current_trace_context();
+
+    // 当前线程的临时内存区，供处理函数中的临时对象使用（std::pmr容器以它为资源）
+    // 每次process_next_message返回前重置，在其中分配的对象不能活过处理函数
+    // 用它作为负载资源的消息可以直接发送：投递时负载会复制到目标邮箱的资源上
+    static ScratchArena &scratch_arena();
+
+    // 关联指标句柄（为空时不记录）
+    void attach_metrics(std::shared_ptr<ActorMetrics> metrics);
+
+    // 关联共享内存指标段中的槽位（为空时不记录）
+    void attach_shared_slot(std::shared_ptr<SharedActorSlot> slot);
+
+    // 获取关联的共享内存指标槽位
+    const std::shared_ptr<SharedActorSlot> &get_shared_slot() const { return shared_slot_; }
+
+    // 获取关联的指标句柄
+    const std::shared_ptr<ActorMetrics> &get_metrics() const { return metrics_; }
+
+    // 设置是否为每次处理计时（计时结果计入read_stats的处理耗时），需要在事件循环未运行时调用
+    void set_handler_timing(bool enabled) { handler_timing_ = enabled; }
+
+    // 设置延迟启动：开启后CREATED和INITIALIZED状态也接收消息，处理第一条消息之前才调用initialize()和start()
+    // 需要在事件循环未运行时调用
+    void set_lazy_start(bool enabled) { lazy_start_ = enabled; }
+
+    // 是否处于延迟启动模式且尚未启动（此时投递的消息留在邮箱中，等待所在worker启动它）
+    bool awaiting_first_message() const {
+        State state = state_;
+        return lazy_start_ && (state == State::CREATED || state == State::INITIALIZED);
+    }
+
+    // 读取运行统计：不加锁，写入方正在更新时重试，多次重试仍不一致时返回最后一次读到的值
+    // 可以在任意线程上调用，不会阻塞worker
+    ActorStats read_stats() const;
+
+    // 获取运行统计槽位
+    ActorStatsSlot *get_stats_slot() const { return stats_; }
+
     // 检查消息队列是否为空
-    bool has_messages() const { return !message_queue_.empty(); }
+    bool has_messages() const;
 
     // 获取当前状态
     State get_state() const { return state_; }
@@ -81,7 +159,7 @@ public:
     bool is_running() const { return state_ == State::RUNNING; }
 
     // 获取消息队列中的消息数量
-    size_t message_count() const { return message_queue_.size(); }
+    size_t message_count() const;
 
     // 查看消息队列中的下一条消息（不会移除）
     Message peek_next_message() const;
@@ -102,18 +180,71 @@ protected:
     // Actor的名称（可读性更好的标识）
     std::string name_;
 
+    // Actor的序号
+    uint64_t serial_;
+
     // 当前状态
     std::atomic<State> state_;
 
+    // 邮箱的内存资源（事件循环没有指定时引用构造时的默认资源），声明在邮箱之前以便比它活得久
+    std::shared_ptr<std::pmr::memory_resource> memory_resource_;
+
     // 消息队列
-    std::queue<Message> message_queue_;
+    std::queue<Message, std::pmr::deque<Message>> message_queue_;
 
-    // 消息处理函数映射
-    std::unordered_map<std::string, MessageHandler> handlers_;
+    // 保护消息队列的互斥锁（关闭阶段会有多个worker线程并发投递和处理）
+    mutable std::mutex queue_mutex_;
+
+    // 消息处理函数映射（按消息类型透明查找，不需要构造临时字符串）
+    FlatHashMap<std::string, MessageHandler, StringHash, std::equal_to<>> handlers_;
 
     // 事件循环的弱引用（避免循环引用）
     std::weak_ptr<EventLoop> event_loop_;
 
-    // 生成唯一ID的静态方法
-    static std::string generate_id();
+    // 在途消息计数（未注册到事件循环时为空）
+    std::shared_ptr<TerminationDetector> termination_detector_;
+
+    // 事件循环的就绪队列（未注册到事件循环时为空，受queue_mutex_保护）
+    std::shared_ptr<RunQueues> run_queues_;
+
+    // 是否已在就绪队列中或正由所在worker处理（受queue_mutex_保护）
+    bool scheduled_ = false;
+
+    // 在就绪队列中的位置（受所在队列的锁保护）
+    RunQueueHook run_hook_;
+    friend class RunQueues;
+
+    // 消息轨迹记录器（未启用时为空）
+    std::shared_ptr<TraceRecorder> trace_recorder_;
+
+    // span缓冲区（未启用时为空）
+    std::shared_ptr<SpanCollector> span_collector_;
+
+    // 指标句柄（未启用时为空）
+    std::shared_ptr<ActorMetrics> metrics_;
+
+    // 共享内存指标槽位（未启用时为空）
+    std::shared_ptr<SharedActorSlot> shared_slot_;
+
+    // 各优先级的待处理消息数量（受queue_mutex_保护）
+    size_t pending_by_priority_[4] = {};
+
+    // 累计入队和出队（含丢弃）的消息数，即邮箱序号（受queue_mutex_保护，邮箱FIFO，出队序号与入队序号一致）
+    uint64_t enqueued_ = 0;
+    uint64_t dequeued_ = 0;
+
+    // 是否为每次处理计时
+    bool handler_timing_ = false;
+
+    // 是否延迟到第一条消息时才初始化和启动
+    bool lazy_start_ = false;
+
+    // 运行统计槽位（构造时从ActorStatsTable分配，析构时归还）
+    ActorStatsSlot *stats_;
+
+    // 在queue_mutex_下更新邮箱深度和最高待处理优先级
+    void publish_mailbox_stats(size_t depth);
+
+    // 生成UUID v4格式的ID：序号决定的部分保证进程内唯一，其余来自线程自己的随机数生成器
+    static std::string generate_id(uint64_t serial);
 };
\ No newline at end of file
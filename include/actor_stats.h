@@ -0,0 +1,91 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+class Actor;
+class EventLoop;
+enum class HugePageMode;
+
+/**
+ * @brief ActorStats结构体 - Actor运行统计的一次一致读取（见Actor::read_stats）
+ */
+struct ActorStats {
+    // 邮箱中的消息数量
+    uint64_t mailbox_depth = 0;
+
+    // 邮箱中最高的消息优先级（Message::Priority的数值），邮箱为空时为-1
+    int top_priority = -1;
+
+    // 已处理的消息数量
+    uint64_t processed = 0;
+
+    // 处理函数的累计耗时和最大耗时（只统计计时的处理，见EventLoop::set_handler_timing）
+    uint64_t handler_ns_total = 0;
+    uint64_t handler_ns_max = 0;
+
+    // 最近一次处理完消息的时间（Unix纳秒，粗粒度时钟），从未处理过消息时为0
+    int64_t last_run_ns = 0;
+};
+
+/**
+ * @brief ActorStatsSlot结构体 - 一个Actor的运行统计，正好占一个缓存行
+ *
+ * 写入方先把sequence从偶数改为奇数，修改字段后再改回偶数（seqlock）；读取方不加锁，
+ * 读到奇数或前后sequence不同时重试。state和两个指针不受sequence保护，单独原子读写。
+ */
+struct alignas(64) ActorStatsSlot {
+    std::atomic<uint32_t> sequence{0};
+    std::atomic<int16_t> top_priority{-1};
+
+    // Actor::State的数值
+    std::atomic<uint8_t> state{0};
+
+    // 所属的事件循环（注册时设置，移除时清空），快照据此筛选本事件循环的Actor
+    std::atomic<const EventLoop*> event_loop{nullptr};
+
+    // 占用该槽位的Actor（槽位空闲时为空）
+    std::atomic<const Actor*> owner{nullptr};
+
+    std::atomic<uint64_t> mailbox_depth{0};
+    std::atomic<uint64_t> processed{0};
+    std::atomic<uint64_t> handler_ns_total{0};
+    std::atomic<uint64_t> handler_ns_max{0};
+    std::atomic<int64_t> last_run_ns{0};
+
+    // 开始/结束修改（写入方之间互斥，读取方不受阻塞）
+    uint32_t begin_write();
+    void end_write(uint32_t sequence_value) { sequence.store(sequence_value + 1, std::memory_order_release); }
+
+    // 一致读取；多次重试仍不一致时返回最后一次读到的值
+    ActorStats read() const;
+};
+
+static_assert(sizeof(ActorStatsSlot) == 64, "ActorStatsSlot should fill exactly one cache line");
+
+/**
+ * @brief ActorStatsTable类 - 进程内所有Actor的统计槽位
+ *
+ * 槽位按块分配、连续存放且从不释放（空闲槽位放回空闲列表复用），快照顺序扫描所有块，
+ * 不需要经过注册表的哈希节点和Actor对象，一百万个Actor也只需要顺序读取64MB。
+ * 开启大页后块从HugePageArena分配，扫描时的TLB缺失随之减少。
+ */
+class ActorStatsTable {
+public:
+    static constexpr size_t kChunkSize = 4096;
+    static constexpr size_t kMaxChunks = 16384;
+
+    // 为Actor分配槽位（Actor构造时调用），槽位用尽时抛出std::runtime_error
+    static ActorStatsSlot* acquire(const Actor* owner);
+
+    // 归还槽位（Actor析构时调用）
+    static void release(ActorStatsSlot* slot);
+
+    // 之后分配的块从大页支持的区域分配（HugePageMode::OFF恢复为普通的堆），应当在创建Actor之前调用
+    static void set_huge_pages(HugePageMode mode);
+
+    // 已分配过的块数量，以及第index块的起始地址（每块kChunkSize个槽位，可以在任意线程上读取）
+    static size_t chunk_count();
+    static const ActorStatsSlot* chunk(size_t index);
+};
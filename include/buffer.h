@@ -0,0 +1,94 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+
+/**
+ * @brief Buffer类 - 引用计数的只读字节块，用作大负载的零拷贝载体
+ *
+ * Buffer只是对一段内存的引用（所有者 + 起始地址 + 长度），复制Buffer、把它放进消息负载、
+ * 复制或投递消息都只增加引用计数，不复制字节。最后一个引用消失时内存归还给来源：
+ * BufferPool分配的块回到池中，映射的文件被munmap并关闭。
+ * slice()得到共享同一块内存的子范围。
+ *
+ * 映射的文件还记录文件描述符和偏移，远程传输发送时可以用sendfile直接从页缓存发出。
+ * Buffer可以在多个线程之间自由复制；内容只在刚分配、还没有交给其他人时写入。
+ */
+class Buffer {
+public:
+    Buffer() = default;
+
+    // 从BufferPool::shared()分配size字节（内容未初始化，用mutable_data()填充）
+    static Buffer allocate(size_t size);
+
+    // 复制一段内存
+    static Buffer copy(const void* data, size_t size);
+
+    // 只读映射整个文件，失败时抛出std::runtime_error
+    static Buffer map_file(const std::string& path);
+
+    // 引用由owner管理的size字节（owner的删除器负责释放）
+    static Buffer adopt(std::shared_ptr<const char> owner, size_t size);
+
+    const char* data() const { return data_; }
+    size_t size() const { return size_; }
+    bool empty() const { return size_ == 0; }
+
+    // 可写的指针，用于填充刚分配的Buffer；映射的文件是只读的，抛出std::logic_error
+    char* mutable_data();
+
+    // 子范围[offset, offset + length)，超出范围时抛出std::out_of_range
+    Buffer slice(size_t offset, size_t length) const;
+
+    // 复制出std::string（用于小负载和调试）
+    std::string to_string() const { return std::string(data_, size_); }
+
+    // 共享这块内存的Buffer数量（空Buffer为0）
+    long use_count() const { return owner_.use_count(); }
+
+    // 映射的文件的描述符和data()在文件中的偏移，其他来源为-1
+    int file_descriptor() const { return fd_; }
+    int64_t file_offset() const { return file_offset_; }
+
+private:
+    Buffer(std::shared_ptr<const char> owner, const char* data, size_t size, int fd = -1, int64_t file_offset = 0)
+        : owner_(std::move(owner)), data_(data), size_(size), fd_(fd), file_offset_(file_offset) {}
+
+    friend class BufferPool;
+
+    std::shared_ptr<const char> owner_;
+    const char* data_ = nullptr;
+    size_t size_ = 0;
+    int fd_ = -1;
+    int64_t file_offset_ = 0;
+};
+
+/**
+ * @brief BufferPool类 - 按2的幂分级缓存的大块内存池
+ *
+ * 块的容量从4 KB到64 MB按2的幂分级，Buffer释放后块回到对应级别的空闲列表，
+ * 同样大小的下一次分配直接复用，避免反复向系统申请和归还大块内存（以及随之而来的缺页）。
+ * 空闲块总量超过max_cached_bytes时多余的块直接释放；超过64 MB的请求不经过池。
+ * 池可以先于它分配的Buffer销毁，之后归还的块直接释放。所有函数都是线程安全的。
+ */
+class BufferPool {
+public:
+    explicit BufferPool(size_t max_cached_bytes = 256 * 1024 * 1024);
+
+    BufferPool(const BufferPool&) = delete;
+    BufferPool& operator=(const BufferPool&) = delete;
+
+    Buffer allocate(size_t size);
+
+    // 空闲列表中缓存的字节数
+    size_t cached_bytes() const;
+
+    // 进程内共享的池，Buffer::allocate使用
+    static BufferPool& shared();
+
+private:
+    struct State;
+    std::shared_ptr<State> state_;
+};
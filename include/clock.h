@@ -0,0 +1,78 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+
+/**
+ * @brief Clock类 - 运行时使用的时间来源
+ *
+ * 消息时间戳、span和调度器通过Clock::current()获取当前线程安装的时钟，默认为系统时钟。
+ * 时钟属于事件循环（EventLoop::clock()，仿真模式下为它的VirtualClock），定时器直接使用事件循环的时钟；
+ * 事件循环只在运行它的线程上、运行期间安装自己的时钟，因此一个事件循环的仿真不会影响其他事件循环。
+ * 限制：不在事件循环线程上创建的消息（例如外部线程投递的消息）和记录的轨迹使用该线程安装的时钟，
+ * 需要虚拟时间的调用方可以用ClockScope安装事件循环的时钟。
+ */
+class Clock {
+public:
+    using time_point = std::chrono::system_clock::time_point;
+    using duration = std::chrono::system_clock::duration;
+
+    virtual ~Clock() = default;
+
+    // 获取当前时间
+    virtual time_point now() const = 0;
+
+    // 获取当前线程安装的时钟（未安装时为系统时钟）
+    static const Clock& current();
+
+    // 在当前线程上安装时钟（nullptr表示恢复系统时钟），调用者需保证时钟在安装期间有效
+    static void set_current(const Clock* clock);
+
+    // 进程共享的系统时钟
+    static const Clock& system();
+};
+
+/**
+ * @brief SystemClock类 - 基于std::chrono::system_clock的真实时钟
+ */
+class SystemClock : public Clock {
+public:
+    time_point now() const override { return std::chrono::system_clock::now(); }
+};
+
+/**
+ * @brief VirtualClock类 - 只在显式推进时才前进的虚拟时钟
+ *
+ * 时间以纳秒计数存储在原子变量中，可以从任意线程读取。
+ */
+class VirtualClock : public Clock {
+public:
+    explicit VirtualClock(time_point start = time_point{});
+
+    time_point now() const override;
+
+    // 将时间向前推进一段时长（负值被忽略）
+    void advance(std::chrono::nanoseconds delta);
+
+    // 将时间推进到指定时刻（早于当前时间时不变）
+    void advance_to(time_point target);
+
+private:
+    std::atomic<int64_t> now_ns_;
+};
+
+/**
+ * @brief ClockScope类 - 在当前线程上临时安装时钟，析构时恢复原来的时钟
+ */
+class ClockScope {
+public:
+    explicit ClockScope(const Clock& clock) : previous_(&Clock::current()) { Clock::set_current(&clock); }
+    ~ClockScope() { Clock::set_current(previous_); }
+
+    ClockScope(const ClockScope&) = delete;
+    ClockScope& operator=(const ClockScope&) = delete;
+
+private:
+    const Clock* previous_;
+};
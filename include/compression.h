@@ -0,0 +1,18 @@
+#pragma once
+
+#include <cstddef>
+#include <string>
+
+/**
+ * @brief LZ4块格式的压缩和解压
+ *
+ * 输出与LZ4的块格式（不含帧头）兼容：liblz4的LZ4_decompress_safe可以解压lz4_compress的结果，
+ * 反之亦然。压缩只做贪心的单次哈希匹配，速度优先，压缩率低于liblz4的默认级别。
+ * 块中不记录原始长度，由调用方另外保存。
+ */
+
+// 压缩size字节，返回压缩后的块（不可压缩的数据会略微变大）
+std::string lz4_compress(const char* data, size_t size);
+
+// 解压得到original_size字节到out，数据格式错误或长度不符时返回false
+bool lz4_decompress(const char* data, size_t size, size_t original_size, std::string& out);
@@ -1,15 +1,94 @@
 #pragma once
 
 #include <memory>
+#include <memory_resource>
 #include <unordered_map>
 #include <string>
+#include <string_view>
 #include <queue>
+#include <vector>
 #include <functional>
 #include <atomic>
+#include <chrono>
+#include <mutex>
+#include <condition_variable>
+#include <shared_mutex>
+#include <thread>
+#include "clock.h"
+#include "flat_hash_map.h"
+#include "message.h"
+#include "metrics.h"
 
 class Actor;
-class Message;
 class Scheduler;
+class RunQueues;
+class TerminationDetector;
+class TraceRecorder;
+class SharedMetricsSegment;
+class SlowHandlerWatchdog;
+class SpanCollector;
+struct SystemSnapshot;
+enum class SnapshotOrder;
+
+/**
+ * @brief 优雅关闭的配置
+ *
+ * 关闭时先停止外部消息投递，再由多个worker并行排空各Actor的邮箱，
+ * 超过截止时间后剩余的Actor会被立即停止，未处理的消息被丢弃。
+ */
+struct ShutdownOptions
+{
+    // 排空邮箱的截止时间
+    std::chrono::milliseconds drain_deadline{std::chrono::seconds(1)};
+
+    // 并行排空邮箱的worker数量（0表示使用硬件并发数）
+    size_t worker_count = 0;
+};
+
+/**
+ * @brief 一次关闭过程的统计结果
+ */
+struct ShutdownReport
+{
+    // 被停止的Actor数量
+    size_t actors_stopped = 0;
+
+    // 截止时间到达后被强制停止的Actor数量
+    size_t actors_force_stopped = 0;
+
+    // 排空阶段处理的消息数量
+    size_t messages_drained = 0;
+
+    // 被丢弃的消息数量（关闭期间被拒绝投递的消息 + 强制停止时邮箱中剩余的消息）
+    size_t messages_dropped = 0;
+
+    // 是否因为到达截止时间而丢弃了邮箱中的消息（截止时间到达时邮箱都已为空不算）
+    bool deadline_exceeded = false;
+
+    // 整个关闭过程的耗时
+    std::chrono::milliseconds elapsed{0};
+};
+
+/**
+ * @brief 仿真模式的配置
+ *
+ * 仿真模式下事件循环在调用线程上单线程运行，使用虚拟时钟和带种子的随机调度器，
+ * 候选Actor按序号排序，因此同一工作负载的调度顺序和时间推进完全可复现。
+ */
+struct SimulationOptions
+{
+    // 处理函数耗时模型：根据Actor和即将处理的消息返回虚拟耗时
+    using CostModel = std::function<std::chrono::nanoseconds(const Actor &, const Message &)>;
+
+    // 随机调度器的种子
+    uint64_t seed = 0;
+
+    // 耗时模型；为空时测量处理函数的真实耗时并据此推进虚拟时间
+    CostModel cost_model;
+
+    // 虚拟时钟的起始时间
+    Clock::time_point start_time{};
+};
 
 /**
  * @brief EventLoop类 - Actor消息调度的核心
@@ -23,45 +102,313 @@ class EventLoop : public std::enable_shared_from_this<EventLoop>
 {
 public:
     EventLoop();
-    ~EventLoop() = default;
+    ~EventLoop();
 
     // 运行事件循环直到没有更多消息或被停止
     void run();
 
+    // 运行事件循环直到整个系统静默（没有在途消息），返回处理的消息数量
+    // 与run()不同，返回后不会停止Actor，可以继续投递消息并再次调用
+    size_t run_until_idle();
+
     // 停止事件循环
     void stop();
 
+    // 优雅关闭：停止外部投递，并行排空所有邮箱直到截止时间，然后停止剩余Actor
+    // run()退出时会自动调用
+    ShutdownReport shutdown();
+
+    // 设置优雅关闭的参数
+    void set_shutdown_options(const ShutdownOptions &options) { shutdown_options_ = options; }
+
+    // 获取最近一次关闭的统计结果
+    const ShutdownReport &last_shutdown_report() const { return last_shutdown_report_; }
+
     // 注册Actor到事件循环
     void register_actor(std::shared_ptr<Actor> actor);
 
     // 从事件循环移除Actor
-    void remove_actor(const std::string &actor_id);
+    void remove_actor(std::string_view actor_id);
 
-    // 查找Actor
-    std::shared_ptr<Actor> find_actor(const std::string &actor_id);
+    // 查找Actor（字符串字面量和string_view直接查找，不构造临时字符串）
+    std::shared_ptr<Actor> find_actor(std::string_view actor_id);
+
+    // 按序号查找Actor（Actor::get_serial()）
+    std::shared_ptr<Actor> find_actor_by_serial(uint64_t serial);
 
     // 传递消息到目标Actor
     void deliver_message(const Message &message);
 
+    // 在指定延迟之后投递消息（按clock()计时，仿真模式下为虚拟时间）
+    void deliver_after(const Message &message, std::chrono::nanoseconds delay);
+
+    // 启用仿真模式（需要在run之前调用），会创建虚拟时钟并替换为带种子的随机调度器
+    void enable_simulation(const SimulationOptions &options);
+
+    // 是否处于仿真模式
+    bool is_simulation() const { return simulation_; }
+
+    // 仿真模式下的虚拟时钟（非仿真模式为空）
+    std::shared_ptr<VirtualClock> virtual_clock() const { return virtual_clock_; }
+
+    // 本事件循环的时钟（仿真模式下为虚拟时钟，否则为系统时钟），运行期间安装到每个worker线程上
+    const Clock &clock() const { return virtual_clock_ ? static_cast<const Clock &>(*virtual_clock_) : Clock::system(); }
+
+    // 设置消息轨迹记录器（会关联到所有已注册和之后注册的Actor，nullptr表示停止记录）
+    // 需要在事件循环未运行时调用
+    void set_trace_recorder(std::shared_ptr<TraceRecorder> recorder);
+
+    // 设置span缓冲区（会关联到所有已注册和之后注册的Actor，nullptr表示不再创建span）
+    // 需要在事件循环未运行时调用
+    void set_span_collector(std::shared_ptr<SpanCollector> collector);
+
+    // 获取span缓冲区（未启用时为空）
+    std::shared_ptr<SpanCollector> span_collector() const { return span_collector_; }
+
+    // 启用指标收集并把收集回调注册到registry（nullptr表示停用）
+    // 需要在事件循环未运行时调用
+    void set_metrics(std::shared_ptr<MetricsRegistry> registry, const MetricsOptions &options = MetricsOptions());
+
+    // 把每个Actor的计数器发布到共享内存指标段（nullptr表示停用），需要在事件循环未运行时调用
+    void set_shared_metrics(std::shared_ptr<SharedMetricsSegment> segment);
+
+    // 设置慢处理函数看门狗（nullptr表示停用），worker线程在运行期间登记到看门狗
+    // 需要在事件循环未运行时调用
+    void set_watchdog(std::shared_ptr<SlowHandlerWatchdog> watchdog) { watchdog_ = std::move(watchdog); }
+
+    // 获取看门狗（未启用时为空）
+    std::shared_ptr<SlowHandlerWatchdog> watchdog() const { return watchdog_; }
+
+    // 为每次处理计时（计入Actor::read_stats和快照中的处理耗时），会应用到所有已注册和之后注册的Actor
+    // 需要在事件循环未运行时调用
+    void set_handler_timing(bool enabled);
+
+    // 延迟启动：开启后启动和注册时不再调用每个Actor的initialize()和start()，
+    // Actor收到第一条消息后由所在worker在处理它之前启动，启动耗时只与实际收到消息的Actor数量有关。
+    // 从未收到消息的Actor一直保持CREATED状态，关闭时也不计入停止的Actor。会应用到所有已注册和之后注册的Actor，
+    // 需要在事件循环未运行时调用
+    void set_lazy_start(bool enabled);
+
+    // 拍摄所有Actor的快照（类型定义在introspection.h），不暂停worker：
+    // 持有注册表读锁扫描一遍，逐个用seqlock读取统计，只为排序后的前top_n个（0表示全部）复制名称和ID
+    SystemSnapshot snapshot(size_t top_n, SnapshotOrder order) const;
+
+    // 获取指标注册表（未启用时为空）
+    std::shared_ptr<MetricsRegistry> metrics() const { return metrics_; }
+
     // 设置调度器
     void set_scheduler(std::shared_ptr<Scheduler> scheduler);
 
-    // 检查是否还有更多工作要做
+    // 设置处理消息的worker线程数量（Actor按序号静态划分到各worker）
+    void set_worker_count(size_t worker_count) { worker_count_ = worker_count; }
+
+    // 获取worker线程数量
+    size_t get_worker_count() const { return worker_count_; }
+
+    // 设置各worker的内存资源（第i个对应worker i，不足worker数量时循环使用，空表示都用默认资源）
+    // Actor的邮箱和进入邮箱的消息负载从它所在worker的资源分配。发送方在自己的线程上向邮箱写入，
+    // 资源必须是线程安全的（例如std::pmr::synchronized_pool_resource）
+    // 邮箱在Actor构造时绑定资源，需要在set_worker_count之后、创建Actor之前调用
+    void set_memory_resources(std::vector<std::shared_ptr<std::pmr::memory_resource>> resources)
+    {
+        memory_resources_ = std::move(resources);
+    }
+
+    // 序号为serial的Actor所在worker的内存资源（没有设置时为空）
+    std::shared_ptr<std::pmr::memory_resource> memory_resource_for(uint64_t serial) const;
+
+    // 设置保活模式：开启后run()在系统静默时不会退出，而是等待新消息直到stop()
+    void set_keep_alive(bool keep_alive) { keep_alive_ = keep_alive; }
+
+    // 检查是否还有更多工作要做（基于在途消息计数，不扫描Actor）
     bool has_work() const;
 
+    // 当前在途消息数量的近似值
+    size_t in_flight_messages() const;
+
     // 获取当前是否正在运行
     bool is_running() const { return running_; }
 
 private:
     // Actor注册表，通过ID映射
-    std::unordered_map<std::string, std::shared_ptr<Actor>> actors_;
+    FlatHashMap<std::string, std::shared_ptr<Actor>, StringHash, std::equal_to<>> actors_;
+
+    // 按序号索引的Actor注册表，与actors_同步维护
+    FlatHashMap<uint64_t, std::shared_ptr<Actor>> actors_by_serial_;
+
+    // 保护Actor注册表的读写锁
+    mutable std::shared_mutex actors_mutex_;
 
     // 事件循环是否正在运行
     std::atomic<bool> running_;
 
+    // 是否接受外部投递的消息（关闭期间为false）
+    std::atomic<bool> accepting_;
+
+    // 关闭期间被拒绝投递的消息数量
+    std::atomic<size_t> rejected_during_shutdown_;
+
+    // 在途消息计数，用于静默检测
+    std::shared_ptr<TerminationDetector> termination_detector_;
+
+    // 每个worker的就绪队列（Actor按序号 % worker数量划分）
+    std::shared_ptr<RunQueues> run_queues_;
+
+    // worker线程数量
+    size_t worker_count_;
+
+    // 各worker的内存资源
+    std::vector<std::shared_ptr<std::pmr::memory_resource>> memory_resources_;
+
+    // 保活模式
+    std::atomic<bool> keep_alive_;
+
+    // 空闲worker在此等待新消息
+    std::mutex idle_mutex_;
+    std::condition_variable idle_cv_;
+
+    // 正在等待的空闲worker数量（投递路径据此决定是否需要唤醒）
+    std::atomic<size_t> idle_workers_;
+
+    // 消息轨迹记录器
+    std::shared_ptr<TraceRecorder> trace_recorder_;
+
+    // span缓冲区（未启用时为空）
+    std::shared_ptr<SpanCollector> span_collector_;
+
+    // 是否为每次处理计时
+    bool handler_timing_;
+
+    // 是否延迟到第一条消息时才启动Actor
+    bool lazy_start_;
+
+    // 每个worker的指标
+    struct WorkerMetrics
+    {
+        std::shared_ptr<Counter> picks;
+        std::shared_ptr<Counter> busy_ns;
+        std::shared_ptr<Counter> idle_ns;
+        std::shared_ptr<Gauge> utilization;
+    };
+
+    // 指标注册表（未启用时为空）
+    std::shared_ptr<MetricsRegistry> metrics_;
+
+    // 指标配置
+    MetricsOptions metrics_options_;
+
+    // 在注册表中的收集回调编号
+    uint64_t metrics_collector_id_;
+
+    // 保护actor_series_和worker_metrics_
+    std::mutex metrics_mutex_;
+
+    // 按actor标签值索引的指标句柄
+    std::unordered_map<std::string, std::shared_ptr<ActorMetrics>> actor_series_;
+
+    // 各worker的指标（只在事件循环启动时调整大小）
+    std::vector<WorkerMetrics> worker_metrics_;
+
+    // 无法投递的消息数量（按原因）
+    std::shared_ptr<Counter> undeliverable_shutdown_;
+    std::shared_ptr<Counter> undeliverable_not_running_;
+    std::shared_ptr<Counter> undeliverable_not_found_;
+
+    // 因超过标签基数上限而计入"_other"的Actor数量
+    std::shared_ptr<Counter> actor_series_overflow_;
+
+    // 共享内存指标段（未启用时为空）
+    std::shared_ptr<SharedMetricsSegment> shared_metrics_;
+
+    // 慢处理函数看门狗（未启用时为空）
+    std::shared_ptr<SlowHandlerWatchdog> watchdog_;
+
+    // 优雅关闭的参数
+    ShutdownOptions shutdown_options_;
+
+    // 最近一次关闭的统计结果
+    ShutdownReport last_shutdown_report_;
+
     // 调度器
     std::shared_ptr<Scheduler> scheduler_;
 
-    // 处理一个调度周期
-    void process_one_cycle();
+    // 保护调度器的互斥锁
+    std::mutex scheduler_mutex_;
+
+    // 调度器是否按就绪顺序轮询（是时worker直接取就绪队列头部）
+    std::atomic<bool> fifo_scheduler_;
+
+    // 定时器
+    struct Timer
+    {
+        Clock::time_point due;
+        uint64_t sequence;
+        Message message;
+    };
+
+    // 定时器堆的比较函数（到期时间早的优先，相同时按加入顺序）
+    struct TimerLater
+    {
+        bool operator()(const Timer &a, const Timer &b) const
+        {
+            return a.due != b.due ? a.due > b.due : a.sequence > b.sequence;
+        }
+    };
+
+    // 等待到期的定时器
+    std::priority_queue<Timer, std::vector<Timer>, TimerLater> timers_;
+
+    // 保护定时器堆的互斥锁
+    std::mutex timers_mutex_;
+
+    // 定时器序号
+    uint64_t next_timer_sequence_;
+
+    // 尚未投递的定时器数量（包括正在投递中的）
+    std::atomic<size_t> pending_timers_;
+
+    // 是否处于仿真模式
+    bool simulation_;
+
+    // 仿真模式的配置
+    SimulationOptions simulation_options_;
+
+    // 仿真模式下的虚拟时钟
+    std::shared_ptr<VirtualClock> virtual_clock_;
+
+    // 投递所有已到期的定时器消息，返回投递的数量
+    size_t fire_due_timers();
+
+    // 获取最早到期的定时器时间，没有定时器时返回false
+    bool next_timer_due(Clock::time_point &due);
+
+    // 仿真模式的主循环：处理消息，空闲时把虚拟时钟推进到下一个定时器
+    size_t run_simulation();
+
+    // 启动所有Actor并在各worker上处理消息直到被停止或系统静默，返回处理的消息数量
+    size_t run_workers();
+
+    // 当前worker没有工作时等待新消息投递（或短暂超时，以便检查定时器和停止标志）
+    void wait_for_work();
+
+    // 唤醒空闲的worker
+    void wake_idle_workers();
+
+    // 在指定worker上处理一个调度周期（从它的就绪队列中由调度器挑选一个actor），返回是否处理了消息
+    bool process_one_cycle(size_t worker_index);
+
+    // 为Actor获取（必要时创建）指标句柄
+    std::shared_ptr<ActorMetrics> actor_metrics_for(const Actor &actor);
+
+    // 为Actor分配共享内存指标槽位
+    void attach_shared_slot(Actor &actor);
+
+    // 确保每个worker都有对应的指标
+    void prepare_worker_metrics(size_t worker_count);
+
+    // 指标收集回调：采样邮箱深度、在途消息和worker利用率
+    void collect_metrics();
+
+    // 获取所有已注册Actor的快照
+    std::vector<std::shared_ptr<Actor>> actors_snapshot() const;
 };
\ No newline at end of file
@@ -0,0 +1,260 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <string_view>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+/**
+ * @brief 字符串键的透明哈希：std::string、std::string_view和字符串字面量得到相同的哈希值，
+ * 查找时不需要构造临时的std::string
+ */
+struct StringHash {
+    using is_transparent = void;
+
+    size_t operator()(std::string_view key) const { return std::hash<std::string_view>{}(key); }
+};
+
+/**
+ * @brief FlatHashMap类 - 开放寻址（线性探测）的哈希表
+ *
+ * 元素直接存放在一个连续数组中，查找只需要顺序比较相邻的槽位，没有std::unordered_map的
+ * 每元素节点分配和指针跳转。每个槽位保存完整的哈希值，比较键之前先比较哈希值。
+ * 哈希值先乘以黄金分割常数再取高位作为位置，整数键的恒等哈希也能均匀分布。
+ * 负载超过7/8时容量翻倍；删除时把后面的元素前移（backward shift），不留墓碑。
+ *
+ * Hash和KeyEqual都声明is_transparent时，find/contains/erase接受任何能与Key比较的类型
+ * （例如用std::string_view查找std::string键）。
+ * 插入和删除会使迭代器和引用失效；只做查找时可以并发读取。
+ */
+template <typename Key, typename Value, typename Hash = std::hash<Key>, typename KeyEqual = std::equal_to<Key>>
+class FlatHashMap {
+    struct Slot {
+        size_t hash = 0;
+        bool occupied = false;
+        std::pair<Key, Value> entry;
+    };
+
+    template <typename H, typename E, typename = void>
+    struct Transparent : std::false_type {};
+
+    template <typename H, typename E>
+    struct Transparent<H, E, std::void_t<typename H::is_transparent, typename E::is_transparent>> : std::true_type {};
+
+    // 透明时直接用调用方的键查找，否则先转换为Key
+    template <typename K>
+    using lookup_key_t = std::conditional_t<Transparent<Hash, KeyEqual>::value, K, Key>;
+
+public:
+    using value_type = std::pair<Key, Value>;
+
+    template <bool Const>
+    class Iterator {
+        using SlotPointer = std::conditional_t<Const, const Slot*, Slot*>;
+
+    public:
+        using reference = std::conditional_t<Const, const value_type&, value_type&>;
+        using pointer = std::conditional_t<Const, const value_type*, value_type*>;
+
+        Iterator(SlotPointer slot, SlotPointer end) : slot_(slot), end_(end) { skip(); }
+
+        // 非const迭代器可以转换为const迭代器
+        template <bool C = Const, typename = std::enable_if_t<!C>>
+        operator Iterator<true>() const {
+            return Iterator<true>(slot_, end_);
+        }
+
+        reference operator*() const { return slot_->entry; }
+        pointer operator->() const { return &slot_->entry; }
+
+        Iterator& operator++() {
+            ++slot_;
+            skip();
+            return *this;
+        }
+
+        bool operator==(const Iterator& other) const { return slot_ == other.slot_; }
+        bool operator!=(const Iterator& other) const { return slot_ != other.slot_; }
+
+    private:
+        friend class FlatHashMap;
+
+        void skip() {
+            while (slot_ != end_ && !slot_->occupied) {
+                ++slot_;
+            }
+        }
+
+        SlotPointer slot_;
+        SlotPointer end_;
+    };
+
+    using iterator = Iterator<false>;
+    using const_iterator = Iterator<true>;
+
+    FlatHashMap() = default;
+
+    size_t size() const { return size_; }
+    bool empty() const { return size_ == 0; }
+
+    iterator begin() { return iterator(slots_.data(), slots_.data() + slots_.size()); }
+    iterator end() { return iterator(slots_.data() + slots_.size(), slots_.data() + slots_.size()); }
+    const_iterator begin() const { return const_iterator(slots_.data(), slots_.data() + slots_.size()); }
+    const_iterator end() const {
+        return const_iterator(slots_.data() + slots_.size(), slots_.data() + slots_.size());
+    }
+
+    // 预留至少能容纳count个元素而不扩容的容量
+    void reserve(size_t count) {
+        size_t capacity = 16;
+        while (capacity * 7 / 8 < count) {
+            capacity <<= 1;
+        }
+        if (capacity > slots_.size()) {
+            rehash(capacity);
+        }
+    }
+
+    void clear() {
+        slots_.clear();
+        size_ = 0;
+        shift_ = 64;
+    }
+
+    template <typename K>
+    iterator find(const K& key) {
+        size_t index = locate(static_cast<const lookup_key_t<K>&>(key));
+        return index == npos ? end() : iterator(slots_.data() + index, slots_.data() + slots_.size());
+    }
+
+    template <typename K>
+    const_iterator find(const K& key) const {
+        size_t index = locate(static_cast<const lookup_key_t<K>&>(key));
+        return index == npos ? end() : const_iterator(slots_.data() + index, slots_.data() + slots_.size());
+    }
+
+    template <typename K>
+    bool contains(const K& key) const {
+        return locate(static_cast<const lookup_key_t<K>&>(key)) != npos;
+    }
+
+    // 插入（键已存在时不修改），返回元素的迭代器和是否插入。
+    // 先查找，只有需要新槽位时才扩容，键已存在时迭代器和引用保持有效
+    template <typename K, typename... Args>
+    std::pair<iterator, bool> try_emplace(K&& key, Args&&... args) {
+        size_t hash = Hash{}(key);
+        size_t index = npos;
+        if (!slots_.empty()) {
+            size_t mask = slots_.size() - 1;
+            for (index = position(hash);; index = (index + 1) & mask) {
+                Slot& slot = slots_[index];
+                if (!slot.occupied) {
+                    break;
+                }
+                if (slot.hash == hash && KeyEqual{}(slot.entry.first, key)) {
+                    return {iterator(&slot, slots_.data() + slots_.size()), false};
+                }
+            }
+        }
+        if ((size_ + 1) * 8 > slots_.size() * 7) {
+            rehash(slots_.empty() ? 16 : slots_.size() * 2);
+            size_t mask = slots_.size() - 1;
+            for (index = position(hash); slots_[index].occupied; index = (index + 1) & mask) {
+            }
+        }
+
+        Slot& slot = slots_[index];
+        slot.hash = hash;
+        slot.occupied = true;
+        slot.entry.first = Key(std::forward<K>(key));
+        slot.entry.second = Value(std::forward<Args>(args)...);
+        ++size_;
+        return {iterator(&slot, slots_.data() + slots_.size()), true};
+    }
+
+    template <typename K>
+    Value& operator[](K&& key) {
+        return try_emplace(std::forward<K>(key)).first->second;
+    }
+
+    // 删除it指向的元素，后面探测链上的元素前移填补空位
+    void erase(const_iterator it) {
+        size_t mask = slots_.size() - 1;
+        size_t hole = static_cast<size_t>(it.slot_ - slots_.data());
+        for (size_t next = (hole + 1) & mask; slots_[next].occupied; next = (next + 1) & mask) {
+            // next的理想位置不在(hole, next]之间时可以移到hole
+            size_t ideal = position(slots_[next].hash);
+            if (((next - ideal) & mask) >= ((next - hole) & mask)) {
+                slots_[hole] = std::move(slots_[next]);
+                hole = next;
+            }
+        }
+        slots_[hole] = Slot();
+        --size_;
+    }
+
+    void erase(iterator it) { erase(const_iterator(it)); }
+
+    template <typename K>
+    size_t erase(const K& key) {
+        size_t index = locate(static_cast<const lookup_key_t<K>&>(key));
+        if (index == npos) {
+            return 0;
+        }
+        erase(const_iterator(slots_.data() + index, slots_.data() + slots_.size()));
+        return 1;
+    }
+
+private:
+    static constexpr size_t npos = static_cast<size_t>(-1);
+
+    size_t position(size_t hash) const {
+        return static_cast<size_t>((static_cast<uint64_t>(hash) * 0x9E3779B97F4A7C15ull) >> shift_);
+    }
+
+    template <typename K>
+    size_t locate(const K& key) const {
+        if (size_ == 0) {
+            return npos;
+        }
+        size_t hash = Hash{}(key);
+        size_t mask = slots_.size() - 1;
+        for (size_t index = position(hash);; index = (index + 1) & mask) {
+            const Slot& slot = slots_[index];
+            if (!slot.occupied) {
+                return npos;
+            }
+            if (slot.hash == hash && KeyEqual{}(slot.entry.first, key)) {
+                return index;
+            }
+        }
+    }
+
+    void rehash(size_t capacity) {
+        std::vector<Slot> old(capacity);
+        old.swap(slots_);
+        shift_ = 64;
+        for (size_t bits = capacity; bits > 1; bits >>= 1) {
+            --shift_;
+        }
+        size_t mask = capacity - 1;
+        for (auto& slot : old) {
+            if (!slot.occupied) {
+                continue;
+            }
+            size_t index = position(slot.hash);
+            while (slots_[index].occupied) {
+                index = (index + 1) & mask;
+            }
+            slots_[index] = std::move(slot);
+        }
+    }
+
+    std::vector<Slot> slots_;
+    size_t size_ = 0;
+    int shift_ = 64;
+};
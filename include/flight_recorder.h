@@ -0,0 +1,127 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+/**
+ * @brief 飞行记录器的配置
+ */
+struct FlightRecorderOptions {
+    // 每个线程环形缓冲区的事件数量（向上取整到2的幂，每个事件32字节）
+    size_t events_per_thread = 1 << 16;
+
+    // 最多记录的线程数量（线程退出后它的缓冲区会被新线程复用）
+    size_t max_threads = 256;
+
+    // 转储文件路径；收到dump_signal或崩溃时写入这里（崩溃时追加".crash"后缀）
+    std::string dump_path = "actor_flight.bin";
+
+    // 触发按需转储的信号，0表示不安装
+    int dump_signal = 0;
+
+    // 是否在SIGSEGV、SIGBUS、SIGFPE、SIGILL、SIGABRT时转储
+    bool dump_on_crash = true;
+};
+
+/**
+ * @brief FlightRecorder类 - 常开的调度事件飞行记录器
+ *
+ * 每个线程有一个固定大小的环形缓冲区，只由该线程写入：记录一个事件只需要读时间戳计数器、
+ * 写32字节和一次release存储，不加锁也不分配内存，缓冲区满后覆盖最旧的事件。
+ * 转储只使用async-signal-safe的系统调用，因此可以在信号处理函数（包括崩溃信号）中执行；
+ * 转储与记录并发进行，读取期间可能被覆盖的事件会在文件中标出并由解码方丢弃。
+ *
+ * 记录器是进程级的，install之后一直有效，不支持卸载。
+ */
+class FlightRecorder {
+public:
+    enum class EventType : uint16_t {
+        PICK = 1,     // 调度器选中Actor：value为候选数量，aux为worker编号
+        ENQUEUE = 2,  // 消息进入邮箱：value为入队后的邮箱深度
+        DEQUEUE = 3,  // 取出消息准备处理：value为剩余邮箱深度
+        HANDLED = 4,  // 处理函数返回：value为耗时（时间戳计数器单位，解码时换算为纳秒）
+        STATE = 5,    // 生命周期状态变化：value为旧状态，aux为新状态
+        DROPPED = 6   // 邮箱拒绝或丢弃消息：value为数量
+    };
+
+    // 安装记录器（只有第一次调用生效），返回是否成功安装
+    static bool install(const FlightRecorderOptions& options = FlightRecorderOptions());
+
+    // 是否正在记录
+    static bool enabled() { return enabled_.load(std::memory_order_relaxed); }
+
+    // 暂停或恢复记录（已安装时有效）
+    static void set_enabled(bool enabled);
+
+    // 读取时间戳计数器（x86上为TSC，其他平台为单调时钟纳秒）
+    static uint64_t timestamp();
+
+    // 记录一个事件
+    static void record(EventType type, uint64_t actor, uint64_t value = 0, uint32_t aux = 0) {
+        if (enabled()) {
+            record_at(timestamp(), type, actor, value, aux);
+        }
+    }
+
+    // 使用已读取的时间戳记录事件
+    static void record_at(uint64_t timestamp, EventType type, uint64_t actor, uint64_t value, uint32_t aux);
+
+    // 登记Actor序号对应的名称和ID，供解码时显示
+    static void note_actor(uint64_t serial, const std::string& name, const std::string& id);
+
+    // 按需转储到文件，返回是否成功
+    static bool dump(const std::string& path);
+
+    // 转储到已打开的文件描述符（async-signal-safe），reason为触发转储的信号（按需转储为0）
+    static bool dump_to_fd(int fd, int reason = 0);
+
+private:
+    static std::atomic<bool> enabled_;
+};
+
+// 解码后的单个事件
+struct FlightEvent {
+    FlightRecorder::EventType type = FlightRecorder::EventType::PICK;
+
+    // 记录线程在转储中的编号和系统线程ID
+    uint32_t thread = 0;
+    uint64_t tid = 0;
+
+    // 距离转储时刻的纳秒数（越早越大）
+    int64_t ns_before_dump = 0;
+
+    uint64_t actor = 0;
+    uint64_t value = 0;
+    uint32_t aux = 0;
+};
+
+// 解码后的转储文件
+struct FlightDump {
+    uint32_t pid = 0;
+
+    // 触发转储的信号（按需转储为0）
+    int reason = 0;
+
+    // 每纳秒的时间戳计数
+    double ticks_per_ns = 1.0;
+
+    // 每个线程缓冲区的容量
+    uint64_t capacity = 0;
+
+    // 因读取期间被覆盖而丢弃的事件数量
+    uint64_t torn_events = 0;
+
+    // Actor序号到名称、ID的映射
+    std::vector<std::pair<uint64_t, std::pair<std::string, std::string>>> actors;
+
+    // 按时间先后排序的事件
+    std::vector<FlightEvent> events;
+};
+
+// 读取转储文件，格式错误时抛出std::runtime_error
+FlightDump read_flight_dump(const std::string& path);
+
+// 事件类型名称
+const char* flight_event_name(FlightRecorder::EventType type);
@@ -0,0 +1,60 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <ostream>
+
+/**
+ * @brief LatencyHistogram类 - HDR风格的对数线性直方图
+ *
+ * 小于128的值精确记录；更大的值按2的幂分段，每段再线性分成64个桶，
+ * 相对误差不超过1/64（约1.6%），可以覆盖完整的int64_t范围。
+ * 记录路径只有一次relaxed原子加法，可以在多个worker上并发记录而不加锁；
+ * 读取（分位数、输出）与记录并发时得到的是近似一致的结果。
+ */
+class LatencyHistogram {
+public:
+    LatencyHistogram();
+
+    // 记录一个值（负值按0记录）
+    void record(int64_t value, uint64_t count = 1);
+
+    // 合并另一个直方图
+    void merge(const LatencyHistogram& other);
+
+    // 清空所有计数
+    void reset();
+
+    // 记录的样本总数
+    uint64_t count() const { return total_count_.load(std::memory_order_relaxed); }
+
+    // 最小值和最大值（没有样本时为0）
+    int64_t min() const;
+    int64_t max() const;
+
+    // 平均值
+    double mean() const;
+
+    // 分位数对应的值（percentile取0~100），返回所在桶的上界
+    int64_t value_at_percentile(double percentile) const;
+
+    // 以HdrHistogram的.hgrm文本格式输出百分位分布，value_scale用于换算单位（如1000表示ns→us）
+    void write_percentile_distribution(std::ostream& out, double value_scale = 1.0) const;
+
+private:
+    static constexpr int kSubBucketBits = 7;
+    static constexpr int64_t kSubBucketCount = int64_t(1) << kSubBucketBits;
+    static constexpr int64_t kHalfCount = kSubBucketCount / 2;
+    static constexpr size_t kBucketCount = static_cast<size_t>((64 - kSubBucketBits) * kHalfCount + kSubBucketCount);
+
+    static size_t index_of(int64_t value);
+    static int64_t lowest_value_at(size_t index);
+    static int64_t highest_value_at(size_t index);
+
+    std::array<std::atomic<uint64_t>, kBucketCount> counts_;
+    std::atomic<uint64_t> total_count_;
+    std::atomic<int64_t> min_;
+    std::atomic<int64_t> max_;
+    std::atomic<int64_t> sum_;
+};
@@ -0,0 +1,70 @@
+#pragma once
+
+#include <cstddef>
+#include <memory>
+#include <memory_resource>
+#include <mutex>
+#include <vector>
+
+/**
+ * @brief 大页的使用方式
+ *
+ * TRANSPARENT：按2 MB对齐映射后madvise(MADV_HUGEPAGE)，由内核的透明大页在缺页时或后台合并为大页；
+ * EXPLICIT：MAP_HUGETLB从预留的大页池（/proc/sys/vm/nr_hugepages）映射，失败时退回TRANSPARENT；
+ * OFF：普通的4 KB页。内核不支持或拒绝时都退回下一种方式，不会失败。
+ */
+enum class HugePageMode {
+    OFF,
+    TRANSPARENT,
+    EXPLICIT
+};
+
+/**
+ * @brief HugePageArena类 - 从大页支持的大块映射中按指针递增分配的内存资源
+ *
+ * 每次向系统映射region_bytes（2 MB的整数倍）的区域，按对齐要求依次切出，释放什么也不做，
+ * 所有区域在析构时一起解除映射。适合作为std::pmr池资源的上游：池只在自身销毁时才把块还给上游，
+ * 邮箱节点、消息负载和统计槽位这些大量的小对象因此集中在少数大页里，减少TLB缺失。
+ * 超过区域大小的分配单独映射一个区域。所有函数都是线程安全的。
+ */
+class HugePageArena : public std::pmr::memory_resource {
+public:
+    static constexpr size_t kHugePageBytes = 2 * 1024 * 1024;
+
+    explicit HugePageArena(HugePageMode mode = HugePageMode::TRANSPARENT, size_t region_bytes = 32 * 1024 * 1024);
+    ~HugePageArena() override;
+
+    HugePageArena(const HugePageArena&) = delete;
+    HugePageArena& operator=(const HugePageArena&) = delete;
+
+    HugePageMode mode() const { return mode_; }
+
+    // 已映射的字节数，以及其中以大页方式映射（MAP_HUGETLB或madvise被接受）的字节数
+    size_t mapped_bytes() const;
+    size_t huge_bytes() const;
+
+private:
+    struct Region {
+        char* base;
+        size_t size;
+    };
+
+    void* do_allocate(size_t bytes, size_t alignment) override;
+    void do_deallocate(void*, size_t, size_t) override {}
+    bool do_is_equal(const std::pmr::memory_resource& other) const noexcept override { return this == &other; }
+
+    // 映射至少size字节的区域，按mode_依次退回
+    Region map_region(size_t size);
+
+    HugePageMode mode_;
+    size_t region_bytes_;
+    mutable std::mutex mutex_;
+    std::vector<Region> regions_;
+    char* next_ = nullptr;
+    char* end_ = nullptr;
+    size_t huge_bytes_ = 0;
+};
+
+// 以HugePageArena为上游的线程安全池资源（池持有区域），可以直接交给EventLoop::set_memory_resources
+std::shared_ptr<std::pmr::memory_resource> make_huge_page_pool(HugePageMode mode,
+                                                               size_t region_bytes = 32 * 1024 * 1024);
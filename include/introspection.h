@@ -0,0 +1,64 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+#include "actor.h"
+
+class EventLoop;
+
+// 快照中Actor的排序方式
+enum class SnapshotOrder {
+    BACKLOG,       // 邮箱深度，相同时按最高待处理优先级
+    HANDLER_TIME,  // 处理函数累计耗时
+    PROCESSED      // 已处理消息数量
+};
+
+// 快照中的一个Actor
+struct ActorSnapshot {
+    std::string id;
+    std::string name;
+    uint64_t serial = 0;
+    Actor::State state = Actor::State::CREATED;
+    ActorStats stats;
+};
+
+/**
+ * @brief SystemSnapshot结构体 - 事件循环中所有Actor的一次快照（见EventLoop::snapshot）
+ *
+ * 各Actor的统计分别用seqlock读取，每个Actor自身是一致的，不同Actor之间不是同一时刻的值。
+ */
+struct SystemSnapshot {
+    // 开始拍摄的时间（Unix纳秒）
+    int64_t taken_ns = 0;
+
+    // 拍摄耗时
+    int64_t scan_ns = 0;
+
+    // 已注册的Actor数量和所有邮箱中的消息总数
+    uint64_t actor_count = 0;
+    uint64_t total_backlog = 0;
+
+    // 在途消息数量
+    uint64_t in_flight = 0;
+
+    // 按排序方式取前N个Actor
+    std::vector<ActorSnapshot> actors;
+};
+
+// 状态名称（CREATED、RUNNING等）
+const char* actor_state_name(Actor::State state);
+
+// 排序方式的名称（backlog、busy、processed）和解析，无法识别时返回false
+const char* snapshot_order_name(SnapshotOrder order);
+bool parse_snapshot_order(const std::string& name, SnapshotOrder& order);
+
+// 序列化为按行的文本格式（首行为汇总，之后每个Actor一行、字段以制表符分隔），用于HTTP端点
+std::string format_snapshot(const SystemSnapshot& snapshot);
+
+// 解析format_snapshot的输出，格式错误时抛出std::runtime_error
+SystemSnapshot parse_snapshot(const std::string& text);
+
+// 处理快照请求：query为URL中'?'之后的部分，支持top=N（默认20，0表示全部）和sort=backlog|busy|processed
+std::string handle_snapshot_request(EventLoop& event_loop, const std::string& query);
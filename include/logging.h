@@ -0,0 +1,24 @@
+#pragma once
+
+/**
+ * @brief 运行时日志级别
+ *
+ * 生命周期日志（INFO）写到std::cout，投递失败、状态错误等警告（WARN）写到std::cerr。
+ * 默认级别为INFO；压测和命令行工具可以调高级别，避免日志淹没输出和影响测量。
+ */
+enum class LogLevel {
+    INFO = 0,
+    WARN = 1,
+    OFF = 2
+};
+
+// 设置全局日志级别
+void set_log_level(LogLevel level);
+
+// 获取全局日志级别
+LogLevel get_log_level();
+
+// 指定级别的日志是否需要输出
+inline bool log_enabled(LogLevel level) {
+    return static_cast<int>(level) >= static_cast<int>(get_log_level());
+}
@@ -0,0 +1,274 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <deque>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+class EventLoop;
+
+// 成员状态（数值越大优先级越高：同一incarnation下SUSPECT覆盖ALIVE，DEAD/LEFT覆盖SUSPECT）
+enum class MemberStatus : uint8_t {
+    ALIVE = 0,
+    SUSPECT = 1,
+    DEAD = 2,
+    LEFT = 3
+};
+
+// 状态名称（alive、suspect、dead、left）
+const char* member_status_name(MemberStatus status);
+
+// 一个集群成员的当前视图
+struct Member {
+    // 节点名称（未指定时与address相同）
+    std::string name;
+
+    // "IP:端口"，同时是成员的唯一标识
+    std::string address;
+
+    MemberStatus status = MemberStatus::ALIVE;
+
+    // 成员自己维护的版本号，被怀疑时递增以反驳
+    uint64_t incarnation = 0;
+
+    // 对该成员的phi值（本节点为0）
+    double phi = 0.0;
+};
+
+/**
+ * @brief PhiAccrualDetector类 - phi累积故障检测器
+ *
+ * 记录最近window次心跳间隔，假设间隔服从正态分布，phi = -log10(P(间隔 > 距上次心跳的时间))。
+ * phi为1时误判概率约10%，为8时约1e-8。间隔的标准差至少为min_stddev，避免心跳非常规律时过于敏感；
+ * 距上次心跳的时间先扣除acceptable_pause，容忍不规律的流量（如大集群中成员间的直接通信）。
+ * 还没有间隔样本时phi为0。
+ */
+class PhiAccrualDetector {
+public:
+    explicit PhiAccrualDetector(size_t window = 100,
+                                std::chrono::milliseconds min_stddev = std::chrono::milliseconds(50),
+                                std::chrono::milliseconds acceptable_pause = std::chrono::milliseconds(0));
+
+    // 记录一次心跳
+    void heartbeat(std::chrono::steady_clock::time_point now);
+
+    // 当前的phi值
+    double phi(std::chrono::steady_clock::time_point now) const;
+
+    // 已记录的间隔数量
+    size_t samples() const { return intervals_.size(); }
+
+private:
+    size_t window_;
+    double min_stddev_ms_;
+    double acceptable_pause_ms_;
+    std::deque<double> intervals_;
+    double sum_ = 0.0;
+    double sum_squares_ = 0.0;
+    bool has_last_ = false;
+    std::chrono::steady_clock::time_point last_;
+};
+
+/**
+ * @brief 成员协议的配置
+ */
+struct MembershipOptions {
+    // 节点名称，为空时使用"IP:端口"
+    std::string name;
+
+    // 监听地址（IPv4，也是通告给其他节点的地址，不能是0.0.0.0）和端口（0表示由系统分配）
+    std::string bind_address = "127.0.0.1";
+    uint16_t port = 0;
+
+    // 种子节点（"IP:端口"），启动时向它们请求完整的成员列表
+    std::vector<std::string> seeds;
+
+    // 协议周期：每个周期探测一个成员
+    std::chrono::milliseconds protocol_period{200};
+
+    // 直接探测的超时，超时后请indirect_probes个成员代为探测
+    std::chrono::milliseconds ack_timeout{60};
+    size_t indirect_probes = 3;
+
+    // 怀疑超时 = suspicion_multiplier * max(1, log10(成员数)) * protocol_period，超时未被反驳则判定为DEAD
+    size_t suspicion_multiplier = 4;
+
+    // 有足够心跳样本（至少8个间隔）的成员phi超过该值时直接怀疑它
+    double phi_threshold = 8.0;
+
+    // 每条成员变化被附带发送的次数 = retransmit_multiplier * ceil(log10(成员数 + 1))
+    size_t retransmit_multiplier = 3;
+
+    // 单个UDP包的上限（附带的成员变化和完整成员列表按此拆分）
+    size_t max_packet_bytes = 1400;
+
+    // 与随机成员交换完整成员列表的间隔（修复丢失的变化和网络分区）
+    std::chrono::milliseconds sync_interval{10000};
+
+    // DEAD/LEFT成员在列表中保留的时间，期间旧的ALIVE消息不能让它复活
+    std::chrono::milliseconds dead_retention{30000};
+};
+
+/**
+ * @brief Membership类 - 基于SWIM的去中心化集群成员协议
+ *
+ * 每个节点在后台线程上运行，通过UDP通信：
+ * 1. 每个协议周期按随机轮转顺序PING一个成员，ack_timeout内没有ACK时请几个成员代为PING（PING_REQ），
+ *    到周期结束仍没有ACK则怀疑该成员（SUSPECT）；
+ * 2. 另外对每个成员直接发来的包做phi累积检测，phi超过阈值也会怀疑它；
+ * 3. 被怀疑的成员在怀疑超时内没有用更大的incarnation反驳，就被判定为DEAD；
+ * 4. 成员变化附带在PING/ACK等协议包中传播（每条变化发送有限次数），没有单独的广播；
+ *    新节点向种子请求完整列表，之后定期与随机成员交换列表。
+ *
+ * 包使用紧凑的二进制编码（地址6字节、incarnation为变长整数、名称与地址相同时省略），
+ * 单个节点每个周期只发送常数个小包，100个以上节点时后台流量依然很低。
+ *
+ * 成员变化以消息形式投递给订阅的Actor：member_up、member_suspect、member_down、member_left，
+ * 负载为node（名称）、address、incarnation（uint64_t）和status（字符串）。
+ */
+class Membership {
+public:
+    // 绑定端口并启动后台线程，失败时抛出std::runtime_error
+    explicit Membership(MembershipOptions options);
+    ~Membership();
+
+    Membership(const Membership&) = delete;
+    Membership& operator=(const Membership&) = delete;
+
+    // 本节点的名称和地址
+    const std::string& name() const { return name_; }
+    const std::string& address() const { return address_; }
+    uint16_t port() const { return port_; }
+
+    // 所有已知成员（包括本节点和保留期内的DEAD/LEFT成员），按地址排序
+    std::vector<Member> members() const;
+
+    // ALIVE成员数量（包括本节点）
+    size_t alive_count() const;
+
+    // 订阅成员变化：先为当前每个ALIVE成员投递一条member_up，之后投递每次状态变化
+    void subscribe(std::weak_ptr<EventLoop> event_loop, const std::string& actor_id);
+
+    // 取消订阅
+    void unsubscribe(const std::string& actor_id);
+
+    // 主动离开：把LEFT状态发给所有成员并停止，其他节点不需要等待故障检测
+    void leave();
+
+    // 停止后台线程（不通知其他节点，对它们而言相当于本节点崩溃）
+    void stop();
+
+    // 流量统计
+    uint64_t packets_sent() const { return packets_sent_; }
+    uint64_t bytes_sent() const { return bytes_sent_; }
+    uint64_t packets_received() const { return packets_received_; }
+
+    // 投递给订阅者的消息类型
+    static constexpr const char* kMemberUp = "member_up";
+    static constexpr const char* kMemberSuspect = "member_suspect";
+    static constexpr const char* kMemberDown = "member_down";
+    static constexpr const char* kMemberLeft = "member_left";
+
+private:
+    // 一个远端成员的本地状态
+    struct MemberState {
+        Member info;
+        uint32_t ip = 0;    // 网络字节序
+        uint16_t port = 0;  // 主机字节序
+        PhiAccrualDetector detector;
+        std::chrono::steady_clock::time_point changed_at;
+
+        // 最近一次计入检测器的心跳（同一批到达的多个包只计一次）
+        std::chrono::steady_clock::time_point last_heard;
+    };
+
+    // 待附带发送的成员变化
+    struct Update {
+        Member member;
+        uint32_t ip = 0;
+        uint16_t port = 0;
+        size_t transmits = 0;
+    };
+
+    // 正在进行的探测
+    struct Probe {
+        std::string target;
+        uint32_t sequence = 0;
+        std::chrono::steady_clock::time_point sent_at;
+        bool indirect_sent = false;
+        bool acked = false;
+    };
+
+    // 代其他成员转发的探测：目标回复ACK后转给请求者
+    struct Relay {
+        uint32_t requester_ip = 0;
+        uint16_t requester_port = 0;
+        uint32_t requester_sequence = 0;
+        std::chrono::steady_clock::time_point expires_at;
+    };
+
+    // 投递给订阅者的一次变化
+    struct Event {
+        const char* type;
+        Member member;
+    };
+
+    void run();
+    void tick(std::chrono::steady_clock::time_point now, std::vector<Event>& events);
+    void handle_packet(const uint8_t* data, size_t size, uint32_t ip, uint16_t port,
+                       std::chrono::steady_clock::time_point now, std::vector<Event>& events);
+
+    // 以下函数要求持有mutex_
+    void send_packet(uint8_t type, uint32_t sequence, uint32_t ip, uint16_t port,
+                     uint32_t target_ip = 0, uint16_t target_port = 0);
+    void send_raw(const std::string& packet, uint32_t ip, uint16_t port);
+    void send_sync(uint8_t type, uint32_t ip, uint16_t port);
+    void apply_update(const Member& update, uint32_t ip, uint16_t port,
+                      std::chrono::steady_clock::time_point now, std::vector<Event>& events);
+    void set_status(MemberState& state, MemberStatus status, uint64_t incarnation,
+                    std::chrono::steady_clock::time_point now, std::vector<Event>& events);
+    void enqueue_update(const Member& member, uint32_t ip, uint16_t port);
+    void refute(uint64_t incarnation);
+    size_t live_members() const;
+    std::chrono::milliseconds suspicion_timeout() const;
+    std::vector<std::string> pick_random(size_t count, const std::string& exclude);
+
+    void deliver(const std::vector<Event>& events);
+
+    MembershipOptions options_;
+    std::string name_;
+    std::string address_;
+    uint32_t ip_;
+    uint16_t port_;
+    int fd_;
+
+    mutable std::mutex mutex_;
+    uint64_t incarnation_ = 0;
+    std::map<std::string, MemberState> members_;
+    std::map<std::string, Update> updates_;
+    std::vector<std::string> probe_order_;
+    size_t probe_index_ = 0;
+    Probe probe_;
+    bool probing_ = false;
+    std::map<uint32_t, Relay> relays_;
+    uint32_t next_sequence_ = 1;
+    std::chrono::steady_clock::time_point next_sync_;
+    std::mt19937_64 random_;
+
+    std::mutex subscribers_mutex_;
+    std::vector<std::pair<std::weak_ptr<EventLoop>, std::string>> subscribers_;
+
+    std::atomic<uint64_t> packets_sent_{0};
+    std::atomic<uint64_t> bytes_sent_{0};
+    std::atomic<uint64_t> packets_received_{0};
+
+    std::atomic<bool> running_;
+    std::thread thread_;
+};
@@ -6,6 +6,28 @@
 #include <map>
 #include <any>  // C++17标准库，需要确保编译器支持
 #include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <memory_resource>
+#include <stdexcept>
+#include <type_traits>
+#include <utility>
+
+/**
+ * @brief TraceContext结构体 - 随消息传播的追踪上下文（W3C Trace Context的紧凑形式）
+ *
+ * trace_id标识一次请求经过的所有消息；span_id是发送这条消息时所在的span，
+ * 接收方为处理这条消息创建的span以它为父span（为0时接收方的span是根span）。
+ */
+struct TraceContext {
+    uint64_t trace_id_high = 0;
+    uint64_t trace_id_low = 0;
+    uint64_t span_id = 0;
+    bool sampled = false;
+
+    // trace_id全为0表示消息不在任何追踪中
+    bool valid() const { return trace_id_high != 0 || trace_id_low != 0; }
+};
 
 /**
  * @brief Message类 - Actor之间通信的基本单元
@@ -17,9 +39,22 @@
  * 4. 消息负载（可以是任意类型的数据）
  * 5. 时间戳
  * 6. 优先级
+ * 7. 追踪上下文（可选）
+ *
+ * 负载是std::pmr::map，节点从构造负载时指定的std::pmr::memory_resource分配（默认为
+ * std::pmr::get_default_resource()）。Message是分配器感知的类型：放进pmr容器（例如Actor的邮箱）
+ * 时负载改由容器的资源分配；复制时负载回到默认资源，移动时保持原来的资源。
+ * 类型和ID字符串以及负载的键仍是std::string（键通常短到不需要分配）。
+ * 仍然可以用std::map<std::string, std::any>构造消息，元素会转到默认资源上的Payload；
+ * get_payload()仍返回std::map（复制一份），不需要复制时使用get_pmr_payload()。
  */
 class Message {
 public:
+    // 消息负载：键 -> 任意类型的值
+    using Payload = std::pmr::map<std::string, std::any>;
+
+    using allocator_type = std::pmr::polymorphic_allocator<std::byte>;
+
     // 消息优先级枚举
     enum class Priority {
         LOW = 0,
@@ -32,8 +67,31 @@ public:
     Message(std::string type, 
             std::string sender_id, 
             std::string target_id,
-            std::map<std::string, std::any> payload = {},
+            Payload payload = {},
             Priority priority = Priority::NORMAL);
+
+    // 兼容以std::map构造负载的调用方（模板参数不能从花括号列表推导，{{"key", value}}仍然选择上面的构造函数）
+    template <typename Map,
+              typename = std::enable_if_t<std::is_same_v<std::decay_t<Map>, std::map<std::string, std::any>>>>
+    Message(std::string type,
+            std::string sender_id,
+            std::string target_id,
+            Map&& payload,
+            Priority priority = Priority::NORMAL)
+        : Message(std::move(type), std::move(sender_id), std::move(target_id), to_payload(std::forward<Map>(payload)),
+                  priority) {}
+
+    // 复制或移动到alloc指定的资源上（pmr容器构造元素时使用）
+    Message(const Message& other, const allocator_type& alloc);
+    Message(Message&& other, const allocator_type& alloc);
+
+    Message(const Message&) = default;
+    Message(Message&&) = default;
+    Message& operator=(const Message&) = default;
+    Message& operator=(Message&&) = default;
+
+    // 负载使用的分配器
+    allocator_type get_allocator() const { return payload_.get_allocator(); }
     
     // 获取消息类型
     const std::string& get_type() const { return type_; }
@@ -44,8 +102,13 @@ public:
     // 获取接收者ID
     const std::string& get_target_id() const { return target_id_; }
     
-    // 获取整个消息负载
-    const std::map<std::string, std::any>& get_payload() const { return payload_; }
+    // 获取整个消息负载（复制为std::map，兼容以std::map接收负载的调用方）
+    std::map<std::string, std::any> get_payload() const {
+        return std::map<std::string, std::any>(payload_.begin(), payload_.end());
+    }
+
+    // 获取整个消息负载，不复制
+    const Payload& get_pmr_payload() const { return payload_; }
     
     // 获取特定键的负载数据
     template<typename T>
@@ -89,12 +152,27 @@ public:
     // 设置消息优先级
     void set_priority(Priority priority) { priority_ = priority; }
     
+    // 获取追踪上下文（不在追踪中时valid()为false）
+    const TraceContext& get_trace_context() const { return trace_context_; }
+
+    // 设置追踪上下文
+    void set_trace_context(const TraceContext& context) { trace_context_ = context; }
+
     // 比较两个消息的优先级
     static bool compare_priority(const Message& a, const Message& b) {
         return static_cast<int>(a.priority_) < static_cast<int>(b.priority_);
     }
 
 private:
+    static Payload to_payload(const std::map<std::string, std::any>& payload) {
+        return Payload(payload.begin(), payload.end());
+    }
+
+    // 键是const不能移动，只移动值
+    static Payload to_payload(std::map<std::string, std::any>&& payload) {
+        return Payload(std::make_move_iterator(payload.begin()), std::make_move_iterator(payload.end()));
+    }
+
     // 消息类型
     std::string type_;
     
@@ -105,11 +183,14 @@ private:
     std::string target_id_;
     
     // 消息负载
-    std::map<std::string, std::any> payload_;
+    Payload payload_;
     
     // 消息创建时间戳
     std::chrono::system_clock::time_point created_at_;
     
     // 消息优先级
     Priority priority_;
+
+    // 追踪上下文
+    TraceContext trace_context_;
 }; 
\ No newline at end of file
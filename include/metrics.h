@@ -0,0 +1,176 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <utility>
+#include <vector>
+#include "histogram.h"
+
+// 指标的标签（按给定顺序输出）
+using MetricLabels = std::vector<std::pair<std::string, std::string>>;
+
+/**
+ * @brief Counter类 - 单调递增的计数器
+ *
+ * 记录路径只有一次relaxed原子加法。scale是输出时乘以的系数，
+ * 例如按纳秒计数、按秒输出时为1e-9。
+ */
+class Counter {
+public:
+    explicit Counter(double scale = 1.0) : value_(0), scale_(scale) {}
+
+    void inc(uint64_t count = 1) { value_.fetch_add(count, std::memory_order_relaxed); }
+
+    uint64_t value() const { return value_.load(std::memory_order_relaxed); }
+
+    double scale() const { return scale_; }
+
+private:
+    std::atomic<uint64_t> value_;
+    double scale_;
+};
+
+/**
+ * @brief Gauge类 - 可增可减的瞬时值
+ */
+class Gauge {
+public:
+    Gauge() : value_(0.0) {}
+
+    void set(double value) { value_.store(value, std::memory_order_relaxed); }
+
+    void add(double delta) {
+        double current = value_.load(std::memory_order_relaxed);
+        while (!value_.compare_exchange_weak(current, current + delta, std::memory_order_relaxed)) {
+        }
+    }
+
+    double value() const { return value_.load(std::memory_order_relaxed); }
+
+private:
+    std::atomic<double> value_;
+};
+
+/**
+ * @brief Summary类 - 基于LatencyHistogram的分位数摘要
+ *
+ * 输出0.5、0.9、0.99、0.999分位数以及_sum和_count，scale的含义与Counter相同。
+ */
+class Summary {
+public:
+    explicit Summary(double scale = 1.0) : scale_(scale) {}
+
+    void observe(int64_t value) { histogram_.record(value); }
+
+    const LatencyHistogram& histogram() const { return histogram_; }
+
+    double scale() const { return scale_; }
+
+private:
+    LatencyHistogram histogram_;
+    double scale_;
+};
+
+/**
+ * @brief MetricsRegistry类 - 指标注册表
+ *
+ * 指标在注册时创建并返回共享指针，之后的记录只操作原子变量，不经过注册表的锁。
+ * 渲染前会先调用收集回调，用于刷新需要现场采样的值（如邮箱深度）。
+ * 输出为Prometheus文本格式（version 0.0.4），指标族按名称排序。
+ */
+class MetricsRegistry {
+public:
+    using Collector = std::function<void()>;
+
+    // 获取或创建指标，同名指标的类型不一致时抛出std::invalid_argument
+    std::shared_ptr<Counter> counter(const std::string& name, const std::string& help,
+                                     const MetricLabels& labels = {}, double scale = 1.0);
+    std::shared_ptr<Gauge> gauge(const std::string& name, const std::string& help,
+                                 const MetricLabels& labels = {});
+    std::shared_ptr<Summary> summary(const std::string& name, const std::string& help,
+                                     const MetricLabels& labels = {}, double scale = 1.0);
+
+    // 移除一个时间序列（已持有的指针仍然有效，只是不再输出）
+    void remove(const std::string& name, const MetricLabels& labels);
+
+    // 注册收集回调，返回用于注销的编号
+    uint64_t add_collector(Collector collector);
+
+    // 注销收集回调；返回后保证该回调不会再被调用
+    void remove_collector(uint64_t id);
+
+    // 运行收集回调并渲染Prometheus文本格式
+    std::string render();
+
+    // 渲染并写入文件（先写临时文件再重命名，读取方不会看到写了一半的内容）
+    bool write_to_file(const std::string& path);
+
+    // 当前的时间序列数量
+    size_t series_count() const;
+
+private:
+    enum class Type { COUNTER, GAUGE, SUMMARY };
+
+    struct Family {
+        Type type;
+        std::string help;
+        std::map<MetricLabels, std::shared_ptr<Counter>> counters;
+        std::map<MetricLabels, std::shared_ptr<Gauge>> gauges;
+        std::map<MetricLabels, std::shared_ptr<Summary>> summaries;
+    };
+
+    static const char* type_name(Type type);
+
+    // 获取或创建指标族（调用者持有锁）
+    Family& family(const std::string& name, const std::string& help, Type type);
+
+    mutable std::mutex mutex_;
+    std::map<std::string, Family> families_;
+
+    // 渲染期间持有，注销回调时据此等待正在进行的渲染结束
+    std::mutex collectors_mutex_;
+    std::map<uint64_t, Collector> collectors_;
+    uint64_t next_collector_id_ = 1;
+};
+
+/**
+ * @brief EventLoop的指标配置
+ *
+ * 每个Actor的指标带actor标签。按名称标注时同名Actor共享时间序列；
+ * 超过max_actor_series个不同标签值之后，新的Actor都计入actor="_other"，避免标签基数失控。
+ */
+struct MetricsOptions {
+    enum class ActorLabel {
+        NAME,  // 使用Actor名称
+        ID,    // 使用Actor ID（Actor移除时对应的时间序列也被移除）
+        NONE   // 不区分Actor，只输出汇总
+    };
+
+    ActorLabel actor_label = ActorLabel::NAME;
+
+    // actor标签不同取值的上限
+    size_t max_actor_series = 256;
+
+    // 是否记录处理函数耗时分位数（每个时间序列约占30KB）
+    bool handler_latency = true;
+};
+
+/**
+ * @brief 单个Actor记录指标用的句柄（由EventLoop创建并关联到Actor）
+ */
+struct ActorMetrics {
+    // 该Actor计入的actor标签值
+    std::string label;
+
+    std::shared_ptr<Counter> processed;
+    std::shared_ptr<Counter> dropped;
+    std::shared_ptr<Gauge> mailbox_depth;
+
+    // 未启用处理耗时时为空
+    std::shared_ptr<Summary> handler_latency;
+};
@@ -0,0 +1,90 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+
+class MetricsRegistry;
+
+/**
+ * @brief MetricsHttpServer类 - 供Prometheus抓取的极简HTTP服务
+ *
+ * 在后台线程上逐个处理连接，GET /metrics（或/）返回注册表的文本格式，
+ * add_endpoint注册的路径由对应的回调生成响应，其余路径返回404。
+ * 只用于本机或内网抓取，不支持keep-alive和并发连接。
+ */
+class MetricsHttpServer {
+public:
+    // 端点回调：参数为URL中'?'之后的查询字符串，返回text/plain响应体
+    using Handler = std::function<std::string(const std::string& query)>;
+
+    // 绑定并开始监听，port为0时由系统分配端口；失败时抛出std::runtime_error
+    MetricsHttpServer(std::shared_ptr<MetricsRegistry> registry, uint16_t port = 0,
+                      const std::string& address = "127.0.0.1");
+    ~MetricsHttpServer();
+
+    MetricsHttpServer(const MetricsHttpServer&) = delete;
+    MetricsHttpServer& operator=(const MetricsHttpServer&) = delete;
+
+    // 实际监听的端口
+    uint16_t port() const { return port_; }
+
+    // 注册（或替换）GET端点，可以在服务运行期间调用；handler为空时移除该端点
+    void add_endpoint(const std::string& path, Handler handler);
+
+    // 停止服务并等待后台线程退出
+    void stop();
+
+private:
+    void serve();
+    void handle_connection(int fd);
+
+    std::shared_ptr<MetricsRegistry> registry_;
+    std::mutex endpoints_mutex_;
+    std::map<std::string, Handler> endpoints_;
+    int listen_fd_;
+    uint16_t port_;
+    std::atomic<bool> running_;
+    std::thread thread_;
+};
+
+/**
+ * @brief MetricsFileDumper类 - 定期把指标写入文件
+ *
+ * 适用于node_exporter的textfile收集器等按文件采集的场景。
+ * 每次写入先写临时文件再重命名；停止时会再写一次，保证文件包含最终值。
+ */
+class MetricsFileDumper {
+public:
+    MetricsFileDumper(std::shared_ptr<MetricsRegistry> registry, std::string path,
+                      std::chrono::milliseconds interval = std::chrono::seconds(10));
+    ~MetricsFileDumper();
+
+    MetricsFileDumper(const MetricsFileDumper&) = delete;
+    MetricsFileDumper& operator=(const MetricsFileDumper&) = delete;
+
+    // 停止定期写入并等待后台线程退出
+    void stop();
+
+    // 已完成的写入次数
+    uint64_t dump_count() const { return dump_count_; }
+
+private:
+    void run();
+
+    std::shared_ptr<MetricsRegistry> registry_;
+    std::string path_;
+    std::chrono::milliseconds interval_;
+    std::mutex mutex_;
+    std::condition_variable cv_;
+    bool stopping_;
+    std::atomic<uint64_t> dump_count_;
+    std::thread thread_;
+};
@@ -0,0 +1,106 @@
+#pragma once
+
+#include <cstdint>
+#include <type_traits>
+
+/**
+ * USDT静态探针（provider为actor_cpp）
+ *
+ * 与<sys/sdt.h>生成的格式相同：每个探针位置只有一条nop指令，探针的位置、参数位置和信号量地址
+ * 写在.note.stapsdt节中，bpftrace、perf、bcc等工具据此在运行中的进程上挂载uprobe，
+ * 不需要重新编译，也不需要额外的运行时库。未挂载时没有任何开销（除了参数已经在寄存器中的计算）。
+ *
+ * 每个探针有一个信号量，挂载工具会把它加一；参数需要额外计算的探针（如处理耗时）
+ * 用ACTOR_PROBE_ENABLED判断后再计算。
+ *
+ * 所有参数按8字节传递：字符串参数为const char*（bpftrace中用str(argN)读取），其余为整数。
+ * 探针列表：
+ *   receive(actor_id, type, depth)              消息进入邮箱
+ *   receive_reject(actor_id, type, state)       Actor不在运行状态，拒绝消息
+ *   process_begin(actor_id, type)               开始处理消息
+ *   process_end(actor_id, type, duration_ns)    处理结束（未计时时duration_ns为0）
+ *   deliver(target_id, type, sender_id)         事件循环投递成功
+ *   deliver_fail(target_id, type, reason)       投递失败，reason为shutdown、not_running、not_found或rejected
+ *   pick(actor_id, worker, candidates)          调度器选中Actor
+ *   state(actor_id, old_state, new_state)       生命周期状态变化
+ *
+ * 编译时未定义ACTOR_CPP_USDT（或不是x86-64/AArch64 Linux）时，所有探针展开为空语句。
+ */
+
+#define ACTOR_PROBE_LIST(X) \
+    X(receive)              \
+    X(receive_reject)       \
+    X(process_begin)        \
+    X(process_end)          \
+    X(deliver)              \
+    X(deliver_fail)         \
+    X(pick)                 \
+    X(state)
+
+#if defined(ACTOR_CPP_USDT) && defined(__linux__) && (defined(__x86_64__) || defined(__aarch64__)) && \
+    (defined(__GNUC__) || defined(__clang__))
+
+#define ACTOR_PROBES_AVAILABLE 1
+
+// 探针信号量（定义在probes.cpp，放在.probes节中，挂载工具据此找到并递增）
+#define ACTOR_PROBE_DECLARE_SEMAPHORE(name) extern "C" volatile unsigned short actor_cpp_##name##_semaphore;
+ACTOR_PROBE_LIST(ACTOR_PROBE_DECLARE_SEMAPHORE)
+#undef ACTOR_PROBE_DECLARE_SEMAPHORE
+
+// 把探针参数转换为8字节整数
+template <typename T>
+inline uint64_t actor_probe_arg(T value) {
+    if constexpr (std::is_pointer_v<T>) {
+        return reinterpret_cast<uintptr_t>(value);
+    } else {
+        return static_cast<uint64_t>(value);
+    }
+}
+
+// stapsdt版本3的note：探针地址、.stapsdt.base地址（用于预链接后的地址修正）、信号量地址、
+// provider、探针名和参数描述（"大小@操作数"，操作数由编译器按约束代入）
+#define ACTOR_PROBE_NOTE(name, args)                                                 \
+    "990: nop\n"                                                                     \
+    ".pushsection .note.stapsdt,\"?\",\"note\"\n"                                    \
+    ".balign 4\n"                                                                    \
+    ".4byte 992f-991f, 994f-993f, 3\n"                                               \
+    "991: .asciz \"stapsdt\"\n"                                                      \
+    "992: .balign 4\n"                                                               \
+    "993: .8byte 990b\n"                                                             \
+    ".8byte _.stapsdt.base\n"                                                        \
+    ".8byte actor_cpp_" #name "_semaphore\n"                                         \
+    ".asciz \"actor_cpp\"\n"                                                         \
+    ".asciz \"" #name "\"\n"                                                         \
+    ".asciz \"" args "\"\n"                                                          \
+    "994: .balign 4\n"                                                               \
+    ".popsection\n"                                                                  \
+    ".ifndef _.stapsdt.base\n"                                                       \
+    ".pushsection .stapsdt.base,\"aG\",\"progbits\",.stapsdt.base,comdat\n"          \
+    ".weak _.stapsdt.base\n"                                                         \
+    ".hidden _.stapsdt.base\n"                                                       \
+    "_.stapsdt.base: .space 1\n"                                                     \
+    ".size _.stapsdt.base, 1\n"                                                      \
+    ".popsection\n"                                                                  \
+    ".endif\n"
+
+#define ACTOR_PROBE_ENABLED(name) __builtin_expect(actor_cpp_##name##_semaphore != 0, 0)
+
+#define ACTOR_PROBE2(name, a1, a2)                                  \
+    __asm__ __volatile__(ACTOR_PROBE_NOTE(name, "8@%0 8@%1")        \
+                         :                                          \
+                         : "nor"(actor_probe_arg(a1)), "nor"(actor_probe_arg(a2)))
+
+#define ACTOR_PROBE3(name, a1, a2, a3)                                                  \
+    __asm__ __volatile__(ACTOR_PROBE_NOTE(name, "8@%0 8@%1 8@%2")                       \
+                         :                                                              \
+                         : "nor"(actor_probe_arg(a1)), "nor"(actor_probe_arg(a2)),      \
+                           "nor"(actor_probe_arg(a3)))
+
+#else
+
+#define ACTOR_PROBES_AVAILABLE 0
+#define ACTOR_PROBE_ENABLED(name) false
+#define ACTOR_PROBE2(name, a1, a2) do {} while (0)
+#define ACTOR_PROBE3(name, a1, a2, a3) do {} while (0)
+
+#endif
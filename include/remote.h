@@ -0,0 +1,209 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include "buffer.h"
+
+class EventLoop;
+class Message;
+
+/**
+ * @brief 消息的二进制编码
+ *
+ * 编码类型、发送者、接收者、优先级、追踪上下文和负载。负载值支持std::string、const char*
+ * （解码为std::string）、bool、int、int64_t、uint32_t、uint64_t、double和Buffer，
+ * 其他类型无法跨节点传递，encode_message抛出std::runtime_error。
+ * 创建时间不编码，解码出的消息以解码时刻为创建时间。
+ */
+std::string encode_message(const Message& message);
+
+// 解码encode_message的结果，数据不完整或格式错误时抛出std::runtime_error。
+// 第一种形式复制Buffer负载，第二种形式中的Buffer负载是data的子范围
+Message decode_message(const char* data, size_t size);
+Message decode_message(const Buffer& data);
+
+/**
+ * @brief 远程传输的配置
+ */
+struct RemoteOptions {
+    // 监听地址（IPv4，也是其他节点连接本节点使用的地址，不能是0.0.0.0）和端口（0表示由系统分配）
+    std::string bind_address = "127.0.0.1";
+    uint16_t port = 0;
+
+    // 单条消息编码后的上限，超过时发送方丢弃、接收方断开连接
+    size_t max_frame_bytes = 16 * 1024 * 1024;
+
+    // 每个连接等待发送的字节数上限（包括等待额度的消息），超过时新消息被丢弃（对端很慢或不可达）
+    size_t max_queued_bytes = 64 * 1024 * 1024;
+
+    // 发送方的额度窗口：每个连接、每个目标最多有多少条消息已发出但接收方还没有处理，
+    // 用完时消息在本地排队。link_credits为0时不做流量控制（接收方总是返还额度）
+    size_t link_credits = 4096;
+    size_t target_credits = 1024;
+
+    // 批量发送：连接上第一条等待发送的消息最多等待batch_window，等待发送的字节达到batch_bytes时立即发送，
+    // 已排队的帧用一次writev发出。batch_window为0时不等待（仍然合并已经排队的帧）
+    std::chrono::microseconds batch_window{0};
+    size_t batch_bytes = 64 * 1024;
+
+    // 一批消息达到compress_bytes字节时用LZ4压缩成一个帧（压缩后没有变小时照常发送），0表示不压缩。
+    // 接收方总是能解压
+    size_t compress_bytes = 0;
+};
+
+/**
+ * @brief RemoteTransport类 - 节点之间基于TCP的消息传输
+ *
+ * 节点以"IP:端口"标识。send()在调用线程编码消息并放入到目标节点的连接的发送队列，
+ * 连接在第一次发送时建立；后台I/O线程负责建立连接、发送和接收。
+ * 每个帧是4字节长度（大端）+ 1字节帧类型 + 内容，消息帧的内容是encode_message的结果。
+ * 同一对节点之间发给同一目标的消息按发送顺序到达。I/O线程按batch_window和batch_bytes积攒帧，
+ * 一次writev发出多个帧，开启compress_bytes时一批消息压缩成一个帧。
+ *
+ * Buffer负载不复制：发送时writev直接引用Buffer的内存，映射的文件用sendfile从页缓存发出；
+ * 接收时大的帧直接读入BufferPool分配的块，解码出的Buffer负载引用其中的字节。
+ *
+ * 收到的消息如果目标是通过add_endpoint注册的名称，交给对应的回调（在I/O线程上调用）；
+ * 否则按目标ID投递给本地事件循环中的Actor。发往本节点地址的消息直接在调用线程上按同样的规则投递。
+ *
+ * 投递语义是至多一次：连接断开时队列中的消息被丢弃并计数，下一次发送时重新建立连接。
+ *
+ * 基于额度的流量控制：接收方在目标Actor的邮箱排空时（发给端点或无法投递的消息在处理后立即）
+ * 经同一个连接返还额度，发送方的在途消息不超过link_credits条，发给每个目标的不超过target_credits条。
+ * 额度用完时消息在发送方按目标排队，队列超过max_queued_bytes时send()返回false，
+ * 过载因此被限制在发送方，双方的内存占用都有上限。一个目标处理得慢不会阻塞发给其他目标的消息。
+ */
+class RemoteTransport {
+public:
+    using Endpoint = std::function<void(const Message&)>;
+
+    // 绑定端口并启动I/O线程，失败时抛出std::runtime_error
+    explicit RemoteTransport(std::weak_ptr<EventLoop> event_loop, RemoteOptions options = RemoteOptions());
+    ~RemoteTransport();
+
+    RemoteTransport(const RemoteTransport&) = delete;
+    RemoteTransport& operator=(const RemoteTransport&) = delete;
+
+    // 本节点的地址（"IP:端口"）
+    const std::string& address() const { return address_; }
+    uint16_t port() const { return port_; }
+
+    // 为名称注册回调，目标为该名称的消息交给回调处理；endpoint为空时移除
+    void add_endpoint(const std::string& name, Endpoint endpoint);
+
+    // 异步发送给node，地址无效、队列已满或已停止时丢弃并返回false；负载无法编码时抛出std::runtime_error
+    bool send(const std::string& node, const Message& message);
+
+    // 关闭所有连接并停止I/O线程
+    void stop();
+
+    // 流量统计（消息数不含发往本节点的消息）
+    uint64_t messages_sent() const { return messages_sent_; }
+    uint64_t messages_received() const { return messages_received_; }
+    uint64_t messages_dropped() const { return messages_dropped_; }
+    uint64_t bytes_sent() const { return bytes_sent_; }
+
+    // 因为额度用完而在本地排队的消息数
+    uint64_t messages_deferred() const { return messages_deferred_; }
+
+    // 发送数据的系统调用次数，以及压缩节省的字节数
+    uint64_t write_calls() const { return write_calls_; }
+    uint64_t bytes_saved() const { return bytes_saved_; }
+
+private:
+    // 等待发送的帧：data之后依次发送attachments（Buffer负载的内容），
+    // messages为其中的消息数（额度帧为0，压缩帧为压缩前的消息数）
+    struct Frame {
+        std::string data;
+        std::vector<Buffer> attachments;
+        size_t messages = 0;
+        bool packed = false;  // 已经压缩过、压缩后没有变小或带有附件，不再尝试
+
+        size_t size() const;
+    };
+
+    // 发送方每个目标的额度状态
+    struct Target {
+        size_t in_flight = 0;
+        std::deque<Frame> waiting;
+    };
+
+    // 一个TCP连接：主动建立的发送消息、接收额度，接受的接收消息、返还额度
+    struct Connection {
+        std::string node;
+        bool outbound = false;
+        bool connecting = false;
+        std::string input;
+        std::deque<Frame> output;
+        size_t output_offset = 0;
+        size_t output_bytes = 0;
+        size_t queued_bytes = 0;
+        std::chrono::steady_clock::time_point batch_deadline;
+
+        // 发送方：在途消息数、各目标的状态和有消息在等待额度的目标（按开始等待的顺序）
+        size_t in_flight = 0;
+        std::map<std::string, Target> targets;
+        std::deque<std::string> blocked;
+
+        // 接收方：各目标已收到但还没有返还额度的消息数
+        std::map<std::string, size_t> unconsumed;
+
+        // 接收方：正在直接读入的大帧（不含长度）和已经读到的字节数
+        Buffer large;
+        size_t large_filled = 0;
+    };
+
+    void run();
+    void wake();
+    void dispatch(const Message& message);
+
+    // 以下函数要求持有mutex_
+    bool enqueue(Connection& connection, Frame frame);
+    bool ready(const Connection& connection, std::chrono::steady_clock::time_point now) const;
+    void compress(Connection& connection);
+    bool flush(Connection& connection, int fd);
+    bool receive(Connection& connection, int fd, std::vector<std::pair<int, Message>>& received);
+    bool parse_input(Connection& connection, int fd, std::vector<std::pair<int, Message>>& received);
+    void accept(Connection& connection, int fd, const char* data, size_t size, const Buffer* backing,
+                std::vector<std::pair<int, Message>>& received);
+    void grant(Connection& connection, const std::string& target, size_t count);
+    void release(Connection& connection);
+    bool return_credits();
+    void close_connection(int fd);
+
+    RemoteOptions options_;
+    std::weak_ptr<EventLoop> event_loop_;
+    std::string address_;
+    uint16_t port_;
+    int listen_fd_;
+    int wake_fd_;
+
+    std::mutex mutex_;
+    std::map<int, Connection> connections_;
+    std::map<std::string, int> outbound_;
+
+    std::mutex endpoints_mutex_;
+    std::map<std::string, Endpoint> endpoints_;
+
+    std::atomic<uint64_t> messages_sent_{0};
+    std::atomic<uint64_t> messages_received_{0};
+    std::atomic<uint64_t> messages_dropped_{0};
+    std::atomic<uint64_t> bytes_sent_{0};
+    std::atomic<uint64_t> messages_deferred_{0};
+    std::atomic<uint64_t> write_calls_{0};
+    std::atomic<uint64_t> bytes_saved_{0};
+
+    std::atomic<bool> running_;
+    std::thread thread_;
+};
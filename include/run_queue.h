@@ -0,0 +1,81 @@
+#pragma once
+
+#include <cstddef>
+#include <limits>
+#include <memory>
+#include <mutex>
+#include <shared_mutex>
+#include <vector>
+
+class Actor;
+class Scheduler;
+
+/**
+ * @brief RunQueueHook结构 - Actor在就绪队列中的位置（受所在队列的锁保护）
+ */
+struct RunQueueHook {
+    static constexpr size_t npos = std::numeric_limits<size_t>::max();
+
+    // FIFO链表中的前后节点
+    Actor* prev = nullptr;
+    Actor* next = nullptr;
+
+    // 在队列成员数组中的下标，不在队列中时为npos
+    size_t index = npos;
+};
+
+/**
+ * @brief RunQueues类 - 每个worker一个就绪队列
+ *
+ * Actor的邮箱从空变为非空时把自己放入序号 % worker数量 对应的队列末尾，worker从自己的队列中取出
+ * 一个Actor处理一条消息，仍有消息时再放回末尾，不需要扫描注册表。
+ * 每个队列是穿过Actor自身节点的FIFO链表，另有一个成员数组持有Actor的引用：
+ * 入队、出队和移除都是O(1)；按顺序轮询时直接取链表头部，其他调度器在成员数组上挑选，不复制候选列表。
+ * 队列之间按缓存行对齐，投递到不同worker的Actor不会争用同一把锁。
+ */
+class RunQueues {
+public:
+    explicit RunQueues(size_t worker_count = 1);
+    ~RunQueues();
+
+    RunQueues(const RunQueues&) = delete;
+    RunQueues& operator=(const RunQueues&) = delete;
+
+    // 把Actor放入它所在worker的队列末尾（已在队列中时什么也不做）
+    void push(std::shared_ptr<Actor> actor);
+
+    // 把Actor从它所在worker的队列中移除（不在队列中时什么也不做）
+    void remove(Actor& actor);
+
+    // 从worker的队列中取出一个Actor：scheduler为空时取头部，否则由调度器在队列成员中挑选
+    // （调度器有内部状态时由调用者加锁）。ready返回取出之前队列中的Actor数量，队列为空时返回nullptr
+    std::shared_ptr<Actor> pop(size_t worker_index, Scheduler* scheduler, size_t& ready);
+
+    // 调整worker数量并按序号重新分配队列中的Actor（保持各自的先后顺序），需要在worker未运行时调用
+    void resize(size_t worker_count);
+
+    // 清空所有队列（事件循环析构时调用，断开Actor和队列之间的引用环）
+    void clear();
+
+    // worker数量
+    size_t worker_count() const;
+
+private:
+    struct alignas(64) Queue {
+        mutable std::mutex mutex;
+        Actor* head = nullptr;
+        Actor* tail = nullptr;
+        std::vector<std::shared_ptr<Actor>> members;
+    };
+
+    // Actor所在的队列（调用者持有layout_mutex_）
+    Queue& queue_for(const Actor& actor) const;
+
+    // 在持有队列锁时链入末尾或摘下（摘下时返回队列持有的引用）
+    static void link(Queue& queue, std::shared_ptr<Actor> actor);
+    static std::shared_ptr<Actor> unlink(Queue& queue, Actor& actor);
+
+    // 保护队列数量；投递路径只取共享锁，resize时独占
+    mutable std::shared_mutex layout_mutex_;
+    std::vector<std::unique_ptr<Queue>> queues_;
+};
@@ -5,6 +5,10 @@
 #include <functional>
 #include <chrono>
 #include <queue>
+#include <random>
+#include <cstdint>
+#include <string>
+#include <unordered_map>
 
 class Actor;
 class Message;
@@ -22,6 +26,9 @@ public:
     
     // 选择下一个要处理消息的Actor
     virtual std::shared_ptr<Actor> next_actor(const std::vector<std::shared_ptr<Actor>>& actors) = 0;
+
+    // 是否等价于按就绪顺序轮流处理：是时事件循环直接取就绪队列头部，不调用next_actor也不加调度器锁
+    virtual bool is_fifo() const { return false; }
 };
 
 /**
@@ -36,6 +43,9 @@ public:
     // 实现轮询策略的next_actor方法
     std::shared_ptr<Actor> next_actor(const std::vector<std::shared_ptr<Actor>>& actors) override;
 
+    // 轮询即就绪队列的FIFO顺序
+    bool is_fifo() const override { return true; }
+
 private:
     // 当前Actor索引
     size_t current_index_;
@@ -101,4 +111,26 @@ private:
     
     // 最大允许的饥饿时间
     std::chrono::milliseconds max_starvation_time_;
-}; 
\ No newline at end of file
+};
+
+/**
+ * @brief RandomScheduler类 - 可设定种子的随机调度器
+ * 
+ * 从有消息的Actor中等概率随机选择一个。给定相同的种子和相同顺序的候选Actor，
+ * 选择序列完全相同，仿真模式下用它来复现调度行为。
+ */
+class RandomScheduler : public Scheduler {
+public:
+    explicit RandomScheduler(uint64_t seed = 0);
+    
+    // 随机选择下一个Actor
+    std::shared_ptr<Actor> next_actor(const std::vector<std::shared_ptr<Actor>>& actors) override;
+    
+private:
+    // 随机数生成器
+    std::mt19937_64 generator_;
+};
+
+// 按名称创建调度器：round-robin、priority、message-priority、fair、random
+// 名称未知时返回nullptr；seed只对random调度器有效
+std::shared_ptr<Scheduler> create_scheduler(const std::string& name, uint64_t seed = 0);
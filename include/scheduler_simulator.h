@@ -0,0 +1,105 @@
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <string>
+#include <vector>
+#include "trace.h"
+
+class Scheduler;
+
+/**
+ * @brief 单个Actor在仿真中的延迟统计
+ */
+struct ActorLatencyStats {
+    // 录制的目标Actor ID
+    std::string actor_id;
+
+    // 处理的消息数量
+    size_t messages = 0;
+
+    // 排队等待时间分位数（从到达到开始处理，纳秒）
+    int64_t wait_p50_ns = 0;
+    int64_t wait_p99_ns = 0;
+    int64_t wait_max_ns = 0;
+
+    // 平均等待时间（纳秒）
+    double wait_mean_ns = 0;
+
+    // 平均拉伸比：(等待 + 处理) / 处理，处理时间不足1us按1us计
+    double stretch_mean = 1.0;
+
+    // 处理函数占用worker的总时间（纳秒）
+    int64_t busy_ns = 0;
+
+    // 等待时间超过饥饿阈值的消息数量
+    size_t starved_messages = 0;
+};
+
+/**
+ * @brief 一次调度仿真的汇总报告
+ */
+struct SchedulerSimulationReport {
+    // 调度器名称
+    std::string scheduler;
+
+    // 处理的消息数量
+    size_t messages = 0;
+
+    // 从第一条消息到达到最后一条处理完成的仿真时长（纳秒）
+    int64_t makespan_ns = 0;
+
+    // 全部消息的等待时间分位数（纳秒）
+    int64_t wait_p50_ns = 0;
+    int64_t wait_p90_ns = 0;
+    int64_t wait_p99_ns = 0;
+    int64_t wait_max_ns = 0;
+
+    // 各Actor平均拉伸比的Jain公平性指数（1表示完全公平，1/n表示最不公平）
+    double jain_fairness = 1.0;
+
+    // 等待超过饥饿阈值的消息数量和涉及的Actor数量
+    size_t starved_messages = 0;
+    size_t starved_actors = 0;
+
+    // 各Actor的统计（按最大等待时间降序）
+    std::vector<ActorLatencyStats> actors;
+};
+
+/**
+ * @brief SchedulerSimulator类 - 基于录制轨迹的离线离散事件调度仿真器
+ *
+ * 仿真器不使用EventLoop：它为每个录制的目标创建代理Actor，按录制的到达时间把消息放入邮箱，
+ * 在虚拟时间中让若干个仿真worker反复调用Scheduler::next_actor做出决策，
+ * 处理耗时由耗时模型给出。一个Actor同一时刻只会被一个worker处理。
+ * 仿真期间安装虚拟时钟，因此依赖时间的调度器（如FairScheduler）也运行在仿真时间上。
+ */
+class SchedulerSimulator {
+public:
+    // 耗时模型：根据投递记录和录制（配对）的耗时返回仿真耗时
+    using CostModel = std::function<int64_t(const TraceEvent& delivery, int64_t recorded_cost_ns)>;
+
+    struct Options {
+        // 仿真worker数量
+        size_t worker_count = 1;
+
+        // 饥饿阈值：等待时间超过该值的消息计为饥饿
+        std::chrono::nanoseconds starvation_threshold = std::chrono::milliseconds(100);
+
+        // 耗时模型，为空时直接使用录制的耗时
+        CostModel cost_model;
+    };
+
+    SchedulerSimulator(std::vector<TraceEvent> events, Options options);
+
+    // 使用给定调度器运行一次仿真
+    SchedulerSimulationReport run(const std::string& scheduler_name,
+                                  const std::shared_ptr<Scheduler>& scheduler) const;
+
+private:
+    std::vector<TraceEvent> deliveries_;
+    std::vector<int64_t> recorded_costs_;
+    Options options_;
+};
@@ -0,0 +1,51 @@
+#pragma once
+
+#include <cstddef>
+#include <memory_resource>
+#include <vector>
+
+/**
+ * @brief ScratchArena类 - 按指针递增分配、整体重置的内存资源
+ *
+ * 分配只是把当前指针对齐后向前移动，释放什么也不做；reset()把指针退回第一个块的开头，
+ * 块本身保留给之后的分配复用，稳定之后不再向系统申请内存。当前块放不下时使用下一个保留的块，
+ * 都放不下时分配新块（至少block_bytes，单次大分配得到恰好够用的块）。
+ * reset()时保留的块超过max_retained_bytes的部分归还给系统，一次异常大的消息不会让内存一直占着。
+ *
+ * 不是线程安全的：每个worker线程各有一个，见Actor::scratch_arena()。
+ */
+class ScratchArena : public std::pmr::memory_resource {
+public:
+    explicit ScratchArena(size_t block_bytes = 64 * 1024, size_t max_retained_bytes = 1024 * 1024);
+    ~ScratchArena() override;
+
+    ScratchArena(const ScratchArena&) = delete;
+    ScratchArena& operator=(const ScratchArena&) = delete;
+
+    // 丢弃所有分配，之前分配的内存都不能再使用
+    void reset();
+
+    // 上次reset()之后分配的字节数（含对齐填充）
+    size_t used() const { return used_; }
+
+    // 保留的块的总字节数
+    size_t capacity() const;
+
+private:
+    struct Block {
+        char* data;
+        size_t size;
+    };
+
+    void* do_allocate(size_t bytes, size_t alignment) override;
+    void do_deallocate(void*, size_t, size_t) override {}
+    bool do_is_equal(const std::pmr::memory_resource& other) const noexcept override { return this == &other; }
+
+    size_t block_bytes_;
+    size_t max_retained_bytes_;
+    std::vector<Block> blocks_;
+    size_t current_ = 0;  // 正在使用的块
+    char* next_ = nullptr;
+    char* end_ = nullptr;
+    size_t used_ = 0;
+};
@@ -0,0 +1,199 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <shared_mutex>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "actor.h"
+
+class RemoteTransport;
+
+// 分片使用的64位哈希（FNV-1a后再做一次混合），所有节点上结果相同
+uint64_t shard_hash(const std::string& key);
+
+/**
+ * @brief HashRing类 - 带虚拟节点的一致性哈希环
+ *
+ * 每个节点在环上放virtual_nodes个点，哈希值属于顺时针方向第一个点的节点。
+ * 增删一个节点时只有约1/N的哈希值改变归属，并且都是移入或移出该节点。
+ */
+class HashRing {
+public:
+    explicit HashRing(size_t virtual_nodes = 100);
+
+    // 替换节点集合（顺序无关）
+    void set_nodes(std::vector<std::string> nodes);
+
+    // 当前节点（已排序）
+    const std::vector<std::string>& nodes() const { return nodes_; }
+
+    // 哈希值所属的节点，没有节点时返回空字符串
+    const std::string& node_for(uint64_t hash) const;
+
+private:
+    size_t virtual_nodes_;
+    std::vector<std::string> nodes_;
+    std::vector<std::pair<uint64_t, uint32_t>> points_;
+};
+
+/**
+ * @brief 分片区域的配置
+ */
+struct ShardingOptions {
+    // 实体类型，各节点上同一类型的区域互相通信
+    std::string type_name = "entity";
+
+    // 消息负载中实体键的字段名（值为std::string）
+    std::string key_field = "entity_key";
+
+    // 分片数量：键按哈希分到分片，分片按一致性哈希分到节点，所有节点必须相同
+    size_t shard_count = 256;
+    size_t virtual_nodes = 100;
+
+    // 接手分片时等待原所有者交接完成的最长时间（之后不再等待，直接开始处理缓冲的消息）
+    std::chrono::milliseconds handoff_timeout{2000};
+
+    // 每个分片缓冲的消息上限，超过时丢弃
+    size_t max_buffered = 10000;
+
+    // 节点视图不一致时一条消息最多被转发的次数，超过时暂存到该分片的路由变化
+    size_t max_hops = 3;
+};
+
+/**
+ * @brief 分片区域的统计
+ */
+struct ShardingStats {
+    uint64_t spawned = 0;           // 按需创建的实体
+    uint64_t forwarded = 0;         // 发往其他节点的消息
+    uint64_t buffered = 0;          // 交接期间缓冲的消息
+    uint64_t dropped = 0;           // 缓冲区满时丢弃的消息
+    uint64_t handoffs = 0;          // 本节点完成的分片交出
+    uint64_t handoff_timeouts = 0;  // 没等到原所有者交接完成就接手的分片
+};
+
+/**
+ * @brief ShardRegion类 - 把按键区分的实体Actor分布到集群各节点
+ *
+ * 消息负载中带有实体键（key_field），路由分两步：键的哈希对shard_count取模得到分片，
+ * 分片在一致性哈希环上的位置决定所属节点。每个节点根据成员变化独立计算路由，结果缓存在
+ * 每个分片的路由表项中，发送消息只需要一次哈希和一次数组访问，不需要询问任何协调者。
+ * 分片在所属节点上时，第一条消息到达时调用工厂创建实体Actor。
+ *
+ * 节点由RemoteTransport的地址标识：Membership的name必须设为transport->address()，
+ * 并用membership.subscribe(event_loop, region->get_id())把成员变化交给区域。
+ *
+ * 成员变化导致分片换主时按缓冲交接进行：
+ * 1. 原所有者不再向该分片的实体投递新消息（转发给新所有者），并在每个实体的邮箱末尾放一条停止消息，
+ *    所有实体处理完剩余消息后交接完成；
+ * 2. 新所有者缓冲收到的消息，直到交接完成（或handoff_timeout）后再按顺序投递；
+ * 3. 其他节点（包括新所有者自己的发送者）在交接完成之前仍然发给原所有者，由它转发。
+ *    换路由时沿旧路由发一个探测，原所有者交接完成后才把它转给新所有者，新所有者开始处理后回复；
+ *    收到回复时之前经旧路由发出的消息都已到达，之后直接发给新所有者也不会乱序。
+ * 刚启动的节点不知道分片之前在哪里，先缓冲自己负责的分片，直到handoff_timeout。
+ *
+ * tell()可以在任意线程调用。实体的状态不会迁移：新所有者上的实体是新创建的。
+ */
+class ShardRegion : public Actor {
+public:
+    using EntityFactory = std::function<std::shared_ptr<Actor>(const std::string& key, std::weak_ptr<EventLoop>)>;
+
+    // 区域内部的消息类型
+    static constexpr const char* kStopEntity = "shard_stop";
+    static constexpr const char* kEntityStopped = "shard_entity_stopped";
+    static constexpr const char* kHandoffTimeout = "shard_handoff_timeout";
+    static constexpr const char* kRouteProbe = "shard_route_probe";
+    static constexpr const char* kRouteAck = "shard_route_ack";
+
+    ShardRegion(ShardingOptions options, EntityFactory factory, std::weak_ptr<EventLoop> event_loop,
+                std::shared_ptr<RemoteTransport> transport);
+    ~ShardRegion() override;
+
+    // 注册远程端点并开始等待启动时的交接
+    void initialize() override;
+
+    // 把消息路由到负载中的键对应的实体（消息的目标ID被忽略），没有键时抛出std::runtime_error
+    void tell(const Message& message);
+
+    // 本节点的地址
+    const std::string& node() const { return node_; }
+
+    // 键所属的分片和当前的路由（消息发往的节点）
+    size_t shard_of(const std::string& key) const;
+    std::string route_of(const std::string& key) const;
+
+    // 本节点上的实体数量和统计
+    size_t local_entities() const;
+    ShardingStats stats() const;
+
+    // 区域在远程传输上的端点名称
+    static std::string endpoint_name(const std::string& type_name) { return "shard-region/" + type_name; }
+
+private:
+    enum class Mode {
+        HOSTED,       // 本节点是所有者，直接投递给实体
+        REMOTE,       // 发往route
+        BUFFERING,    // 本节点是新所有者，等待原所有者（route）交接完成
+        HANDING_OFF   // 本节点是原所有者，实体正在处理剩余消息
+    };
+
+    struct Shard {
+        Mode mode = Mode::BUFFERING;
+        std::string owner;
+        std::string route;
+        std::unordered_map<std::string, std::shared_ptr<Actor>> entities;
+        std::vector<Message> pending;
+        std::vector<Message> probes;  // 原所有者交接完成之前暂存的探测
+        size_t draining = 0;
+        uint64_t epoch = 0;
+    };
+
+    void route(const Message& message, bool from_remote);
+    void on_membership(const Message& message);
+    void on_entity_stopped(const Message& message);
+    void on_timeout(const Message& message);
+    void on_remote(const Message& message);
+    void forward(const std::string& node, const Message& message, size_t hops);
+
+    // 以下函数要求持有mutex_的独占锁
+    void dispatch(size_t index, const std::string& key, const Message& message, bool from_remote);
+    void rebalance();
+    void begin_handoff(size_t index);
+    void finish_handoff(size_t index);
+    void send_probe(size_t index, const std::string& via);
+    void handle_probe(size_t index, const Message& probe);
+    void acknowledge(size_t index, const std::string& origin, const std::string& via);
+    void switch_route(size_t index, const std::string& via);
+    void host(size_t index);
+    void deliver_local(size_t index, const std::string& key, const Message& message);
+    void hold(size_t index, const Message& message);
+    void flush_pending(size_t index);
+    void schedule_timeout(size_t index);
+    bool is_member(const std::string& node) const;
+
+    ShardingOptions options_;
+    EntityFactory factory_;
+    std::shared_ptr<RemoteTransport> transport_;
+    std::string node_;
+    std::string endpoint_;
+
+    mutable std::shared_mutex mutex_;
+    std::vector<std::string> members_;
+    HashRing ring_;
+    std::vector<Shard> shards_;
+    std::vector<uint64_t> shard_points_;
+
+    std::atomic<uint64_t> spawned_{0};
+    std::atomic<uint64_t> forwarded_{0};
+    std::atomic<uint64_t> buffered_{0};
+    std::atomic<uint64_t> dropped_{0};
+    std::atomic<uint64_t> handoffs_{0};
+    std::atomic<uint64_t> handoff_timeouts_{0};
+};
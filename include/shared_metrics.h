@@ -0,0 +1,178 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+/**
+ * 共享内存指标段的布局（版本1）
+ *
+ * 文件开头是SharedMetricsHeader，之后紧跟capacity个SharedActorSlot。
+ * 所有字段都是本机字节序；计数器使用无锁原子变量，写入方用relaxed存储更新，
+ * 其他进程只读映射同一文件即可读取，不需要与写入方做任何同步。
+ *
+ * 兼容规则：major版本不同的读取方必须拒绝该文件；同一major版本内只会在结构末尾追加字段，
+ * 读取方应按header_size和slot_size定位，而不是按自己编译时的sizeof。
+ */
+constexpr char kSharedMetricsMagic[8] = {'A', 'C', 'T', 'R', 'S', 'H', 'M', '1'};
+constexpr uint16_t kSharedMetricsMajorVersion = 1;
+constexpr uint16_t kSharedMetricsMinorVersion = 0;
+
+static_assert(std::atomic<uint64_t>::is_always_lock_free, "shared metrics require lock-free 64-bit atomics");
+
+struct SharedMetricsHeader {
+    char magic[8];
+    uint16_t major_version;
+    uint16_t minor_version;
+    uint32_t header_size;
+    uint32_t slot_size;
+    uint32_t capacity;
+
+    // 进程ID和创建时间（系统时钟纳秒）
+    uint32_t pid;
+    uint32_t reserved0;
+    int64_t created_ns;
+
+    // 曾经分配过的槽位数量（只增不减），读取方只需要扫描前slot_count个槽位
+    std::atomic<uint32_t> slot_count;
+    uint32_t reserved1;
+
+    // 事件循环最近一次更新的时间（系统时钟纳秒），用于判断写入方是否还活着
+    std::atomic<int64_t> heartbeat_ns;
+
+    // 事件循环级别的值
+    std::atomic<uint64_t> actors;
+    std::atomic<uint64_t> in_flight;
+    std::atomic<uint64_t> worker_count;
+
+    // 槽位已满、没有分配到槽位的Actor数量
+    std::atomic<uint64_t> overflow_actors;
+
+    char reserved[48];
+};
+
+/**
+ * 单个Actor的槽位
+ *
+ * 槽位在Actor移除后会被复用：写入方先写入名称和ID，再递增generation并把state置为LIVE。
+ * 读取方读取前后各检查一次generation，不一致时说明槽位正在被复用，应丢弃本次读取的内容；
+ * 计算速率时也应以(槽位下标, generation)作为Actor的标识。
+ */
+struct alignas(64) SharedActorSlot {
+    enum : uint32_t {
+        FREE = 0,
+        LIVE = 1
+    };
+
+    std::atomic<uint32_t> state;
+    std::atomic<uint32_t> generation;
+    uint64_t serial;
+    char name[48];
+    char id[40];
+
+    // 只由处理该Actor的worker写入
+    std::atomic<uint64_t> processed;
+    std::atomic<uint64_t> handler_ns;
+    std::atomic<int64_t> mailbox_depth;
+
+    // 任意线程都可能写入
+    std::atomic<uint64_t> enqueued;
+    std::atomic<uint64_t> dropped;
+};
+
+/**
+ * @brief SharedMetricsSegment类 - 写入方：创建并映射共享内存指标文件
+ *
+ * 类似JVM的hsperfdata：指标直接位于mmap的文件中，外部工具（actor_top）读取文件即可获得实时数据，
+ * 不会经过Actor系统本身，也不会打扰事件循环。
+ */
+class SharedMetricsSegment {
+public:
+    // 创建（覆盖）指标文件并映射，失败时抛出std::runtime_error
+    explicit SharedMetricsSegment(const std::string& path, uint32_t capacity = 4096, bool remove_on_close = true);
+    ~SharedMetricsSegment();
+
+    SharedMetricsSegment(const SharedMetricsSegment&) = delete;
+    SharedMetricsSegment& operator=(const SharedMetricsSegment&) = delete;
+
+    // 默认路径：$TMPDIR/actor_cpp_metrics/<pid>（目录不存在时创建）
+    static std::string default_path();
+
+    // 为Actor分配槽位，槽位已满时返回nullptr
+    SharedActorSlot* allocate(const std::string& name, const std::string& id, uint64_t serial);
+
+    // 释放槽位供之后的Actor复用
+    void release(SharedActorSlot* slot);
+
+    SharedMetricsHeader* header() { return header_; }
+
+    const std::string& path() const { return path_; }
+
+    // 更新心跳时间
+    void touch();
+
+private:
+    std::string path_;
+    bool remove_on_close_;
+    size_t size_;
+    void* mapping_;
+    SharedMetricsHeader* header_;
+    SharedActorSlot* slots_;
+
+    // 保护槽位分配
+    std::mutex mutex_;
+    std::vector<uint32_t> free_slots_;
+};
+
+// 读取方得到的单个Actor样本
+struct SharedActorSample {
+    uint32_t slot = 0;
+    uint32_t generation = 0;
+    uint64_t serial = 0;
+    std::string name;
+    std::string id;
+    uint64_t processed = 0;
+    uint64_t handler_ns = 0;
+    int64_t mailbox_depth = 0;
+    uint64_t enqueued = 0;
+    uint64_t dropped = 0;
+};
+
+// 读取方得到的整个段的快照
+struct SharedMetricsSnapshot {
+    uint32_t pid = 0;
+    int64_t created_ns = 0;
+    int64_t heartbeat_ns = 0;
+    uint64_t actors = 0;
+    uint64_t in_flight = 0;
+    uint64_t worker_count = 0;
+    uint64_t overflow_actors = 0;
+    std::vector<SharedActorSample> samples;
+};
+
+/**
+ * @brief SharedMetricsReader类 - 读取方：只读映射其他进程的指标文件
+ */
+class SharedMetricsReader {
+public:
+    // 映射文件并校验魔数和版本，失败时抛出std::runtime_error
+    explicit SharedMetricsReader(const std::string& path);
+    ~SharedMetricsReader();
+
+    SharedMetricsReader(const SharedMetricsReader&) = delete;
+    SharedMetricsReader& operator=(const SharedMetricsReader&) = delete;
+
+    // 读取当前所有存活Actor的快照
+    SharedMetricsSnapshot snapshot() const;
+
+private:
+    size_t size_;
+    const void* mapping_;
+    const SharedMetricsHeader* header_;
+    const char* slots_;
+    uint32_t slot_size_;
+    uint32_t capacity_;
+};
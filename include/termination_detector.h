@@ -0,0 +1,63 @@
+#pragma once
+
+#include <atomic>
+#include <array>
+#include <cstdint>
+#include <cstddef>
+
+/**
+ * @brief TerminationDetector类 - 多worker场景下的静默检测
+ *
+ * 每条被邮箱接受的消息计一次"发送"，处理完成（或被丢弃）时计一次"完成"。
+ * 计数器按线程分片并按缓存行对齐，投递和处理路径上只有一次无竞争的原子加法。
+ *
+ * 静默判断采用Mattern的四计数器方法：连续两轮汇总（每轮先读完成数再读发送数），
+ * 两轮结果完全相同且发送数等于完成数时，系统中没有任何在途消息。
+ * 处理函数发送的消息总是在其所处理的消息完成之前计数，因此不会出现误判。
+ */
+class TerminationDetector {
+public:
+    // 分片数量（线程按首次使用顺序映射到分片）
+    static constexpr size_t kShardCount = 16;
+
+    TerminationDetector();
+
+    // 一条消息被放入邮箱
+    void on_enqueued() {
+        shard().sent.fetch_add(1, std::memory_order_release);
+    }
+
+    // count条消息处理完成或被丢弃
+    void on_completed(uint64_t count = 1) {
+        if (count > 0) {
+            shard().completed.fetch_add(count, std::memory_order_release);
+        }
+    }
+
+    // 系统是否处于静默状态（没有在途消息）
+    bool is_quiescent() const;
+
+    // 当前在途消息数量的近似值（仅用于观测，不保证一致性）
+    uint64_t in_flight() const;
+
+private:
+    struct alignas(64) Shard {
+        std::atomic<uint64_t> sent{0};
+        std::atomic<uint64_t> completed{0};
+    };
+
+    struct Totals {
+        uint64_t sent;
+        uint64_t completed;
+    };
+
+    // 汇总所有分片（先读完成数，再读发送数）
+    Totals collect() const;
+
+    // 获取当前线程对应的分片
+    Shard &shard() { return shards_[shard_index()]; }
+
+    static size_t shard_index();
+
+    std::array<Shard, kShardCount> shards_;
+};
@@ -0,0 +1,194 @@
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <fstream>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include "flat_hash_map.h"
+#include "message.h"
+
+/**
+ * @brief TraceEvent结构 - 消息轨迹中的一条记录
+ *
+ * DELIVERY表示一条消息被目标Actor的邮箱接受，HANDLED表示目标Actor处理完一条消息。
+ * 两者都带有消息在目标邮箱中的序号（从1开始，入队时分配），同一目标序号相同的两条记录对应同一条消息。
+ */
+struct TraceEvent {
+    enum class Kind : uint8_t {
+        DELIVERY = 1,
+        HANDLED = 2
+    };
+
+    Kind kind = Kind::DELIVERY;
+
+    // 事件时间（Clock::current()的纳秒时间戳）
+    int64_t timestamp_ns = 0;
+
+    // 消息类型
+    std::string type;
+
+    // 发送者ID（仅DELIVERY）
+    std::string sender_id;
+
+    // 目标Actor ID
+    std::string target_id;
+
+    // 消息优先级（仅DELIVERY）
+    Message::Priority priority = Message::Priority::NORMAL;
+
+    // 负载大小估计（字节，仅DELIVERY）
+    uint32_t payload_size = 0;
+
+    // 处理函数耗时（纳秒，仅HANDLED）
+    int64_t cost_ns = 0;
+
+    // 消息在目标邮箱中的序号（旧格式的轨迹中为0）
+    uint64_t sequence = 0;
+};
+
+/**
+ * @brief TraceRecorder类 - 把消息投递和处理流记录到紧凑的二进制轨迹文件
+ *
+ * 文件格式：8字节魔数"ACTRTRC2"，之后是一串带标签的记录。
+ * 字符串（类型、ID）第一次出现时写一条定义记录，之后只写编号；
+ * 时间戳写相对上一条记录的差值，整数均使用varint编码。
+ * 每个线程把记录追加到自己的缓冲区（只在刷新时才和其他线程竞争），线程退出时缓冲区中的记录
+ * 并入共享的退休缓冲区；刷新时合并所有缓冲区，按时间戳排序后编码写入文件，并丢弃已退出线程的缓冲区。
+ */
+class TraceRecorder {
+public:
+    // 打开轨迹文件，失败时抛出std::runtime_error
+    explicit TraceRecorder(const std::string& path, size_t flush_threshold = 64 * 1024);
+    ~TraceRecorder();
+
+    TraceRecorder(const TraceRecorder&) = delete;
+    TraceRecorder& operator=(const TraceRecorder&) = delete;
+
+    // 记录一条被邮箱接受的消息，sequence为它在目标邮箱中的序号。
+    // 应在目标的邮箱锁内、入队之后调用，这里不会触发写文件
+    void record_delivery(const Message& message, uint64_t sequence);
+
+    // 记录一条消息处理完成，sequence为出队时的序号；当前线程的缓冲区超过阈值时刷新
+    void record_handled(const std::string& actor_id, const std::string& type,
+                        std::chrono::nanoseconds cost, uint64_t sequence);
+
+    // 合并所有线程的缓冲区并写入文件
+    void flush();
+
+    // 已记录的事件数量
+    uint64_t event_count() const;
+
+private:
+    // 缓冲区中的一条记录，字符串使用全局编号（写文件时再换成文件中的编号）
+    struct Record {
+        int64_t timestamp_ns;
+        uint64_t sequence;
+        int64_t cost_ns;
+        uint32_t type;
+        uint32_t sender;
+        uint32_t target;
+        uint32_t payload_size;
+        TraceEvent::Kind kind;
+        Message::Priority priority;
+    };
+
+    // 已退出线程的记录，等待下一次刷新（线程缓冲区也持有它，记录器可能先于线程销毁）
+    struct Retired {
+        std::mutex mutex;
+        std::vector<Record> records;
+        uint64_t recorded = 0;
+    };
+
+    // 一个线程的缓冲区；records受mutex保护（刷新的线程会来取），ids只由所属线程访问
+    struct ThreadBuffer {
+        uint64_t instance = 0;
+        std::mutex mutex;
+        std::vector<Record> records;
+        uint64_t recorded = 0;
+        // 所属线程已退出，记录已并入retired（受mutex保护）
+        bool exited = false;
+        std::shared_ptr<Retired> retired;
+        FlatHashMap<std::string, uint32_t, StringHash, std::equal_to<>> ids;
+    };
+
+    // 线程在各记录器中的缓冲区；线程退出时把它们的记录并入各自的Retired
+    struct ThreadOwner {
+        std::vector<std::shared_ptr<ThreadBuffer>> buffers;
+        ~ThreadOwner();
+    };
+
+    // 当前线程在本记录器中的缓冲区，第一次使用时创建
+    ThreadBuffer& local_buffer();
+
+    // 获取字符串的全局编号，先查线程自己的缓存，未命中时才加strings_mutex_
+    uint32_t string_id(ThreadBuffer& buffer, const std::string& value);
+
+    // 追加一条记录，返回缓冲区是否超过刷新阈值
+    bool append(ThreadBuffer& buffer, Record& record);
+
+    void put_varint(uint64_t value);
+
+    // 刷新和创建缓冲区时持有，保证刷新之间写文件的顺序
+    mutable std::mutex mutex_;
+    std::ofstream out_;
+    std::vector<char> buffer_;
+    size_t flush_threshold_;
+    std::vector<std::shared_ptr<ThreadBuffer>> threads_;
+    std::shared_ptr<Retired> retired_;
+    // 刷新时从线程缓冲区取出的记录（受mutex_保护，复用容量）
+    std::vector<Record> batch_;
+
+    // 全局字符串表
+    mutable std::mutex strings_mutex_;
+    FlatHashMap<std::string, uint32_t, StringHash, std::equal_to<>> strings_;
+    std::vector<std::string> values_;
+
+    // 全局编号在文件中的编号加1（0表示还没有写定义记录，受mutex_保护）
+    std::vector<uint64_t> file_ids_;
+    uint64_t next_file_id_;
+    int64_t last_timestamp_ns_;
+
+    // 区分记录器实例，使线程缓存的缓冲区指针不会被新的记录器误用
+    uint64_t instance_;
+    static thread_local uint64_t local_instance_;
+    static thread_local ThreadBuffer* local_buffer_;
+    static thread_local ThreadOwner thread_owner_;
+};
+
+/**
+ * @brief TraceReader类 - 顺序读取TraceRecorder生成的轨迹文件
+ */
+class TraceReader {
+public:
+    // 打开轨迹文件并校验文件头，失败时抛出std::runtime_error
+    explicit TraceReader(const std::string& path);
+
+    // 读取下一条事件，文件结束时返回false，格式错误时抛出std::runtime_error
+    bool next(TraceEvent& event);
+
+    // 读取剩余全部事件
+    std::vector<TraceEvent> read_all();
+
+private:
+    bool get_varint(uint64_t& value);
+    uint64_t require_varint();
+    const std::string& lookup(uint64_t id) const;
+
+    std::ifstream in_;
+    std::vector<std::string> strings_;
+    int64_t last_timestamp_ns_;
+    // 文件版本（1的记录没有邮箱序号）
+    int version_;
+};
+
+// 估计消息负载的字节数（字符串按实际长度，其他类型按存储大小）
+uint32_t estimate_payload_size(const Message& message);
+
+// 为轨迹中的每条DELIVERY（按出现顺序）配对处理耗时：
+// 同一目标、同一邮箱序号的HANDLED对应这条DELIVERY（没有序号时按同一目标的第k条对应第k条），
+// 没有对应记录时使用同类型消息的平均耗时
+std::vector<int64_t> pair_handler_costs(const std::vector<TraceEvent>& events);
@@ -0,0 +1,76 @@
+#pragma once
+
+#include <cstdint>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <vector>
+#include "message.h"
+
+// 一个已结束的span：某个Actor处理一条被采样的消息
+struct Span {
+    uint64_t trace_id_high = 0;
+    uint64_t trace_id_low = 0;
+    uint64_t span_id = 0;
+
+    // 发送该消息时所在的span，0表示根span
+    uint64_t parent_span_id = 0;
+
+    // span名称（消息类型）
+    std::string name;
+
+    std::string actor_name;
+    std::string actor_id;
+    std::string sender_id;
+
+    // 开始和结束时间（Clock::current()的纳秒数，默认即Unix时间）
+    int64_t start_ns = 0;
+    int64_t end_ns = 0;
+
+    // 消息创建到开始处理之间的排队时间
+    int64_t queue_ns = 0;
+};
+
+// 开始一条新的追踪：按sampling_ratio（0~1）决定是否采样，返回的上下文没有父span
+TraceContext start_trace(double sampling_ratio = 1.0);
+
+// 生成非0的随机span ID
+uint64_t generate_span_id();
+
+/**
+ * @brief SpanCollector类 - 进程内的span缓冲区，可以导出为OTLP JSON
+ *
+ * EventLoop::set_span_collector之后，Actor处理带有已采样上下文的消息时会为这次处理创建span，
+ * 结束后放入缓冲区；缓冲区满时丢弃最旧的span。导出的文件符合OTLP/JSON的
+ * ExportTraceServiceRequest格式，可以直接发给OTLP/HTTP接收端或导入支持OTLP的追踪后端。
+ */
+class SpanCollector {
+public:
+    explicit SpanCollector(size_t capacity = 65536, std::string service_name = "actor_cpp");
+
+    // 记录一个结束的span
+    void record(Span span);
+
+    // 当前缓冲区中的span（按结束顺序）
+    std::vector<Span> spans() const;
+
+    // 因缓冲区满而丢弃的span数量
+    uint64_t dropped() const;
+
+    // 清空缓冲区
+    void clear();
+
+    // 生成OTLP JSON
+    std::string to_otlp_json() const;
+
+    // 把OTLP JSON写入文件（先写临时文件再重命名），返回是否成功
+    bool write_otlp_json(const std::string& path) const;
+
+private:
+    size_t capacity_;
+    std::string service_name_;
+
+    mutable std::mutex mutex_;
+    std::deque<Span> spans_;
+    uint64_t dropped_ = 0;
+};
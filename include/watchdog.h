@@ -0,0 +1,162 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <csignal>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <pthread.h>
+#include <string>
+#include <thread>
+#include <vector>
+
+class Actor;
+class Message;
+class MetricsRegistry;
+
+// 一次慢处理函数的报告
+struct SlowHandlerReport {
+    size_t worker = 0;
+    std::string actor_name;
+    std::string actor_id;
+    std::string message_type;
+
+    // 采样时处理函数已经运行的时间（误差不超过一个轮询间隔）
+    std::chrono::milliseconds elapsed{0};
+
+    // 采样时worker的调用栈（已符号化，最内层在前）
+    std::vector<std::string> stack;
+};
+
+/**
+ * @brief 看门狗的配置
+ */
+struct WatchdogOptions {
+    // 处理函数运行超过该时间即视为慢处理
+    std::chrono::milliseconds threshold{100};
+
+    // 是否采样调用栈
+    bool capture_stack = true;
+
+    // 调用栈的最大帧数
+    size_t max_frames = 32;
+
+    // 用于采样的信号，0表示SIGRTMIN + 1
+    int signal = 0;
+
+    // 保留最近的报告数量
+    size_t max_reports = 16;
+
+    // 每次报告时调用（在看门狗线程中）
+    std::function<void(const SlowHandlerReport&)> on_report;
+};
+
+// 每个worker一个，只由该worker写入seq、actor和message
+struct alignas(64) WatchdogSlot {
+    // 奇数表示正在执行处理函数
+    std::atomic<uint64_t> seq{0};
+    std::atomic<const Actor*> actor{nullptr};
+    std::atomic<const Message*> message{nullptr};
+
+    // 以下字段由看门狗线程和信号处理函数使用
+    size_t worker = 0;
+    pthread_t thread{};
+    uint64_t observed_seq = 0;
+    std::chrono::steady_clock::time_point observed_since;
+    uint64_t reported_seq = 0;
+    std::atomic<uint64_t> requested{0};
+    std::atomic<uint64_t> captured{0};
+    char actor_name[64] = {};
+    char actor_id[64] = {};
+    char message_type[64] = {};
+    int max_frames = 0;
+    int frame_count = 0;
+    void* frames[64] = {};
+};
+
+/**
+ * @brief SlowHandlerWatchdog类 - 发现运行过久的消息处理函数并采样调用栈
+ *
+ * worker在处理函数前后各递增一次自己槽位的序号（没有时钟读取，也没有共享写入）。
+ * 看门狗线程按threshold/10轮询，发现某个worker的序号停在同一个奇数上超过threshold时，
+ * 向该worker发送信号；信号处理函数在worker自己的线程上复制Actor、消息类型并调用backtrace，
+ * 看门狗线程再完成符号化、写日志和指标。同一次处理只报告一次；采样超时的处理在下一次轮询时重试。
+ * 等待采样和报告时不持有槽位锁，不会阻塞其他槽位的检查和worker的登记。
+ * 构造时安装采样信号的处理函数，析构时恢复原来的处理方式。
+ */
+class SlowHandlerWatchdog {
+public:
+    explicit SlowHandlerWatchdog(const WatchdogOptions& options = WatchdogOptions(),
+                                 std::shared_ptr<MetricsRegistry> metrics = nullptr);
+    ~SlowHandlerWatchdog();
+
+    SlowHandlerWatchdog(const SlowHandlerWatchdog&) = delete;
+    SlowHandlerWatchdog& operator=(const SlowHandlerWatchdog&) = delete;
+
+    // 把当前线程登记为worker（由事件循环在worker线程启动时调用）
+    void attach_current_thread(size_t worker);
+
+    // 取消当前线程的登记
+    void detach_current_thread();
+
+    // 处理函数开始和结束（由Actor调用，当前线程未登记时什么都不做）
+    static void handler_started(const Actor* actor, const Message* message) {
+        if (WatchdogSlot* slot = current_slot_) {
+            slot->actor.store(actor, std::memory_order_relaxed);
+            slot->message.store(message, std::memory_order_relaxed);
+            slot->seq.store(slot->seq.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+        }
+    }
+
+    static void handler_finished() {
+        if (WatchdogSlot* slot = current_slot_) {
+            slot->seq.store(slot->seq.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+        }
+    }
+
+    // 最近的报告
+    std::vector<SlowHandlerReport> recent_reports() const;
+
+    // 累计报告次数
+    uint64_t report_count() const { return report_count_.load(); }
+
+    const WatchdogOptions& options() const { return options_; }
+
+private:
+    void watch();
+    // 检查槽位，处理函数超过阈值且尚未报告时返回true并给出已运行的时间
+    bool check(WatchdogSlot& slot, std::chrono::steady_clock::time_point now,
+               std::chrono::steady_clock::duration& elapsed);
+
+    // 请求worker采样（需要持有slots_mutex_，保证线程仍然登记着）
+    bool request_sample(WatchdogSlot& slot, uint64_t seq);
+
+    // 等待采样结果并生成报告，采样超时或处理已经结束时返回false
+    bool report(WatchdogSlot& slot, uint64_t seq, std::chrono::steady_clock::duration elapsed);
+
+    static void on_sample_signal(int signo);
+
+    static thread_local WatchdogSlot* current_slot_;
+
+    WatchdogOptions options_;
+    int signal_;
+    struct sigaction previous_action_;
+    std::shared_ptr<MetricsRegistry> metrics_;
+
+    // 保护slots_（报告期间看门狗线程另外持有槽位的引用，取消登记不会释放它）
+    std::mutex slots_mutex_;
+    std::vector<std::shared_ptr<WatchdogSlot>> slots_;
+
+    mutable std::mutex reports_mutex_;
+    std::deque<SlowHandlerReport> reports_;
+    std::atomic<uint64_t> report_count_{0};
+
+    std::mutex stop_mutex_;
+    std::condition_variable stop_cv_;
+    bool stopping_ = false;
+    std::thread thread_;
+};
@@ -1,21 +1,250 @@
 #include "actor.h"
+#include "clock.h"
 #include "event_loop.h"
+#include "flight_recorder.h"
+#include "logging.h"
+#include "metrics.h"
+#include "probes.h"
+#include "run_queue.h"
+#include "shared_metrics.h"
+#include "termination_detector.h"
+#include "trace.h"
+#include "tracing.h"
+#include "watchdog.h"
+#include <algorithm>
+#include <chrono>
 #include <iostream>
 #include <random>
-#include <sstream>
+#include <time.h>
+
+namespace {
+    std::atomic<uint64_t> next_serial{1};
+
+    // 当前线程正在处理的消息的追踪上下文，Actor::send据此传播
+    thread_local TraceContext current_context;
+
+    // 每个worker线程的临时内存区，以及正在处理的消息的嵌套深度（只在最外层结束时重置）
+    thread_local ScratchArena scratch;
+    thread_local int processing_depth = 0;
+
+    uint64_t splitmix64(uint64_t& state) {
+        uint64_t z = (state += 0x9E3779B97F4A7C15ull);
+        z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ull;
+        z = (z ^ (z >> 27)) * 0x94D049BB133111EBull;
+        return z ^ (z >> 31);
+    }
+
+    // 进程启动时取一次的随机数，作为ID的密钥和各线程随机数生成器的种子来源
+    uint64_t id_key() {
+        static const uint64_t key = []() {
+            std::random_device device;
+            return (static_cast<uint64_t>(device()) << 32) ^ device() ^
+                   static_cast<uint64_t>(std::chrono::steady_clock::now().time_since_epoch().count());
+        }();
+        return key;
+    }
+
+    // xoshiro256**，每个线程一个，种子由进程密钥和线程编号经splitmix64展开，线程之间互不相同
+    class IdRandom {
+    public:
+        IdRandom() {
+            static std::atomic<uint64_t> next_thread{0};
+            uint64_t seed = id_key() ^ (next_thread.fetch_add(1, std::memory_order_relaxed) * 0xD1B54A32D192ED03ull);
+            for (auto& word : state_) {
+                word = splitmix64(seed);
+            }
+        }
+
+        uint64_t next() {
+            uint64_t result = rotl(state_[1] * 5, 7) * 9;
+            uint64_t t = state_[1] << 17;
+            state_[2] ^= state_[0];
+            state_[3] ^= state_[1];
+            state_[1] ^= state_[2];
+            state_[0] ^= state_[3];
+            state_[2] ^= t;
+            state_[3] = rotl(state_[3], 45);
+            return result;
+        }
+
+    private:
+        static uint64_t rotl(uint64_t x, int k) { return (x << k) | (x >> (64 - k)); }
+
+        uint64_t state_[4];
+    };
+
+    thread_local IdRandom id_random;
+
+    // 处理函数返回（或抛出异常）时重置临时内存区
+    struct ScratchScope {
+        ScratchScope() { ++processing_depth; }
+        ~ScratchScope() {
+            if (--processing_depth == 0 && scratch.used() > 0) {
+                scratch.reset();
+            }
+        }
+    };
+
+    // 处理结束（或处理函数抛出异常）时恢复之前的追踪上下文
+    struct TraceContextScope {
+        TraceContextScope() : previous(current_context) {}
+        ~TraceContextScope() { current_context = previous; }
+
+        TraceContext previous;
+    };
+
+    // 处理函数返回或抛出异常时都结束看门狗的记录，保持槽位序号的奇偶性
+    struct WatchdogScope {
+        WatchdogScope(const Actor* actor, const Message* message) {
+            SlowHandlerWatchdog::handler_started(actor, message);
+        }
+        ~WatchdogScope() { SlowHandlerWatchdog::handler_finished(); }
+    };
+
+    // 出队的消息无论处理函数是否抛出异常都计为完成，否则静默检测和关闭排空永远等不到零
+    struct CompletionScope {
+        explicit CompletionScope(TerminationDetector* detector) : detector(detector) {}
+        ~CompletionScope() {
+            if (detector) {
+                detector->on_completed();
+            }
+        }
+
+        TerminationDetector* detector;
+    };
+
+    int64_t to_ns(Clock::time_point time) {
+        return std::chrono::duration_cast<std::chrono::nanoseconds>(time.time_since_epoch()).count();
+    }
+
+    // 每处理一条消息都要记录，用粗粒度时钟（精度为一个时钟节拍，只读vDSO中的变量）
+    int64_t coarse_now_ns() {
+        timespec ts;
+#ifdef CLOCK_REALTIME_COARSE
+        ::clock_gettime(CLOCK_REALTIME_COARSE, &ts);
+#else
+        ::clock_gettime(CLOCK_REALTIME, &ts);
+#endif
+        return static_cast<int64_t>(ts.tv_sec) * 1000000000 + ts.tv_nsec;
+    }
+
+    size_t priority_index(Message::Priority priority) {
+        return std::min<size_t>(static_cast<size_t>(priority), 3);
+    }
+
+    // 事件循环为Actor所在worker指定的资源，没有时不持有所有权地引用当前的默认资源
+    std::shared_ptr<std::pmr::memory_resource> resource_for(const std::weak_ptr<EventLoop>& event_loop,
+                                                            uint64_t serial) {
+        auto loop = event_loop.lock();
+        auto resource = loop ? loop->memory_resource_for(serial) : nullptr;
+        if (!resource) {
+            resource = std::shared_ptr<std::pmr::memory_resource>(std::shared_ptr<void>(),
+                                                                  std::pmr::get_default_resource());
+        }
+        return resource;
+    }
+}
 
 Actor::Actor(std::string name, std::weak_ptr<EventLoop> event_loop)
     : name_(std::move(name))
-    , event_loop_(std::move(event_loop))
-    , state_(State::CREATED) {
-    id_ = generate_id();
+    , serial_(next_serial.fetch_add(1, std::memory_order_relaxed))
+    , state_(State::CREATED)
+    , memory_resource_(resource_for(event_loop, serial_))
+    , message_queue_(std::pmr::polymorphic_allocator<Message>(memory_resource_.get()))
+    , event_loop_(std::move(event_loop)) {
+    id_ = generate_id(serial_);
+    stats_ = ActorStatsTable::acquire(this);
+    if (FlightRecorder::enabled()) {
+        FlightRecorder::note_actor(serial_, name_, id_);
+    }
+}
+
+Actor::~Actor() {
+    ActorStatsTable::release(stats_);
+}
+
+void Actor::attach_termination_detector(std::shared_ptr<TerminationDetector> detector) {
+    termination_detector_ = std::move(detector);
+}
+
+void Actor::attach_run_queues(std::shared_ptr<RunQueues> queues) {
+    std::shared_ptr<RunQueues> ready;
+    {
+        std::lock_guard<std::mutex> lock(queue_mutex_);
+        run_queues_ = std::move(queues);
+        // 注册之前已经收到的消息也要让所在worker看到
+        scheduled_ = run_queues_ && !message_queue_.empty();
+        if (scheduled_) {
+            ready = run_queues_;
+        }
+    }
+    if (ready) {
+        ready->push(shared_from_this());
+    }
+}
+
+bool Actor::try_unschedule() {
+    std::lock_guard<std::mutex> lock(queue_mutex_);
+    if (run_queues_ && !message_queue_.empty()) {
+        return false;
+    }
+    scheduled_ = false;
+    return true;
+}
+
+void Actor::attach_trace_recorder(std::shared_ptr<TraceRecorder> recorder) {
+    trace_recorder_ = std::move(recorder);
+}
+
+void Actor::attach_span_collector(std::shared_ptr<SpanCollector> collector) {
+    span_collector_ = std::move(collector);
+}
+
+const TraceContext& Actor::current_trace_context() {
+    return current_context;
+}
+
+ScratchArena& Actor::scratch_arena() {
+    return scratch;
+}
+
+void Actor::attach_metrics(std::shared_ptr<ActorMetrics> metrics) {
+    metrics_ = std::move(metrics);
+}
+
+void Actor::attach_shared_slot(std::shared_ptr<SharedActorSlot> slot) {
+    shared_slot_ = std::move(slot);
+}
+
+std::pmr::memory_resource* Actor::mailbox_resource() const {
+    return memory_resource_.get();
+}
+
+void Actor::publish_mailbox_stats(size_t depth) {
+    int top = -1;
+    for (int priority = 3; priority >= 0; --priority) {
+        if (pending_by_priority_[priority] > 0) {
+            top = priority;
+            break;
+        }
+    }
+    uint32_t sequence = stats_->begin_write();
+    stats_->mailbox_depth.store(depth, std::memory_order_relaxed);
+    stats_->top_priority.store(static_cast<int16_t>(top), std::memory_order_relaxed);
+    stats_->end_write(sequence);
+}
+
+ActorStats Actor::read_stats() const {
+    return stats_->read();
 }
 
 void Actor::initialize() {
     if (state_ != State::CREATED) {
         State current_state = state_.load();
-        std::cerr << "Cannot initialize Actor " << name_ << " in state " 
-                 << static_cast<int>(current_state) << std::endl;
+        if (log_enabled(LogLevel::WARN)) {
+            std::cerr << "Cannot initialize Actor " << name_ << " in state " 
+                     << static_cast<int>(current_state) << std::endl;
+        }
         return;
     }
     
@@ -25,8 +254,10 @@ void Actor::initialize() {
 void Actor::start() {
     if (state_ != State::INITIALIZED) {
         State current_state = state_.load();
-        std::cerr << "Cannot start Actor " << name_ << " in state " 
-                 << static_cast<int>(current_state) << std::endl;
+        if (log_enabled(LogLevel::WARN)) {
+            std::cerr << "Cannot start Actor " << name_ << " in state " 
+                     << static_cast<int>(current_state) << std::endl;
+        }
         return;
     }
     
@@ -49,36 +280,122 @@ void Actor::stop() {
 
 void Actor::stop_immediately() {
     // 清空消息队列
-    std::queue<Message> empty;
-    std::swap(message_queue_, empty);
+    discard_messages();
     
     // 设置状态为已停止
     set_state(State::STOPPED);
 }
 
+size_t Actor::discard_messages() {
+    // 与邮箱使用同一资源，交换才是合法的
+    std::queue<Message, std::pmr::deque<Message>> empty(
+        std::pmr::polymorphic_allocator<Message>(memory_resource_.get()));
+    {
+        std::lock_guard<std::mutex> lock(queue_mutex_);
+        std::swap(message_queue_, empty);
+        dequeued_ += empty.size();
+        std::fill(std::begin(pending_by_priority_), std::end(pending_by_priority_), 0);
+        publish_mailbox_stats(0);
+        if (shared_slot_) {
+            shared_slot_->mailbox_depth.store(0, std::memory_order_relaxed);
+        }
+    }
+    if (termination_detector_) {
+        termination_detector_->on_completed(empty.size());
+    }
+    if (metrics_ && !empty.empty()) {
+        metrics_->dropped->inc(empty.size());
+    }
+    if (shared_slot_ && !empty.empty()) {
+        shared_slot_->dropped.fetch_add(empty.size(), std::memory_order_relaxed);
+    }
+    if (!empty.empty()) {
+        FlightRecorder::record(FlightRecorder::EventType::DROPPED, serial_, empty.size());
+    }
+    return empty.size();
+}
+
+bool Actor::has_messages() const {
+    std::lock_guard<std::mutex> lock(queue_mutex_);
+    return !message_queue_.empty();
+}
+
+size_t Actor::message_count() const {
+    std::lock_guard<std::mutex> lock(queue_mutex_);
+    return message_queue_.size();
+}
+
 void Actor::set_state(State new_state) {
     State old_state = state_.load();
     state_ = new_state;
+    stats_->state.store(static_cast<uint8_t>(new_state), std::memory_order_relaxed);
+    ACTOR_PROBE3(state, id_.c_str(), static_cast<int>(old_state), static_cast<int>(new_state));
+    FlightRecorder::record(FlightRecorder::EventType::STATE, serial_, static_cast<uint64_t>(old_state),
+                           static_cast<uint32_t>(new_state));
     
     // 调用状态变化回调
     on_state_changed(old_state, new_state);
     
     // 记录状态变化
-    std::cout << "Actor " << name_ << " (ID: " << id_ << ") state changed: " 
-              << static_cast<int>(old_state) << " -> " 
-              << static_cast<int>(new_state) << std::endl;
+    if (log_enabled(LogLevel::INFO)) {
+        std::cout << "Actor " << name_ << " (ID: " << id_ << ") state changed: " 
+                  << static_cast<int>(old_state) << " -> " 
+                  << static_cast<int>(new_state) << std::endl;
+    }
 }
 
-void Actor::receive(Message message) {
-    // 不在运行状态时拒绝接收新消息
-    if (state_ != State::RUNNING && state_ != State::STOPPING) {
+bool Actor::receive(Message message) {
+    // 不在运行状态时拒绝接收新消息（等待延迟启动的Actor除外）
+    if (state_ != State::RUNNING && state_ != State::STOPPING && !awaiting_first_message()) {
         State current_state = state_.load();
-        std::cerr << "Actor " << name_ << " rejected message in state " 
-                  << static_cast<int>(current_state) << std::endl;
-        return;
+        if (log_enabled(LogLevel::WARN)) {
+            std::cerr << "Actor " << name_ << " rejected message in state " 
+                      << static_cast<int>(current_state) << std::endl;
+        }
+        if (metrics_) {
+            metrics_->dropped->inc();
+        }
+        if (shared_slot_) {
+            shared_slot_->dropped.fetch_add(1, std::memory_order_relaxed);
+        }
+        FlightRecorder::record(FlightRecorder::EventType::DROPPED, serial_, 1);
+        ACTOR_PROBE3(receive_reject, id_.c_str(), message.get_type().c_str(), static_cast<int>(current_state));
+        return false;
     }
     
-    message_queue_.push(std::move(message));
+    // 先计数再入队，保证消息可被处理之前已经计入在途消息
+    if (termination_detector_) {
+        termination_detector_->on_enqueued();
+    }
+    size_t depth;
+    std::shared_ptr<RunQueues> ready;
+    {
+        std::lock_guard<std::mutex> lock(queue_mutex_);
+        message_queue_.push(std::move(message));
+        depth = message_queue_.size();
+        ++enqueued_;
+        // 邮箱从空变为非空（或上一次清除就绪标记之后第一次收到消息）时放入所在worker的就绪队列
+        if (run_queues_ && !scheduled_) {
+            scheduled_ = true;
+            ready = run_queues_;
+        }
+        // 在锁内记录，并发发送者的记录顺序和序号都与入队顺序一致
+        if (trace_recorder_) {
+            trace_recorder_->record_delivery(message_queue_.back(), enqueued_);
+        }
+        ++pending_by_priority_[priority_index(message_queue_.back().get_priority())];
+        publish_mailbox_stats(depth);
+        ACTOR_PROBE3(receive, id_.c_str(), message_queue_.back().get_type().c_str(), depth);
+        if (shared_slot_) {
+            shared_slot_->enqueued.fetch_add(1, std::memory_order_relaxed);
+            shared_slot_->mailbox_depth.store(static_cast<int64_t>(depth), std::memory_order_relaxed);
+        }
+    }
+    if (ready) {
+        ready->push(shared_from_this());
+    }
+    FlightRecorder::record(FlightRecorder::EventType::ENQUEUE, serial_, depth);
+    return true;
 }
 
 bool Actor::process_next_message() {
@@ -86,8 +403,21 @@ bool Actor::process_next_message() {
     if (state_ == State::STOPPED) {
         return false;
     }
+
+    // 延迟启动：在处理第一条消息的worker上初始化并启动
+    if (awaiting_first_message()) {
+        if (!has_messages()) {
+            return false;
+        }
+        if (state_ == State::CREATED) {
+            initialize();
+        }
+        start();
+    }
     
+    std::unique_lock<std::mutex> lock(queue_mutex_);
     if (message_queue_.empty()) {
+        lock.unlock();
         // 如果状态是STOPPING且消息队列为空，则完成停止过程
         if (state_ == State::STOPPING) {
             set_state(State::STOPPED);
@@ -97,20 +427,114 @@ bool Actor::process_next_message() {
 
     Message message = std::move(message_queue_.front());
     message_queue_.pop();
+    uint64_t mailbox_sequence = ++dequeued_;
+    size_t depth = message_queue_.size();
+    --pending_by_priority_[priority_index(message.get_priority())];
+    publish_mailbox_stats(depth);
+    SharedActorSlot* slot = shared_slot_.get();
+    if (slot) {
+        slot->mailbox_depth.store(static_cast<int64_t>(depth), std::memory_order_relaxed);
+    }
+    lock.unlock();
+
+    // 最后析构：处理函数中发送的消息已经计数，此时再标记完成不会让静默检测误判
+    CompletionScope completion(termination_detector_.get());
+
+    bool flight = FlightRecorder::enabled();
+    uint64_t flight_started = 0;
+    if (flight) {
+        flight_started = FlightRecorder::timestamp();
+        FlightRecorder::record_at(flight_started, FlightRecorder::EventType::DEQUEUE, serial_, depth, 0);
+    }
+
+    TraceRecorder* recorder = trace_recorder_.get();
+    Summary* latency = metrics_ ? metrics_->handler_latency.get() : nullptr;
+    bool timed = handler_timing_ || recorder || latency || slot || ACTOR_PROBE_ENABLED(process_end);
+    auto started_at = timed ? std::chrono::steady_clock::now() : std::chrono::steady_clock::time_point{};
+
+    // 处理带追踪上下文的消息时，处理函数中发送的消息继承该上下文；
+    // 已采样且启用了span缓冲区时为这次处理创建新的span
+    TraceContextScope context_scope;
+    const TraceContext& incoming = message.get_trace_context();
+    SpanCollector* spans = incoming.sampled ? span_collector_.get() : nullptr;
+    Clock::time_point span_started{};
+    current_context = incoming;
+    if (spans) {
+        current_context.span_id = generate_span_id();
+        span_started = Clock::current().now();
+    }
 
     auto it = handlers_.find(message.get_type());
     if (it != handlers_.end()) {
         // 找到处理函数，调用它
+        ACTOR_PROBE2(process_begin, id_.c_str(), message.get_type().c_str());
+        WatchdogScope watchdog_scope(this, &message);
+        ScratchScope scope;
         it->second(message);
     } else {
         // 没有找到处理函数，打印警告
-        std::cerr << "Actor " << name_ << " (ID: " << id_ 
-                  << ") received unhandled message type: " 
-                  << message.get_type() << std::endl;
+        if (log_enabled(LogLevel::WARN)) {
+            std::cerr << "Actor " << name_ << " (ID: " << id_ 
+                      << ") received unhandled message type: " 
+                      << message.get_type() << std::endl;
+        }
+    }
+
+    int64_t cost_ns = 0;
+    if (timed) {
+        auto cost = std::chrono::steady_clock::now() - started_at;
+        if (recorder) {
+            recorder->record_handled(id_, message.get_type(), cost, mailbox_sequence);
+        }
+        cost_ns = std::chrono::duration_cast<std::chrono::nanoseconds>(cost).count();
+        if (latency) {
+            latency->observe(cost_ns);
+        }
+        if (slot) {
+            // 只有处理本Actor的worker写入，relaxed读改写即可
+            slot->processed.store(slot->processed.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+            slot->handler_ns.store(slot->handler_ns.load(std::memory_order_relaxed) + static_cast<uint64_t>(cost_ns),
+                                   std::memory_order_relaxed);
+        }
+    }
+    ACTOR_PROBE3(process_end, id_.c_str(), message.get_type().c_str(), cost_ns);
+    int64_t finished_ns = coarse_now_ns();
+    uint32_t sequence = stats_->begin_write();
+    stats_->processed.store(stats_->processed.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+    if (timed) {
+        uint64_t cost = static_cast<uint64_t>(std::max<int64_t>(0, cost_ns));
+        stats_->handler_ns_total.store(stats_->handler_ns_total.load(std::memory_order_relaxed) + cost,
+                                       std::memory_order_relaxed);
+        if (cost > stats_->handler_ns_max.load(std::memory_order_relaxed)) {
+            stats_->handler_ns_max.store(cost, std::memory_order_relaxed);
+        }
+    }
+    stats_->last_run_ns.store(finished_ns, std::memory_order_relaxed);
+    stats_->end_write(sequence);
+    if (spans) {
+        Span span;
+        span.trace_id_high = incoming.trace_id_high;
+        span.trace_id_low = incoming.trace_id_low;
+        span.span_id = current_context.span_id;
+        span.parent_span_id = incoming.span_id;
+        span.name = message.get_type();
+        span.actor_name = name_;
+        span.actor_id = id_;
+        span.sender_id = message.get_sender_id();
+        span.start_ns = to_ns(span_started);
+        span.end_ns = to_ns(Clock::current().now());
+        span.queue_ns = std::max<int64_t>(0, span.start_ns - to_ns(message.get_created_at()));
+        spans->record(std::move(span));
+    }
+    if (flight) {
+        FlightRecorder::record(FlightRecorder::EventType::HANDLED, serial_, FlightRecorder::timestamp() - flight_started);
+    }
+    if (metrics_) {
+        metrics_->processed->inc();
     }
 
     // 如果状态是STOPPING且消息队列为空，则完成停止过程
-    if (state_ == State::STOPPING && message_queue_.empty()) {
+    if (state_ == State::STOPPING && !has_messages()) {
         set_state(State::STOPPED);
     }
     
@@ -124,20 +548,26 @@ void Actor::register_handler(const std::string& message_type, MessageHandler han
 void Actor::send(const std::string& target_actor_id, Message message) {
     auto event_loop = event_loop_.lock();
     if (!event_loop) {
-        std::cerr << "Failed to send message: event loop no longer exists" << std::endl;
+        if (log_enabled(LogLevel::WARN)) {
+            std::cerr << "Failed to send message: event loop no longer exists" << std::endl;
+        }
         return;
     }
     
+    // 没有显式设置追踪上下文时继承正在处理的消息的上下文（重新构造消息时也要保留）
+    TraceContext context = message.get_trace_context().valid() ? message.get_trace_context() : current_context;
+
     // 确保消息的发送者ID和目标ID正确设置
     if (message.get_sender_id().empty()) {
-        message = Message(message.get_type(), id_, target_actor_id, message.get_payload());
+        message = Message(message.get_type(), id_, target_actor_id, message.get_pmr_payload());
     }
     
     // 确保目标ID正确
     if (message.get_target_id() != target_actor_id) {
         message = Message(message.get_type(), message.get_sender_id(), 
-                         target_actor_id, message.get_payload());
+                         target_actor_id, message.get_pmr_payload());
     }
+    message.set_trace_context(context);
 
     event_loop->deliver_message(message);
 }
@@ -145,7 +575,9 @@ void Actor::send(const std::string& target_actor_id, Message message) {
 Actor::ActorPtr Actor::create_child(const std::string& name) {
     auto event_loop = event_loop_.lock();
     if (!event_loop) {
-        std::cerr << "Failed to create child actor: event loop no longer exists" << std::endl;
+        if (log_enabled(LogLevel::WARN)) {
+            std::cerr << "Failed to create child actor: event loop no longer exists" << std::endl;
+        }
         return nullptr;
     }
 
@@ -155,6 +587,7 @@ Actor::ActorPtr Actor::create_child(const std::string& name) {
 }
 
 Message Actor::peek_next_message() const {
+    std::lock_guard<std::mutex> lock(queue_mutex_);
     if (message_queue_.empty()) {
         return Message("empty", "", "", {});
     }
@@ -162,12 +595,14 @@ Message Actor::peek_next_message() const {
 }
 
 Message Actor::peek_highest_priority_message() const {
+    std::unique_lock<std::mutex> lock(queue_mutex_);
     if (message_queue_.empty()) {
         return Message("empty", "", "", {});
     }
     
     // 创建一个临时队列的副本
     auto queue_copy = message_queue_;
+    lock.unlock();
     Message highest_priority_msg = queue_copy.front();
     queue_copy.pop();
     
@@ -185,34 +620,36 @@ Message Actor::peek_highest_priority_message() const {
     return highest_priority_msg;
 }
 
-std::string Actor::generate_id() {
-    static std::random_device rd;
-    static std::mt19937 gen(rd());
-    static std::uniform_int_distribution<> dis(0, 15);
-    
-    std::stringstream ss;
-    ss << std::hex;
-    
-    for (int i = 0; i < 8; ++i) {
-        ss << dis(gen);
-    }
-    ss << "-";
-    for (int i = 0; i < 4; ++i) {
-        ss << dis(gen);
-    }
-    ss << "-4";  // Version 4 UUID
-    for (int i = 0; i < 3; ++i) {
-        ss << dis(gen);
-    }
-    ss << "-";
-    ss << static_cast<char>((dis(gen) & 0x3) | 0x8);  // Variant
-    for (int i = 0; i < 3; ++i) {
-        ss << dis(gen);
-    }
-    ss << "-";
-    for (int i = 0; i < 12; ++i) {
-        ss << dis(gen);
-    }
-    
-    return ss.str();
+std::string Actor::generate_id(uint64_t serial) {
+    // 低64位：序号经过进程随机密钥和62位空间内的双射混合，进程内保证唯一（版本和变体位不覆盖它）
+    constexpr uint64_t kLowMask = (uint64_t{1} << 62) - 1;
+    uint64_t low = (serial ^ id_key()) & kLowMask;
+    low = (low * 0x9E3779B97F4A7C15ull) & kLowMask;
+    low ^= low >> 31;
+    low = (low * 0xBF58476D1CE4E5B9ull) & kLowMask;
+    low ^= low >> 29;
+    low |= uint64_t{0x2} << 62;  // 变体10xx
+
+    // 高64位：每个线程自己的xoshiro256**，不同进程之间的ID以很高概率不同
+    uint64_t high = id_random.next();
+    high = (high & ~(uint64_t{0xF} << 12)) | (uint64_t{0x4} << 12);  // 版本4
+
+    static constexpr char kHex[] = "0123456789abcdef";
+    char text[36];
+    size_t position = 0;
+    auto put = [&](uint64_t bits, int nibbles) {
+        for (int shift = (nibbles - 1) * 4; shift >= 0; shift -= 4) {
+            text[position++] = kHex[(bits >> shift) & 0xF];
+        }
+    };
+    put(high >> 32, 8);
+    text[position++] = '-';
+    put(high >> 16, 4);
+    text[position++] = '-';
+    put(high, 4);
+    text[position++] = '-';
+    put(low >> 48, 4);
+    text[position++] = '-';
+    put(low, 12);
+    return std::string(text, sizeof(text));
 } 
\ No newline at end of file
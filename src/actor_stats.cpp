@@ -0,0 +1,132 @@
+#include "actor_stats.h"
+#include "huge_pages.h"
+#include <mutex>
+#include <new>
+#include <stdexcept>
+#include <vector>
+
+namespace {
+    std::atomic<ActorStatsSlot*> chunks[ActorStatsTable::kMaxChunks];
+    std::atomic<size_t> published_chunks{0};
+
+    struct Allocator {
+        std::mutex mutex;
+        std::vector<ActorStatsSlot*> free_slots;
+        size_t next_unused = 0;
+
+        // 开启大页时块的来源（和块一样从不释放）
+        HugePageArena* arena = nullptr;
+    };
+
+    // 不析构：静态对象析构之后仍可能有Actor被释放
+    Allocator& allocator() {
+        static Allocator* instance = new Allocator();
+        return *instance;
+    }
+}
+
+uint32_t ActorStatsSlot::begin_write() {
+    // 写入方只有投递线程（持有邮箱锁）和处理线程，临界区只有几次存储，自旋等待即可
+    uint32_t value = sequence.load(std::memory_order_relaxed);
+    for (;;) {
+        if ((value & 1) == 0 &&
+            sequence.compare_exchange_weak(value, value + 1, std::memory_order_acquire, std::memory_order_relaxed)) {
+            break;
+        }
+        if ((value & 1) != 0) {
+            value = sequence.load(std::memory_order_relaxed);
+        }
+    }
+    // 序号变为奇数之后的存储不能被重排到它之前
+    std::atomic_thread_fence(std::memory_order_release);
+    return value + 1;
+}
+
+ActorStats ActorStatsSlot::read() const {
+    ActorStats stats;
+    for (int attempt = 0; attempt < 64; ++attempt) {
+        uint32_t before = sequence.load(std::memory_order_acquire);
+        stats.mailbox_depth = mailbox_depth.load(std::memory_order_relaxed);
+        stats.top_priority = top_priority.load(std::memory_order_relaxed);
+        stats.processed = processed.load(std::memory_order_relaxed);
+        stats.handler_ns_total = handler_ns_total.load(std::memory_order_relaxed);
+        stats.handler_ns_max = handler_ns_max.load(std::memory_order_relaxed);
+        stats.last_run_ns = last_run_ns.load(std::memory_order_relaxed);
+        // 字段的读取不能被重排到再次读取序号之后
+        std::atomic_thread_fence(std::memory_order_acquire);
+        if ((before & 1) == 0 && sequence.load(std::memory_order_relaxed) == before) {
+            break;
+        }
+    }
+    return stats;
+}
+
+ActorStatsSlot* ActorStatsTable::acquire(const Actor* owner) {
+    Allocator& state = allocator();
+    ActorStatsSlot* slot;
+    {
+        std::lock_guard<std::mutex> lock(state.mutex);
+        if (!state.free_slots.empty()) {
+            slot = state.free_slots.back();
+            state.free_slots.pop_back();
+        } else {
+            size_t chunk_index = state.next_unused / kChunkSize;
+            if (chunk_index == kMaxChunks) {
+                throw std::runtime_error("Too many actors for the statistics table");
+            }
+            if (state.next_unused % kChunkSize == 0) {
+                ActorStatsSlot* block;
+                if (state.arena) {
+                    void* memory = state.arena->allocate(sizeof(ActorStatsSlot) * kChunkSize, alignof(ActorStatsSlot));
+                    block = static_cast<ActorStatsSlot*>(memory);
+                    for (size_t i = 0; i < kChunkSize; ++i) {
+                        new (&block[i]) ActorStatsSlot();
+                    }
+                } else {
+                    block = new ActorStatsSlot[kChunkSize];
+                }
+                chunks[chunk_index].store(block, std::memory_order_relaxed);
+                published_chunks.store(chunk_index + 1, std::memory_order_release);
+            }
+            slot = chunks[chunk_index].load(std::memory_order_relaxed) + state.next_unused % kChunkSize;
+            ++state.next_unused;
+        }
+    }
+
+    // 空闲槽位没有写入方，快照也会因为event_loop为空而跳过它
+    slot->top_priority.store(-1, std::memory_order_relaxed);
+    slot->state.store(0, std::memory_order_relaxed);
+    slot->mailbox_depth.store(0, std::memory_order_relaxed);
+    slot->processed.store(0, std::memory_order_relaxed);
+    slot->handler_ns_total.store(0, std::memory_order_relaxed);
+    slot->handler_ns_max.store(0, std::memory_order_relaxed);
+    slot->last_run_ns.store(0, std::memory_order_relaxed);
+    slot->owner.store(owner, std::memory_order_release);
+    return slot;
+}
+
+void ActorStatsTable::release(ActorStatsSlot* slot) {
+    slot->event_loop.store(nullptr, std::memory_order_relaxed);
+    slot->owner.store(nullptr, std::memory_order_release);
+    Allocator& state = allocator();
+    std::lock_guard<std::mutex> lock(state.mutex);
+    state.free_slots.push_back(slot);
+}
+
+void ActorStatsTable::set_huge_pages(HugePageMode mode) {
+    Allocator& state = allocator();
+    std::lock_guard<std::mutex> lock(state.mutex);
+    if (mode == HugePageMode::OFF) {
+        state.arena = nullptr;
+    } else if (!state.arena || state.arena->mode() != mode) {
+        state.arena = new HugePageArena(mode);
+    }
+}
+
+size_t ActorStatsTable::chunk_count() {
+    return published_chunks.load(std::memory_order_acquire);
+}
+
+const ActorStatsSlot* ActorStatsTable::chunk(size_t index) {
+    return chunks[index].load(std::memory_order_acquire);
+}
@@ -0,0 +1,162 @@
+#include "buffer.h"
+#include <cerrno>
+#include <cstring>
+#include <fcntl.h>
+#include <mutex>
+#include <stdexcept>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <vector>
+
+namespace {
+    constexpr size_t kMinClassBytes = 4096;
+    constexpr size_t kClassCount = 15;  // 4 KB ... 64 MB
+
+    // 容纳size字节的最小级别，超出最大级别时返回kClassCount
+    size_t class_of(size_t size) {
+        size_t index = 0;
+        size_t capacity = kMinClassBytes;
+        while (capacity < size && index < kClassCount) {
+            capacity <<= 1;
+            ++index;
+        }
+        return index;
+    }
+}
+
+struct BufferPool::State {
+    explicit State(size_t max_cached) : max_cached_bytes(max_cached), free_lists(kClassCount) {}
+
+    ~State() {
+        for (auto& list : free_lists) {
+            for (char* block : list) {
+                delete[] block;
+            }
+        }
+    }
+
+    size_t max_cached_bytes;
+    mutable std::mutex mutex;
+    std::vector<std::vector<char*>> free_lists;
+    size_t cached_bytes = 0;
+};
+
+Buffer Buffer::allocate(size_t size) {
+    return BufferPool::shared().allocate(size);
+}
+
+Buffer Buffer::copy(const void* data, size_t size) {
+    Buffer buffer = allocate(size);
+    if (size > 0) {
+        std::memcpy(buffer.mutable_data(), data, size);
+    }
+    return buffer;
+}
+
+Buffer Buffer::map_file(const std::string& path) {
+    int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+        throw std::runtime_error("Cannot open " + path + ": " + std::strerror(errno));
+    }
+    struct stat info;
+    if (::fstat(fd, &info) < 0) {
+        std::string error = std::strerror(errno);
+        ::close(fd);
+        throw std::runtime_error("Cannot stat " + path + ": " + error);
+    }
+    size_t size = static_cast<size_t>(info.st_size);
+    if (size == 0) {
+        ::close(fd);
+        return Buffer();
+    }
+    void* base = ::mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+    if (base == MAP_FAILED) {
+        std::string error = std::strerror(errno);
+        ::close(fd);
+        throw std::runtime_error("Cannot map " + path + ": " + error);
+    }
+
+    // 描述符随映射一起保持打开，sendfile使用
+    std::shared_ptr<const char> owner(static_cast<const char*>(base), [fd, size](const char* p) {
+        ::munmap(const_cast<char*>(p), size);
+        ::close(fd);
+    });
+    const char* data = owner.get();
+    return Buffer(std::move(owner), data, size, fd, 0);
+}
+
+Buffer Buffer::adopt(std::shared_ptr<const char> owner, size_t size) {
+    const char* data = owner.get();
+    return Buffer(std::move(owner), data, size);
+}
+
+char* Buffer::mutable_data() {
+    if (fd_ >= 0) {
+        throw std::logic_error("Buffer backed by a mapped file is read-only");
+    }
+    return const_cast<char*>(data_);
+}
+
+Buffer Buffer::slice(size_t offset, size_t length) const {
+    if (offset > size_ || length > size_ - offset) {
+        throw std::out_of_range("Buffer slice [" + std::to_string(offset) + ", +" + std::to_string(length) +
+                                ") exceeds size " + std::to_string(size_));
+    }
+    return Buffer(owner_, data_ + offset, length, fd_, fd_ >= 0 ? file_offset_ + static_cast<int64_t>(offset) : 0);
+}
+
+BufferPool::BufferPool(size_t max_cached_bytes) : state_(std::make_shared<State>(max_cached_bytes)) {
+}
+
+Buffer BufferPool::allocate(size_t size) {
+    if (size == 0) {
+        return Buffer();
+    }
+    size_t index = class_of(size);
+    if (index == kClassCount) {
+        std::shared_ptr<const char> owner(new char[size], std::default_delete<const char[]>());
+        const char* data = owner.get();
+        return Buffer(std::move(owner), data, size);
+    }
+
+    size_t capacity = kMinClassBytes << index;
+    char* block = nullptr;
+    {
+        std::lock_guard<std::mutex> lock(state_->mutex);
+        auto& list = state_->free_lists[index];
+        if (!list.empty()) {
+            block = list.back();
+            list.pop_back();
+            state_->cached_bytes -= capacity;
+        }
+    }
+    if (!block) {
+        block = new char[capacity];
+    }
+
+    // 最后一个引用消失时归还到池中（池已经销毁或缓存已满时直接释放）
+    std::weak_ptr<State> pool = state_;
+    std::shared_ptr<const char> owner(block, [pool, index, capacity](const char* p) {
+        if (auto state = pool.lock()) {
+            std::lock_guard<std::mutex> lock(state->mutex);
+            if (state->cached_bytes + capacity <= state->max_cached_bytes) {
+                state->free_lists[index].push_back(const_cast<char*>(p));
+                state->cached_bytes += capacity;
+                return;
+            }
+        }
+        delete[] p;
+    });
+    return Buffer(std::move(owner), block, size);
+}
+
+size_t BufferPool::cached_bytes() const {
+    std::lock_guard<std::mutex> lock(state_->mutex);
+    return state_->cached_bytes;
+}
+
+BufferPool& BufferPool::shared() {
+    static BufferPool pool;
+    return pool;
+}
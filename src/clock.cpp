@@ -0,0 +1,41 @@
+#include "clock.h"
+
+namespace {
+    SystemClock system_clock_instance;
+    // 每个线程各自安装（事件循环只在运行它的线程上安装自己的时钟）
+    thread_local const Clock* current_clock = nullptr;
+}
+
+const Clock& Clock::current() {
+    return current_clock ? *current_clock : system_clock_instance;
+}
+
+void Clock::set_current(const Clock* clock) {
+    current_clock = clock == &system_clock_instance ? nullptr : clock;
+}
+
+const Clock& Clock::system() {
+    return system_clock_instance;
+}
+
+VirtualClock::VirtualClock(time_point start)
+    : now_ns_(std::chrono::duration_cast<std::chrono::nanoseconds>(start.time_since_epoch()).count()) {}
+
+Clock::time_point VirtualClock::now() const {
+    auto ns = std::chrono::nanoseconds(now_ns_.load(std::memory_order_acquire));
+    return time_point(std::chrono::duration_cast<duration>(ns));
+}
+
+void VirtualClock::advance(std::chrono::nanoseconds delta) {
+    if (delta.count() > 0) {
+        now_ns_.fetch_add(delta.count(), std::memory_order_acq_rel);
+    }
+}
+
+void VirtualClock::advance_to(time_point target) {
+    int64_t target_ns = std::chrono::duration_cast<std::chrono::nanoseconds>(target.time_since_epoch()).count();
+    int64_t current = now_ns_.load(std::memory_order_acquire);
+    while (current < target_ns &&
+           !now_ns_.compare_exchange_weak(current, target_ns, std::memory_order_acq_rel)) {
+    }
+}
@@ -0,0 +1,147 @@
+#include "compression.h"
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <vector>
+
+namespace {
+    constexpr size_t kMinMatch = 4;
+    // 块末尾至少5字节是字面量，最后一个匹配至少在末尾12字节之前开始（LZ4块格式的要求）
+    constexpr size_t kLastLiterals = 5;
+    constexpr size_t kMatchLimit = 12;
+    constexpr size_t kMaxOffset = 65535;
+    constexpr int kHashBits = 14;
+
+    uint32_t read32(const uint8_t* p) {
+        uint32_t value;
+        std::memcpy(&value, p, sizeof(value));
+        return value;
+    }
+
+    uint32_t hash4(uint32_t sequence) {
+        return (sequence * 2654435761u) >> (32 - kHashBits);
+    }
+
+    // 长度字段超过15的部分用连续的255表示
+    void put_length(std::string& out, size_t length) {
+        while (length >= 255) {
+            out.push_back(static_cast<char>(255));
+            length -= 255;
+        }
+        out.push_back(static_cast<char>(length));
+    }
+
+    void put_sequence(std::string& out, const uint8_t* literals, size_t literal_length, size_t offset,
+                      size_t match_length) {
+        size_t match_code = match_length >= kMinMatch ? match_length - kMinMatch : 0;
+        uint8_t token = static_cast<uint8_t>((std::min<size_t>(literal_length, 15) << 4) |
+                                             (match_length ? std::min<size_t>(match_code, 15) : 0));
+        out.push_back(static_cast<char>(token));
+        if (literal_length >= 15) {
+            put_length(out, literal_length - 15);
+        }
+        out.append(reinterpret_cast<const char*>(literals), literal_length);
+        if (match_length == 0) {
+            return;
+        }
+        out.push_back(static_cast<char>(offset & 0xFF));
+        out.push_back(static_cast<char>(offset >> 8));
+        if (match_code >= 15) {
+            put_length(out, match_code - 15);
+        }
+    }
+
+    // 读取超过15的长度扩展，越界时返回false
+    bool read_length(const uint8_t*& ip, const uint8_t* end, size_t& length) {
+        uint8_t byte;
+        do {
+            if (ip >= end) {
+                return false;
+            }
+            byte = *ip++;
+            length += byte;
+        } while (byte == 255);
+        return true;
+    }
+}
+
+std::string lz4_compress(const char* data, size_t size) {
+    const auto* in = reinterpret_cast<const uint8_t*>(data);
+    std::string out;
+    out.reserve(size + size / 255 + 16);
+
+    size_t anchor = 0;
+    if (size > kMatchLimit) {
+        // 表中保存位置+1，0表示空
+        std::vector<uint32_t> table(size_t(1) << kHashBits, 0);
+        size_t limit = size - kMatchLimit;
+        size_t pos = 0;
+        while (pos < limit) {
+            uint32_t sequence = read32(in + pos);
+            uint32_t& slot = table[hash4(sequence)];
+            size_t candidate = slot;
+            slot = static_cast<uint32_t>(pos + 1);
+            if (candidate == 0 || pos - (candidate - 1) > kMaxOffset || read32(in + candidate - 1) != sequence) {
+                ++pos;
+                continue;
+            }
+
+            size_t match = candidate - 1;
+            size_t length = kMinMatch;
+            while (pos + length < size - kLastLiterals && in[match + length] == in[pos + length]) {
+                ++length;
+            }
+            put_sequence(out, in + anchor, pos - anchor, pos - match, length);
+            pos += length;
+            anchor = pos;
+        }
+    }
+    put_sequence(out, in + anchor, size - anchor, 0, 0);
+    return out;
+}
+
+bool lz4_decompress(const char* data, size_t size, size_t original_size, std::string& out) {
+    const auto* ip = reinterpret_cast<const uint8_t*>(data);
+    const uint8_t* end = ip + size;
+    out.resize(original_size);
+    auto* base = reinterpret_cast<uint8_t*>(&out[0]);
+    size_t op = 0;
+
+    while (ip < end) {
+        uint8_t token = *ip++;
+        size_t literal_length = token >> 4;
+        if (literal_length == 15 && !read_length(ip, end, literal_length)) {
+            return false;
+        }
+        if (literal_length > static_cast<size_t>(end - ip) || literal_length > original_size - op) {
+            return false;
+        }
+        std::memcpy(base + op, ip, literal_length);
+        ip += literal_length;
+        op += literal_length;
+        if (ip == end) {
+            break;
+        }
+
+        if (end - ip < 2) {
+            return false;
+        }
+        size_t offset = static_cast<size_t>(ip[0]) | (static_cast<size_t>(ip[1]) << 8);
+        ip += 2;
+        size_t match_length = token & 0x0F;
+        if (match_length == 15 && !read_length(ip, end, match_length)) {
+            return false;
+        }
+        match_length += kMinMatch;
+        if (offset == 0 || offset > op || match_length > original_size - op) {
+            return false;
+        }
+        // 匹配可以与输出重叠（偏移小于长度时重复前面的内容），逐字节复制
+        const uint8_t* match = base + op - offset;
+        for (size_t i = 0; i < match_length; ++i) {
+            base[op + i] = match[i];
+        }
+        op += match_length;
+    }
+    return op == original_size;
+}
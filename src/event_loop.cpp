@@ -1,71 +1,559 @@
 #include "event_loop.h"
 #include "actor.h"
+#include "flight_recorder.h"
+#include "introspection.h"
 #include "message.h"
+#include "probes.h"
+#include "run_queue.h"
 #include "scheduler.h"
+#include "shared_metrics.h"
+#include "logging.h"
+#include "termination_detector.h"
+#include "trace.h"
+#include "watchdog.h"
 #include <iostream>
 #include <vector>
 #include <thread>
 #include <chrono>
 #include <algorithm>
+#include <limits>
+#include <mutex>
+
+namespace
+{
+    // 当前线程是否是关闭阶段的排空worker（排空worker上的处理函数仍然可以互相发送消息）
+    thread_local bool t_shutdown_worker = false;
+
+    struct ShutdownWorkerScope
+    {
+        ShutdownWorkerScope() { t_shutdown_worker = true; }
+        ~ShutdownWorkerScope() { t_shutdown_worker = false; }
+    };
+
+    // worker退出（包括处理函数抛出异常）时取消在看门狗中的登记
+    struct WatchdogAttachment
+    {
+        WatchdogAttachment(SlowHandlerWatchdog *watchdog, size_t worker) : watchdog(watchdog)
+        {
+            if (watchdog)
+            {
+                watchdog->attach_current_thread(worker);
+            }
+        }
+        ~WatchdogAttachment()
+        {
+            if (watchdog)
+            {
+                watchdog->detach_current_thread();
+            }
+        }
+
+        SlowHandlerWatchdog *watchdog;
+    };
+
+    // 处理完（包括处理函数抛出异常）后把取出的actor放回就绪队列末尾，邮箱已空时清除就绪标记
+    struct Requeue
+    {
+        Requeue(RunQueues &queues, std::shared_ptr<Actor> actor) : queues(queues), actor(std::move(actor)) {}
+        ~Requeue()
+        {
+            if (!actor->try_unschedule())
+            {
+                queues.push(std::move(actor));
+            }
+        }
+
+        RunQueues &queues;
+        std::shared_ptr<Actor> actor;
+    };
+}
 
 EventLoop::EventLoop()
-    : running_(false), scheduler_(std::make_shared<RoundRobinScheduler>())
+    : running_(false), accepting_(true), rejected_during_shutdown_(0),
+      termination_detector_(std::make_shared<TerminationDetector>()),
+      run_queues_(std::make_shared<RunQueues>()), worker_count_(1), keep_alive_(false), idle_workers_(0), handler_timing_(false), lazy_start_(false),
+      metrics_collector_id_(0), scheduler_(std::make_shared<RoundRobinScheduler>()), fifo_scheduler_(true),
+      next_timer_sequence_(0), pending_timers_(0), simulation_(false)
 {
 }
 
+EventLoop::~EventLoop()
+{
+    // 就绪队列持有Actor的引用，Actor又引用就绪队列，先断开
+    run_queues_->clear();
+
+    // Actor可能比事件循环活得久，它们的统计槽位不能再指向本事件循环
+    for (const auto &[_, actor] : actors_)
+    {
+        actor->get_stats_slot()->event_loop.store(nullptr, std::memory_order_relaxed);
+    }
+
+    // 注册表可能比事件循环活得久，先注销收集回调
+    if (metrics_)
+    {
+        metrics_->remove_collector(metrics_collector_id_);
+    }
+
+    // 共享内存指标段同理，释放本事件循环中Actor占用的槽位
+    if (shared_metrics_)
+    {
+        set_shared_metrics(nullptr);
+    }
+}
+
 void EventLoop::run()
 {
     running_ = true;
-    std::cout << "Event loop started" << std::endl;
+    if (log_enabled(LogLevel::INFO))
+    {
+        std::cout << "Event loop started" << std::endl;
+    }
+
+    run_workers();
 
-    // 初始化所有已注册的Actor
-    for (auto &[id, actor] : actors_)
+    // 排空邮箱并停止所有Actor
+    shutdown();
+
+    if (log_enabled(LogLevel::INFO))
     {
-        if (actor->get_state() == Actor::State::CREATED)
+        std::cout << "Event loop stopped" << std::endl;
+    }
+    running_ = false;
+}
+
+size_t EventLoop::run_until_idle()
+{
+    running_ = true;
+    size_t processed = run_workers();
+    running_ = false;
+    return processed;
+}
+
+size_t EventLoop::run_workers()
+{
+    // Actor的启动、处理函数和调度器在这个线程上看到的是本事件循环的时钟
+    ClockScope clock_scope(clock());
+
+    // 初始化所有已注册的Actor（延迟启动时由worker在第一条消息之前启动）
+    if (!lazy_start_)
+    {
+        for (auto &actor : actors_snapshot())
         {
-            actor->initialize();
-            actor->start();
+            if (actor->get_state() == Actor::State::CREATED)
+            {
+                actor->initialize();
+                actor->start();
+            }
+            else if (actor->get_state() == Actor::State::INITIALIZED)
+            {
+                actor->start();
+            }
         }
-        else if (actor->get_state() == Actor::State::INITIALIZED)
+    }
+
+    size_t worker_count = simulation_ ? 1 : std::max<size_t>(1, worker_count_);
+    run_queues_->resize(worker_count);
+    if (metrics_)
+    {
+        prepare_worker_metrics(worker_count);
+    }
+    if (shared_metrics_)
+    {
+        shared_metrics_->header()->worker_count.store(worker_count, std::memory_order_relaxed);
+    }
+
+    if (simulation_)
+    {
+        return run_simulation();
+    }
+
+    std::atomic<size_t> processed{0};
+
+    auto work = [&](size_t worker_index)
+    {
+        ClockScope clock_scope(clock());
+        // 启用指标时按周期统计忙碌和空闲时间
+        WorkerMetrics *worker_metrics = metrics_ ? &worker_metrics_[worker_index] : nullptr;
+        auto mark = std::chrono::steady_clock::now();
+        SharedMetricsSegment *segment = worker_index == 0 ? shared_metrics_.get() : nullptr;
+        uint64_t ticks = 0;
+        WatchdogAttachment attachment(watchdog_.get(), worker_index);
+        auto account = [&](const std::shared_ptr<Counter> &counter)
         {
-            actor->start();
+            auto now = std::chrono::steady_clock::now();
+            counter->inc(std::chrono::duration_cast<std::chrono::nanoseconds>(now - mark).count());
+            mark = now;
+        };
+
+        while (running_ && (keep_alive_ || has_work()))
+        {
+            if (worker_index == 0)
+            {
+                fire_due_timers();
+
+                // 每64个周期刷新一次共享内存中的心跳和在途消息数
+                if (segment && (ticks++ & 63) == 0)
+                {
+                    segment->header()->in_flight.store(in_flight_messages(), std::memory_order_relaxed);
+                    segment->touch();
+                }
+            }
+
+            if (process_one_cycle(worker_index))
+            {
+                processed.fetch_add(1, std::memory_order_relaxed);
+                if (worker_metrics)
+                {
+                    account(worker_metrics->busy_ns);
+                }
+                continue;
+            }
+
+            // 本worker暂时没有工作，等待新消息而不是空转
+            wait_for_work();
+            if (worker_metrics)
+            {
+                account(worker_metrics->idle_ns);
+            }
         }
+    };
+
+    std::vector<std::thread> workers;
+    for (size_t i = 1; i < worker_count; ++i)
+    {
+        workers.emplace_back(work, i);
     }
+    work(0);
+    for (auto &worker : workers)
+    {
+        worker.join();
+    }
+
+    return processed;
+}
 
-    while (running_ && has_work())
+size_t EventLoop::run_simulation()
+{
+    size_t processed = 0;
+    while (running_)
     {
-        process_one_cycle();
+        fire_due_timers();
+
+        if (process_one_cycle(0))
+        {
+            ++processed;
+            continue;
+        }
+
+        // 其他线程仍在投递消息
+        if (!termination_detector_->is_quiescent())
+        {
+            std::this_thread::yield();
+            continue;
+        }
 
-        // 避免CPU占用过高
-        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        // 没有可处理的消息，把虚拟时间直接推进到下一个定时器
+        Clock::time_point due;
+        if (!next_timer_due(due))
+        {
+            break;
+        }
+        virtual_clock_->advance_to(due);
+    }
+    return processed;
+}
+
+void EventLoop::enable_simulation(const SimulationOptions &options)
+{
+    simulation_ = true;
+    simulation_options_ = options;
+    virtual_clock_ = std::make_shared<VirtualClock>(options.start_time);
+    set_scheduler(std::make_shared<RandomScheduler>(options.seed));
+}
+
+void EventLoop::deliver_after(const Message &message, std::chrono::nanoseconds delay)
+{
+    auto due = clock().now() + std::chrono::duration_cast<Clock::duration>(delay);
+    std::lock_guard<std::mutex> lock(timers_mutex_);
+    timers_.push(Timer{due, next_timer_sequence_++, message});
+    ++pending_timers_;
+}
+
+size_t EventLoop::fire_due_timers()
+{
+    if (pending_timers_.load() == 0)
+    {
+        return 0;
     }
 
-    // 停止所有Actor
-    for (auto &[id, actor] : actors_)
+    std::vector<Message> due_messages;
     {
-        if (actor->is_running())
+        std::lock_guard<std::mutex> lock(timers_mutex_);
+        auto now = clock().now();
+        while (!timers_.empty() && timers_.top().due <= now)
         {
-            actor->stop();
+            due_messages.push_back(timers_.top().message);
+            timers_.pop();
         }
     }
 
-    std::cout << "Event loop stopped" << std::endl;
-    running_ = false;
+    for (const auto &message : due_messages)
+    {
+        deliver_message(message);
+    }
+
+    // 投递完成后才减少计数，避免其他worker在投递过程中误判系统静默
+    pending_timers_ -= due_messages.size();
+    return due_messages.size();
+}
+
+bool EventLoop::next_timer_due(Clock::time_point &due)
+{
+    std::lock_guard<std::mutex> lock(timers_mutex_);
+    if (timers_.empty())
+    {
+        return false;
+    }
+    due = timers_.top().due;
+    return true;
 }
 
 void EventLoop::stop()
 {
     running_ = false;
+    wake_idle_workers();
+}
+
+void EventLoop::wait_for_work()
+{
+    std::unique_lock<std::mutex> lock(idle_mutex_);
+    idle_workers_.fetch_add(1);
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+
+    // 有在途消息时它们可能属于其他worker，只短暂等待；系统静默时等待投递唤醒
+    auto timeout = termination_detector_->in_flight() > 0
+                       ? std::chrono::microseconds(100)
+                       : std::chrono::microseconds(1000);
+    if (running_)
+    {
+        idle_cv_.wait_for(lock, timeout);
+    }
+    idle_workers_.fetch_sub(1);
+}
+
+void EventLoop::wake_idle_workers()
+{
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    if (idle_workers_.load(std::memory_order_relaxed) > 0)
+    {
+        std::lock_guard<std::mutex> lock(idle_mutex_);
+        idle_cv_.notify_all();
+    }
+}
+
+ShutdownReport EventLoop::shutdown()
+{
+    auto started_at = std::chrono::steady_clock::now();
+    auto deadline = started_at + shutdown_options_.drain_deadline;
+    ShutdownReport report;
+    ClockScope clock_scope(clock());
+
+    // 1. 停止外部投递，之后只有排空worker上的处理函数还能发送消息
+    rejected_during_shutdown_ = 0;
+    accepting_ = false;
+
+    auto actors = actors_snapshot();
+
+    size_t worker_count = shutdown_options_.worker_count;
+    if (worker_count == 0)
+    {
+        worker_count = std::max(1u, std::thread::hardware_concurrency());
+    }
+    worker_count = std::min(worker_count, std::max<size_t>(1, actors.size()));
+
+    // 2. 按worker划分Actor，每个Actor只会被一个worker处理
+    std::vector<std::vector<std::shared_ptr<Actor>>> partitions(worker_count);
+    for (size_t i = 0; i < actors.size(); ++i)
+    {
+        partitions[i % worker_count].push_back(actors[i]);
+    }
+
+    std::atomic<size_t> drained{0};
+    std::atomic<bool> deadline_exceeded{false};
+
+    auto drain = [&](const std::vector<std::shared_ptr<Actor>> &partition)
+    {
+        ShutdownWorkerScope scope;
+        ClockScope clock_scope(clock());
+        while (true)
+        {
+            if (std::chrono::steady_clock::now() >= deadline)
+            {
+                deadline_exceeded = true;
+                return;
+            }
+
+            size_t processed = 0;
+            for (const auto &actor : partition)
+            {
+                auto state = actor->get_state();
+                if ((state == Actor::State::RUNNING || state == Actor::State::STOPPING ||
+                     actor->awaiting_first_message()) &&
+                    actor->process_next_message())
+                {
+                    ++processed;
+                }
+            }
+            if (processed > 0)
+            {
+                drained += processed;
+                continue;
+            }
+
+            // 本分区已空，但其他worker上的处理函数仍可能向本分区发送消息
+            if (termination_detector_->is_quiescent())
+            {
+                return;
+            }
+            std::this_thread::yield();
+        }
+    };
+
+    std::vector<std::thread> workers;
+    for (size_t i = 1; i < worker_count; ++i)
+    {
+        workers.emplace_back(drain, std::cref(partitions[i]));
+    }
+    drain(partitions[0]);
+    for (auto &worker : workers)
+    {
+        worker.join();
+    }
+
+    // 3. 停止所有Actor，截止时间到达后仍有消息的Actor被立即停止；未到期的定时器一并丢弃
+    size_t discarded = 0;
+    // 从邮箱中丢弃的消息数量，只有确实丢弃了消息才算超过截止时间
+    size_t abandoned = 0;
+    {
+        std::lock_guard<std::mutex> lock(timers_mutex_);
+        discarded += timers_.size();
+        pending_timers_ -= timers_.size();
+        timers_ = decltype(timers_)();
+    }
+    for (const auto &actor : actors)
+    {
+        // 截止时间前没有轮到的延迟启动Actor不再启动，只丢弃邮箱
+        if (actor->awaiting_first_message())
+        {
+            if (actor->has_messages())
+            {
+                abandoned += actor->discard_messages();
+            }
+            continue;
+        }
+
+        auto state = actor->get_state();
+        if (state != Actor::State::RUNNING && state != Actor::State::STOPPING)
+        {
+            continue;
+        }
+
+        if (actor->has_messages())
+        {
+            abandoned += actor->discard_messages();
+            actor->stop_immediately();
+            ++report.actors_force_stopped;
+        }
+        else
+        {
+            actor->stop();
+        }
+        ++report.actors_stopped;
+    }
+
+    // 邮箱都已清空，把Actor从就绪队列中摘下，不再持有它们的引用
+    std::vector<std::shared_ptr<Actor>> pending;
+    for (size_t i = 0; i < run_queues_->worker_count(); ++i)
+    {
+        size_t ready = 0;
+        while (auto actor = run_queues_->pop(i, nullptr, ready))
+        {
+            if (!actor->try_unschedule())
+            {
+                pending.push_back(std::move(actor));
+            }
+        }
+    }
+    for (auto &actor : pending)
+    {
+        run_queues_->push(std::move(actor));
+    }
+
+    report.messages_drained = drained;
+    report.messages_dropped = discarded + abandoned + rejected_during_shutdown_;
+    report.deadline_exceeded = deadline_exceeded && abandoned > 0;
+    report.elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(
+        std::chrono::steady_clock::now() - started_at);
+
+    accepting_ = true;
+    last_shutdown_report_ = report;
+
+    if (log_enabled(LogLevel::INFO))
+    {
+        std::cout << "Event loop shutdown: " << report.actors_stopped << " actors stopped ("
+                  << report.actors_force_stopped << " forced), "
+                  << report.messages_drained << " messages drained, "
+                  << report.messages_dropped << " messages dropped" << std::endl;
+    }
+
+    return report;
 }
 
 void EventLoop::register_actor(std::shared_ptr<Actor> actor)
 {
-    actors_[actor->get_id()] = actor;
-    std::cout << "Registered actor: " << actor->get_name()
-              << " (ID: " << actor->get_id() << ")" << std::endl;
+    actor->attach_termination_detector(termination_detector_);
+    actor->attach_run_queues(run_queues_);
+    actor->attach_trace_recorder(trace_recorder_);
+    actor->attach_span_collector(span_collector_);
+    if (handler_timing_)
+    {
+        actor->set_handler_timing(true);
+    }
+    if (lazy_start_)
+    {
+        actor->set_lazy_start(true);
+    }
+    if (metrics_)
+    {
+        actor->attach_metrics(actor_metrics_for(*actor));
+    }
+    if (shared_metrics_)
+    {
+        attach_shared_slot(*actor);
+    }
+    {
+        std::unique_lock<std::shared_mutex> lock(actors_mutex_);
+        auto &entry = actors_[actor->get_id()];
+        if (entry)
+        {
+            actors_by_serial_.erase(entry->get_serial());
+        }
+        entry = actor;
+        actors_by_serial_[actor->get_serial()] = actor;
+        actor->get_stats_slot()->event_loop.store(this, std::memory_order_relaxed);
+        if (shared_metrics_)
+        {
+            shared_metrics_->header()->actors.store(actors_.size(), std::memory_order_relaxed);
+        }
+    }
+    if (log_enabled(LogLevel::INFO))
+    {
+        std::cout << "Registered actor: " << actor->get_name()
+                  << " (ID: " << actor->get_id() << ")" << std::endl;
+    }
 
     // 如果事件循环已经在运行，则初始化并启动Actor
-    if (running_)
+    if (running_ && !lazy_start_)
     {
         if (actor->get_state() == Actor::State::CREATED)
         {
@@ -79,27 +567,71 @@ void EventLoop::register_actor(std::shared_ptr<Actor> actor)
     }
 }
 
-void EventLoop::remove_actor(const std::string &actor_id)
+void EventLoop::remove_actor(std::string_view actor_id)
 {
-    auto it = actors_.find(actor_id);
-    if (it != actors_.end())
+    std::shared_ptr<Actor> actor;
+    {
+        std::unique_lock<std::shared_mutex> lock(actors_mutex_);
+        auto it = actors_.find(actor_id);
+        if (it == actors_.end())
+        {
+            return;
+        }
+        actor = it->second;
+        actors_.erase(it);
+        actors_by_serial_.erase(actor->get_serial());
+        actor->get_stats_slot()->event_loop.store(nullptr, std::memory_order_relaxed);
+        if (shared_metrics_)
+        {
+            shared_metrics_->header()->actors.store(actors_.size(), std::memory_order_relaxed);
+        }
+    }
+
+    // 如果Actor正在运行，先停止它；未处理完的消息也要丢弃，否则会一直计为在途消息
+    if (actor->is_running())
+    {
+        actor->stop_immediately();
+    }
+    else if (actor->has_messages())
     {
-        auto actor = it->second;
+        actor->discard_messages();
+    }
+    actor->attach_termination_detector(nullptr);
+    actor->attach_run_queues(nullptr);
+    run_queues_->remove(*actor);
+    actor->attach_trace_recorder(nullptr);
+    actor->attach_span_collector(nullptr);
+    if (shared_metrics_ && actor->get_shared_slot())
+    {
+        shared_metrics_->release(actor->get_shared_slot().get());
+        actor->attach_shared_slot(nullptr);
+    }
 
-        // 如果Actor正在运行，先停止它
-        if (actor->is_running())
+    // 指标句柄保留在Actor上（收集回调可能正在读取），按ID标注时移除对应的时间序列
+    const auto &actor_metrics = actor->get_metrics();
+    if (metrics_ && actor_metrics && metrics_options_.actor_label == MetricsOptions::ActorLabel::ID)
+    {
+        std::lock_guard<std::mutex> lock(metrics_mutex_);
+        if (actor_series_.erase(actor_metrics->label) > 0)
         {
-            actor->stop_immediately();
+            MetricLabels labels{{"actor", actor_metrics->label}};
+            metrics_->remove("actor_messages_processed_total", labels);
+            metrics_->remove("actor_messages_dropped_total", labels);
+            metrics_->remove("actor_mailbox_depth", labels);
+            metrics_->remove("actor_handler_latency_seconds", labels);
         }
+    }
 
-        actors_.erase(it);
+    if (log_enabled(LogLevel::INFO))
+    {
         std::cout << "Removed actor: " << actor->get_name()
                   << " (ID: " << actor->get_id() << ")" << std::endl;
     }
 }
 
-std::shared_ptr<Actor> EventLoop::find_actor(const std::string &actor_id)
+std::shared_ptr<Actor> EventLoop::find_actor(std::string_view actor_id)
 {
+    std::shared_lock<std::shared_mutex> lock(actors_mutex_);
     auto it = actors_.find(actor_id);
     if (it != actors_.end())
     {
@@ -108,78 +640,519 @@ std::shared_ptr<Actor> EventLoop::find_actor(const std::string &actor_id)
     return nullptr;
 }
 
+std::shared_ptr<Actor> EventLoop::find_actor_by_serial(uint64_t serial)
+{
+    std::shared_lock<std::shared_mutex> lock(actors_mutex_);
+    auto it = actors_by_serial_.find(serial);
+    if (it != actors_by_serial_.end())
+    {
+        return it->second;
+    }
+    return nullptr;
+}
+
 void EventLoop::deliver_message(const Message &message)
 {
+    // 关闭期间拒绝外部投递
+    if (!accepting_ && !t_shutdown_worker)
+    {
+        ++rejected_during_shutdown_;
+        ACTOR_PROBE3(deliver_fail, message.get_target_id().c_str(), message.get_type().c_str(), "shutdown");
+        if (undeliverable_shutdown_)
+        {
+            undeliverable_shutdown_->inc();
+        }
+        if (log_enabled(LogLevel::WARN))
+        {
+            std::cerr << "Failed to deliver message: event loop is shutting down, ID: "
+                      << message.get_target_id() << std::endl;
+        }
+        return;
+    }
+
     auto target_actor = find_actor(message.get_target_id());
     if (target_actor)
     {
-        if (target_actor->is_running())
+        if (target_actor->is_running() || target_actor->awaiting_first_message())
         {
-            target_actor->receive(message);
+            // 直接复制到邮箱的资源上，入队时不必再搬一次负载
+            if (target_actor->receive(Message(message, Message::allocator_type(target_actor->mailbox_resource()))))
+            {
+                ACTOR_PROBE3(deliver, message.get_target_id().c_str(), message.get_type().c_str(),
+                             message.get_sender_id().c_str());
+                wake_idle_workers();
+            }
+            else
+            {
+                ACTOR_PROBE3(deliver_fail, message.get_target_id().c_str(), message.get_type().c_str(), "rejected");
+            }
         }
         else
         {
-            std::cerr << "Failed to deliver message: target actor not running, ID: "
-                      << message.get_target_id() << std::endl;
+            ACTOR_PROBE3(deliver_fail, message.get_target_id().c_str(), message.get_type().c_str(), "not_running");
+            if (undeliverable_not_running_)
+            {
+                undeliverable_not_running_->inc();
+            }
+            if (log_enabled(LogLevel::WARN))
+            {
+                std::cerr << "Failed to deliver message: target actor not running, ID: "
+                          << message.get_target_id() << std::endl;
+            }
         }
     }
     else
     {
-        std::cerr << "Failed to deliver message: target actor not found, ID: "
-                  << message.get_target_id() << std::endl;
+        ACTOR_PROBE3(deliver_fail, message.get_target_id().c_str(), message.get_type().c_str(), "not_found");
+        if (undeliverable_not_found_)
+        {
+            undeliverable_not_found_->inc();
+        }
+        if (log_enabled(LogLevel::WARN))
+        {
+            std::cerr << "Failed to deliver message: target actor not found, ID: "
+                      << message.get_target_id() << std::endl;
+        }
     }
 }
 
-void EventLoop::set_scheduler(std::shared_ptr<Scheduler> scheduler)
+void EventLoop::set_trace_recorder(std::shared_ptr<TraceRecorder> recorder)
 {
-    scheduler_ = scheduler;
+    trace_recorder_ = recorder;
+    for (const auto &actor : actors_snapshot())
+    {
+        actor->attach_trace_recorder(recorder);
+    }
 }
 
-bool EventLoop::has_work() const
+void EventLoop::set_span_collector(std::shared_ptr<SpanCollector> collector)
 {
-    // 检查是否有运行中的Actor还有消息要处理
-    for (const auto &[_, actor] : actors_)
+    span_collector_ = collector;
+    for (const auto &actor : actors_snapshot())
     {
-        if (actor->is_running() && actor->has_messages())
+        actor->attach_span_collector(collector);
+    }
+}
+
+std::shared_ptr<std::pmr::memory_resource> EventLoop::memory_resource_for(uint64_t serial) const
+{
+    if (memory_resources_.empty())
+    {
+        return nullptr;
+    }
+    size_t worker = simulation_ ? 0 : serial % std::max<size_t>(1, worker_count_);
+    return memory_resources_[worker % memory_resources_.size()];
+}
+
+void EventLoop::set_handler_timing(bool enabled)
+{
+    handler_timing_ = enabled;
+    for (const auto &actor : actors_snapshot())
+    {
+        actor->set_handler_timing(enabled);
+    }
+}
+
+void EventLoop::set_lazy_start(bool enabled)
+{
+    lazy_start_ = enabled;
+    for (const auto &actor : actors_snapshot())
+    {
+        actor->set_lazy_start(enabled);
+    }
+}
+
+SystemSnapshot EventLoop::snapshot(size_t top_n, SnapshotOrder order) const
+{
+    SystemSnapshot result;
+    result.taken_ns = std::chrono::duration_cast<std::chrono::nanoseconds>(
+                          std::chrono::system_clock::now().time_since_epoch())
+                          .count();
+    auto started_at = std::chrono::steady_clock::now();
+
+    // 排序键在扫描时算好，比较时不再区分排序方式；相同时按槽位顺序
+    struct Candidate
+    {
+        uint64_t primary;
+        uint64_t secondary;
+        size_t index;
+        const ActorStatsSlot *slot;
+        ActorStats stats;
+    };
+    auto ranks_before = [](const Candidate &a, const Candidate &b)
+    {
+        if (a.primary != b.primary)
+        {
+            return a.primary > b.primary;
+        }
+        if (a.secondary != b.secondary)
         {
-            return true;
+            return a.secondary > b.secondary;
+        }
+        return a.index < b.index;
+    };
+
+    // 只保留前top_n个：堆顶是其中排名最靠后的，新的Actor排在它前面时替换它
+    size_t limit = top_n == 0 ? std::numeric_limits<size_t>::max() : top_n;
+    std::vector<Candidate> top;
+    top.reserve(std::min<size_t>(limit, 4096));
+
+    // 持有读锁期间注册表不变，event_loop指向本事件循环的槽位的owner都是存活的
+    std::shared_lock<std::shared_mutex> lock(actors_mutex_);
+    result.actor_count = actors_.size();
+    size_t chunks = ActorStatsTable::chunk_count();
+    for (size_t c = 0; c < chunks; ++c)
+    {
+        const ActorStatsSlot *chunk = ActorStatsTable::chunk(c);
+        for (size_t i = 0; i < ActorStatsTable::kChunkSize; ++i)
+        {
+            const ActorStatsSlot &slot = chunk[i];
+            if (slot.event_loop.load(std::memory_order_relaxed) != this)
+            {
+                continue;
+            }
+            Candidate candidate{0, 0, c * ActorStatsTable::kChunkSize + i, &slot, slot.read()};
+            result.total_backlog += candidate.stats.mailbox_depth;
+            switch (order)
+            {
+            case SnapshotOrder::BACKLOG:
+                candidate.primary = candidate.stats.mailbox_depth;
+                candidate.secondary = static_cast<uint64_t>(candidate.stats.top_priority + 1);
+                break;
+            case SnapshotOrder::HANDLER_TIME:
+                candidate.primary = candidate.stats.handler_ns_total;
+                break;
+            case SnapshotOrder::PROCESSED:
+                candidate.primary = candidate.stats.processed;
+                break;
+            }
+
+            if (top.size() < limit)
+            {
+                top.push_back(candidate);
+                std::push_heap(top.begin(), top.end(), ranks_before);
+            }
+            else if (ranks_before(candidate, top.front()))
+            {
+                std::pop_heap(top.begin(), top.end(), ranks_before);
+                top.back() = candidate;
+                std::push_heap(top.begin(), top.end(), ranks_before);
+            }
         }
     }
+    std::sort_heap(top.begin(), top.end(), ranks_before);
 
-    // 检查是否有处于STOPPING状态的Actor还有消息要处理
-    for (const auto &[_, actor] : actors_)
+    // 只为入选的Actor访问Actor对象，名称和ID创建后不会修改
+    result.actors.reserve(top.size());
+    for (const auto &candidate : top)
     {
-        if (actor->get_state() == Actor::State::STOPPING && actor->has_messages())
+        const Actor *owner = candidate.slot->owner.load(std::memory_order_acquire);
+        ActorSnapshot actor;
+        actor.id = owner->get_id();
+        actor.name = owner->get_name();
+        actor.serial = owner->get_serial();
+        actor.state = static_cast<Actor::State>(candidate.slot->state.load(std::memory_order_relaxed));
+        actor.stats = candidate.stats;
+        result.actors.push_back(std::move(actor));
+    }
+    lock.unlock();
+
+    result.in_flight = termination_detector_->in_flight();
+    result.scan_ns = std::chrono::duration_cast<std::chrono::nanoseconds>(
+                         std::chrono::steady_clock::now() - started_at)
+                         .count();
+    return result;
+}
+
+void EventLoop::set_metrics(std::shared_ptr<MetricsRegistry> registry, const MetricsOptions &options)
+{
+    if (metrics_)
+    {
+        metrics_->remove_collector(metrics_collector_id_);
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(metrics_mutex_);
+        metrics_ = registry;
+        metrics_options_ = options;
+        actor_series_.clear();
+        worker_metrics_.clear();
+    }
+
+    if (!metrics_)
+    {
+        undeliverable_shutdown_.reset();
+        undeliverable_not_running_.reset();
+        undeliverable_not_found_.reset();
+        actor_series_overflow_.reset();
+        for (const auto &actor : actors_snapshot())
         {
-            return true;
+            actor->attach_metrics(nullptr);
         }
+        return;
     }
 
-    return false;
+    const std::string help = "Messages that could not be delivered, by reason.";
+    undeliverable_shutdown_ = metrics_->counter("actor_messages_undeliverable_total", help, {{"reason", "shutdown"}});
+    undeliverable_not_running_ = metrics_->counter("actor_messages_undeliverable_total", help, {{"reason", "not_running"}});
+    undeliverable_not_found_ = metrics_->counter("actor_messages_undeliverable_total", help, {{"reason", "not_found"}});
+    actor_series_overflow_ = metrics_->counter("actor_metrics_series_overflow_total",
+                                               "Actors folded into actor=\"_other\" by the series limit.");
+
+    for (const auto &actor : actors_snapshot())
+    {
+        actor->attach_metrics(actor_metrics_for(*actor));
+    }
+    metrics_collector_id_ = metrics_->add_collector([this]()
+                                                    { collect_metrics(); });
 }
 
-void EventLoop::process_one_cycle()
+void EventLoop::set_shared_metrics(std::shared_ptr<SharedMetricsSegment> segment)
 {
-    // 收集所有有消息且在运行状态的actor
-    std::vector<std::shared_ptr<Actor>> active_actors;
-    for (const auto &[_, actor] : actors_)
+    auto actors = actors_snapshot();
+    for (const auto &actor : actors)
     {
-        if ((actor->is_running() || actor->get_state() == Actor::State::STOPPING) && actor->has_messages())
+        if (shared_metrics_ && actor->get_shared_slot())
         {
-            active_actors.push_back(actor);
+            shared_metrics_->release(actor->get_shared_slot().get());
         }
+        actor->attach_shared_slot(nullptr);
+    }
+
+    shared_metrics_ = std::move(segment);
+    if (!shared_metrics_)
+    {
+        return;
+    }
+
+    for (const auto &actor : actors)
+    {
+        attach_shared_slot(*actor);
+    }
+    shared_metrics_->header()->actors.store(actors.size(), std::memory_order_relaxed);
+    shared_metrics_->header()->worker_count.store(std::max<size_t>(1, worker_count_), std::memory_order_relaxed);
+}
+
+void EventLoop::attach_shared_slot(Actor &actor)
+{
+    SharedActorSlot *slot = shared_metrics_->allocate(actor.get_name(), actor.get_id(), actor.get_serial());
+    if (slot)
+    {
+        // 别名指针：槽位存活期间保持整个段的映射
+        actor.attach_shared_slot(std::shared_ptr<SharedActorSlot>(shared_metrics_, slot));
+    }
+}
+
+std::shared_ptr<ActorMetrics> EventLoop::actor_metrics_for(const Actor &actor)
+{
+    std::string label;
+    switch (metrics_options_.actor_label)
+    {
+    case MetricsOptions::ActorLabel::NAME:
+        label = actor.get_name();
+        break;
+    case MetricsOptions::ActorLabel::ID:
+        label = actor.get_id();
+        break;
+    case MetricsOptions::ActorLabel::NONE:
+        break;
+    }
+
+    std::lock_guard<std::mutex> lock(metrics_mutex_);
+    auto it = actor_series_.find(label);
+    if (it != actor_series_.end())
+    {
+        return it->second;
     }
 
-    if (active_actors.empty())
+    // 超过基数上限后新的标签值都合并到"_other"
+    if (actor_series_.size() >= std::max<size_t>(1, metrics_options_.max_actor_series))
     {
-        return; // 没有工作要做
+        actor_series_overflow_->inc();
+        label = "_other";
+        it = actor_series_.find(label);
+        if (it != actor_series_.end())
+        {
+            return it->second;
+        }
     }
 
-    // 使用调度器选择下一个要处理的actor
-    auto next = scheduler_->next_actor(active_actors);
-    if (next)
+    MetricLabels labels;
+    if (metrics_options_.actor_label != MetricsOptions::ActorLabel::NONE)
+    {
+        labels.emplace_back("actor", label);
+    }
+
+    auto handle = std::make_shared<ActorMetrics>();
+    handle->label = label;
+    handle->processed = metrics_->counter("actor_messages_processed_total",
+                                          "Messages processed by actor handlers.", labels);
+    handle->dropped = metrics_->counter("actor_messages_dropped_total",
+                                        "Messages rejected by or discarded from actor mailboxes.", labels);
+    handle->mailbox_depth = metrics_->gauge("actor_mailbox_depth", "Messages waiting in actor mailboxes.", labels);
+    if (metrics_options_.handler_latency)
+    {
+        handle->handler_latency = metrics_->summary("actor_handler_latency_seconds",
+                                                    "Handler execution time.", labels, 1e-9);
+    }
+    actor_series_[label] = handle;
+    return handle;
+}
+
+void EventLoop::prepare_worker_metrics(size_t worker_count)
+{
+    std::lock_guard<std::mutex> lock(metrics_mutex_);
+    while (worker_metrics_.size() < worker_count)
+    {
+        MetricLabels labels{{"worker", std::to_string(worker_metrics_.size())}};
+        WorkerMetrics worker;
+        worker.picks = metrics_->counter("actor_scheduler_picks_total",
+                                         "Actors selected by the scheduler.", labels);
+        worker.busy_ns = metrics_->counter("actor_worker_busy_seconds_total",
+                                           "Time workers spent processing messages.", labels, 1e-9);
+        worker.idle_ns = metrics_->counter("actor_worker_idle_seconds_total",
+                                           "Time workers spent waiting for messages.", labels, 1e-9);
+        worker.utilization = metrics_->gauge("actor_worker_utilization",
+                                             "Fraction of worker time spent processing messages.", labels);
+        worker_metrics_.push_back(std::move(worker));
+    }
+}
+
+void EventLoop::collect_metrics()
+{
+    auto actors = actors_snapshot();
+
+    // 同一时间序列可能对应多个Actor，邮箱深度按序列求和
+    std::unordered_map<const ActorMetrics *, size_t> depths;
+    for (const auto &actor : actors)
+    {
+        if (const auto &handle = actor->get_metrics())
+        {
+            depths[handle.get()] += actor->message_count();
+        }
+    }
+
+    uint64_t busy_total = 0;
+    uint64_t idle_total = 0;
+    {
+        std::lock_guard<std::mutex> lock(metrics_mutex_);
+        for (const auto &[_, handle] : actor_series_)
+        {
+            auto it = depths.find(handle.get());
+            handle->mailbox_depth->set(it != depths.end() ? static_cast<double>(it->second) : 0.0);
+        }
+
+        for (const auto &worker : worker_metrics_)
+        {
+            uint64_t busy = worker.busy_ns->value();
+            uint64_t idle = worker.idle_ns->value();
+            busy_total += busy;
+            idle_total += idle;
+            worker.utilization->set(busy + idle > 0 ? static_cast<double>(busy) / static_cast<double>(busy + idle) : 0.0);
+        }
+    }
+
+    metrics_->gauge("actor_loop_actors", "Actors registered with the event loop.")
+        ->set(static_cast<double>(actors.size()));
+    metrics_->gauge("actor_loop_in_flight_messages", "Messages enqueued but not yet processed.")
+        ->set(static_cast<double>(in_flight_messages()));
+    metrics_->gauge("actor_loop_idle_ratio", "Fraction of worker time spent idle.")
+        ->set(busy_total + idle_total > 0
+                  ? static_cast<double>(idle_total) / static_cast<double>(busy_total + idle_total)
+                  : 0.0);
+}
+
+void EventLoop::set_scheduler(std::shared_ptr<Scheduler> scheduler)
+{
+    std::lock_guard<std::mutex> lock(scheduler_mutex_);
+    scheduler_ = scheduler;
+    fifo_scheduler_ = scheduler_->is_fifo();
+}
+
+bool EventLoop::has_work() const
+{
+    // 只要还有在途消息（已入队但尚未处理完成）或未投递的定时器，就还有工作要做
+    return pending_timers_.load() > 0 || !termination_detector_->is_quiescent();
+}
+
+size_t EventLoop::in_flight_messages() const
+{
+    return termination_detector_->in_flight();
+}
+
+bool EventLoop::process_one_cycle(size_t worker_index)
+{
+    // 从本worker的就绪队列中取出actor（不扫描注册表）；取出的actor不接受在别处重复入队，
+    // 由Requeue在处理之后放回末尾或清除就绪标记。最多尝试一轮，跳过邮箱已被清空的actor
+    size_t attempts = 0;
+    size_t ready = 0;
+    do
+    {
+        std::shared_ptr<Actor> next;
+        if (fifo_scheduler_)
+        {
+            next = run_queues_->pop(worker_index, nullptr, ready);
+        }
+        else
+        {
+            // 调度器可能有内部状态，多个worker共享时需要加锁
+            std::lock_guard<std::mutex> lock(scheduler_mutex_);
+            next = run_queues_->pop(worker_index, scheduler_.get(), ready);
+        }
+        if (!next)
+        {
+            return false; // 没有工作要做
+        }
+
+        Requeue requeue(*run_queues_, next);
+        if (!(next->is_running() || next->get_state() == Actor::State::STOPPING || next->awaiting_first_message()) ||
+            !next->has_messages())
+        {
+            continue;
+        }
+
+        if (!worker_metrics_.empty() && metrics_)
+        {
+            worker_metrics_[worker_index].picks->inc();
+        }
+        ACTOR_PROBE3(pick, next->get_id().c_str(), worker_index, ready);
+        FlightRecorder::record(FlightRecorder::EventType::PICK, next->get_serial(), ready,
+                               static_cast<uint32_t>(worker_index));
+
+        if (!simulation_)
+        {
+            // 处理该actor的下一条消息
+            return next->process_next_message();
+        }
+
+        // 仿真模式：按耗时模型（或实测耗时）推进虚拟时钟
+        std::chrono::nanoseconds cost{0};
+        bool processed = false;
+        if (simulation_options_.cost_model)
+        {
+            cost = simulation_options_.cost_model(*next, next->peek_next_message());
+            processed = next->process_next_message();
+        }
+        else
+        {
+            auto started_at = std::chrono::steady_clock::now();
+            processed = next->process_next_message();
+            cost = std::chrono::steady_clock::now() - started_at;
+        }
+        virtual_clock_->advance(cost);
+        return processed;
+    } while (++attempts < ready);
+    return false;
+}
+
+std::vector<std::shared_ptr<Actor>> EventLoop::actors_snapshot() const
+{
+    std::shared_lock<std::shared_mutex> lock(actors_mutex_);
+    std::vector<std::shared_ptr<Actor>> actors;
+    actors.reserve(actors_.size());
+    for (const auto &[_, actor] : actors_)
     {
-        // 处理该actor的下一条消息
-        next->process_next_message();
+        actors.push_back(actor);
     }
+    return actors;
 }
\ No newline at end of file
@@ -0,0 +1,509 @@
+#include "flight_recorder.h"
+#include <algorithm>
+#include <cerrno>
+#include <csignal>
+#include <cstring>
+#include <ctime>
+#include <fcntl.h>
+#include <fstream>
+#include <mutex>
+#include <stdexcept>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#define ACTOR_FLIGHT_USE_TSC 1
+#endif
+
+/**
+ * 转储文件格式（本机字节序）：
+ *   DumpHeader
+ *   actor_count个ActorEntry
+ *   ring_count个线程段：RingHeader，count个RawEvent（序号从first开始），RingTrailer
+ * 序号小于RingTrailer::head_after - capacity的事件在读取期间可能已被覆盖，解码时丢弃。
+ */
+namespace {
+    constexpr char kFlightMagic[8] = {'A', 'C', 'T', 'R', 'F', 'L', 'T', '1'};
+    constexpr uint32_t kFlightVersion = 1;
+
+    struct RawEvent {
+        uint64_t ticks;
+        uint64_t actor;
+        uint64_t value;
+        uint32_t aux;
+        uint16_t type;
+        uint16_t reserved;
+    };
+    static_assert(sizeof(RawEvent) == 32, "flight events must stay 32 bytes");
+
+    struct DumpHeader {
+        char magic[8];
+        uint32_t version;
+        uint32_t event_size;
+        uint32_t pid;
+        int32_t reason;
+        uint64_t capacity;
+        uint64_t ring_count;
+        uint64_t actor_count;
+        uint64_t install_ticks;
+        int64_t install_ns;
+        uint64_t dump_ticks;
+        int64_t dump_ns;
+        double calibrated_ticks_per_ns;
+    };
+
+    struct ActorEntry {
+        uint64_t serial;
+        char name[48];
+        char id[40];
+    };
+
+    struct RingHeader {
+        uint32_t index;
+        uint32_t reserved;
+        uint64_t tid;
+        uint64_t first;
+        uint64_t count;
+    };
+
+    struct RingTrailer {
+        uint64_t head_after;
+    };
+
+    // 单个线程的环形缓冲区，只由所属线程写入
+    struct alignas(64) Ring {
+        std::atomic<uint64_t> head{0};
+        // 线程退出后复用缓冲区时，之前的事件不属于新线程，从base开始转储
+        std::atomic<uint64_t> base{0};
+        std::atomic<uint64_t> tid{0};
+        std::atomic<bool> in_use{false};
+        RawEvent* events = nullptr;
+    };
+
+    constexpr size_t kActorChunkSize = 1024;
+    constexpr size_t kMaxActorChunks = 1024;
+
+    // 名称表按块追加，块一旦发布就不再移动，信号处理函数可以无锁遍历
+    struct ActorChunk {
+        ActorEntry entries[kActorChunkSize];
+        std::atomic<uint32_t> count{0};
+        std::atomic<ActorChunk*> next{nullptr};
+    };
+
+    std::atomic<bool> installed{false};
+    uint64_t capacity = 0;
+    uint64_t mask = 0;
+    size_t max_threads = 0;
+    Ring* rings = nullptr;
+    std::atomic<uint32_t> ring_count{0};
+
+    ActorChunk* first_chunk = nullptr;
+    ActorChunk* last_chunk = nullptr;
+    size_t chunk_count = 0;
+
+    // 保护缓冲区分配和名称表追加（不会在信号处理函数中使用）
+    std::mutex install_mutex;
+
+    uint64_t install_ticks = 0;
+    int64_t install_ns = 0;
+    double calibrated_ticks_per_ns = 1.0;
+
+    char dump_path[4096];
+    char crash_path[4096];
+    struct sigaction previous_actions[NSIG];
+
+    thread_local Ring* thread_ring = nullptr;
+    thread_local bool thread_detached = false;
+
+    // 线程退出时释放缓冲区供新线程复用
+    struct RingOwner {
+        Ring* ring = nullptr;
+        ~RingOwner() {
+            if (ring) {
+                ring->in_use.store(false, std::memory_order_release);
+            }
+        }
+    };
+    thread_local RingOwner ring_owner;
+
+    int64_t monotonic_ns() {
+        timespec now;
+        ::clock_gettime(CLOCK_MONOTONIC, &now);
+        return static_cast<int64_t>(now.tv_sec) * 1000000000 + now.tv_nsec;
+    }
+
+    // 在每个时间戳计数器与单调时钟之间建立换算关系
+    void calibrate() {
+        install_ticks = FlightRecorder::timestamp();
+        install_ns = monotonic_ns();
+#ifdef ACTOR_FLIGHT_USE_TSC
+        int64_t end_ns;
+        uint64_t end_ticks;
+        do {
+            end_ticks = FlightRecorder::timestamp();
+            end_ns = monotonic_ns();
+        } while (end_ns - install_ns < 2000000);
+        calibrated_ticks_per_ns = static_cast<double>(end_ticks - install_ticks) / static_cast<double>(end_ns - install_ns);
+#endif
+    }
+
+    Ring* attach_thread() {
+        if (thread_detached || !installed.load(std::memory_order_acquire)) {
+            return nullptr;
+        }
+        std::lock_guard<std::mutex> lock(install_mutex);
+        uint64_t tid = static_cast<uint64_t>(::syscall(SYS_gettid));
+        uint32_t count = ring_count.load(std::memory_order_relaxed);
+
+        Ring* ring = nullptr;
+        for (uint32_t i = 0; i < count && !ring; ++i) {
+            if (!rings[i].in_use.load(std::memory_order_acquire)) {
+                ring = &rings[i];
+                ring->base.store(ring->head.load(std::memory_order_relaxed), std::memory_order_relaxed);
+            }
+        }
+        if (!ring && count < max_threads) {
+            ring = &rings[count];
+            ring->events = new RawEvent[capacity]();
+            ring_count.store(count + 1, std::memory_order_release);
+        }
+        if (!ring) {
+            // 线程数超过上限，本线程不再记录
+            thread_detached = true;
+            return nullptr;
+        }
+        ring->tid.store(tid, std::memory_order_relaxed);
+        ring->in_use.store(true, std::memory_order_release);
+        ring_owner.ring = ring;
+        thread_ring = ring;
+        return ring;
+    }
+
+    bool write_all(int fd, const void* data, size_t size) {
+        const char* bytes = static_cast<const char*>(data);
+        while (size > 0) {
+            ssize_t written = ::write(fd, bytes, size);
+            if (written < 0) {
+                if (errno == EINTR) {
+                    continue;
+                }
+                return false;
+            }
+            bytes += written;
+            size -= static_cast<size_t>(written);
+        }
+        return true;
+    }
+
+    void copy_field(char* dest, size_t size, const std::string& value) {
+        size_t length = std::min(value.size(), size - 1);
+        std::memcpy(dest, value.data(), length);
+        std::memset(dest + length, 0, size - length);
+    }
+
+    void dump_to_path(const char* path, int signo) {
+        int saved_errno = errno;
+        int fd = ::open(path, O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+        if (fd >= 0) {
+            FlightRecorder::dump_to_fd(fd, signo);
+            ::close(fd);
+        }
+        errno = saved_errno;
+    }
+
+    void on_dump_signal(int signo) {
+        dump_to_path(dump_path, signo);
+    }
+
+    // 崩溃时转储后恢复原来的处理方式并重新触发信号
+    void on_crash_signal(int signo) {
+        dump_to_path(crash_path, signo);
+        ::sigaction(signo, &previous_actions[signo], nullptr);
+        ::raise(signo);
+    }
+
+    void install_handler(int signo, void (*handler)(int)) {
+        struct sigaction action;
+        std::memset(&action, 0, sizeof(action));
+        action.sa_handler = handler;
+        sigemptyset(&action.sa_mask);
+        action.sa_flags = SA_RESTART;
+        ::sigaction(signo, &action, &previous_actions[signo]);
+    }
+
+    void set_path(char* dest, size_t size, const std::string& path) {
+        if (path.empty() || path.size() >= size) {
+            throw std::invalid_argument("Invalid flight recorder dump path: " + path);
+        }
+        copy_field(dest, size, path);
+    }
+}
+
+std::atomic<bool> FlightRecorder::enabled_{false};
+
+bool FlightRecorder::install(const FlightRecorderOptions& options) {
+    std::lock_guard<std::mutex> lock(install_mutex);
+    if (installed.load(std::memory_order_relaxed)) {
+        return false;
+    }
+
+    set_path(dump_path, sizeof(dump_path), options.dump_path);
+    set_path(crash_path, sizeof(crash_path), options.dump_path + ".crash");
+
+    capacity = 1;
+    while (capacity < std::max<size_t>(options.events_per_thread, 16)) {
+        capacity <<= 1;
+    }
+    mask = capacity - 1;
+    max_threads = std::max<size_t>(1, options.max_threads);
+    rings = new Ring[max_threads];
+    first_chunk = last_chunk = new ActorChunk();
+    chunk_count = 1;
+    calibrate();
+
+    if (options.dump_signal > 0) {
+        install_handler(options.dump_signal, on_dump_signal);
+    }
+    if (options.dump_on_crash) {
+        for (int signo : {SIGSEGV, SIGBUS, SIGFPE, SIGILL, SIGABRT}) {
+            install_handler(signo, on_crash_signal);
+        }
+    }
+
+    installed.store(true, std::memory_order_release);
+    enabled_.store(true, std::memory_order_relaxed);
+    return true;
+}
+
+void FlightRecorder::set_enabled(bool enabled) {
+    if (installed.load(std::memory_order_acquire)) {
+        enabled_.store(enabled, std::memory_order_relaxed);
+    }
+}
+
+uint64_t FlightRecorder::timestamp() {
+#ifdef ACTOR_FLIGHT_USE_TSC
+    return __rdtsc();
+#else
+    return static_cast<uint64_t>(monotonic_ns());
+#endif
+}
+
+void FlightRecorder::record_at(uint64_t timestamp, EventType type, uint64_t actor, uint64_t value, uint32_t aux) {
+    Ring* ring = thread_ring;
+    if (!ring && !(ring = attach_thread())) {
+        return;
+    }
+    uint64_t head = ring->head.load(std::memory_order_relaxed);
+    RawEvent& event = ring->events[head & mask];
+    event.ticks = timestamp;
+    event.actor = actor;
+    event.value = value;
+    event.aux = aux;
+    event.type = static_cast<uint16_t>(type);
+    // 事件内容写完后再发布序号，转储方读到的head之前的事件都是完整的
+    ring->head.store(head + 1, std::memory_order_release);
+}
+
+void FlightRecorder::note_actor(uint64_t serial, const std::string& name, const std::string& id) {
+    if (!installed.load(std::memory_order_acquire)) {
+        return;
+    }
+    std::lock_guard<std::mutex> lock(install_mutex);
+    uint32_t count = last_chunk->count.load(std::memory_order_relaxed);
+    if (count == kActorChunkSize) {
+        if (chunk_count == kMaxActorChunks) {
+            return;
+        }
+        auto* chunk = new ActorChunk();
+        last_chunk->next.store(chunk, std::memory_order_release);
+        last_chunk = chunk;
+        ++chunk_count;
+        count = 0;
+    }
+    ActorEntry& entry = last_chunk->entries[count];
+    entry.serial = serial;
+    copy_field(entry.name, sizeof(entry.name), name);
+    copy_field(entry.id, sizeof(entry.id), id);
+    last_chunk->count.store(count + 1, std::memory_order_release);
+}
+
+bool FlightRecorder::dump(const std::string& path) {
+    int fd = ::open(path.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    if (fd < 0) {
+        return false;
+    }
+    bool ok = dump_to_fd(fd, 0);
+    return ::close(fd) == 0 && ok;
+}
+
+bool FlightRecorder::dump_to_fd(int fd, int reason) {
+    if (!installed.load(std::memory_order_acquire)) {
+        return false;
+    }
+
+    // 名称表和缓冲区数量以此刻为准，之后追加的不写入
+    uint32_t rings_to_write = ring_count.load(std::memory_order_acquire);
+    uint64_t actor_count = 0;
+    uint32_t chunk_counts[kMaxActorChunks];
+    size_t chunks = 0;
+    for (ActorChunk* chunk = first_chunk; chunk && chunks < kMaxActorChunks;
+         chunk = chunk->next.load(std::memory_order_acquire)) {
+        chunk_counts[chunks] = chunk->count.load(std::memory_order_acquire);
+        actor_count += chunk_counts[chunks++];
+    }
+
+    DumpHeader header;
+    std::memset(&header, 0, sizeof(header));
+    std::memcpy(header.magic, kFlightMagic, sizeof(kFlightMagic));
+    header.version = kFlightVersion;
+    header.event_size = sizeof(RawEvent);
+    header.pid = static_cast<uint32_t>(::getpid());
+    header.reason = reason;
+    header.capacity = capacity;
+    header.ring_count = rings_to_write;
+    header.actor_count = actor_count;
+    header.install_ticks = install_ticks;
+    header.install_ns = install_ns;
+    header.dump_ticks = timestamp();
+    header.dump_ns = monotonic_ns();
+    header.calibrated_ticks_per_ns = calibrated_ticks_per_ns;
+    if (!write_all(fd, &header, sizeof(header))) {
+        return false;
+    }
+
+    size_t index = 0;
+    for (ActorChunk* chunk = first_chunk; index < chunks; chunk = chunk->next.load(std::memory_order_acquire)) {
+        if (!write_all(fd, chunk->entries, chunk_counts[index++] * sizeof(ActorEntry))) {
+            return false;
+        }
+    }
+
+    for (uint32_t i = 0; i < rings_to_write; ++i) {
+        Ring& ring = rings[i];
+        uint64_t head = ring.head.load(std::memory_order_acquire);
+        uint64_t base = std::min(ring.base.load(std::memory_order_relaxed), head);
+        uint64_t count = std::min(head - base, capacity);
+
+        RingHeader ring_header;
+        std::memset(&ring_header, 0, sizeof(ring_header));
+        ring_header.index = i;
+        ring_header.tid = ring.tid.load(std::memory_order_relaxed);
+        ring_header.first = head - count;
+        ring_header.count = count;
+        if (!write_all(fd, &ring_header, sizeof(ring_header))) {
+            return false;
+        }
+
+        // 环形缓冲区中的事件可能分成两段
+        uint64_t start = ring_header.first & mask;
+        uint64_t first_part = std::min(count, capacity - start);
+        if (!write_all(fd, ring.events + start, first_part * sizeof(RawEvent)) ||
+            !write_all(fd, ring.events, (count - first_part) * sizeof(RawEvent))) {
+            return false;
+        }
+
+        std::atomic_thread_fence(std::memory_order_acquire);
+        RingTrailer trailer{ring.head.load(std::memory_order_relaxed)};
+        if (!write_all(fd, &trailer, sizeof(trailer))) {
+            return false;
+        }
+    }
+    return true;
+}
+
+namespace {
+    template <typename T>
+    void read_exact(std::ifstream& in, T* data, size_t count, const std::string& path) {
+        if (count > 0 && !in.read(reinterpret_cast<char*>(data), static_cast<std::streamsize>(count * sizeof(T)))) {
+            throw std::runtime_error("Truncated flight recorder dump: " + path);
+        }
+    }
+}
+
+FlightDump read_flight_dump(const std::string& path) {
+    std::ifstream in(path, std::ios::binary);
+    if (!in) {
+        throw std::runtime_error("Cannot open flight recorder dump: " + path);
+    }
+
+    DumpHeader header;
+    read_exact(in, &header, 1, path);
+    if (std::memcmp(header.magic, kFlightMagic, sizeof(kFlightMagic)) != 0) {
+        throw std::runtime_error("Not a flight recorder dump: " + path);
+    }
+    if (header.version != kFlightVersion || header.event_size != sizeof(RawEvent)) {
+        throw std::runtime_error("Unsupported flight recorder dump version " + std::to_string(header.version));
+    }
+
+    FlightDump dump;
+    dump.pid = header.pid;
+    dump.reason = header.reason;
+    dump.capacity = header.capacity;
+
+    // 安装到转储的间隔足够长时用它重新换算，比安装时的短校准更精确
+    dump.ticks_per_ns = header.calibrated_ticks_per_ns > 0 ? header.calibrated_ticks_per_ns : 1.0;
+    if (header.dump_ns - header.install_ns > 100000000 && header.dump_ticks > header.install_ticks) {
+        dump.ticks_per_ns = static_cast<double>(header.dump_ticks - header.install_ticks) /
+                            static_cast<double>(header.dump_ns - header.install_ns);
+    }
+
+    std::vector<ActorEntry> entries(header.actor_count);
+    read_exact(in, entries.data(), entries.size(), path);
+    for (const auto& entry : entries) {
+        dump.actors.push_back({entry.serial, {std::string(entry.name, strnlen(entry.name, sizeof(entry.name))),
+                                              std::string(entry.id, strnlen(entry.id, sizeof(entry.id)))}});
+    }
+
+    std::vector<RawEvent> events;
+    for (uint64_t r = 0; r < header.ring_count; ++r) {
+        RingHeader ring;
+        read_exact(in, &ring, 1, path);
+        if (ring.count > header.capacity) {
+            throw std::runtime_error("Corrupt flight recorder dump: " + path);
+        }
+        events.resize(ring.count);
+        read_exact(in, events.data(), events.size(), path);
+        RingTrailer trailer;
+        read_exact(in, &trailer, 1, path);
+
+        uint64_t valid_from = trailer.head_after > header.capacity ? trailer.head_after - header.capacity : 0;
+        for (uint64_t i = 0; i < ring.count; ++i) {
+            if (ring.first + i < valid_from) {
+                ++dump.torn_events;
+                continue;
+            }
+            const RawEvent& raw = events[i];
+            FlightEvent event;
+            event.type = static_cast<FlightRecorder::EventType>(raw.type);
+            event.thread = ring.index;
+            event.tid = ring.tid;
+            event.ns_before_dump = static_cast<int64_t>(
+                static_cast<double>(static_cast<int64_t>(header.dump_ticks - raw.ticks)) / dump.ticks_per_ns);
+            event.actor = raw.actor;
+            event.value = event.type == FlightRecorder::EventType::HANDLED
+                              ? static_cast<uint64_t>(static_cast<double>(raw.value) / dump.ticks_per_ns)
+                              : raw.value;
+            event.aux = raw.aux;
+            dump.events.push_back(event);
+        }
+    }
+
+    std::stable_sort(dump.events.begin(), dump.events.end(), [](const FlightEvent& a, const FlightEvent& b) {
+        return a.ns_before_dump > b.ns_before_dump;
+    });
+    return dump;
+}
+
+const char* flight_event_name(FlightRecorder::EventType type) {
+    switch (type) {
+        case FlightRecorder::EventType::PICK: return "PICK";
+        case FlightRecorder::EventType::ENQUEUE: return "ENQUEUE";
+        case FlightRecorder::EventType::DEQUEUE: return "DEQUEUE";
+        case FlightRecorder::EventType::HANDLED: return "HANDLED";
+        case FlightRecorder::EventType::STATE: return "STATE";
+        case FlightRecorder::EventType::DROPPED: return "DROPPED";
+    }
+    return "UNKNOWN";
+}
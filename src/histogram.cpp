@@ -0,0 +1,155 @@
+#include "histogram.h"
+#include <algorithm>
+#include <cmath>
+#include <iomanip>
+#include <limits>
+
+LatencyHistogram::LatencyHistogram()
+    : total_count_(0)
+    , min_(std::numeric_limits<int64_t>::max())
+    , max_(0)
+    , sum_(0) {
+    for (auto& count : counts_) {
+        count.store(0, std::memory_order_relaxed);
+    }
+}
+
+size_t LatencyHistogram::index_of(int64_t value) {
+    if (value < kSubBucketCount) {
+        return static_cast<size_t>(value);
+    }
+    int msb = 63 - __builtin_clzll(static_cast<uint64_t>(value));
+    int shift = msb - kSubBucketBits + 1;
+    return static_cast<size_t>(shift * kHalfCount + (value >> shift));
+}
+
+int64_t LatencyHistogram::lowest_value_at(size_t index) {
+    int64_t i = static_cast<int64_t>(index);
+    if (i < kSubBucketCount) {
+        return i;
+    }
+    int64_t shift = i / kHalfCount - 1;
+    int64_t sub_bucket = i - shift * kHalfCount;
+    return sub_bucket << shift;
+}
+
+int64_t LatencyHistogram::highest_value_at(size_t index) {
+    int64_t i = static_cast<int64_t>(index);
+    int64_t shift = i < kSubBucketCount ? 0 : i / kHalfCount - 1;
+    return lowest_value_at(index) + (int64_t(1) << shift) - 1;
+}
+
+void LatencyHistogram::record(int64_t value, uint64_t count) {
+    value = std::max<int64_t>(0, value);
+    counts_[index_of(value)].fetch_add(count, std::memory_order_relaxed);
+    total_count_.fetch_add(count, std::memory_order_relaxed);
+    sum_.fetch_add(value * static_cast<int64_t>(count), std::memory_order_relaxed);
+
+    int64_t current = min_.load(std::memory_order_relaxed);
+    while (value < current && !min_.compare_exchange_weak(current, value, std::memory_order_relaxed)) {
+    }
+    current = max_.load(std::memory_order_relaxed);
+    while (value > current && !max_.compare_exchange_weak(current, value, std::memory_order_relaxed)) {
+    }
+}
+
+void LatencyHistogram::merge(const LatencyHistogram& other) {
+    for (size_t i = 0; i < kBucketCount; ++i) {
+        uint64_t count = other.counts_[i].load(std::memory_order_relaxed);
+        if (count > 0) {
+            counts_[i].fetch_add(count, std::memory_order_relaxed);
+        }
+    }
+    total_count_.fetch_add(other.total_count_.load(std::memory_order_relaxed), std::memory_order_relaxed);
+    sum_.fetch_add(other.sum_.load(std::memory_order_relaxed), std::memory_order_relaxed);
+
+    int64_t other_min = other.min_.load(std::memory_order_relaxed);
+    int64_t current = min_.load(std::memory_order_relaxed);
+    while (other_min < current && !min_.compare_exchange_weak(current, other_min, std::memory_order_relaxed)) {
+    }
+    int64_t other_max = other.max_.load(std::memory_order_relaxed);
+    current = max_.load(std::memory_order_relaxed);
+    while (other_max > current && !max_.compare_exchange_weak(current, other_max, std::memory_order_relaxed)) {
+    }
+}
+
+void LatencyHistogram::reset() {
+    for (auto& count : counts_) {
+        count.store(0, std::memory_order_relaxed);
+    }
+    total_count_.store(0, std::memory_order_relaxed);
+    sum_.store(0, std::memory_order_relaxed);
+    min_.store(std::numeric_limits<int64_t>::max(), std::memory_order_relaxed);
+    max_.store(0, std::memory_order_relaxed);
+}
+
+int64_t LatencyHistogram::min() const {
+    return count() == 0 ? 0 : min_.load(std::memory_order_relaxed);
+}
+
+int64_t LatencyHistogram::max() const {
+    return max_.load(std::memory_order_relaxed);
+}
+
+double LatencyHistogram::mean() const {
+    uint64_t total = count();
+    return total == 0 ? 0.0 : static_cast<double>(sum_.load(std::memory_order_relaxed)) / static_cast<double>(total);
+}
+
+int64_t LatencyHistogram::value_at_percentile(double percentile) const {
+    uint64_t total = count();
+    if (total == 0) {
+        return 0;
+    }
+
+    percentile = std::min(100.0, std::max(0.0, percentile));
+    auto target = static_cast<uint64_t>(std::ceil(percentile / 100.0 * static_cast<double>(total)));
+    target = std::max<uint64_t>(1, target);
+
+    uint64_t seen = 0;
+    for (size_t i = 0; i < kBucketCount; ++i) {
+        seen += counts_[i].load(std::memory_order_relaxed);
+        if (seen >= target) {
+            return std::min(highest_value_at(i), max());
+        }
+    }
+    return max();
+}
+
+void LatencyHistogram::write_percentile_distribution(std::ostream& out, double value_scale) const {
+    uint64_t total = count();
+    out << std::setw(12) << "Value" << " " << std::setw(14) << "Percentile" << " "
+        << std::setw(10) << "TotalCount" << " " << std::setw(14) << "1/(1-Percentile)" << "\n\n";
+
+    auto write_row = [&](double quantile) {
+        int64_t value = value_at_percentile(quantile * 100.0);
+        auto cumulative = static_cast<uint64_t>(std::ceil(quantile * static_cast<double>(total)));
+        out << std::fixed << std::setprecision(3) << std::setw(12) << static_cast<double>(value) / value_scale << " "
+            << std::setprecision(12) << std::setw(14) << quantile << " "
+            << std::setw(10) << std::max<uint64_t>(cumulative, total > 0 ? 1 : 0) << " ";
+        if (quantile < 1.0) {
+            out << std::setprecision(2) << std::setw(14) << 1.0 / (1.0 - quantile) << "\n";
+        } else {
+            out << std::setw(14) << "inf" << "\n";
+        }
+    };
+
+    if (total > 0) {
+        // 与HdrHistogram相同：剩余距离每减半一次，输出5个刻度，直到覆盖全部样本
+        const double ticks_per_half = 5.0;
+        double level = 0.0;
+        while (std::ceil(level / 100.0 * static_cast<double>(total)) < static_cast<double>(total)) {
+            write_row(level / 100.0);
+            double halvings = std::floor(std::log2(100.0 / (100.0 - level))) + 1.0;
+            level += 100.0 / ticks_per_half / std::pow(2.0, halvings);
+        }
+        write_row(1.0);
+    }
+
+    double mean_value = mean() / value_scale;
+    out << std::setprecision(3)
+        << "#[Mean    = " << std::setw(12) << mean_value
+        << ", Max            = " << std::setw(12) << static_cast<double>(max()) / value_scale << "]\n"
+        << "#[Total count    = " << std::setw(12) << total
+        << ", Buckets        = " << std::setw(12) << kBucketCount << "]\n";
+}
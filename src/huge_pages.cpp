@@ -0,0 +1,120 @@
+#include "huge_pages.h"
+#include <algorithm>
+#include <cstdint>
+#include <new>
+#include <sys/mman.h>
+
+namespace {
+    size_t round_up(size_t value, size_t unit) {
+        return (value + unit - 1) / unit * unit;
+    }
+
+    void* map_anonymous(size_t size, int extra_flags) {
+        void* base = ::mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | extra_flags, -1, 0);
+        return base == MAP_FAILED ? nullptr : base;
+    }
+
+    // 池和它的上游一起销毁：先析构池（把块还给上游），再解除上游的映射
+    struct HugePagePool : std::pmr::synchronized_pool_resource {
+        explicit HugePagePool(std::unique_ptr<HugePageArena> arena)
+            : std::pmr::synchronized_pool_resource(arena.get()), arena_(std::move(arena)) {}
+
+        ~HugePagePool() override { release(); }
+
+        std::unique_ptr<HugePageArena> arena_;
+    };
+}
+
+HugePageArena::HugePageArena(HugePageMode mode, size_t region_bytes)
+    : mode_(mode), region_bytes_(round_up(std::max<size_t>(region_bytes, 1), kHugePageBytes)) {
+}
+
+HugePageArena::~HugePageArena() {
+    for (const auto& region : regions_) {
+        ::munmap(region.base, region.size);
+    }
+}
+
+size_t HugePageArena::mapped_bytes() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    size_t total = 0;
+    for (const auto& region : regions_) {
+        total += region.size;
+    }
+    return total;
+}
+
+size_t HugePageArena::huge_bytes() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return huge_bytes_;
+}
+
+HugePageArena::Region HugePageArena::map_region(size_t size) {
+    size = round_up(size, kHugePageBytes);
+#ifdef MAP_HUGETLB
+    if (mode_ == HugePageMode::EXPLICIT) {
+        if (void* base = map_anonymous(size, MAP_HUGETLB)) {
+            huge_bytes_ += size;
+            return Region{static_cast<char*>(base), size};
+        }
+    }
+#endif
+
+    if (mode_ == HugePageMode::OFF) {
+        void* base = map_anonymous(size, 0);
+        if (!base) {
+            throw std::bad_alloc();
+        }
+        return Region{static_cast<char*>(base), size};
+    }
+
+    // 多映射一个大页再裁掉首尾，得到2 MB对齐的区域，透明大页才能覆盖整个区域
+    void* raw = map_anonymous(size + kHugePageBytes, 0);
+    if (!raw) {
+        throw std::bad_alloc();
+    }
+    auto address = reinterpret_cast<uintptr_t>(raw);
+    uintptr_t aligned = round_up(address, kHugePageBytes);
+    if (aligned > address) {
+        ::munmap(raw, aligned - address);
+    }
+    size_t tail = kHugePageBytes - (aligned - address);
+    if (tail > 0) {
+        ::munmap(reinterpret_cast<char*>(aligned + size), tail);
+    }
+    auto* base = reinterpret_cast<char*>(aligned);
+#ifdef MADV_HUGEPAGE
+    if (::madvise(base, size, MADV_HUGEPAGE) == 0) {
+        huge_bytes_ += size;
+    }
+#endif
+    return Region{base, size};
+}
+
+void* HugePageArena::do_allocate(size_t bytes, size_t alignment) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (next_) {
+        auto address = reinterpret_cast<uintptr_t>(next_);
+        size_t padding = round_up(address, alignment) - address;
+        if (padding <= static_cast<size_t>(end_ - next_) && bytes <= static_cast<size_t>(end_ - next_) - padding) {
+            char* result = next_ + padding;
+            next_ = result + bytes;
+            return result;
+        }
+    }
+
+    Region region = map_region(std::max(region_bytes_, bytes + alignment));
+    regions_.push_back(region);
+    auto address = reinterpret_cast<uintptr_t>(region.base);
+    char* result = region.base + (round_up(address, alignment) - address);
+    // 单独映射的大区域剩余空间比当前区域少时，继续使用当前区域
+    if (static_cast<size_t>(region.base + region.size - (result + bytes)) >= static_cast<size_t>(end_ - next_)) {
+        next_ = result + bytes;
+        end_ = region.base + region.size;
+    }
+    return result;
+}
+
+std::shared_ptr<std::pmr::memory_resource> make_huge_page_pool(HugePageMode mode, size_t region_bytes) {
+    return std::make_shared<HugePagePool>(std::make_unique<HugePageArena>(mode, region_bytes));
+}
@@ -0,0 +1,174 @@
+#include "introspection.h"
+#include "event_loop.h"
+#include <cstdlib>
+#include <sstream>
+#include <stdexcept>
+
+namespace {
+    // 名称中的制表符、换行和反斜杠需要转义，保证一行一个Actor
+    std::string escape(const std::string& value) {
+        std::string result;
+        for (char c : value) {
+            switch (c) {
+                case '\\': result += "\\\\"; break;
+                case '\t': result += "\\t"; break;
+                case '\n': result += "\\n"; break;
+                case '\r': result += "\\r"; break;
+                default: result += c;
+            }
+        }
+        return result;
+    }
+
+    std::string unescape(const std::string& value) {
+        std::string result;
+        for (size_t i = 0; i < value.size(); ++i) {
+            if (value[i] != '\\' || i + 1 == value.size()) {
+                result += value[i];
+                continue;
+            }
+            switch (value[++i]) {
+                case 't': result += '\t'; break;
+                case 'n': result += '\n'; break;
+                case 'r': result += '\r'; break;
+                default: result += value[i];
+            }
+        }
+        return result;
+    }
+
+    std::vector<std::string> split(const std::string& line, char separator) {
+        std::vector<std::string> fields;
+        size_t start = 0;
+        for (;;) {
+            size_t end = line.find(separator, start);
+            fields.push_back(line.substr(start, end - start));
+            if (end == std::string::npos) {
+                return fields;
+            }
+            start = end + 1;
+        }
+    }
+
+    int64_t to_int(const std::string& text) {
+        char* end = nullptr;
+        long long value = std::strtoll(text.c_str(), &end, 10);
+        if (text.empty() || *end != '\0') {
+            throw std::runtime_error("Invalid number in actor snapshot: " + text);
+        }
+        return value;
+    }
+
+    const char* const kHeader = "actor_cpp snapshot v1";
+}
+
+const char* actor_state_name(Actor::State state) {
+    switch (state) {
+        case Actor::State::CREATED: return "CREATED";
+        case Actor::State::INITIALIZED: return "INITIALIZED";
+        case Actor::State::RUNNING: return "RUNNING";
+        case Actor::State::STOPPING: return "STOPPING";
+        case Actor::State::STOPPED: return "STOPPED";
+    }
+    return "UNKNOWN";
+}
+
+const char* snapshot_order_name(SnapshotOrder order) {
+    switch (order) {
+        case SnapshotOrder::BACKLOG: return "backlog";
+        case SnapshotOrder::HANDLER_TIME: return "busy";
+        case SnapshotOrder::PROCESSED: return "processed";
+    }
+    return "backlog";
+}
+
+bool parse_snapshot_order(const std::string& name, SnapshotOrder& order) {
+    for (SnapshotOrder candidate : {SnapshotOrder::BACKLOG, SnapshotOrder::HANDLER_TIME, SnapshotOrder::PROCESSED}) {
+        if (name == snapshot_order_name(candidate)) {
+            order = candidate;
+            return true;
+        }
+    }
+    return false;
+}
+
+std::string format_snapshot(const SystemSnapshot& snapshot) {
+    std::ostringstream out;
+    out << kHeader << "\n"
+        << snapshot.taken_ns << "\t" << snapshot.scan_ns << "\t" << snapshot.actor_count << "\t"
+        << snapshot.total_backlog << "\t" << snapshot.in_flight << "\n";
+    for (const auto& actor : snapshot.actors) {
+        const ActorStats& stats = actor.stats;
+        out << actor.serial << "\t" << static_cast<int>(actor.state) << "\t" << stats.mailbox_depth << "\t"
+            << stats.top_priority << "\t" << stats.processed << "\t" << stats.handler_ns_total << "\t"
+            << stats.handler_ns_max << "\t" << stats.last_run_ns << "\t" << escape(actor.id) << "\t"
+            << escape(actor.name) << "\n";
+    }
+    return out.str();
+}
+
+SystemSnapshot parse_snapshot(const std::string& text) {
+    std::istringstream in(text);
+    std::string line;
+    if (!std::getline(in, line) || line != kHeader) {
+        throw std::runtime_error("Not an actor snapshot");
+    }
+    if (!std::getline(in, line)) {
+        throw std::runtime_error("Truncated actor snapshot");
+    }
+    auto summary = split(line, '\t');
+    if (summary.size() != 5) {
+        throw std::runtime_error("Invalid actor snapshot summary: " + line);
+    }
+
+    SystemSnapshot snapshot;
+    snapshot.taken_ns = to_int(summary[0]);
+    snapshot.scan_ns = to_int(summary[1]);
+    snapshot.actor_count = static_cast<uint64_t>(to_int(summary[2]));
+    snapshot.total_backlog = static_cast<uint64_t>(to_int(summary[3]));
+    snapshot.in_flight = static_cast<uint64_t>(to_int(summary[4]));
+
+    while (std::getline(in, line)) {
+        if (line.empty()) {
+            continue;
+        }
+        auto fields = split(line, '\t');
+        if (fields.size() != 10) {
+            throw std::runtime_error("Invalid actor snapshot line: " + line);
+        }
+        int64_t state = to_int(fields[1]);
+        if (state < 0 || state > static_cast<int64_t>(Actor::State::STOPPED)) {
+            throw std::runtime_error("Invalid actor state in snapshot: " + fields[1]);
+        }
+
+        ActorSnapshot actor;
+        actor.serial = static_cast<uint64_t>(to_int(fields[0]));
+        actor.state = static_cast<Actor::State>(state);
+        actor.stats.mailbox_depth = static_cast<uint64_t>(to_int(fields[2]));
+        actor.stats.top_priority = static_cast<int>(to_int(fields[3]));
+        actor.stats.processed = static_cast<uint64_t>(to_int(fields[4]));
+        actor.stats.handler_ns_total = static_cast<uint64_t>(to_int(fields[5]));
+        actor.stats.handler_ns_max = static_cast<uint64_t>(to_int(fields[6]));
+        actor.stats.last_run_ns = to_int(fields[7]);
+        actor.id = unescape(fields[8]);
+        actor.name = unescape(fields[9]);
+        snapshot.actors.push_back(std::move(actor));
+    }
+    return snapshot;
+}
+
+std::string handle_snapshot_request(EventLoop& event_loop, const std::string& query) {
+    size_t top = 20;
+    SnapshotOrder order = SnapshotOrder::BACKLOG;
+    for (const auto& parameter : split(query, '&')) {
+        size_t equals = parameter.find('=');
+        std::string key = parameter.substr(0, equals);
+        std::string value = equals == std::string::npos ? "" : parameter.substr(equals + 1);
+        if (key == "top") {
+            top = static_cast<size_t>(std::strtoull(value.c_str(), nullptr, 10));
+        } else if (key == "sort") {
+            parse_snapshot_order(value, order);
+        }
+    }
+    return format_snapshot(event_loop.snapshot(top, order));
+}
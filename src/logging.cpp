@@ -0,0 +1,14 @@
+#include "logging.h"
+#include <atomic>
+
+namespace {
+    std::atomic<LogLevel> current_level{LogLevel::INFO};
+}
+
+void set_log_level(LogLevel level) {
+    current_level.store(level, std::memory_order_relaxed);
+}
+
+LogLevel get_log_level() {
+    return current_level.load(std::memory_order_relaxed);
+}
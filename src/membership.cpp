@@ -0,0 +1,788 @@
+#include "membership.h"
+#include "event_loop.h"
+#include "logging.h"
+#include "message.h"
+#include <algorithm>
+#include <arpa/inet.h>
+#include <cerrno>
+#include <cmath>
+#include <cstring>
+#include <iostream>
+#include <netinet/in.h>
+#include <poll.h>
+#include <stdexcept>
+#include <sys/socket.h>
+#include <unistd.h>
+
+namespace {
+    constexpr uint8_t kMagic = 0xA7;
+
+    // phi检测至少需要的心跳间隔样本数，样本太少时均值和方差不可靠
+    constexpr size_t kMinPhiSamples = 8;
+
+    // 包类型
+    enum PacketType : uint8_t {
+        PING = 1,
+        PING_REQ = 2,
+        ACK = 3,
+        SYNC = 4,        // 推送本节点的完整成员列表，并请求对方的列表
+        SYNC_REPLY = 5,  // 对SYNC的回复
+        GOSSIP = 6       // 只携带成员变化（离开时使用）
+    };
+
+    using SteadyClock = std::chrono::steady_clock;
+
+    double to_ms(SteadyClock::duration duration) {
+        return std::chrono::duration<double, std::milli>(duration).count();
+    }
+
+    std::string address_key(uint32_t ip, uint16_t port) {
+        char buffer[INET_ADDRSTRLEN];
+        in_addr addr{};
+        addr.s_addr = ip;
+        ::inet_ntop(AF_INET, &addr, buffer, sizeof(buffer));
+        return std::string(buffer) + ":" + std::to_string(port);
+    }
+
+    bool parse_address(const std::string& text, uint32_t& ip, uint16_t& port) {
+        size_t colon = text.rfind(':');
+        if (colon == std::string::npos) {
+            return false;
+        }
+        in_addr addr{};
+        if (::inet_pton(AF_INET, text.substr(0, colon).c_str(), &addr) != 1) {
+            return false;
+        }
+        long value = std::strtol(text.c_str() + colon + 1, nullptr, 10);
+        if (value <= 0 || value > 65535) {
+            return false;
+        }
+        ip = addr.s_addr;
+        port = static_cast<uint16_t>(value);
+        return true;
+    }
+
+    // 编码：地址为4字节IP（网络字节序）+ 2字节端口（大端），整数为LEB128变长编码，
+    // 字符串为1字节长度 + 内容
+    void put_u8(std::string& out, uint8_t value) {
+        out.push_back(static_cast<char>(value));
+    }
+
+    void put_varint(std::string& out, uint64_t value) {
+        while (value >= 0x80) {
+            put_u8(out, static_cast<uint8_t>(value | 0x80));
+            value >>= 7;
+        }
+        put_u8(out, static_cast<uint8_t>(value));
+    }
+
+    void put_address(std::string& out, uint32_t ip, uint16_t port) {
+        out.append(reinterpret_cast<const char*>(&ip), 4);
+        put_u8(out, static_cast<uint8_t>(port >> 8));
+        put_u8(out, static_cast<uint8_t>(port & 0xFF));
+    }
+
+    void put_string(std::string& out, const std::string& value) {
+        size_t length = std::min<size_t>(value.size(), 255);
+        put_u8(out, static_cast<uint8_t>(length));
+        out.append(value, 0, length);
+    }
+
+    struct Reader {
+        const uint8_t* data;
+        const uint8_t* end;
+        bool ok = true;
+
+        uint8_t u8() {
+            if (data >= end) {
+                ok = false;
+                return 0;
+            }
+            return *data++;
+        }
+
+        uint64_t varint() {
+            uint64_t value = 0;
+            for (int shift = 0; shift < 64; shift += 7) {
+                uint8_t byte = u8();
+                value |= static_cast<uint64_t>(byte & 0x7F) << shift;
+                if ((byte & 0x80) == 0) {
+                    return value;
+                }
+            }
+            ok = false;
+            return 0;
+        }
+
+        void address(uint32_t& ip, uint16_t& port) {
+            if (end - data < 6) {
+                ok = false;
+                return;
+            }
+            std::memcpy(&ip, data, 4);
+            port = static_cast<uint16_t>((data[4] << 8) | data[5]);
+            data += 6;
+        }
+
+        std::string string() {
+            size_t length = u8();
+            if (static_cast<size_t>(end - data) < length) {
+                ok = false;
+                return {};
+            }
+            std::string value(reinterpret_cast<const char*>(data), length);
+            data += length;
+            return value;
+        }
+    };
+
+    // 名称与地址相同时省略
+    void put_member(std::string& out, const Member& member, uint32_t ip, uint16_t port) {
+        put_address(out, ip, port);
+        put_u8(out, static_cast<uint8_t>(member.status));
+        put_varint(out, member.incarnation);
+        put_string(out, member.name == member.address ? std::string() : member.name);
+    }
+
+    std::string packet_header(uint8_t type, uint32_t sequence, uint64_t incarnation, const std::string& name,
+                              const std::string& address) {
+        std::string packet;
+        put_u8(packet, kMagic);
+        put_u8(packet, type);
+        put_varint(packet, sequence);
+        put_varint(packet, incarnation);
+        put_string(packet, name == address ? std::string() : name);
+        return packet;
+    }
+
+    const char* event_type(MemberStatus status) {
+        switch (status) {
+            case MemberStatus::ALIVE: return Membership::kMemberUp;
+            case MemberStatus::SUSPECT: return Membership::kMemberSuspect;
+            case MemberStatus::DEAD: return Membership::kMemberDown;
+            case MemberStatus::LEFT: return Membership::kMemberLeft;
+        }
+        return Membership::kMemberUp;
+    }
+
+    bool is_gone(MemberStatus status) {
+        return status == MemberStatus::DEAD || status == MemberStatus::LEFT;
+    }
+}
+
+const char* member_status_name(MemberStatus status) {
+    switch (status) {
+        case MemberStatus::ALIVE: return "alive";
+        case MemberStatus::SUSPECT: return "suspect";
+        case MemberStatus::DEAD: return "dead";
+        case MemberStatus::LEFT: return "left";
+    }
+    return "unknown";
+}
+
+PhiAccrualDetector::PhiAccrualDetector(size_t window, std::chrono::milliseconds min_stddev,
+                                       std::chrono::milliseconds acceptable_pause)
+    : window_(std::max<size_t>(1, window)),
+      min_stddev_ms_(static_cast<double>(min_stddev.count())),
+      acceptable_pause_ms_(static_cast<double>(acceptable_pause.count())) {
+}
+
+void PhiAccrualDetector::heartbeat(std::chrono::steady_clock::time_point now) {
+    if (has_last_) {
+        double interval = to_ms(now - last_);
+        intervals_.push_back(interval);
+        sum_ += interval;
+        sum_squares_ += interval * interval;
+        if (intervals_.size() > window_) {
+            double oldest = intervals_.front();
+            intervals_.pop_front();
+            sum_ -= oldest;
+            sum_squares_ -= oldest * oldest;
+        }
+    }
+    last_ = now;
+    has_last_ = true;
+}
+
+double PhiAccrualDetector::phi(std::chrono::steady_clock::time_point now) const {
+    if (!has_last_ || intervals_.empty()) {
+        return 0.0;
+    }
+    double count = static_cast<double>(intervals_.size());
+    double mean = sum_ / count;
+    double variance = std::max(0.0, sum_squares_ / count - mean * mean);
+    double stddev = std::max(std::sqrt(variance), min_stddev_ms_);
+    double elapsed = std::max(0.0, to_ms(now - last_) - acceptable_pause_ms_);
+
+    // 正态分布尾概率的logistic近似（误差小于1e-4）
+    double y = (elapsed - mean) / stddev;
+    double e = std::exp(-y * (1.5976 + 0.070566 * y * y));
+    double probability = elapsed > mean ? e / (1.0 + e) : 1.0 - 1.0 / (1.0 + e);
+    return probability > 1e-300 ? -std::log10(probability) : 300.0;
+}
+
+Membership::Membership(MembershipOptions options)
+    : options_(std::move(options)), ip_(0), port_(0), fd_(-1), random_(std::random_device{}()), running_(false) {
+    in_addr addr{};
+    if (::inet_pton(AF_INET, options_.bind_address.c_str(), &addr) != 1 || addr.s_addr == htonl(INADDR_ANY)) {
+        throw std::runtime_error("Invalid membership bind address: " + options_.bind_address);
+    }
+
+    fd_ = ::socket(AF_INET, SOCK_DGRAM, 0);
+    if (fd_ < 0) {
+        throw std::runtime_error(std::string("Cannot create membership socket: ") + std::strerror(errno));
+    }
+    sockaddr_in bind_addr{};
+    bind_addr.sin_family = AF_INET;
+    bind_addr.sin_addr = addr;
+    bind_addr.sin_port = htons(options_.port);
+    if (::bind(fd_, reinterpret_cast<sockaddr*>(&bind_addr), sizeof(bind_addr)) < 0) {
+        std::string error = std::strerror(errno);
+        ::close(fd_);
+        throw std::runtime_error("Cannot bind membership socket to " + options_.bind_address + ":" +
+                                 std::to_string(options_.port) + ": " + error);
+    }
+    socklen_t length = sizeof(bind_addr);
+    ::getsockname(fd_, reinterpret_cast<sockaddr*>(&bind_addr), &length);
+
+    ip_ = addr.s_addr;
+    port_ = ntohs(bind_addr.sin_port);
+    address_ = address_key(ip_, port_);
+    name_ = options_.name.empty() ? address_ : options_.name;
+    next_sync_ = SteadyClock::now();
+
+    running_ = true;
+    thread_ = std::thread(&Membership::run, this);
+}
+
+Membership::~Membership() {
+    stop();
+}
+
+void Membership::stop() {
+    if (!running_.exchange(false)) {
+        return;
+    }
+    if (thread_.joinable()) {
+        thread_.join();
+    }
+    ::close(fd_);
+    fd_ = -1;
+}
+
+void Membership::leave() {
+    if (!running_) {
+        return;
+    }
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        ++incarnation_;
+        Member self{name_, address_, MemberStatus::LEFT, incarnation_, 0.0};
+        std::string packet = packet_header(GOSSIP, 0, incarnation_, name_, address_);
+        put_u8(packet, 1);
+        put_member(packet, self, ip_, port_);
+        for (const auto& [_, state] : members_) {
+            if (!is_gone(state.info.status)) {
+                send_raw(packet, state.ip, state.port);
+            }
+        }
+    }
+    stop();
+}
+
+std::vector<Member> Membership::members() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto now = SteadyClock::now();
+    std::vector<Member> result;
+    result.push_back(Member{name_, address_, MemberStatus::ALIVE, incarnation_, 0.0});
+    for (const auto& [_, state] : members_) {
+        Member member = state.info;
+        member.phi = is_gone(member.status) ? 0.0 : state.detector.phi(now);
+        result.push_back(member);
+    }
+    std::sort(result.begin(), result.end(),
+              [](const Member& a, const Member& b) { return a.address < b.address; });
+    return result;
+}
+
+size_t Membership::alive_count() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    size_t count = 1;
+    for (const auto& [_, state] : members_) {
+        if (state.info.status == MemberStatus::ALIVE) {
+            ++count;
+        }
+    }
+    return count;
+}
+
+void Membership::subscribe(std::weak_ptr<EventLoop> event_loop, const std::string& actor_id) {
+    // 先持有订阅锁再读取成员：读取之后发生的变化一定会投递给这个订阅者，
+    // 初始状态也排在这些变化之前
+    std::lock_guard<std::mutex> lock(subscribers_mutex_);
+    std::vector<Member> current;
+    for (const auto& member : members()) {
+        if (member.status == MemberStatus::ALIVE) {
+            current.push_back(member);
+        }
+    }
+
+    subscribers_.emplace_back(event_loop, actor_id);
+    if (auto loop = event_loop.lock()) {
+        for (const auto& member : current) {
+            Message::Payload payload;
+            payload["node"] = member.name;
+            payload["address"] = member.address;
+            payload["incarnation"] = member.incarnation;
+            payload["status"] = std::string(member_status_name(member.status));
+            loop->deliver_message(Message(kMemberUp, "membership", actor_id, payload));
+        }
+    }
+}
+
+void Membership::unsubscribe(const std::string& actor_id) {
+    std::lock_guard<std::mutex> lock(subscribers_mutex_);
+    subscribers_.erase(std::remove_if(subscribers_.begin(), subscribers_.end(),
+                                      [&actor_id](const auto& subscriber) { return subscriber.second == actor_id; }),
+                       subscribers_.end());
+}
+
+void Membership::deliver(const std::vector<Event>& events) {
+    if (events.empty()) {
+        return;
+    }
+    if (log_enabled(LogLevel::INFO)) {
+        for (const auto& event : events) {
+            std::cout << "Membership " << name_ << ": " << event.member.name << " (" << event.member.address
+                      << ") is " << member_status_name(event.member.status) << std::endl;
+        }
+    }
+
+    std::lock_guard<std::mutex> lock(subscribers_mutex_);
+    for (auto it = subscribers_.begin(); it != subscribers_.end();) {
+        auto loop = it->first.lock();
+        if (!loop) {
+            it = subscribers_.erase(it);
+            continue;
+        }
+        for (const auto& event : events) {
+            Message::Payload payload;
+            payload["node"] = event.member.name;
+            payload["address"] = event.member.address;
+            payload["incarnation"] = event.member.incarnation;
+            payload["status"] = std::string(member_status_name(event.member.status));
+            loop->deliver_message(Message(event.type, "membership", it->second, payload));
+        }
+        ++it;
+    }
+}
+
+void Membership::run() {
+    std::vector<uint8_t> buffer(65536);
+    auto next_tick = SteadyClock::now();
+
+    while (running_) {
+        std::vector<Event> events;
+        auto now = SteadyClock::now();
+        auto wake_at = now + std::chrono::milliseconds(20);
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            if (now >= next_tick) {
+                tick(now, events);
+                next_tick = now + options_.protocol_period;
+            }
+
+            // 直接探测超时：请其他成员代为探测
+            if (probing_ && !probe_.acked && !probe_.indirect_sent) {
+                auto deadline = probe_.sent_at + options_.ack_timeout;
+                if (now >= deadline) {
+                    auto it = members_.find(probe_.target);
+                    if (it != members_.end()) {
+                        for (const auto& helper : pick_random(options_.indirect_probes, probe_.target)) {
+                            const MemberState& state = members_.at(helper);
+                            send_packet(PING_REQ, probe_.sequence, state.ip, state.port, it->second.ip,
+                                        it->second.port);
+                        }
+                    }
+                    probe_.indirect_sent = true;
+                } else {
+                    wake_at = std::min(wake_at, deadline);
+                }
+            }
+            wake_at = std::min(wake_at, next_tick);
+        }
+        deliver(events);
+        events.clear();
+
+        int timeout_ms = static_cast<int>(std::max<int64_t>(
+            0, std::chrono::duration_cast<std::chrono::milliseconds>(wake_at - SteadyClock::now()).count()));
+        pollfd pfd{fd_, POLLIN, 0};
+        if (::poll(&pfd, 1, timeout_ms) <= 0) {
+            continue;
+        }
+
+        for (;;) {
+            sockaddr_in from{};
+            socklen_t from_length = sizeof(from);
+            ssize_t n = ::recvfrom(fd_, buffer.data(), buffer.size(), MSG_DONTWAIT,
+                                   reinterpret_cast<sockaddr*>(&from), &from_length);
+            if (n < 0 && errno == EINTR) {
+                continue;
+            }
+            if (n <= 0) {
+                break;
+            }
+            ++packets_received_;
+            std::lock_guard<std::mutex> lock(mutex_);
+            handle_packet(buffer.data(), static_cast<size_t>(n), from.sin_addr.s_addr, ntohs(from.sin_port),
+                          SteadyClock::now(), events);
+        }
+        deliver(events);
+    }
+}
+
+void Membership::tick(std::chrono::steady_clock::time_point now, std::vector<Event>& events) {
+    // 上一个周期的探测（直接和间接）都没有收到ACK
+    if (probing_ && !probe_.acked) {
+        auto it = members_.find(probe_.target);
+        if (it != members_.end() && it->second.info.status == MemberStatus::ALIVE) {
+            set_status(it->second, MemberStatus::SUSPECT, it->second.info.incarnation, now, events);
+        }
+    }
+    probing_ = false;
+
+    auto suspicion = suspicion_timeout();
+    for (auto it = members_.begin(); it != members_.end();) {
+        MemberState& state = it->second;
+        if (state.info.status == MemberStatus::ALIVE && state.detector.samples() >= kMinPhiSamples &&
+            state.detector.phi(now) > options_.phi_threshold) {
+            set_status(state, MemberStatus::SUSPECT, state.info.incarnation, now, events);
+        } else if (state.info.status == MemberStatus::SUSPECT && now - state.changed_at > suspicion) {
+            set_status(state, MemberStatus::DEAD, state.info.incarnation, now, events);
+        } else if (is_gone(state.info.status) && now - state.changed_at > options_.dead_retention) {
+            updates_.erase(it->first);
+            it = members_.erase(it);
+            continue;
+        }
+        ++it;
+    }
+    for (auto it = relays_.begin(); it != relays_.end();) {
+        it = it->second.expires_at < now ? relays_.erase(it) : std::next(it);
+    }
+
+    // 按随机轮转顺序选择下一个探测目标：每一轮每个成员恰好被探测一次
+    for (int round = 0; round < 2 && !probing_; ++round) {
+        if (probe_index_ >= probe_order_.size()) {
+            probe_order_.clear();
+            for (const auto& [address, state] : members_) {
+                if (!is_gone(state.info.status)) {
+                    probe_order_.push_back(address);
+                }
+            }
+            std::shuffle(probe_order_.begin(), probe_order_.end(), random_);
+            probe_index_ = 0;
+        }
+        while (probe_index_ < probe_order_.size()) {
+            auto it = members_.find(probe_order_[probe_index_++]);
+            if (it == members_.end() || is_gone(it->second.info.status)) {
+                continue;
+            }
+            probe_ = Probe{it->first, next_sequence_++, now, false, false};
+            probing_ = true;
+            send_packet(PING, probe_.sequence, it->second.ip, it->second.port);
+            break;
+        }
+    }
+
+    // 还没有加入集群时每个周期联系种子，之后定期与随机成员交换完整列表
+    if (now >= next_sync_) {
+        auto peers = pick_random(1, std::string());
+        if (peers.empty()) {
+            for (const auto& seed : options_.seeds) {
+                uint32_t ip;
+                uint16_t port;
+                if (parse_address(seed, ip, port) && !(ip == ip_ && port == port_)) {
+                    send_sync(SYNC, ip, port);
+                }
+            }
+            next_sync_ = now + options_.protocol_period;
+        } else {
+            const MemberState& state = members_.at(peers.front());
+            send_sync(SYNC, state.ip, state.port);
+            next_sync_ = now + options_.sync_interval;
+        }
+    }
+}
+
+void Membership::handle_packet(const uint8_t* data, size_t size, uint32_t ip, uint16_t port,
+                               std::chrono::steady_clock::time_point now, std::vector<Event>& events) {
+    Reader reader{data, data + size};
+    if (reader.u8() != kMagic) {
+        return;
+    }
+    uint8_t type = reader.u8();
+    uint32_t sequence = static_cast<uint32_t>(reader.varint());
+    uint64_t sender_incarnation = reader.varint();
+    std::string sender_name = reader.string();
+    uint32_t target_ip = 0;
+    uint16_t target_port = 0;
+    if (type == PING_REQ) {
+        reader.address(target_ip, target_port);
+    }
+
+    struct Received {
+        Member member;
+        uint32_t ip;
+        uint16_t port;
+    };
+    std::vector<Received> received;
+    size_t count = reader.u8();
+    for (size_t i = 0; i < count && reader.ok; ++i) {
+        Received update;
+        reader.address(update.ip, update.port);
+        update.member.status = static_cast<MemberStatus>(std::min<uint8_t>(reader.u8(), 3));
+        update.member.incarnation = reader.varint();
+        update.member.name = reader.string();
+        update.member.address = address_key(update.ip, update.port);
+        if (update.member.name.empty()) {
+            update.member.name = update.member.address;
+        }
+        received.push_back(std::move(update));
+    }
+    if (!reader.ok) {
+        return;
+    }
+
+    // 发送者本身是活着的直接证据
+    std::string sender = address_key(ip, port);
+    if (sender != address_) {
+        Member member{sender_name.empty() ? sender : sender_name, sender, MemberStatus::ALIVE, sender_incarnation, 0.0};
+        apply_update(member, ip, port, now, events);
+        auto it = members_.find(sender);
+        if (it != members_.end() && !is_gone(it->second.info.status) &&
+            now - it->second.last_heard >= options_.protocol_period / 2) {
+            it->second.detector.heartbeat(now);
+            it->second.last_heard = now;
+        }
+    }
+    for (const auto& update : received) {
+        apply_update(update.member, update.ip, update.port, now, events);
+    }
+
+    switch (type) {
+        case PING:
+            send_packet(ACK, sequence, ip, port);
+            break;
+        case PING_REQ: {
+            uint32_t relayed = next_sequence_++;
+            relays_[relayed] = Relay{ip, port, sequence, now + options_.protocol_period};
+            send_packet(PING, relayed, target_ip, target_port);
+            break;
+        }
+        case ACK: {
+            if (probing_ && sequence == probe_.sequence) {
+                probe_.acked = true;
+                break;
+            }
+            auto it = relays_.find(sequence);
+            if (it != relays_.end()) {
+                send_packet(ACK, it->second.requester_sequence, it->second.requester_ip, it->second.requester_port);
+                relays_.erase(it);
+            }
+            break;
+        }
+        case SYNC:
+            send_sync(SYNC_REPLY, ip, port);
+            break;
+        default:
+            break;
+    }
+}
+
+void Membership::send_raw(const std::string& packet, uint32_t ip, uint16_t port) {
+    sockaddr_in to{};
+    to.sin_family = AF_INET;
+    to.sin_addr.s_addr = ip;
+    to.sin_port = htons(port);
+    ssize_t n = ::sendto(fd_, packet.data(), packet.size(), 0, reinterpret_cast<sockaddr*>(&to), sizeof(to));
+    if (n > 0) {
+        ++packets_sent_;
+        bytes_sent_ += static_cast<uint64_t>(n);
+    }
+}
+
+void Membership::send_packet(uint8_t type, uint32_t sequence, uint32_t ip, uint16_t port, uint32_t target_ip,
+                             uint16_t target_port) {
+    std::string packet = packet_header(type, sequence, incarnation_, name_, address_);
+    if (type == PING_REQ) {
+        put_address(packet, target_ip, target_port);
+    }
+
+    // 附带发送次数最少的成员变化，直到包满；发送够次数的变化不再传播
+    size_t count_offset = packet.size();
+    put_u8(packet, 0);
+    if (!updates_.empty()) {
+        std::vector<Update*> pending;
+        for (auto& [_, update] : updates_) {
+            pending.push_back(&update);
+        }
+        std::sort(pending.begin(), pending.end(),
+                  [](const Update* a, const Update* b) { return a->transmits < b->transmits; });
+
+        size_t limit = options_.retransmit_multiplier *
+                       static_cast<size_t>(std::ceil(std::log10(static_cast<double>(live_members()) + 1.0)));
+        uint8_t count = 0;
+        std::string encoded;
+        for (Update* update : pending) {
+            encoded.clear();
+            put_member(encoded, update->member, update->ip, update->port);
+            if (packet.size() + encoded.size() > options_.max_packet_bytes || count == 255) {
+                break;
+            }
+            packet += encoded;
+            ++count;
+            ++update->transmits;
+        }
+        packet[count_offset] = static_cast<char>(count);
+        for (auto it = updates_.begin(); it != updates_.end();) {
+            it = it->second.transmits >= std::max<size_t>(1, limit) ? updates_.erase(it) : std::next(it);
+        }
+    }
+    send_raw(packet, ip, port);
+}
+
+void Membership::send_sync(uint8_t type, uint32_t ip, uint16_t port) {
+    // 完整列表（包括本节点和DEAD/LEFT成员）按包大小拆分
+    std::vector<std::string> entries;
+    std::string encoded;
+    put_member(encoded, Member{name_, address_, MemberStatus::ALIVE, incarnation_, 0.0}, ip_, port_);
+    entries.push_back(encoded);
+    for (const auto& [_, state] : members_) {
+        encoded.clear();
+        put_member(encoded, state.info, state.ip, state.port);
+        entries.push_back(encoded);
+    }
+
+    std::string header = packet_header(type, 0, incarnation_, name_, address_);
+    size_t next = 0;
+    while (next < entries.size()) {
+        std::string packet = header;
+        size_t count_offset = packet.size();
+        put_u8(packet, 0);
+        uint8_t count = 0;
+        while (next < entries.size() && count < 255 &&
+               (count == 0 || packet.size() + entries[next].size() <= options_.max_packet_bytes)) {
+            packet += entries[next++];
+            ++count;
+        }
+        packet[count_offset] = static_cast<char>(count);
+        send_raw(packet, ip, port);
+        // 只需要对方回复一次
+        header = packet_header(type == SYNC ? static_cast<uint8_t>(SYNC_REPLY) : type, 0, incarnation_, name_, address_);
+    }
+}
+
+void Membership::apply_update(const Member& update, uint32_t ip, uint16_t port,
+                              std::chrono::steady_clock::time_point now, std::vector<Event>& events) {
+    if (update.address == address_) {
+        // 其他节点认为本节点可疑或已经失效：用更大的incarnation反驳
+        if (update.status != MemberStatus::ALIVE && update.incarnation >= incarnation_) {
+            refute(update.incarnation);
+        }
+        return;
+    }
+
+    auto it = members_.find(update.address);
+    if (it == members_.end()) {
+        // 不认识的成员只在它还活着（或可疑）时加入
+        if (is_gone(update.status)) {
+            return;
+        }
+        MemberState state;
+        state.info = update;
+        state.info.phi = 0.0;
+        state.ip = ip;
+        state.port = port;
+        state.detector = PhiAccrualDetector(100, options_.protocol_period, options_.protocol_period * 2);
+        state.changed_at = now;
+        it = members_.emplace(update.address, std::move(state)).first;
+        events.push_back(Event{kMemberUp, it->second.info});
+        if (update.status == MemberStatus::SUSPECT) {
+            events.push_back(Event{kMemberSuspect, it->second.info});
+        }
+        enqueue_update(it->second.info, ip, port);
+        return;
+    }
+
+    MemberState& state = it->second;
+    // DEAD/LEFT的成员只能以更大的incarnation重新加入
+    if (is_gone(state.info.status) && update.status != MemberStatus::ALIVE) {
+        return;
+    }
+    bool newer = update.incarnation > state.info.incarnation ||
+                 (update.incarnation == state.info.incarnation && update.status > state.info.status);
+    if (!newer) {
+        return;
+    }
+    state.info.name = update.name;
+    set_status(state, update.status, update.incarnation, now, events);
+}
+
+void Membership::set_status(MemberState& state, MemberStatus status, uint64_t incarnation,
+                            std::chrono::steady_clock::time_point now, std::vector<Event>& events) {
+    MemberStatus old_status = state.info.status;
+    state.info.status = status;
+    state.info.incarnation = incarnation;
+    if (status != old_status) {
+        state.changed_at = now;
+        if (status == MemberStatus::ALIVE && is_gone(old_status)) {
+            // 重新加入的成员从头积累心跳间隔
+            state.detector = PhiAccrualDetector(100, options_.protocol_period, options_.protocol_period * 2);
+        }
+        events.push_back(Event{event_type(status), state.info});
+    }
+    enqueue_update(state.info, state.ip, state.port);
+}
+
+void Membership::enqueue_update(const Member& member, uint32_t ip, uint16_t port) {
+    Update& update = updates_[member.address];
+    update.member = member;
+    update.ip = ip;
+    update.port = port;
+    update.transmits = 0;
+}
+
+void Membership::refute(uint64_t incarnation) {
+    incarnation_ = incarnation + 1;
+    enqueue_update(Member{name_, address_, MemberStatus::ALIVE, incarnation_, 0.0}, ip_, port_);
+}
+
+size_t Membership::live_members() const {
+    size_t count = 1;
+    for (const auto& [_, state] : members_) {
+        if (!is_gone(state.info.status)) {
+            ++count;
+        }
+    }
+    return count;
+}
+
+std::chrono::milliseconds Membership::suspicion_timeout() const {
+    double scale = std::max(1.0, std::log10(static_cast<double>(live_members())));
+    return std::chrono::milliseconds(static_cast<int64_t>(
+        static_cast<double>(options_.suspicion_multiplier) * scale * static_cast<double>(options_.protocol_period.count())));
+}
+
+std::vector<std::string> Membership::pick_random(size_t count, const std::string& exclude) {
+    std::vector<std::string> candidates;
+    for (const auto& [address, state] : members_) {
+        if (state.info.status == MemberStatus::ALIVE && address != exclude) {
+            candidates.push_back(address);
+        }
+    }
+    std::shuffle(candidates.begin(), candidates.end(), random_);
+    if (candidates.size() > count) {
+        candidates.resize(count);
+    }
+    return candidates;
+}
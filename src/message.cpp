@@ -1,14 +1,35 @@
 #include "message.h"
+#include "clock.h"
 
 Message::Message(std::string type, 
                  std::string sender_id, 
                  std::string target_id,
-                 std::map<std::string, std::any> payload,
+                 Payload payload,
                  Priority priority)
     : type_(std::move(type))
     , sender_id_(std::move(sender_id))
     , target_id_(std::move(target_id))
     , payload_(std::move(payload))
-    , created_at_(std::chrono::system_clock::now())
+    , created_at_(Clock::current().now())
     , priority_(priority) {
-} 
\ No newline at end of file
+} 
+
+Message::Message(const Message& other, const allocator_type& alloc)
+    : type_(other.type_)
+    , sender_id_(other.sender_id_)
+    , target_id_(other.target_id_)
+    , payload_(other.payload_, alloc)
+    , created_at_(other.created_at_)
+    , priority_(other.priority_)
+    , trace_context_(other.trace_context_) {
+}
+
+Message::Message(Message&& other, const allocator_type& alloc)
+    : type_(std::move(other.type_))
+    , sender_id_(std::move(other.sender_id_))
+    , target_id_(std::move(other.target_id_))
+    , payload_(std::move(other.payload_), alloc)
+    , created_at_(other.created_at_)
+    , priority_(other.priority_)
+    , trace_context_(other.trace_context_) {
+}
@@ -0,0 +1,205 @@
+#include "metrics.h"
+#include <cstdio>
+#include <fstream>
+#include <sstream>
+#include <stdexcept>
+
+namespace {
+    // 转义标签值中的反斜杠、双引号和换行
+    std::string escape_label_value(const std::string& value) {
+        std::string escaped;
+        escaped.reserve(value.size());
+        for (char c : value) {
+            switch (c) {
+                case '\\': escaped += "\\\\"; break;
+                case '"': escaped += "\\\""; break;
+                case '\n': escaped += "\\n"; break;
+                default: escaped += c;
+            }
+        }
+        return escaped;
+    }
+
+    // 转义HELP文本中的反斜杠和换行
+    std::string escape_help(const std::string& help) {
+        std::string escaped;
+        for (char c : help) {
+            if (c == '\\') {
+                escaped += "\\\\";
+            } else if (c == '\n') {
+                escaped += "\\n";
+            } else {
+                escaped += c;
+            }
+        }
+        return escaped;
+    }
+
+    std::string format_labels(const MetricLabels& labels, const std::string& extra_name = "",
+                              const std::string& extra_value = "") {
+        if (labels.empty() && extra_name.empty()) {
+            return "";
+        }
+        std::string text = "{";
+        bool first = true;
+        for (const auto& [name, value] : labels) {
+            text += (first ? "" : ",") + name + "=\"" + escape_label_value(value) + "\"";
+            first = false;
+        }
+        if (!extra_name.empty()) {
+            text += (first ? "" : ",") + extra_name + "=\"" + extra_value + "\"";
+        }
+        return text + "}";
+    }
+
+    std::string format_value(double value) {
+        std::ostringstream out;
+        out.precision(17);
+        out << value;
+        return out.str();
+    }
+}
+
+const char* MetricsRegistry::type_name(Type type) {
+    switch (type) {
+        case Type::COUNTER: return "counter";
+        case Type::GAUGE: return "gauge";
+        default: return "summary";
+    }
+}
+
+MetricsRegistry::Family& MetricsRegistry::family(const std::string& name, const std::string& help, Type type) {
+    auto it = families_.find(name);
+    if (it == families_.end()) {
+        Family family;
+        family.type = type;
+        family.help = help;
+        it = families_.emplace(name, std::move(family)).first;
+    } else if (it->second.type != type) {
+        throw std::invalid_argument("Metric " + name + " already registered with a different type");
+    }
+    return it->second;
+}
+
+std::shared_ptr<Counter> MetricsRegistry::counter(const std::string& name, const std::string& help,
+                                                  const MetricLabels& labels, double scale) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto& series = family(name, help, Type::COUNTER).counters[labels];
+    if (!series) {
+        series = std::make_shared<Counter>(scale);
+    }
+    return series;
+}
+
+std::shared_ptr<Gauge> MetricsRegistry::gauge(const std::string& name, const std::string& help,
+                                              const MetricLabels& labels) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto& series = family(name, help, Type::GAUGE).gauges[labels];
+    if (!series) {
+        series = std::make_shared<Gauge>();
+    }
+    return series;
+}
+
+std::shared_ptr<Summary> MetricsRegistry::summary(const std::string& name, const std::string& help,
+                                                  const MetricLabels& labels, double scale) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto& series = family(name, help, Type::SUMMARY).summaries[labels];
+    if (!series) {
+        series = std::make_shared<Summary>(scale);
+    }
+    return series;
+}
+
+void MetricsRegistry::remove(const std::string& name, const MetricLabels& labels) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto it = families_.find(name);
+    if (it == families_.end()) {
+        return;
+    }
+    it->second.counters.erase(labels);
+    it->second.gauges.erase(labels);
+    it->second.summaries.erase(labels);
+}
+
+uint64_t MetricsRegistry::add_collector(Collector collector) {
+    std::lock_guard<std::mutex> lock(collectors_mutex_);
+    uint64_t id = next_collector_id_++;
+    collectors_[id] = std::move(collector);
+    return id;
+}
+
+void MetricsRegistry::remove_collector(uint64_t id) {
+    std::lock_guard<std::mutex> lock(collectors_mutex_);
+    collectors_.erase(id);
+}
+
+std::string MetricsRegistry::render() {
+    // 收集回调会注册或更新指标，因此不能持有mutex_
+    {
+        std::lock_guard<std::mutex> lock(collectors_mutex_);
+        for (const auto& [_, collector] : collectors_) {
+            collector();
+        }
+    }
+
+    static const double quantiles[] = {0.5, 0.9, 0.99, 0.999};
+
+    std::ostringstream out;
+    std::lock_guard<std::mutex> lock(mutex_);
+    for (const auto& [name, family] : families_) {
+        if (family.counters.empty() && family.gauges.empty() && family.summaries.empty()) {
+            continue;
+        }
+        out << "# HELP " << name << " " << escape_help(family.help) << "\n"
+            << "# TYPE " << name << " " << type_name(family.type) << "\n";
+
+        for (const auto& [labels, counter] : family.counters) {
+            out << name << format_labels(labels) << " "
+                << format_value(static_cast<double>(counter->value()) * counter->scale()) << "\n";
+        }
+        for (const auto& [labels, gauge] : family.gauges) {
+            out << name << format_labels(labels) << " " << format_value(gauge->value()) << "\n";
+        }
+        for (const auto& [labels, summary] : family.summaries) {
+            const auto& histogram = summary->histogram();
+            double scale = summary->scale();
+            for (double q : quantiles) {
+                std::ostringstream q_text;
+                q_text << q;
+                out << name << format_labels(labels, "quantile", q_text.str()) << " "
+                    << format_value(static_cast<double>(histogram.value_at_percentile(q * 100.0)) * scale) << "\n";
+            }
+            uint64_t count = histogram.count();
+            out << name << "_sum" << format_labels(labels) << " "
+                << format_value(histogram.mean() * static_cast<double>(count) * scale) << "\n"
+                << name << "_count" << format_labels(labels) << " " << count << "\n";
+        }
+    }
+    return out.str();
+}
+
+bool MetricsRegistry::write_to_file(const std::string& path) {
+    std::string text = render();
+    std::string temp_path = path + ".tmp";
+    {
+        std::ofstream out(temp_path, std::ios::trunc);
+        if (!out) {
+            return false;
+        }
+        out << text;
+        if (!out) {
+            return false;
+        }
+    }
+    return std::rename(temp_path.c_str(), path.c_str()) == 0;
+}
+
+size_t MetricsRegistry::series_count() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    size_t count = 0;
+    for (const auto& [_, family] : families_) {
+        count += family.counters.size() + family.gauges.size() + family.summaries.size();
+    }
+    return count;
+}
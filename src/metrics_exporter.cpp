@@ -0,0 +1,222 @@
+#include "metrics_exporter.h"
+#include "logging.h"
+#include "metrics.h"
+#include <arpa/inet.h>
+#include <cerrno>
+#include <cstring>
+#include <iostream>
+#include <netinet/in.h>
+#include <poll.h>
+#include <stdexcept>
+#include <sys/socket.h>
+#include <sys/time.h>
+#include <unistd.h>
+
+namespace {
+    // 把整个缓冲区写入套接字
+    bool send_all(int fd, const std::string& data) {
+        size_t sent = 0;
+        while (sent < data.size()) {
+            ssize_t n = ::send(fd, data.data() + sent, data.size() - sent, MSG_NOSIGNAL);
+            if (n < 0 && errno == EINTR) {
+                continue;
+            }
+            if (n <= 0) {
+                return false;
+            }
+            sent += static_cast<size_t>(n);
+        }
+        return true;
+    }
+
+    std::string http_response(const std::string& status, const std::string& content_type, const std::string& body) {
+        return "HTTP/1.1 " + status + "\r\n"
+               "Content-Type: " + content_type + "\r\n"
+               "Content-Length: " + std::to_string(body.size()) + "\r\n"
+               "Connection: close\r\n\r\n" + body;
+    }
+}
+
+MetricsHttpServer::MetricsHttpServer(std::shared_ptr<MetricsRegistry> registry, uint16_t port,
+                                     const std::string& address)
+    : registry_(std::move(registry)), listen_fd_(-1), port_(0), running_(false) {
+    listen_fd_ = ::socket(AF_INET, SOCK_STREAM, 0);
+    if (listen_fd_ < 0) {
+        throw std::runtime_error(std::string("Cannot create metrics socket: ") + std::strerror(errno));
+    }
+
+    int reuse = 1;
+    ::setsockopt(listen_fd_, SOL_SOCKET, SO_REUSEADDR, &reuse, sizeof(reuse));
+
+    sockaddr_in addr{};
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons(port);
+    if (::inet_pton(AF_INET, address.c_str(), &addr.sin_addr) != 1) {
+        ::close(listen_fd_);
+        throw std::runtime_error("Invalid metrics listen address: " + address);
+    }
+    if (::bind(listen_fd_, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) < 0 ||
+        ::listen(listen_fd_, 16) < 0) {
+        std::string error = std::strerror(errno);
+        ::close(listen_fd_);
+        throw std::runtime_error("Cannot listen on " + address + ":" + std::to_string(port) + ": " + error);
+    }
+
+    socklen_t length = sizeof(addr);
+    ::getsockname(listen_fd_, reinterpret_cast<sockaddr*>(&addr), &length);
+    port_ = ntohs(addr.sin_port);
+
+    running_ = true;
+    thread_ = std::thread(&MetricsHttpServer::serve, this);
+}
+
+MetricsHttpServer::~MetricsHttpServer() {
+    stop();
+}
+
+void MetricsHttpServer::stop() {
+    if (!running_.exchange(false)) {
+        return;
+    }
+    if (thread_.joinable()) {
+        thread_.join();
+    }
+    ::close(listen_fd_);
+    listen_fd_ = -1;
+}
+
+void MetricsHttpServer::add_endpoint(const std::string& path, Handler handler) {
+    std::lock_guard<std::mutex> lock(endpoints_mutex_);
+    if (handler) {
+        endpoints_[path] = std::move(handler);
+    } else {
+        endpoints_.erase(path);
+    }
+}
+
+void MetricsHttpServer::serve() {
+    while (running_) {
+        // 定期超时以便检查停止标志
+        pollfd pfd{listen_fd_, POLLIN, 0};
+        int ready = ::poll(&pfd, 1, 100);
+        if (ready <= 0) {
+            continue;
+        }
+
+        int fd = ::accept(listen_fd_, nullptr, nullptr);
+        if (fd < 0) {
+            continue;
+        }
+        handle_connection(fd);
+        ::close(fd);
+    }
+}
+
+void MetricsHttpServer::handle_connection(int fd) {
+    // 慢客户端不能阻塞服务线程太久
+    timeval timeout{1, 0};
+    ::setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+    ::setsockopt(fd, SOL_SOCKET, SO_SNDTIMEO, &timeout, sizeof(timeout));
+
+    std::string request;
+    char buffer[1024];
+    while (request.find("\r\n\r\n") == std::string::npos && request.size() < 8192) {
+        ssize_t n = ::recv(fd, buffer, sizeof(buffer), 0);
+        if (n < 0 && errno == EINTR) {
+            continue;
+        }
+        if (n <= 0) {
+            break;
+        }
+        request.append(buffer, static_cast<size_t>(n));
+    }
+
+    // 只解析请求行："GET /metrics HTTP/1.1"
+    std::string line = request.substr(0, request.find("\r\n"));
+    size_t first_space = line.find(' ');
+    size_t second_space = line.find(' ', first_space + 1);
+    if (first_space == std::string::npos || second_space == std::string::npos) {
+        send_all(fd, http_response("400 Bad Request", "text/plain", "bad request\n"));
+        return;
+    }
+
+    std::string method = line.substr(0, first_space);
+    std::string path = line.substr(first_space + 1, second_space - first_space - 1);
+    size_t question = path.find('?');
+    std::string query = question == std::string::npos ? "" : path.substr(question + 1);
+    path = path.substr(0, question);
+    if (method != "GET") {
+        send_all(fd, http_response("405 Method Not Allowed", "text/plain", "method not allowed\n"));
+        return;
+    }
+
+    Handler handler;
+    {
+        std::lock_guard<std::mutex> lock(endpoints_mutex_);
+        auto it = endpoints_.find(path);
+        if (it != endpoints_.end()) {
+            handler = it->second;
+        }
+    }
+    if (handler) {
+        std::string body;
+        try {
+            body = handler(query);
+        } catch (const std::exception& e) {
+            send_all(fd, http_response("500 Internal Server Error", "text/plain", std::string(e.what()) + "\n"));
+            return;
+        }
+        send_all(fd, http_response("200 OK", "text/plain; charset=utf-8", body));
+        return;
+    }
+    if (path != "/metrics" && path != "/") {
+        send_all(fd, http_response("404 Not Found", "text/plain", "not found\n"));
+        return;
+    }
+
+    send_all(fd, http_response("200 OK", "text/plain; version=0.0.4; charset=utf-8", registry_->render()));
+}
+
+MetricsFileDumper::MetricsFileDumper(std::shared_ptr<MetricsRegistry> registry, std::string path,
+                                     std::chrono::milliseconds interval)
+    : registry_(std::move(registry)), path_(std::move(path)), interval_(interval),
+      stopping_(false), dump_count_(0) {
+    thread_ = std::thread(&MetricsFileDumper::run, this);
+}
+
+MetricsFileDumper::~MetricsFileDumper() {
+    stop();
+}
+
+void MetricsFileDumper::stop() {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (stopping_) {
+            return;
+        }
+        stopping_ = true;
+    }
+    cv_.notify_all();
+    if (thread_.joinable()) {
+        thread_.join();
+    }
+}
+
+void MetricsFileDumper::run() {
+    std::unique_lock<std::mutex> lock(mutex_);
+    while (true) {
+        bool stopping = cv_.wait_for(lock, interval_, [this]() { return stopping_; });
+
+        lock.unlock();
+        if (registry_->write_to_file(path_)) {
+            ++dump_count_;
+        } else if (log_enabled(LogLevel::WARN)) {
+            std::cerr << "Failed to write metrics to " << path_ << std::endl;
+        }
+        lock.lock();
+
+        if (stopping) {
+            return;
+        }
+    }
+}
@@ -0,0 +1,12 @@
+#include "probes.h"
+
+#if ACTOR_PROBES_AVAILABLE
+
+// 每个探针的信号量（已在probes.h中声明为extern "C"），uprobe挂载时由内核递增
+// 放在.probes节中，与sys/sdt.h的约定一致
+#define ACTOR_PROBE_DEFINE_SEMAPHORE(name) \
+    __attribute__((section(".probes"), used)) volatile unsigned short actor_cpp_##name##_semaphore = 0;
+ACTOR_PROBE_LIST(ACTOR_PROBE_DEFINE_SEMAPHORE)
+#undef ACTOR_PROBE_DEFINE_SEMAPHORE
+
+#endif
@@ -0,0 +1,1031 @@
+#include "remote.h"
+#include "actor.h"
+#include "compression.h"
+#include "event_loop.h"
+#include "logging.h"
+#include "message.h"
+#include <algorithm>
+#include <arpa/inet.h>
+#include <cerrno>
+#include <chrono>
+#include <cstring>
+#include <iostream>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <csignal>
+#include <poll.h>
+#include <stdexcept>
+#include <sys/eventfd.h>
+#include <sys/sendfile.h>
+#include <sys/socket.h>
+#include <sys/uio.h>
+#include <typeinfo>
+#include <unistd.h>
+
+namespace {
+    // 负载值的类型标记
+    enum ValueTag : uint8_t {
+        TAG_STRING = 0,
+        TAG_BOOL = 1,
+        TAG_INT32 = 2,
+        TAG_INT64 = 3,
+        TAG_UINT32 = 4,
+        TAG_UINT64 = 5,
+        TAG_DOUBLE = 6,
+        TAG_BUFFER = 7
+    };
+
+    constexpr uint8_t kTraceValid = 1;
+    constexpr uint8_t kTraceSampled = 2;
+
+    // 帧类型：消息由发送方发往接收方，额度沿同一个连接反向返还
+    // 压缩帧的内容是原始长度 + 连续的消息帧经LZ4压缩后的块
+    enum FrameKind : uint8_t {
+        FRAME_MESSAGE = 0,
+        FRAME_CREDIT = 1,
+        FRAME_COMPRESSED = 2
+    };
+
+    // 有额度等待返还时I/O线程检查邮箱的间隔
+    constexpr std::chrono::milliseconds kCreditPollInterval{1};
+
+    // 一次writev最多发送的片段数（帧头和附件各占一个）
+    constexpr int kMaxIov = 64;
+
+    // 至少这么大的文件附件用sendfile从页缓存直接发送，更小的随其他片段一起writev
+    constexpr size_t kSendfileBytes = 256 * 1024;
+
+    // 至少这么大的消息帧直接接收到单独分配的Buffer中，附件切片引用它而不再复制
+    constexpr size_t kDirectReceiveBytes = 64 * 1024;
+
+    // 编码：整数为LEB128变长编码（有符号数先做zigzag），字符串为变长长度 + 内容，
+    // 追踪ID和double为8字节大端
+    void put_u8(std::string& out, uint8_t value) {
+        out.push_back(static_cast<char>(value));
+    }
+
+    void put_varint(std::string& out, uint64_t value) {
+        while (value >= 0x80) {
+            put_u8(out, static_cast<uint8_t>(value | 0x80));
+            value >>= 7;
+        }
+        put_u8(out, static_cast<uint8_t>(value));
+    }
+
+    void put_zigzag(std::string& out, int64_t value) {
+        put_varint(out, (static_cast<uint64_t>(value) << 1) ^ static_cast<uint64_t>(value >> 63));
+    }
+
+    void put_u64(std::string& out, uint64_t value) {
+        for (int shift = 56; shift >= 0; shift -= 8) {
+            put_u8(out, static_cast<uint8_t>(value >> shift));
+        }
+    }
+
+    void put_string(std::string& out, const std::string& value) {
+        put_varint(out, value.size());
+        out.append(value);
+    }
+
+    struct Reader {
+        const uint8_t* data;
+        const uint8_t* end;
+
+        uint8_t u8() {
+            if (data >= end) {
+                throw std::runtime_error("Truncated remote message");
+            }
+            return *data++;
+        }
+
+        uint64_t varint() {
+            uint64_t value = 0;
+            for (int shift = 0; shift < 64; shift += 7) {
+                uint8_t byte = u8();
+                value |= static_cast<uint64_t>(byte & 0x7F) << shift;
+                if ((byte & 0x80) == 0) {
+                    return value;
+                }
+            }
+            throw std::runtime_error("Malformed varint in remote message");
+        }
+
+        int64_t zigzag() {
+            uint64_t value = varint();
+            return static_cast<int64_t>(value >> 1) ^ -static_cast<int64_t>(value & 1);
+        }
+
+        uint64_t u64() {
+            uint64_t value = 0;
+            for (int i = 0; i < 8; ++i) {
+                value = (value << 8) | u8();
+            }
+            return value;
+        }
+
+        std::string string() {
+            uint64_t length = varint();
+            if (static_cast<uint64_t>(end - data) < length) {
+                throw std::runtime_error("Truncated remote message");
+            }
+            std::string value(reinterpret_cast<const char*>(data), static_cast<size_t>(length));
+            data += length;
+            return value;
+        }
+    };
+
+    // 消息编码为：头部长度 + 头部 + 附件。Buffer负载在头部中只有长度，内容按出现顺序放在附件中，
+    // 发送时直接引用Buffer的内存
+    void put_value(std::string& out, const std::string& key, const std::any& value, std::vector<Buffer>& attachments) {
+        const std::type_info& type = value.type();
+        if (type == typeid(Buffer)) {
+            const auto& buffer = std::any_cast<const Buffer&>(value);
+            put_u8(out, TAG_BUFFER);
+            put_varint(out, buffer.size());
+            attachments.push_back(buffer);
+        } else if (type == typeid(std::string)) {
+            put_u8(out, TAG_STRING);
+            put_string(out, std::any_cast<const std::string&>(value));
+        } else if (type == typeid(const char*)) {
+            put_u8(out, TAG_STRING);
+            put_string(out, std::any_cast<const char*>(value));
+        } else if (type == typeid(bool)) {
+            put_u8(out, TAG_BOOL);
+            put_u8(out, std::any_cast<bool>(value) ? 1 : 0);
+        } else if (type == typeid(int)) {
+            put_u8(out, TAG_INT32);
+            put_zigzag(out, std::any_cast<int>(value));
+        } else if (type == typeid(int64_t)) {
+            put_u8(out, TAG_INT64);
+            put_zigzag(out, std::any_cast<int64_t>(value));
+        } else if (type == typeid(uint32_t)) {
+            put_u8(out, TAG_UINT32);
+            put_varint(out, std::any_cast<uint32_t>(value));
+        } else if (type == typeid(uint64_t)) {
+            put_u8(out, TAG_UINT64);
+            put_varint(out, std::any_cast<uint64_t>(value));
+        } else if (type == typeid(double)) {
+            double number = std::any_cast<double>(value);
+            uint64_t bits;
+            std::memcpy(&bits, &number, sizeof(bits));
+            put_u8(out, TAG_DOUBLE);
+            put_u64(out, bits);
+        } else {
+            throw std::runtime_error("Cannot encode payload value of key '" + key + "' (" + type.name() + ")");
+        }
+    }
+
+    // 解码时附件的读取位置；backing不为空时Buffer负载引用其中的字节，否则复制
+    struct Attachments {
+        const uint8_t* next;
+        const uint8_t* end;
+        const Buffer* backing;
+
+        Buffer take(size_t length) {
+            if (static_cast<size_t>(end - next) < length) {
+                throw std::runtime_error("Truncated remote message attachment");
+            }
+            const auto* data = reinterpret_cast<const char*>(next);
+            next += length;
+            if (backing) {
+                return backing->slice(static_cast<size_t>(data - backing->data()), length);
+            }
+            return Buffer::copy(data, length);
+        }
+    };
+
+    std::any read_value(Reader& reader, Attachments& attachments) {
+        switch (reader.u8()) {
+            case TAG_STRING: return reader.string();
+            case TAG_BOOL: return reader.u8() != 0;
+            case TAG_INT32: return static_cast<int>(reader.zigzag());
+            case TAG_INT64: return static_cast<int64_t>(reader.zigzag());
+            case TAG_UINT32: return static_cast<uint32_t>(reader.varint());
+            case TAG_UINT64: return static_cast<uint64_t>(reader.varint());
+            case TAG_DOUBLE: {
+                uint64_t bits = reader.u64();
+                double number;
+                std::memcpy(&number, &bits, sizeof(number));
+                return number;
+            }
+            case TAG_BUFFER: return attachments.take(static_cast<size_t>(reader.varint()));
+            default: throw std::runtime_error("Unknown payload value type in remote message");
+        }
+    }
+
+    // 开始一个帧：预留4字节长度，写入帧类型
+    std::string open_frame(FrameKind kind) {
+        std::string frame(4, '\0');
+        put_u8(frame, kind);
+        return frame;
+    }
+
+    // 填写帧头中的长度（不含长度本身，extra为随后发送的附件字节数）
+    void seal_frame(std::string& frame, size_t extra = 0) {
+        size_t length = frame.size() - 4 + extra;
+        for (int i = 0; i < 4; ++i) {
+            frame[i] = static_cast<char>(length >> (24 - 8 * i));
+        }
+    }
+
+    size_t frame_length(const char* header) {
+        const auto* bytes = reinterpret_cast<const uint8_t*>(header);
+        return (static_cast<size_t>(bytes[0]) << 24) | (static_cast<size_t>(bytes[1]) << 16) |
+               (static_cast<size_t>(bytes[2]) << 8) | bytes[3];
+    }
+
+    bool parse_address(const std::string& text, sockaddr_in& addr) {
+        size_t colon = text.rfind(':');
+        if (colon == std::string::npos) {
+            return false;
+        }
+        addr = sockaddr_in{};
+        addr.sin_family = AF_INET;
+        if (::inet_pton(AF_INET, text.substr(0, colon).c_str(), &addr.sin_addr) != 1) {
+            return false;
+        }
+        long value = std::strtol(text.c_str() + colon + 1, nullptr, 10);
+        if (value <= 0 || value > 65535) {
+            return false;
+        }
+        addr.sin_port = htons(static_cast<uint16_t>(value));
+        return true;
+    }
+
+    // 发起非阻塞连接，失败时返回-1；连接还在进行中时connecting为true
+    int connect_to(const std::string& node, bool& connecting) {
+        sockaddr_in addr;
+        if (!parse_address(node, addr)) {
+            return -1;
+        }
+        int fd = ::socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+        if (fd < 0) {
+            return -1;
+        }
+        int one = 1;
+        ::setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+        if (::connect(fd, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) == 0) {
+            connecting = false;
+            return fd;
+        }
+        if (errno == EINPROGRESS) {
+            connecting = true;
+            return fd;
+        }
+        ::close(fd);
+        return -1;
+    }
+}
+
+namespace {
+    // 编码消息的头部（带长度前缀），Buffer负载追加到attachments
+    std::string encode_head(const Message& message, std::vector<Buffer>& attachments) {
+        std::string out;
+        out.reserve(64);
+        put_string(out, message.get_type());
+        put_string(out, message.get_sender_id());
+        put_string(out, message.get_target_id());
+        put_u8(out, static_cast<uint8_t>(message.get_priority()));
+
+        const TraceContext& context = message.get_trace_context();
+        if (context.valid()) {
+            put_u8(out, kTraceValid | (context.sampled ? kTraceSampled : 0));
+            put_u64(out, context.trace_id_high);
+            put_u64(out, context.trace_id_low);
+            put_u64(out, context.span_id);
+        } else {
+            put_u8(out, 0);
+        }
+
+        const auto& payload = message.get_pmr_payload();
+        put_varint(out, payload.size());
+        for (const auto& [key, value] : payload) {
+            put_string(out, key);
+            put_value(out, key, value, attachments);
+        }
+
+        std::string head;
+        head.reserve(out.size() + 4);
+        put_varint(head, out.size());
+        head += out;
+        return head;
+    }
+
+    Message decode(const char* data, size_t size, const Buffer* backing) {
+        Reader outer{reinterpret_cast<const uint8_t*>(data), reinterpret_cast<const uint8_t*>(data) + size};
+        uint64_t head_size = outer.varint();
+        if (static_cast<uint64_t>(outer.end - outer.data) < head_size) {
+            throw std::runtime_error("Truncated remote message");
+        }
+        Reader reader{outer.data, outer.data + head_size};
+        Attachments attachments{reader.end, outer.end, backing};
+
+        std::string type = reader.string();
+        std::string sender = reader.string();
+        std::string target = reader.string();
+        uint8_t priority = reader.u8();
+        if (priority > static_cast<uint8_t>(Message::Priority::CRITICAL)) {
+            throw std::runtime_error("Invalid priority in remote message");
+        }
+
+        TraceContext context;
+        uint8_t flags = reader.u8();
+        if (flags & kTraceValid) {
+            context.trace_id_high = reader.u64();
+            context.trace_id_low = reader.u64();
+            context.span_id = reader.u64();
+            context.sampled = (flags & kTraceSampled) != 0;
+        }
+
+        Message::Payload payload;
+        uint64_t count = reader.varint();
+        for (uint64_t i = 0; i < count; ++i) {
+            std::string key = reader.string();
+            payload[key] = read_value(reader, attachments);
+        }
+        if (reader.data != reader.end || attachments.next != attachments.end) {
+            throw std::runtime_error("Trailing bytes in remote message");
+        }
+
+        Message message(std::move(type), std::move(sender), std::move(target), std::move(payload),
+                        static_cast<Message::Priority>(priority));
+        message.set_trace_context(context);
+        return message;
+    }
+}
+
+std::string encode_message(const Message& message) {
+    std::vector<Buffer> attachments;
+    std::string out = encode_head(message, attachments);
+    for (const auto& buffer : attachments) {
+        out.append(buffer.data(), buffer.size());
+    }
+    return out;
+}
+
+Message decode_message(const char* data, size_t size) {
+    return decode(data, size, nullptr);
+}
+
+Message decode_message(const Buffer& data) {
+    return decode(data.data(), data.size(), &data);
+}
+
+RemoteTransport::RemoteTransport(std::weak_ptr<EventLoop> event_loop, RemoteOptions options)
+    : options_(std::move(options)), event_loop_(std::move(event_loop)), port_(0), listen_fd_(-1), wake_fd_(-1),
+      running_(false) {
+    sockaddr_in addr;
+    if (!parse_address(options_.bind_address + ":1", addr) || addr.sin_addr.s_addr == htonl(INADDR_ANY)) {
+        throw std::runtime_error("Invalid remote bind address: " + options_.bind_address);
+    }
+    addr.sin_port = htons(options_.port);
+
+    listen_fd_ = ::socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    if (listen_fd_ < 0) {
+        throw std::runtime_error(std::string("Cannot create remote socket: ") + std::strerror(errno));
+    }
+    int one = 1;
+    ::setsockopt(listen_fd_, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+    if (::bind(listen_fd_, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) < 0 || ::listen(listen_fd_, 128) < 0) {
+        std::string error = std::strerror(errno);
+        ::close(listen_fd_);
+        throw std::runtime_error("Cannot listen on " + options_.bind_address + ":" + std::to_string(options_.port) +
+                                 ": " + error);
+    }
+    socklen_t length = sizeof(addr);
+    ::getsockname(listen_fd_, reinterpret_cast<sockaddr*>(&addr), &length);
+    port_ = ntohs(addr.sin_port);
+    address_ = options_.bind_address + ":" + std::to_string(port_);
+
+    wake_fd_ = ::eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    if (wake_fd_ < 0) {
+        std::string error = std::strerror(errno);
+        ::close(listen_fd_);
+        throw std::runtime_error("Cannot create remote wakeup descriptor: " + error);
+    }
+
+    running_ = true;
+    thread_ = std::thread(&RemoteTransport::run, this);
+}
+
+RemoteTransport::~RemoteTransport() {
+    stop();
+}
+
+void RemoteTransport::stop() {
+    if (!running_.exchange(false)) {
+        return;
+    }
+    wake();
+    if (thread_.joinable()) {
+        thread_.join();
+    }
+    std::lock_guard<std::mutex> lock(mutex_);
+    while (!connections_.empty()) {
+        close_connection(connections_.begin()->first);
+    }
+    ::close(listen_fd_);
+    ::close(wake_fd_);
+    listen_fd_ = -1;
+    wake_fd_ = -1;
+}
+
+void RemoteTransport::add_endpoint(const std::string& name, Endpoint endpoint) {
+    std::lock_guard<std::mutex> lock(endpoints_mutex_);
+    if (endpoint) {
+        endpoints_[name] = std::move(endpoint);
+    } else {
+        endpoints_.erase(name);
+    }
+}
+
+bool RemoteTransport::send(const std::string& node, const Message& message) {
+    if (!running_) {
+        ++messages_dropped_;
+        return false;
+    }
+    if (node == address_) {
+        dispatch(message);
+        return true;
+    }
+
+    // 在调用线程编码，I/O线程只负责搬运字节；Buffer负载作为附件引用，不复制
+    Frame frame;
+    frame.data = open_frame(FRAME_MESSAGE);
+    frame.data += encode_head(message, frame.attachments);
+    frame.messages = 1;
+    frame.packed = !frame.attachments.empty();
+    size_t length = frame.size() - 4;
+    if (length > options_.max_frame_bytes) {
+        ++messages_dropped_;
+        if (log_enabled(LogLevel::WARN)) {
+            std::cerr << "Dropping " << length << "-byte message " << message.get_type() << " to " << node
+                      << ": frame too large" << std::endl;
+        }
+        return false;
+    }
+    seal_frame(frame.data, frame.size() - frame.data.size());
+
+    bool notify = false;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        int fd;
+        auto it = outbound_.find(node);
+        if (it != outbound_.end()) {
+            fd = it->second;
+        } else {
+            bool connecting = false;
+            fd = connect_to(node, connecting);
+            if (fd < 0) {
+                ++messages_dropped_;
+                if (log_enabled(LogLevel::WARN)) {
+                    std::cerr << "Cannot connect to remote node " << node << std::endl;
+                }
+                return false;
+            }
+            Connection& connection = connections_[fd];
+            connection.node = node;
+            connection.outbound = true;
+            connection.connecting = connecting;
+            outbound_[node] = fd;
+        }
+
+        Connection& connection = connections_[fd];
+        if (connection.queued_bytes + frame.size() > options_.max_queued_bytes) {
+            ++messages_dropped_;
+            return false;
+        }
+        connection.queued_bytes += frame.size();
+        if (options_.link_credits == 0) {
+            notify = enqueue(connection, std::move(frame));
+        } else {
+            // 同一目标已有消息在等待时排在它们后面，保持顺序
+            const std::string& name = message.get_target_id();
+            Target& target = connection.targets[name];
+            if (target.waiting.empty() && connection.in_flight < options_.link_credits &&
+                (options_.target_credits == 0 || target.in_flight < options_.target_credits)) {
+                ++target.in_flight;
+                ++connection.in_flight;
+                notify = enqueue(connection, std::move(frame));
+            } else {
+                if (target.waiting.empty()) {
+                    connection.blocked.push_back(name);
+                }
+                target.waiting.push_back(std::move(frame));
+                ++messages_deferred_;
+            }
+        }
+    }
+    if (notify) {
+        wake();
+    }
+    return true;
+}
+
+void RemoteTransport::wake() {
+    uint64_t one = 1;
+    ssize_t written = ::write(wake_fd_, &one, sizeof(one));
+    (void)written;
+}
+
+void RemoteTransport::dispatch(const Message& message) {
+    Endpoint endpoint;
+    {
+        std::lock_guard<std::mutex> lock(endpoints_mutex_);
+        auto it = endpoints_.find(message.get_target_id());
+        if (it != endpoints_.end()) {
+            endpoint = it->second;
+        }
+    }
+    if (endpoint) {
+        endpoint(message);
+    } else if (auto event_loop = event_loop_.lock()) {
+        event_loop->deliver_message(message);
+    }
+}
+
+void RemoteTransport::run() {
+    // sendfile没有MSG_NOSIGNAL，对端关闭时产生的SIGPIPE在本线程屏蔽，由flush()取走
+    sigset_t sigpipe;
+    sigemptyset(&sigpipe);
+    sigaddset(&sigpipe, SIGPIPE);
+    pthread_sigmask(SIG_BLOCK, &sigpipe, nullptr);
+
+    std::vector<pollfd> fds;
+    std::vector<std::pair<int, Message>> received;
+    bool crediting = false;
+
+    while (running_) {
+        fds.clear();
+        fds.push_back(pollfd{listen_fd_, POLLIN, 0});
+        fds.push_back(pollfd{wake_fd_, POLLIN, 0});
+        // 接收方有额度等待返还时频繁检查邮箱，邮箱排空后尽快返还；
+        // 还在等待批次的连接不关心可写，等到批次的截止时间
+        std::chrono::nanoseconds wait = crediting ? kCreditPollInterval : std::chrono::milliseconds(100);
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            auto now = std::chrono::steady_clock::now();
+            for (const auto& [fd, connection] : connections_) {
+                short events = POLLIN;
+                if (connection.connecting || ready(connection, now)) {
+                    events |= POLLOUT;
+                } else if (!connection.output.empty()) {
+                    wait = std::min<std::chrono::nanoseconds>(wait, connection.batch_deadline - now);
+                }
+                fds.push_back(pollfd{fd, events, 0});
+            }
+        }
+
+        wait = std::max(wait, std::chrono::nanoseconds(0));
+        timespec timeout{static_cast<time_t>(wait.count() / 1000000000),
+                         static_cast<long>(wait.count() % 1000000000)};
+        int count = ::ppoll(fds.data(), fds.size(), &timeout, nullptr);
+        if (count <= 0) {
+            if (crediting) {
+                std::lock_guard<std::mutex> lock(mutex_);
+                crediting = return_credits();
+            }
+            continue;
+        }
+        if (fds[1].revents) {
+            uint64_t value;
+            ssize_t n = ::read(wake_fd_, &value, sizeof(value));
+            (void)n;
+        }
+        if (fds[0].revents & POLLIN) {
+            for (;;) {
+                int fd = ::accept4(listen_fd_, nullptr, nullptr, SOCK_NONBLOCK | SOCK_CLOEXEC);
+                if (fd < 0) {
+                    break;
+                }
+                std::lock_guard<std::mutex> lock(mutex_);
+                connections_[fd];
+            }
+        }
+
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            for (size_t i = 2; i < fds.size(); ++i) {
+                short revents = fds[i].revents;
+                if (revents == 0) {
+                    continue;
+                }
+                int fd = fds[i].fd;
+                auto it = connections_.find(fd);
+                if (it == connections_.end()) {
+                    continue;
+                }
+                Connection& connection = it->second;
+                bool ok = (revents & POLLNVAL) == 0;
+                if (ok && connection.connecting && (revents & (POLLOUT | POLLERR | POLLHUP))) {
+                    int error = 0;
+                    socklen_t length = sizeof(error);
+                    ::getsockopt(fd, SOL_SOCKET, SO_ERROR, &error, &length);
+                    ok = error == 0;
+                    connection.connecting = false;
+                }
+                if (ok && (revents & POLLOUT) && ready(connection, std::chrono::steady_clock::now())) {
+                    ok = flush(connection, fd);
+                }
+                if (ok && (revents & (POLLIN | POLLHUP | POLLERR))) {
+                    ok = receive(connection, fd, received);
+                }
+                if (!ok) {
+                    close_connection(fd);
+                }
+            }
+        }
+
+        for (const auto& [fd, message] : received) {
+            dispatch(message);
+        }
+        received.clear();
+
+        std::lock_guard<std::mutex> lock(mutex_);
+        crediting = return_credits();
+    }
+}
+
+size_t RemoteTransport::Frame::size() const {
+    size_t total = data.size();
+    for (const auto& buffer : attachments) {
+        total += buffer.size();
+    }
+    return total;
+}
+
+bool RemoteTransport::enqueue(Connection& connection, Frame frame) {
+    bool was_idle = connection.output.empty();
+    size_t before = connection.output_bytes;
+    if (was_idle) {
+        connection.batch_deadline = std::chrono::steady_clock::now() + options_.batch_window;
+    }
+    connection.output_bytes += frame.size();
+    connection.output.push_back(std::move(frame));
+    // 批次开始时I/O线程要重新计算等待时间，字节数达到阈值时要立即发送
+    return was_idle || (before < options_.batch_bytes && connection.output_bytes >= options_.batch_bytes);
+}
+
+bool RemoteTransport::ready(const Connection& connection, std::chrono::steady_clock::time_point now) const {
+    if (connection.output.empty()) {
+        return false;
+    }
+    // 只有发送消息的连接等待批次，额度立即返还
+    return !connection.outbound || connection.output_offset > 0 || options_.batch_window.count() == 0 ||
+           connection.output_bytes >= options_.batch_bytes || now >= connection.batch_deadline;
+}
+
+void RemoteTransport::compress(Connection& connection) {
+    // 已经开始发送的帧不能再改动
+    size_t i = connection.output_offset > 0 ? 1 : 0;
+    size_t chunk = std::max(options_.batch_bytes, options_.compress_bytes);
+    auto& output = connection.output;
+    while (i < output.size()) {
+        if (output[i].packed) {
+            ++i;
+            continue;
+        }
+        size_t j = i;
+        size_t raw_size = 0;
+        size_t messages = 0;
+        while (j < output.size() && !output[j].packed && raw_size < chunk &&
+               raw_size + output[j].data.size() <= options_.max_frame_bytes) {
+            raw_size += output[j].data.size();
+            messages += output[j].messages;
+            ++j;
+        }
+        if (j == i) {
+            output[i++].packed = true;
+            continue;
+        }
+        if (raw_size < options_.compress_bytes) {
+            break;
+        }
+
+        std::string raw;
+        raw.reserve(raw_size);
+        for (size_t k = i; k < j; ++k) {
+            raw += output[k].data;  // 带附件的帧已经标记为packed，不会出现在这里
+        }
+        std::string frame = open_frame(FRAME_COMPRESSED);
+        put_varint(frame, raw.size());
+        frame += lz4_compress(raw.data(), raw.size());
+        if (frame.size() >= raw.size()) {
+            for (size_t k = i; k < j; ++k) {
+                output[k].packed = true;
+            }
+            i = j;
+            continue;
+        }
+        seal_frame(frame);
+
+        size_t saved = raw.size() - frame.size();
+        bytes_saved_ += saved;
+        connection.queued_bytes -= saved;
+        connection.output_bytes -= saved;
+        output.erase(output.begin() + static_cast<std::ptrdiff_t>(i), output.begin() + static_cast<std::ptrdiff_t>(j));
+        output.insert(output.begin() + static_cast<std::ptrdiff_t>(i), Frame{std::move(frame), {}, messages, true});
+        ++i;
+    }
+}
+
+bool RemoteTransport::flush(Connection& connection, int fd) {
+    if (connection.outbound && options_.compress_bytes > 0) {
+        compress(connection);
+    }
+    while (!connection.output.empty()) {
+        // 一次系统调用发出多个帧的帧头和附件（第一个帧可能已经发出一部分）；
+        // 遇到大的文件附件时停下，先发出前面的片段，再单独sendfile
+        iovec iov[kMaxIov];
+        int count = 0;
+        const Buffer* file = nullptr;
+        size_t skip = connection.output_offset;
+        auto gather = [&](const char* data, size_t size) {
+            if (skip >= size) {
+                skip -= size;
+                return true;
+            }
+            if (count == kMaxIov) {
+                return false;
+            }
+            iov[count].iov_base = const_cast<char*>(data) + skip;
+            iov[count].iov_len = size - skip;
+            skip = 0;
+            ++count;
+            return true;
+        };
+        for (auto it = connection.output.begin(); it != connection.output.end() && !file && count < kMaxIov; ++it) {
+            if (!gather(it->data.data(), it->data.size())) {
+                break;
+            }
+            for (const auto& buffer : it->attachments) {
+                if (buffer.file_descriptor() >= 0 && skip < buffer.size() && buffer.size() - skip >= kSendfileBytes) {
+                    file = &buffer;
+                    break;
+                }
+                if (!gather(buffer.data(), buffer.size())) {
+                    break;
+                }
+            }
+        }
+
+        ssize_t n;
+        if (count > 0) {
+            msghdr header{};
+            header.msg_iov = iov;
+            header.msg_iovlen = static_cast<size_t>(count);
+            n = ::sendmsg(fd, &header, MSG_NOSIGNAL);
+        } else {
+            off_t offset = static_cast<off_t>(file->file_offset() + static_cast<int64_t>(skip));
+            n = ::sendfile(fd, file->file_descriptor(), &offset, file->size() - skip);
+            if (n < 0 && errno == EPIPE) {
+                sigset_t sigpipe;
+                sigemptyset(&sigpipe);
+                sigaddset(&sigpipe, SIGPIPE);
+                timespec zero{0, 0};
+                sigtimedwait(&sigpipe, nullptr, &zero);
+            }
+        }
+        if (n < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            return errno == EAGAIN || errno == EWOULDBLOCK;
+        }
+        ++write_calls_;
+        bytes_sent_ += static_cast<uint64_t>(n);
+
+        size_t written = static_cast<size_t>(n);
+        while (written > 0) {
+            Frame& frame = connection.output.front();
+            size_t size = frame.size();
+            size_t left = size - connection.output_offset;
+            if (written < left) {
+                connection.output_offset += written;
+                break;
+            }
+            written -= left;
+            messages_sent_ += frame.messages;
+            connection.queued_bytes -= size;
+            connection.output_bytes -= size;
+            connection.output_offset = 0;
+            connection.output.pop_front();
+        }
+    }
+    return true;
+}
+
+bool RemoteTransport::receive(Connection& connection, int fd, std::vector<std::pair<int, Message>>& received) {
+    char buffer[65536];
+    for (;;) {
+        // 正在接收大帧时直接读入它的Buffer，否则读入栈上的缓冲区再追加到input
+        bool direct = !connection.large.empty();
+        char* into = direct ? connection.large.mutable_data() + connection.large_filled : buffer;
+        size_t room = direct ? connection.large.size() - connection.large_filled : sizeof(buffer);
+        ssize_t n = ::recv(fd, into, room, 0);
+        if (n < 0 && errno == EINTR) {
+            continue;
+        }
+        if (n < 0) {
+            return errno == EAGAIN || errno == EWOULDBLOCK;
+        }
+        if (n == 0) {
+            return false;
+        }
+        if (direct) {
+            connection.large_filled += static_cast<size_t>(n);
+        } else {
+            connection.input.append(buffer, static_cast<size_t>(n));
+        }
+        if (!parse_input(connection, fd, received)) {
+            return false;
+        }
+    }
+}
+
+bool RemoteTransport::parse_input(Connection& connection, int fd, std::vector<std::pair<int, Message>>& received) {
+    try {
+        if (!connection.large.empty()) {
+            if (connection.large_filled < connection.large.size()) {
+                return true;
+            }
+            Buffer frame = std::move(connection.large);
+            connection.large = Buffer();
+            connection.large_filled = 0;
+            accept(connection, fd, frame.data(), frame.size(), &frame, received);
+            return true;
+        }
+
+        size_t offset = 0;
+        while (connection.input.size() - offset >= 4) {
+            size_t length = frame_length(connection.input.data() + offset);
+            if (length == 0 || length > options_.max_frame_bytes) {
+                throw std::runtime_error("invalid " + std::to_string(length) + "-byte frame");
+            }
+            size_t available = connection.input.size() - offset - 4;
+            if (available < length) {
+                // 大帧的其余部分直接读入池中的块，解码出的Buffer负载引用它
+                if (length >= kDirectReceiveBytes) {
+                    connection.large = Buffer::allocate(length);
+                    std::memcpy(connection.large.mutable_data(), connection.input.data() + offset + 4, available);
+                    connection.large_filled = available;
+                    offset = connection.input.size();
+                }
+                break;
+            }
+            accept(connection, fd, connection.input.data() + offset + 4, length, nullptr, received);
+            offset += 4 + length;
+        }
+        connection.input.erase(0, offset);
+    } catch (const std::exception& e) {
+        if (log_enabled(LogLevel::WARN)) {
+            std::cerr << "Closing remote connection: " << e.what() << std::endl;
+        }
+        return false;
+    }
+    return true;
+}
+
+void RemoteTransport::accept(Connection& connection, int fd, const char* data, size_t size, const Buffer* backing,
+                             std::vector<std::pair<int, Message>>& received) {
+    // 主动建立的连接上只会收到额度，接受的连接上只会收到消息
+    auto kind = static_cast<uint8_t>(data[0]);
+    const auto* body = reinterpret_cast<const uint8_t*>(data + 1);
+    Reader reader{body, body + size - 1};
+    if (connection.outbound && kind == FRAME_CREDIT) {
+        size_t count = static_cast<size_t>(reader.varint());
+        grant(connection, reader.string(), count);
+    } else if (!connection.outbound && kind == FRAME_MESSAGE) {
+        Message message = decode(data + 1, size - 1, backing);
+        ++connection.unconsumed[message.get_target_id()];
+        received.emplace_back(fd, std::move(message));
+        ++messages_received_;
+    } else if (!connection.outbound && kind == FRAME_COMPRESSED) {
+        uint64_t original = reader.varint();
+        if (original > options_.max_frame_bytes) {
+            throw std::runtime_error("Compressed batch exceeds the frame limit");
+        }
+        std::string raw;
+        if (!lz4_decompress(reinterpret_cast<const char*>(reader.data), static_cast<size_t>(reader.end - reader.data),
+                            static_cast<size_t>(original), raw)) {
+            throw std::runtime_error("Corrupt compressed batch");
+        }
+        // 批次由完整的消息帧组成
+        size_t offset = 0;
+        while (offset < raw.size()) {
+            size_t length = raw.size() - offset >= 4 ? frame_length(raw.data() + offset) : 0;
+            if (length == 0 || raw.size() - offset - 4 < length ||
+                static_cast<uint8_t>(raw[offset + 4]) != FRAME_MESSAGE) {
+                throw std::runtime_error("Malformed compressed batch");
+            }
+            accept(connection, fd, raw.data() + offset + 4, length, nullptr, received);
+            offset += 4 + length;
+        }
+    } else {
+        throw std::runtime_error("Unexpected frame type " + std::to_string(kind));
+    }
+}
+
+void RemoteTransport::grant(Connection& connection, const std::string& name, size_t count) {
+    auto it = connection.targets.find(name);
+    if (it == connection.targets.end()) {
+        return;
+    }
+    Target& target = it->second;
+    size_t returned = std::min(count, target.in_flight);
+    target.in_flight -= returned;
+    connection.in_flight -= std::min(returned, connection.in_flight);
+    if (target.in_flight == 0 && target.waiting.empty()) {
+        connection.targets.erase(it);
+    }
+    release(connection);
+}
+
+void RemoteTransport::release(Connection& connection) {
+    // 轮流放行等待额度的目标，直到连接的额度用完
+    for (size_t rounds = connection.blocked.size(); rounds > 0 && connection.in_flight < options_.link_credits;
+         --rounds) {
+        std::string name = std::move(connection.blocked.front());
+        connection.blocked.pop_front();
+        Target& target = connection.targets[name];
+        while (!target.waiting.empty() && connection.in_flight < options_.link_credits &&
+               (options_.target_credits == 0 || target.in_flight < options_.target_credits)) {
+            enqueue(connection, std::move(target.waiting.front()));
+            target.waiting.pop_front();
+            ++target.in_flight;
+            ++connection.in_flight;
+        }
+        if (!target.waiting.empty()) {
+            connection.blocked.push_back(std::move(name));
+        }
+    }
+}
+
+bool RemoteTransport::return_credits() {
+    auto event_loop = event_loop_.lock();
+    std::map<std::string, size_t> depths;
+    bool remaining = false;
+    for (auto& [fd, connection] : connections_) {
+        for (auto it = connection.unconsumed.begin(); it != connection.unconsumed.end();) {
+            auto depth = depths.find(it->first);
+            if (depth == depths.end()) {
+                size_t count = 0;
+                if (event_loop) {
+                    if (auto actor = event_loop->find_actor(it->first)) {
+                        count = actor->message_count();
+                    }
+                }
+                depth = depths.emplace(it->first, count).first;
+            }
+
+            // 邮箱中剩下的消息按最坏情况都算作这个连接发来的（端点和无法投递的消息没有邮箱，全部返还）
+            size_t consumed = it->second - std::min(it->second, depth->second);
+            if (consumed > 0) {
+                std::string frame = open_frame(FRAME_CREDIT);
+                put_varint(frame, consumed);
+                put_string(frame, it->first);
+                seal_frame(frame);
+                connection.queued_bytes += frame.size();
+                enqueue(connection, Frame{std::move(frame), {}, 0, false});
+                it->second -= consumed;
+            }
+            if (it->second == 0) {
+                it = connection.unconsumed.erase(it);
+            } else {
+                remaining = true;
+                ++it;
+            }
+        }
+    }
+    return remaining;
+}
+
+void RemoteTransport::close_connection(int fd) {
+    auto it = connections_.find(fd);
+    if (it == connections_.end()) {
+        return;
+    }
+    Connection& connection = it->second;
+    if (connection.outbound) {
+        auto outbound = outbound_.find(connection.node);
+        if (outbound != outbound_.end() && outbound->second == fd) {
+            outbound_.erase(outbound);
+        }
+        size_t dropped = 0;
+        for (const auto& frame : connection.output) {
+            dropped += frame.messages;
+        }
+        for (const auto& [name, target] : connection.targets) {
+            dropped += target.waiting.size();
+        }
+        if (dropped > 0) {
+            messages_dropped_ += dropped;
+            if (log_enabled(LogLevel::WARN)) {
+                std::cerr << "Connection to " << connection.node << " closed, dropped " << dropped
+                          << " queued messages" << std::endl;
+            }
+        }
+    }
+    ::close(fd);
+    connections_.erase(it);
+}
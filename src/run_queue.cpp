@@ -0,0 +1,137 @@
+#include "run_queue.h"
+#include "actor.h"
+#include "scheduler.h"
+#include <algorithm>
+
+RunQueues::RunQueues(size_t worker_count) {
+    resize(worker_count);
+}
+
+RunQueues::~RunQueues() {
+    clear();
+}
+
+void RunQueues::push(std::shared_ptr<Actor> actor) {
+    std::shared_lock<std::shared_mutex> layout(layout_mutex_);
+    Queue& queue = queue_for(*actor);
+    std::lock_guard<std::mutex> lock(queue.mutex);
+    link(queue, std::move(actor));
+}
+
+void RunQueues::remove(Actor& actor) {
+    // 最后一个引用可能就是队列持有的，在锁外释放
+    std::shared_ptr<Actor> removed;
+    std::shared_lock<std::shared_mutex> layout(layout_mutex_);
+    Queue& queue = queue_for(actor);
+    std::lock_guard<std::mutex> lock(queue.mutex);
+    removed = unlink(queue, actor);
+}
+
+std::shared_ptr<Actor> RunQueues::pop(size_t worker_index, Scheduler* scheduler, size_t& ready) {
+    std::shared_lock<std::shared_mutex> layout(layout_mutex_);
+    Queue& queue = *queues_[worker_index % queues_.size()];
+    std::lock_guard<std::mutex> lock(queue.mutex);
+    ready = queue.members.size();
+    if (!queue.head) {
+        return nullptr;
+    }
+
+    Actor* chosen = queue.head;
+    if (scheduler) {
+        std::shared_ptr<Actor> picked = scheduler->next_actor(queue.members);
+        // 调度器只能从成员中挑选
+        size_t index = picked ? picked->run_hook_.index : RunQueueHook::npos;
+        if (index >= queue.members.size() || queue.members[index] != picked) {
+            return nullptr;
+        }
+        chosen = picked.get();
+    }
+    return unlink(queue, *chosen);
+}
+
+void RunQueues::resize(size_t worker_count) {
+    worker_count = std::max<size_t>(1, worker_count);
+    std::unique_lock<std::shared_mutex> layout(layout_mutex_);
+    if (queues_.size() == worker_count) {
+        return;
+    }
+
+    std::vector<std::shared_ptr<Actor>> ready;
+    for (auto& queue : queues_) {
+        while (queue->head) {
+            ready.push_back(unlink(*queue, *queue->head));
+        }
+    }
+    queues_.clear();
+    for (size_t i = 0; i < worker_count; ++i) {
+        queues_.push_back(std::make_unique<Queue>());
+    }
+    for (auto& actor : ready) {
+        Queue& queue = queue_for(*actor);
+        link(queue, std::move(actor));
+    }
+}
+
+void RunQueues::clear() {
+    // 在锁外释放引用，Actor析构时可能再访问队列
+    std::vector<std::shared_ptr<Actor>> released;
+    std::unique_lock<std::shared_mutex> layout(layout_mutex_);
+    for (auto& queue : queues_) {
+        while (queue->head) {
+            released.push_back(unlink(*queue, *queue->head));
+        }
+    }
+}
+
+size_t RunQueues::worker_count() const {
+    std::shared_lock<std::shared_mutex> layout(layout_mutex_);
+    return queues_.size();
+}
+
+RunQueues::Queue& RunQueues::queue_for(const Actor& actor) const {
+    return *queues_[actor.get_serial() % queues_.size()];
+}
+
+void RunQueues::link(Queue& queue, std::shared_ptr<Actor> actor) {
+    RunQueueHook& hook = actor->run_hook_;
+    if (hook.index != RunQueueHook::npos) {
+        return;
+    }
+    hook.prev = queue.tail;
+    hook.next = nullptr;
+    if (queue.tail) {
+        queue.tail->run_hook_.next = actor.get();
+    } else {
+        queue.head = actor.get();
+    }
+    queue.tail = actor.get();
+    hook.index = queue.members.size();
+    queue.members.push_back(std::move(actor));
+}
+
+std::shared_ptr<Actor> RunQueues::unlink(Queue& queue, Actor& actor) {
+    RunQueueHook& hook = actor.run_hook_;
+    if (hook.index == RunQueueHook::npos) {
+        return nullptr;
+    }
+    if (hook.prev) {
+        hook.prev->run_hook_.next = hook.next;
+    } else {
+        queue.head = hook.next;
+    }
+    if (hook.next) {
+        hook.next->run_hook_.prev = hook.prev;
+    } else {
+        queue.tail = hook.prev;
+    }
+
+    // 成员数组中用最后一个元素填补空位
+    std::shared_ptr<Actor> owned = std::move(queue.members[hook.index]);
+    if (hook.index + 1 != queue.members.size()) {
+        queue.members[hook.index] = std::move(queue.members.back());
+        queue.members[hook.index]->run_hook_.index = hook.index;
+    }
+    queue.members.pop_back();
+    hook = RunQueueHook{};
+    return owned;
+}
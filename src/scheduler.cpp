@@ -1,6 +1,7 @@
 #include "scheduler.h"
 #include "actor.h"
 #include "message.h"
+#include "clock.h"
 #include <algorithm>
 #include <limits>
 #include <iostream>
@@ -91,7 +92,7 @@ std::shared_ptr<Actor> FairScheduler::next_actor(const std::vector<std::shared_p
         return nullptr;
     }
     
-    auto now = std::chrono::system_clock::now();
+    auto now = Clock::current().now();
     
     // 首先检查是否有长时间未被调度的Actor
     for (const auto& actor : actors) {
@@ -125,4 +126,35 @@ std::shared_ptr<Actor> FairScheduler::next_actor(const std::vector<std::shared_p
     last_scheduled_[oldest_scheduled->get_id()] = now;
     
     return oldest_scheduled;
-} 
\ No newline at end of file
+}
+
+// RandomScheduler Implementation
+RandomScheduler::RandomScheduler(uint64_t seed) : generator_(seed) {}
+
+std::shared_ptr<Actor> RandomScheduler::next_actor(const std::vector<std::shared_ptr<Actor>>& actors) {
+    if (actors.empty()) {
+        return nullptr;
+    }
+    
+    // 不使用std::uniform_int_distribution，它的实现在不同标准库之间不一致
+    return actors[generator_() % actors.size()];
+}
+
+std::shared_ptr<Scheduler> create_scheduler(const std::string& name, uint64_t seed) {
+    if (name == "round-robin") {
+        return std::make_shared<RoundRobinScheduler>();
+    }
+    if (name == "priority") {
+        return std::make_shared<PriorityScheduler>();
+    }
+    if (name == "message-priority") {
+        return std::make_shared<MessagePriorityScheduler>();
+    }
+    if (name == "fair") {
+        return std::make_shared<FairScheduler>();
+    }
+    if (name == "random") {
+        return std::make_shared<RandomScheduler>(seed);
+    }
+    return nullptr;
+}
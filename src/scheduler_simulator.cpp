@@ -0,0 +1,246 @@
+#include "scheduler_simulator.h"
+#include "actor.h"
+#include "clock.h"
+#include "message.h"
+#include "scheduler.h"
+#include <algorithm>
+#include <deque>
+#include <map>
+#include <queue>
+#include <set>
+#include <unordered_map>
+
+namespace {
+    // 代理Actor：只负责持有邮箱，处理函数什么也不做
+    class ProxyActor : public Actor {
+    public:
+        ProxyActor(const std::string& name, const std::set<std::string>& types)
+            : Actor(name, std::weak_ptr<EventLoop>()) {
+            for (const auto& type : types) {
+                register_handler(type, [](const Message&) {});
+            }
+        }
+    };
+
+    struct ProxyState {
+        std::shared_ptr<Actor> actor;
+        std::deque<size_t> pending;  // 邮箱中消息对应的投递记录下标（FIFO）
+        bool busy = false;
+        std::vector<int64_t> waits;
+        double stretch_sum = 0;
+        ActorLatencyStats stats;
+    };
+
+    struct Completion {
+        int64_t finish_ns;
+        size_t proxy;
+
+        bool operator>(const Completion& other) const { return finish_ns > other.finish_ns; }
+    };
+
+    int64_t percentile(const std::vector<int64_t>& sorted, double q) {
+        if (sorted.empty()) {
+            return 0;
+        }
+        size_t index = static_cast<size_t>(q * static_cast<double>(sorted.size() - 1) + 0.5);
+        return sorted[std::min(index, sorted.size() - 1)];
+    }
+}
+
+SchedulerSimulator::SchedulerSimulator(std::vector<TraceEvent> events, Options options)
+    : options_(std::move(options)) {
+    recorded_costs_ = pair_handler_costs(events);
+    for (auto& event : events) {
+        if (event.kind == TraceEvent::Kind::DELIVERY) {
+            deliveries_.push_back(std::move(event));
+        }
+    }
+
+    // 轨迹中的时间戳来自多个线程，按到达时间稳定排序
+    std::vector<size_t> order(deliveries_.size());
+    for (size_t i = 0; i < order.size(); ++i) {
+        order[i] = i;
+    }
+    std::stable_sort(order.begin(), order.end(), [this](size_t a, size_t b) {
+        return deliveries_[a].timestamp_ns < deliveries_[b].timestamp_ns;
+    });
+    std::vector<TraceEvent> sorted_deliveries;
+    std::vector<int64_t> sorted_costs;
+    for (size_t index : order) {
+        sorted_deliveries.push_back(std::move(deliveries_[index]));
+        sorted_costs.push_back(recorded_costs_[index]);
+    }
+    deliveries_ = std::move(sorted_deliveries);
+    recorded_costs_ = std::move(sorted_costs);
+
+    if (options_.worker_count == 0) {
+        options_.worker_count = 1;
+    }
+}
+
+SchedulerSimulationReport SchedulerSimulator::run(const std::string& scheduler_name,
+                                                  const std::shared_ptr<Scheduler>& scheduler) const {
+    SchedulerSimulationReport report;
+    report.scheduler = scheduler_name;
+    if (deliveries_.empty() || !scheduler) {
+        return report;
+    }
+
+    const int64_t base_ns = deliveries_.front().timestamp_ns;
+    const Clock::time_point base_time(
+        std::chrono::duration_cast<Clock::duration>(std::chrono::nanoseconds(base_ns)));
+    VirtualClock clock(base_time);
+    // 仿真在当前线程上进行，只在这个线程上安装虚拟时钟
+    ClockScope clock_scope(clock);
+
+    // 为每个目标创建代理Actor
+    std::map<std::string, std::set<std::string>> types_by_target;
+    for (const auto& delivery : deliveries_) {
+        types_by_target[delivery.target_id].insert(delivery.type);
+    }
+
+    std::vector<ProxyState> proxies;
+    std::unordered_map<std::string, size_t> proxy_by_target;
+    std::unordered_map<const Actor*, size_t> proxy_by_actor;
+    for (const auto& [target, types] : types_by_target) {
+        ProxyState state;
+        state.actor = std::make_shared<ProxyActor>(target, types);
+        state.actor->initialize();
+        state.actor->start();
+        state.stats.actor_id = target;
+        proxy_by_target[target] = proxies.size();
+        proxy_by_actor[state.actor.get()] = proxies.size();
+        proxies.push_back(std::move(state));
+    }
+
+    std::priority_queue<Completion, std::vector<Completion>, std::greater<Completion>> completions;
+    std::vector<std::shared_ptr<Actor>> candidates;
+    std::vector<int64_t> all_waits;
+    size_t free_workers = options_.worker_count;
+    size_t next_arrival = 0;
+    int64_t now = 0;
+
+    while (true) {
+        // 1. 释放已经处理完成的Actor和worker
+        while (!completions.empty() && completions.top().finish_ns <= now) {
+            proxies[completions.top().proxy].busy = false;
+            ++free_workers;
+            completions.pop();
+        }
+
+        // 2. 把已到达的消息放入邮箱
+        while (next_arrival < deliveries_.size() &&
+               deliveries_[next_arrival].timestamp_ns - base_ns <= now) {
+            const auto& delivery = deliveries_[next_arrival];
+            auto& proxy = proxies[proxy_by_target[delivery.target_id]];
+            proxy.actor->receive(Message(delivery.type, delivery.sender_id,
+                                         proxy.actor->get_id(), {}, delivery.priority));
+            proxy.pending.push_back(next_arrival);
+            ++next_arrival;
+        }
+
+        // 3. 空闲worker向调度器请求下一个Actor
+        while (free_workers > 0) {
+            candidates.clear();
+            for (const auto& proxy : proxies) {
+                if (!proxy.busy && !proxy.pending.empty()) {
+                    candidates.push_back(proxy.actor);
+                }
+            }
+            if (candidates.empty()) {
+                break;
+            }
+
+            auto chosen = scheduler->next_actor(candidates);
+            if (!chosen) {
+                break;
+            }
+            auto& proxy = proxies[proxy_by_actor[chosen.get()]];
+
+            size_t index = proxy.pending.front();
+            proxy.pending.pop_front();
+            proxy.actor->process_next_message();
+
+            const auto& delivery = deliveries_[index];
+            int64_t wait = now - (delivery.timestamp_ns - base_ns);
+            int64_t cost = options_.cost_model ? options_.cost_model(delivery, recorded_costs_[index])
+                                               : recorded_costs_[index];
+            cost = std::max<int64_t>(0, cost);
+
+            proxy.waits.push_back(wait);
+            double service = static_cast<double>(std::max<int64_t>(cost, 1000));
+            proxy.stretch_sum += (static_cast<double>(wait) + service) / service;
+            proxy.stats.busy_ns += cost;
+            if (std::chrono::nanoseconds(wait) > options_.starvation_threshold) {
+                ++proxy.stats.starved_messages;
+            }
+            all_waits.push_back(wait);
+
+            proxy.busy = true;
+            --free_workers;
+            completions.push({now + cost, proxy_by_actor[chosen.get()]});
+            report.makespan_ns = std::max(report.makespan_ns, now + cost);
+        }
+
+        // 4. 推进仿真时间到下一个事件
+        int64_t next_time = -1;
+        if (next_arrival < deliveries_.size()) {
+            next_time = deliveries_[next_arrival].timestamp_ns - base_ns;
+        }
+        if (!completions.empty() && (next_time < 0 || completions.top().finish_ns < next_time)) {
+            next_time = completions.top().finish_ns;
+        }
+        if (next_time < 0) {
+            break;
+        }
+        now = std::max(now, next_time);
+        clock.advance_to(base_time + std::chrono::duration_cast<Clock::duration>(std::chrono::nanoseconds(now)));
+    }
+
+    // 汇总统计
+    double sum = 0;
+    double sum_squares = 0;
+    size_t active = 0;
+    for (auto& proxy : proxies) {
+        auto& stats = proxy.stats;
+        std::sort(proxy.waits.begin(), proxy.waits.end());
+        stats.messages = proxy.waits.size();
+        if (stats.messages == 0) {
+            continue;
+        }
+
+        stats.wait_p50_ns = percentile(proxy.waits, 0.50);
+        stats.wait_p99_ns = percentile(proxy.waits, 0.99);
+        stats.wait_max_ns = proxy.waits.back();
+        double total = 0;
+        for (int64_t wait : proxy.waits) {
+            total += static_cast<double>(wait);
+        }
+        stats.wait_mean_ns = total / static_cast<double>(stats.messages);
+        stats.stretch_mean = proxy.stretch_sum / static_cast<double>(stats.messages);
+
+        sum += stats.stretch_mean;
+        sum_squares += stats.stretch_mean * stats.stretch_mean;
+        ++active;
+        report.starved_messages += stats.starved_messages;
+        if (stats.starved_messages > 0) {
+            ++report.starved_actors;
+        }
+        report.actors.push_back(stats);
+    }
+
+    report.jain_fairness = sum_squares > 0 ? (sum * sum) / (static_cast<double>(active) * sum_squares) : 1.0;
+
+    std::sort(all_waits.begin(), all_waits.end());
+    report.messages = all_waits.size();
+    report.wait_p50_ns = percentile(all_waits, 0.50);
+    report.wait_p90_ns = percentile(all_waits, 0.90);
+    report.wait_p99_ns = percentile(all_waits, 0.99);
+    report.wait_max_ns = all_waits.empty() ? 0 : all_waits.back();
+
+    std::sort(report.actors.begin(), report.actors.end(),
+              [](const ActorLatencyStats& a, const ActorLatencyStats& b) {
+                  return a.wait_max_ns > b.wait_max_ns;
+              });
+    return report;
+}
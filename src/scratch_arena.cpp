@@ -0,0 +1,68 @@
+#include "scratch_arena.h"
+#include <algorithm>
+#include <cstdint>
+#include <new>
+
+ScratchArena::ScratchArena(size_t block_bytes, size_t max_retained_bytes)
+    : block_bytes_(std::max<size_t>(block_bytes, 64)), max_retained_bytes_(max_retained_bytes) {
+}
+
+ScratchArena::~ScratchArena() {
+    for (const auto& block : blocks_) {
+        ::operator delete(block.data);
+    }
+}
+
+void ScratchArena::reset() {
+    // 从第一个块之后开始，超过保留上限的块归还给系统（第一个块总是保留）
+    size_t retained = blocks_.empty() ? 0 : blocks_[0].size;
+    size_t kept = blocks_.empty() ? 0 : 1;
+    for (size_t i = 1; i < blocks_.size(); ++i) {
+        if (retained + blocks_[i].size <= max_retained_bytes_) {
+            retained += blocks_[i].size;
+            blocks_[kept++] = blocks_[i];
+        } else {
+            ::operator delete(blocks_[i].data);
+        }
+    }
+    blocks_.resize(kept);
+
+    current_ = 0;
+    next_ = blocks_.empty() ? nullptr : blocks_[0].data;
+    end_ = blocks_.empty() ? nullptr : blocks_[0].data + blocks_[0].size;
+    used_ = 0;
+}
+
+size_t ScratchArena::capacity() const {
+    size_t total = 0;
+    for (const auto& block : blocks_) {
+        total += block.size;
+    }
+    return total;
+}
+
+void* ScratchArena::do_allocate(size_t bytes, size_t alignment) {
+    for (;;) {
+        if (next_) {
+            auto address = reinterpret_cast<uintptr_t>(next_);
+            size_t padding = (alignment - address % alignment) % alignment;
+            if (padding <= static_cast<size_t>(end_ - next_) && bytes <= static_cast<size_t>(end_ - next_) - padding) {
+                char* result = next_ + padding;
+                next_ = result + bytes;
+                used_ += padding + bytes;
+                return result;
+            }
+        }
+
+        // 换到下一个保留的块；没有时分配新块，放在当前块之后
+        size_t next_block = next_ ? current_ + 1 : current_;
+        if (next_block >= blocks_.size() || blocks_[next_block].size < bytes + alignment) {
+            size_t size = std::max(block_bytes_, bytes + alignment);
+            Block block{static_cast<char*>(::operator new(size)), size};
+            blocks_.insert(blocks_.begin() + static_cast<std::ptrdiff_t>(std::min(next_block, blocks_.size())), block);
+        }
+        current_ = next_block;
+        next_ = blocks_[current_].data;
+        end_ = next_ + blocks_[current_].size;
+    }
+}
@@ -0,0 +1,600 @@
+#include "sharding.h"
+#include "event_loop.h"
+#include "logging.h"
+#include "membership.h"
+#include "message.h"
+#include "remote.h"
+#include <algorithm>
+#include <iostream>
+#include <mutex>
+#include <stdexcept>
+
+namespace {
+    // 消息被区域转发的次数，只在节点之间传递，投递给实体前去掉
+    constexpr const char* kHopsField = "shard_hops";
+
+    uint64_t mix(uint64_t x) {
+        x ^= x >> 30;
+        x *= 0xbf58476d1ce4e5b9ULL;
+        x ^= x >> 27;
+        x *= 0x94d049bb133111ebULL;
+        x ^= x >> 31;
+        return x;
+    }
+
+    size_t hops_of(const Message& message) {
+        return message.get_payload_value_or<uint32_t>(kHopsField, 0);
+    }
+
+    // 换一个目标重新构造消息（保留优先级和追踪上下文），hops为0时去掉转发次数
+    Message retarget(const Message& message, const std::string& target, size_t hops) {
+        auto payload = message.get_pmr_payload();
+        if (hops == 0) {
+            payload.erase(kHopsField);
+        } else {
+            payload[kHopsField] = static_cast<uint32_t>(hops);
+        }
+        Message result(message.get_type(), message.get_sender_id(), target, std::move(payload),
+                       message.get_priority());
+        result.set_trace_context(message.get_trace_context());
+        return result;
+    }
+}
+
+uint64_t shard_hash(const std::string& key) {
+    uint64_t hash = 14695981039346656037ULL;
+    for (unsigned char c : key) {
+        hash ^= c;
+        hash *= 1099511628211ULL;
+    }
+    return mix(hash);
+}
+
+HashRing::HashRing(size_t virtual_nodes) : virtual_nodes_(std::max<size_t>(1, virtual_nodes)) {
+}
+
+void HashRing::set_nodes(std::vector<std::string> nodes) {
+    std::sort(nodes.begin(), nodes.end());
+    nodes.erase(std::unique(nodes.begin(), nodes.end()), nodes.end());
+    nodes_ = std::move(nodes);
+
+    points_.clear();
+    points_.reserve(nodes_.size() * virtual_nodes_);
+    for (uint32_t i = 0; i < nodes_.size(); ++i) {
+        for (size_t v = 0; v < virtual_nodes_; ++v) {
+            points_.emplace_back(shard_hash(nodes_[i] + "#" + std::to_string(v)), i);
+        }
+    }
+    std::sort(points_.begin(), points_.end());
+}
+
+const std::string& HashRing::node_for(uint64_t hash) const {
+    static const std::string none;
+    if (points_.empty()) {
+        return none;
+    }
+    auto it = std::lower_bound(points_.begin(), points_.end(), std::make_pair(hash, uint32_t{0}));
+    if (it == points_.end()) {
+        it = points_.begin();
+    }
+    return nodes_[it->second];
+}
+
+ShardRegion::ShardRegion(ShardingOptions options, EntityFactory factory, std::weak_ptr<EventLoop> event_loop,
+                         std::shared_ptr<RemoteTransport> transport)
+    : Actor(options.type_name + "-region", std::move(event_loop)),
+      options_(std::move(options)),
+      factory_(std::move(factory)),
+      transport_(std::move(transport)),
+      ring_(options_.virtual_nodes) {
+    if (options_.shard_count == 0) {
+        throw std::runtime_error("Shard count must be positive");
+    }
+    node_ = transport_->address();
+    endpoint_ = endpoint_name(options_.type_name);
+
+    // 启动时只知道自己，负责所有分片，但在交接完成或超时之前只缓冲
+    members_.push_back(node_);
+    ring_.set_nodes(members_);
+    shards_.resize(options_.shard_count);
+    shard_points_.resize(options_.shard_count);
+    for (size_t index = 0; index < shards_.size(); ++index) {
+        shard_points_[index] = shard_hash(std::to_string(index));
+        shards_[index].owner = node_;
+    }
+
+    for (const char* type : {Membership::kMemberUp, Membership::kMemberSuspect, Membership::kMemberDown,
+                             Membership::kMemberLeft}) {
+        register_handler(type, [this](const Message& message) { on_membership(message); });
+    }
+    register_handler(kEntityStopped, [this](const Message& message) { on_entity_stopped(message); });
+    register_handler(kHandoffTimeout, [this](const Message& message) { on_timeout(message); });
+}
+
+ShardRegion::~ShardRegion() {
+    transport_->add_endpoint(endpoint_, nullptr);
+}
+
+void ShardRegion::initialize() {
+    Actor::initialize();
+
+    std::weak_ptr<ShardRegion> self = std::static_pointer_cast<ShardRegion>(shared_from_this());
+    transport_->add_endpoint(endpoint_, [self](const Message& message) {
+        if (auto region = self.lock()) {
+            region->on_remote(message);
+        }
+    });
+
+    std::unique_lock<std::shared_mutex> lock(mutex_);
+    for (size_t index = 0; index < shards_.size(); ++index) {
+        if (shards_[index].mode == Mode::BUFFERING) {
+            schedule_timeout(index);
+        }
+    }
+}
+
+void ShardRegion::tell(const Message& message) {
+    if (!message.has_payload_key(options_.key_field)) {
+        throw std::runtime_error("Message " + message.get_type() + " has no entity key '" + options_.key_field + "'");
+    }
+
+    // 与Actor::send一样继承正在处理的消息的追踪上下文
+    if (!message.get_trace_context().valid() && current_trace_context().valid()) {
+        Message traced = message;
+        traced.set_trace_context(current_trace_context());
+        route(traced, false);
+        return;
+    }
+    route(message, false);
+}
+
+size_t ShardRegion::shard_of(const std::string& key) const {
+    return shard_hash(key) % shards_.size();
+}
+
+std::string ShardRegion::route_of(const std::string& key) const {
+    std::shared_lock<std::shared_mutex> lock(mutex_);
+    return shards_[shard_of(key)].route;
+}
+
+size_t ShardRegion::local_entities() const {
+    std::shared_lock<std::shared_mutex> lock(mutex_);
+    size_t count = 0;
+    for (const auto& shard : shards_) {
+        count += shard.entities.size();
+    }
+    return count;
+}
+
+ShardingStats ShardRegion::stats() const {
+    ShardingStats stats;
+    stats.spawned = spawned_;
+    stats.forwarded = forwarded_;
+    stats.buffered = buffered_;
+    stats.dropped = dropped_;
+    stats.handoffs = handoffs_;
+    stats.handoff_timeouts = handoff_timeouts_;
+    return stats;
+}
+
+void ShardRegion::route(const Message& message, bool from_remote) {
+    std::string key = message.get_payload_value<std::string>(options_.key_field);
+    size_t index = shard_of(key);
+
+    // 快速路径：实体已经存在，或者分片在其他节点上。持有共享锁投递，
+    // 开始交接（需要独占锁）时停止消息一定排在这条消息之后
+    {
+        std::shared_lock<std::shared_mutex> lock(mutex_);
+        const Shard& shard = shards_[index];
+        if (shard.mode == Mode::HOSTED) {
+            auto it = shard.entities.find(key);
+            if (it != shard.entities.end()) {
+                if (auto event_loop = event_loop_.lock()) {
+                    event_loop->deliver_message(retarget(message, it->second->get_id(), 0));
+                }
+                return;
+            }
+        } else if (shard.mode == Mode::REMOTE && !from_remote && !shard.route.empty() && shard.route != node_) {
+            forward(shard.route, message, 0);
+            return;
+        }
+    }
+
+    std::unique_lock<std::shared_mutex> lock(mutex_);
+    dispatch(index, key, message, from_remote);
+}
+
+void ShardRegion::dispatch(size_t index, const std::string& key, const Message& message, bool from_remote) {
+    Shard& shard = shards_[index];
+    switch (shard.mode) {
+        case Mode::HOSTED:
+            deliver_local(index, key, message);
+            return;
+        case Mode::BUFFERING:
+            // 本地发送者在交接完成之前仍经原所有者发送，与之前发出的消息保持顺序
+            if (!from_remote && !shard.route.empty()) {
+                forward(shard.route, message, 0);
+            } else {
+                hold(index, message);
+            }
+            return;
+        case Mode::HANDING_OFF:
+        case Mode::REMOTE: {
+            if (shard.route.empty() || shard.route == node_) {
+                hold(index, message);
+                return;
+            }
+            size_t hops = from_remote ? hops_of(message) + 1 : 0;
+            if (hops > options_.max_hops) {
+                // 各节点的视图暂时不一致，消息在节点之间来回转发，等路由变化后再发
+                hold(index, message);
+                return;
+            }
+            forward(shard.route, message, hops);
+            return;
+        }
+    }
+}
+
+void ShardRegion::forward(const std::string& node, const Message& message, size_t hops) {
+    transport_->send(node, retarget(message, endpoint_, hops));
+    ++forwarded_;
+}
+
+void ShardRegion::deliver_local(size_t index, const std::string& key, const Message& message) {
+    auto event_loop = event_loop_.lock();
+    if (!event_loop) {
+        return;
+    }
+    Shard& shard = shards_[index];
+    auto& entity = shard.entities[key];
+    if (!entity) {
+        entity = factory_(key, event_loop_);
+        if (!entity) {
+            shard.entities.erase(key);
+            ++dropped_;
+            return;
+        }
+
+        // 停止消息排在实体邮箱的最后，处理到它时之前的消息都已处理完
+        Actor* raw = entity.get();
+        std::weak_ptr<EventLoop> weak_loop = event_loop_;
+        std::string region_id = id_;
+        entity->register_handler(kStopEntity, [raw, weak_loop, region_id, key](const Message&) {
+            raw->stop();
+            if (auto loop = weak_loop.lock()) {
+                loop->deliver_message(Message(kEntityStopped, raw->get_id(), region_id, {{"key", key}}));
+            }
+        });
+        event_loop->register_actor(entity);
+        ++spawned_;
+    }
+    event_loop->deliver_message(retarget(message, entity->get_id(), 0));
+}
+
+void ShardRegion::hold(size_t index, const Message& message) {
+    Shard& shard = shards_[index];
+    if (shard.pending.size() >= options_.max_buffered) {
+        ++dropped_;
+        if (log_enabled(LogLevel::WARN)) {
+            std::cerr << "Shard " << index << " of " << options_.type_name << " buffer is full, dropping "
+                      << message.get_type() << std::endl;
+        }
+        return;
+    }
+    bool first = shard.pending.empty();
+    shard.pending.push_back(retarget(message, endpoint_, 0));
+    ++buffered_;
+
+    // 暂存的消息在超时后按当时的路由重发
+    if (first && shard.mode == Mode::REMOTE) {
+        ++shard.epoch;
+        schedule_timeout(index);
+    }
+}
+
+void ShardRegion::flush_pending(size_t index) {
+    std::vector<Message> pending;
+    pending.swap(shards_[index].pending);
+    for (const auto& message : pending) {
+        if (message.get_type() == kRouteProbe) {
+            handle_probe(index, message);
+        } else {
+            dispatch(index, message.get_payload_value<std::string>(options_.key_field), message, true);
+        }
+    }
+}
+
+void ShardRegion::schedule_timeout(size_t index) {
+    if (auto event_loop = event_loop_.lock()) {
+        Message timeout(kHandoffTimeout, id_, id_,
+                        {{"shard", static_cast<uint64_t>(index)}, {"epoch", shards_[index].epoch}});
+        event_loop->deliver_after(timeout, options_.handoff_timeout);
+    }
+}
+
+bool ShardRegion::is_member(const std::string& node) const {
+    return std::binary_search(members_.begin(), members_.end(), node);
+}
+
+void ShardRegion::on_membership(const Message& message) {
+    std::string node = message.get_payload_value<std::string>("node");
+    bool up = message.get_type() == Membership::kMemberUp || message.get_type() == Membership::kMemberSuspect;
+
+    std::unique_lock<std::shared_mutex> lock(mutex_);
+    auto it = std::lower_bound(members_.begin(), members_.end(), node);
+    bool present = it != members_.end() && *it == node;
+    if (up == present || node == node_) {
+        return;
+    }
+    if (up) {
+        members_.insert(it, node);
+    } else {
+        members_.erase(it);
+    }
+    if (log_enabled(LogLevel::INFO)) {
+        std::cout << "Shard region " << options_.type_name << " on " << node_ << ": " << members_.size()
+                  << " nodes after " << message.get_type() << " " << node << std::endl;
+    }
+    rebalance();
+}
+
+void ShardRegion::rebalance() {
+    ring_.set_nodes(members_);
+    for (size_t index = 0; index < shards_.size(); ++index) {
+        Shard& shard = shards_[index];
+        const std::string& owner = ring_.node_for(shard_points_[index]);
+
+        if (owner == shard.owner) {
+            // 正在经由的节点已经离开集群，探测不会再回来
+            bool waiting = shard.mode == Mode::BUFFERING || (shard.mode == Mode::REMOTE && shard.route != owner);
+            if (waiting && !shard.route.empty() && !is_member(shard.route)) {
+                if (shard.mode == Mode::BUFFERING) {
+                    host(index);
+                } else {
+                    switch_route(index, shard.route);
+                }
+            }
+            continue;
+        }
+
+        std::string previous = shard.route;
+        shard.owner = owner;
+        // 原路由节点还在集群中时继续经它发送，直到沿旧路由发出的探测得到回复
+        bool wait = !previous.empty() && previous != owner && previous != node_ && is_member(previous);
+        switch (shard.mode) {
+            case Mode::HOSTED:
+                begin_handoff(index);
+                break;
+            case Mode::HANDING_OFF:
+                shard.route = owner;
+                ++shard.epoch;
+                if (owner != node_) {
+                    flush_pending(index);
+                }
+                break;
+            case Mode::BUFFERING:
+                // 之前发出的探测回来时再切换到新所有者
+                shard.mode = Mode::REMOTE;
+                shard.route = wait ? previous : owner;
+                ++shard.epoch;
+                flush_pending(index);
+                if (wait) {
+                    schedule_timeout(index);
+                }
+                break;
+            case Mode::REMOTE:
+                ++shard.epoch;
+                if (owner == node_ && !wait) {
+                    host(index);
+                    break;
+                }
+                if (owner == node_) {
+                    shard.mode = Mode::BUFFERING;
+                }
+                shard.route = wait ? previous : owner;
+                if (wait) {
+                    send_probe(index, previous);
+                    schedule_timeout(index);
+                }
+                break;
+        }
+    }
+}
+
+void ShardRegion::begin_handoff(size_t index) {
+    Shard& shard = shards_[index];
+    shard.mode = Mode::HANDING_OFF;
+    shard.route = shard.owner;
+    ++shard.epoch;
+
+    auto event_loop = event_loop_.lock();
+    shard.draining = 0;
+    for (auto it = shard.entities.begin(); it != shard.entities.end();) {
+        if (event_loop && (it->second->is_running() || it->second->awaiting_first_message())) {
+            event_loop->deliver_message(Message(kStopEntity, id_, it->second->get_id(), {}, Message::Priority::LOW));
+            ++shard.draining;
+            ++it;
+        } else {
+            if (event_loop) {
+                event_loop->remove_actor(it->second->get_id());
+            }
+            it = shard.entities.erase(it);
+        }
+    }
+    if (shard.draining == 0) {
+        finish_handoff(index);
+    }
+}
+
+void ShardRegion::finish_handoff(size_t index) {
+    Shard& shard = shards_[index];
+    shard.draining = 0;
+    ++handoffs_;
+    std::vector<Message> probes;
+    probes.swap(shard.probes);
+
+    if (shard.owner == node_) {
+        // 交出期间分片又回到本节点：经本节点发送的消息都已处理，直接回复探测
+        host(index);
+        for (const auto& probe : probes) {
+            acknowledge(index, probe.get_payload_value<std::string>("origin"), node_);
+        }
+        return;
+    }
+
+    shard.mode = Mode::REMOTE;
+    shard.route = shard.owner;
+    ++shard.epoch;
+    flush_pending(index);
+
+    // 探测排在所有转发的消息之后到达新所有者
+    for (const auto& probe : probes) {
+        handle_probe(index, probe);
+    }
+    if (log_enabled(LogLevel::INFO)) {
+        std::cout << "Shard " << index << " of " << options_.type_name << " handed off from " << node_ << " to "
+                  << shard.owner << std::endl;
+    }
+}
+
+void ShardRegion::send_probe(size_t index, const std::string& via) {
+    transport_->send(via, Message(kRouteProbe, id_, endpoint_,
+                                  {{"shard", static_cast<uint64_t>(index)}, {"origin", node_}, {"via", via}}));
+}
+
+void ShardRegion::handle_probe(size_t index, const Message& probe) {
+    Shard& shard = shards_[index];
+    std::string origin = probe.get_payload_value<std::string>("origin");
+    std::string via = probe.get_payload_value<std::string>("via");
+    switch (shard.mode) {
+        case Mode::HOSTED:
+            // 本节点就是探测经由的原所有者，还没有开始交出
+            if (via == node_) {
+                shard.probes.push_back(probe);
+            } else {
+                acknowledge(index, origin, via);
+            }
+            return;
+        case Mode::HANDING_OFF:
+            shard.probes.push_back(probe);
+            return;
+        case Mode::BUFFERING:
+            // 自己的探测经原所有者回来了：原所有者转发的消息都已在缓冲区中
+            if (origin == node_) {
+                host(index);
+            } else {
+                hold(index, probe);
+            }
+            return;
+        case Mode::REMOTE: {
+            if (origin == node_) {
+                switch_route(index, via);
+                return;
+            }
+            size_t hops = hops_of(probe) + 1;
+            if (shard.route.empty() || shard.route == node_ || hops > options_.max_hops) {
+                hold(index, probe);
+                return;
+            }
+            transport_->send(shard.route, retarget(probe, endpoint_, hops));
+            return;
+        }
+    }
+}
+
+void ShardRegion::acknowledge(size_t index, const std::string& origin, const std::string& via) {
+    if (origin == node_) {
+        return;
+    }
+    transport_->send(origin, Message(kRouteAck, id_, endpoint_,
+                                     {{"shard", static_cast<uint64_t>(index)}, {"node", node_}, {"via", via}}));
+}
+
+void ShardRegion::switch_route(size_t index, const std::string& via) {
+    Shard& shard = shards_[index];
+    if (shard.mode != Mode::REMOTE || shard.route != via || shard.route == shard.owner) {
+        return;
+    }
+    shard.route = shard.owner;
+    ++shard.epoch;
+    flush_pending(index);
+}
+
+void ShardRegion::host(size_t index) {
+    Shard& shard = shards_[index];
+    shard.mode = Mode::HOSTED;
+    shard.route = node_;
+    ++shard.epoch;
+    flush_pending(index);
+}
+
+void ShardRegion::on_entity_stopped(const Message& message) {
+    std::string key = message.get_payload_value<std::string>("key");
+    size_t index = shard_of(key);
+
+    std::unique_lock<std::shared_mutex> lock(mutex_);
+    Shard& shard = shards_[index];
+    auto it = shard.entities.find(key);
+    if (it == shard.entities.end() || it->second->get_id() != message.get_sender_id()) {
+        return;
+    }
+    if (auto event_loop = event_loop_.lock()) {
+        event_loop->remove_actor(it->second->get_id());
+    }
+    shard.entities.erase(it);
+    if (shard.mode == Mode::HANDING_OFF && shard.draining > 0 && --shard.draining == 0) {
+        finish_handoff(index);
+    }
+}
+
+void ShardRegion::on_timeout(const Message& message) {
+    size_t index = static_cast<size_t>(message.get_payload_value<uint64_t>("shard"));
+    uint64_t epoch = message.get_payload_value<uint64_t>("epoch");
+
+    std::unique_lock<std::shared_mutex> lock(mutex_);
+    Shard& shard = shards_[index];
+    if (shard.epoch != epoch) {
+        return;
+    }
+    if (shard.mode == Mode::BUFFERING) {
+        if (!shard.route.empty()) {
+            ++handoff_timeouts_;
+            if (log_enabled(LogLevel::WARN)) {
+                std::cerr << "Shard " << index << " of " << options_.type_name << ": no hand-off from "
+                          << shard.route << " within " << options_.handoff_timeout.count() << " ms" << std::endl;
+            }
+        }
+        host(index);
+    } else if (shard.mode == Mode::REMOTE) {
+        if (shard.route != shard.owner) {
+            shard.route = shard.owner;
+            ++shard.epoch;
+        }
+        flush_pending(index);
+    }
+}
+
+void ShardRegion::on_remote(const Message& message) {
+    try {
+        if (message.get_type() == kRouteProbe || message.get_type() == kRouteAck) {
+            size_t index = static_cast<size_t>(message.get_payload_value<uint64_t>("shard"));
+            if (index >= shards_.size()) {
+                return;
+            }
+            std::unique_lock<std::shared_mutex> lock(mutex_);
+            if (message.get_type() == kRouteProbe) {
+                handle_probe(index, message);
+            } else {
+                switch_route(index, message.get_payload_value<std::string>("via"));
+            }
+            return;
+        }
+        route(message, true);
+    } catch (const std::exception& e) {
+        if (log_enabled(LogLevel::WARN)) {
+            std::cerr << "Shard region " << options_.type_name << " rejected remote message "
+                      << message.get_type() << ": " << e.what() << std::endl;
+        }
+    }
+}
@@ -0,0 +1,231 @@
+#include "shared_metrics.h"
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <fcntl.h>
+#include <stdexcept>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace {
+    // 槽位区从64字节对齐的位置开始
+    constexpr size_t kSlotsOffset = (sizeof(SharedMetricsHeader) + 63) / 64 * 64;
+
+    int64_t system_now_ns() {
+        return std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::system_clock::now().time_since_epoch()).count();
+    }
+
+    // 复制字符串并保证以'\0'结尾（过长时截断）
+    void copy_field(char* dest, size_t capacity, const std::string& value) {
+        size_t length = std::min(value.size(), capacity - 1);
+        std::memcpy(dest, value.data(), length);
+        std::memset(dest + length, 0, capacity - length);
+    }
+
+    std::string read_field(const char* field, size_t capacity) {
+        return std::string(field, strnlen(field, capacity));
+    }
+
+    std::string error_text(const std::string& what, const std::string& path) {
+        return what + " " + path + ": " + std::strerror(errno);
+    }
+}
+
+SharedMetricsSegment::SharedMetricsSegment(const std::string& path, uint32_t capacity, bool remove_on_close)
+    : path_(path), remove_on_close_(remove_on_close), size_(0), mapping_(nullptr),
+      header_(nullptr), slots_(nullptr) {
+    capacity = std::max<uint32_t>(1, capacity);
+    size_ = kSlotsOffset + static_cast<size_t>(capacity) * sizeof(SharedActorSlot);
+
+    int fd = ::open(path.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0644);
+    if (fd < 0) {
+        throw std::runtime_error(error_text("Cannot create metrics segment", path));
+    }
+    if (::ftruncate(fd, static_cast<off_t>(size_)) != 0) {
+        std::string error = error_text("Cannot size metrics segment", path);
+        ::close(fd);
+        throw std::runtime_error(error);
+    }
+    mapping_ = ::mmap(nullptr, size_, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    ::close(fd);
+    if (mapping_ == MAP_FAILED) {
+        mapping_ = nullptr;
+        throw std::runtime_error(error_text("Cannot map metrics segment", path));
+    }
+
+    // ftruncate得到的内容全为0，原子变量的初始值即为0
+    header_ = static_cast<SharedMetricsHeader*>(mapping_);
+    slots_ = reinterpret_cast<SharedActorSlot*>(static_cast<char*>(mapping_) + kSlotsOffset);
+
+    header_->major_version = kSharedMetricsMajorVersion;
+    header_->minor_version = kSharedMetricsMinorVersion;
+    header_->header_size = static_cast<uint32_t>(kSlotsOffset);
+    header_->slot_size = static_cast<uint32_t>(sizeof(SharedActorSlot));
+    header_->capacity = capacity;
+    header_->pid = static_cast<uint32_t>(::getpid());
+    header_->created_ns = system_now_ns();
+    header_->heartbeat_ns.store(header_->created_ns, std::memory_order_relaxed);
+
+    // 魔数最后写入：读取方看到魔数时其余字段已经就绪
+    std::atomic_thread_fence(std::memory_order_release);
+    std::memcpy(header_->magic, kSharedMetricsMagic, sizeof(kSharedMetricsMagic));
+}
+
+SharedMetricsSegment::~SharedMetricsSegment() {
+    if (mapping_) {
+        ::munmap(mapping_, size_);
+    }
+    if (remove_on_close_) {
+        ::unlink(path_.c_str());
+    }
+}
+
+std::string SharedMetricsSegment::default_path() {
+    const char* tmp = std::getenv("TMPDIR");
+    std::string directory = std::string(tmp && *tmp ? tmp : "/tmp") + "/actor_cpp_metrics";
+    ::mkdir(directory.c_str(), 0755);
+    return directory + "/" + std::to_string(::getpid());
+}
+
+SharedActorSlot* SharedMetricsSegment::allocate(const std::string& name, const std::string& id, uint64_t serial) {
+    std::lock_guard<std::mutex> lock(mutex_);
+
+    uint32_t index;
+    if (!free_slots_.empty()) {
+        index = free_slots_.back();
+        free_slots_.pop_back();
+    } else {
+        index = header_->slot_count.load(std::memory_order_relaxed);
+        if (index >= header_->capacity) {
+            header_->overflow_actors.fetch_add(1, std::memory_order_relaxed);
+            return nullptr;
+        }
+    }
+
+    SharedActorSlot* slot = &slots_[index];
+    slot->serial = serial;
+    copy_field(slot->name, sizeof(slot->name), name);
+    copy_field(slot->id, sizeof(slot->id), id);
+    slot->processed.store(0, std::memory_order_relaxed);
+    slot->handler_ns.store(0, std::memory_order_relaxed);
+    slot->mailbox_depth.store(0, std::memory_order_relaxed);
+    slot->enqueued.store(0, std::memory_order_relaxed);
+    slot->dropped.store(0, std::memory_order_relaxed);
+
+    // 先递增代数再发布状态，读取方据此识别槽位复用
+    slot->generation.fetch_add(1, std::memory_order_release);
+    slot->state.store(SharedActorSlot::LIVE, std::memory_order_release);
+
+    if (index == header_->slot_count.load(std::memory_order_relaxed)) {
+        header_->slot_count.store(index + 1, std::memory_order_release);
+    }
+    return slot;
+}
+
+void SharedMetricsSegment::release(SharedActorSlot* slot) {
+    if (!slot) {
+        return;
+    }
+    std::lock_guard<std::mutex> lock(mutex_);
+    slot->state.store(SharedActorSlot::FREE, std::memory_order_release);
+    free_slots_.push_back(static_cast<uint32_t>(slot - slots_));
+}
+
+void SharedMetricsSegment::touch() {
+    header_->heartbeat_ns.store(system_now_ns(), std::memory_order_relaxed);
+}
+
+SharedMetricsReader::SharedMetricsReader(const std::string& path)
+    : size_(0), mapping_(nullptr), header_(nullptr), slots_(nullptr), slot_size_(0), capacity_(0) {
+    int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0) {
+        throw std::runtime_error(error_text("Cannot open metrics segment", path));
+    }
+    struct stat info;
+    if (::fstat(fd, &info) != 0 || static_cast<size_t>(info.st_size) < sizeof(SharedMetricsHeader)) {
+        ::close(fd);
+        throw std::runtime_error("Metrics segment too small: " + path);
+    }
+    size_ = static_cast<size_t>(info.st_size);
+    void* mapping = ::mmap(nullptr, size_, PROT_READ, MAP_SHARED, fd, 0);
+    ::close(fd);
+    if (mapping == MAP_FAILED) {
+        throw std::runtime_error(error_text("Cannot map metrics segment", path));
+    }
+    mapping_ = mapping;
+    header_ = static_cast<const SharedMetricsHeader*>(mapping_);
+
+    auto fail = [&](const std::string& message) {
+        ::munmap(const_cast<void*>(mapping_), size_);
+        mapping_ = nullptr;
+        throw std::runtime_error(message + ": " + path);
+    };
+    if (std::memcmp(header_->magic, kSharedMetricsMagic, sizeof(kSharedMetricsMagic)) != 0) {
+        fail("Not an actor metrics segment");
+    }
+    std::atomic_thread_fence(std::memory_order_acquire);
+    if (header_->major_version != kSharedMetricsMajorVersion) {
+        fail("Unsupported metrics segment version " + std::to_string(header_->major_version));
+    }
+
+    // 按文件中记录的大小定位，兼容同一major版本内追加的字段
+    slot_size_ = header_->slot_size;
+    capacity_ = header_->capacity;
+    if (slot_size_ < sizeof(SharedActorSlot) ||
+        header_->header_size + static_cast<size_t>(slot_size_) * capacity_ > size_) {
+        fail("Corrupt metrics segment");
+    }
+    slots_ = static_cast<const char*>(mapping_) + header_->header_size;
+}
+
+SharedMetricsReader::~SharedMetricsReader() {
+    if (mapping_) {
+        ::munmap(const_cast<void*>(mapping_), size_);
+    }
+}
+
+SharedMetricsSnapshot SharedMetricsReader::snapshot() const {
+    SharedMetricsSnapshot snapshot;
+    snapshot.pid = header_->pid;
+    snapshot.created_ns = header_->created_ns;
+    snapshot.heartbeat_ns = header_->heartbeat_ns.load(std::memory_order_relaxed);
+    snapshot.actors = header_->actors.load(std::memory_order_relaxed);
+    snapshot.in_flight = header_->in_flight.load(std::memory_order_relaxed);
+    snapshot.worker_count = header_->worker_count.load(std::memory_order_relaxed);
+    snapshot.overflow_actors = header_->overflow_actors.load(std::memory_order_relaxed);
+
+    uint32_t count = std::min(header_->slot_count.load(std::memory_order_acquire), capacity_);
+    for (uint32_t i = 0; i < count; ++i) {
+        const auto* slot = reinterpret_cast<const SharedActorSlot*>(slots_ + static_cast<size_t>(i) * slot_size_);
+
+        uint32_t generation = slot->generation.load(std::memory_order_acquire);
+        if (slot->state.load(std::memory_order_acquire) != SharedActorSlot::LIVE) {
+            continue;
+        }
+
+        SharedActorSample sample;
+        sample.slot = i;
+        sample.generation = generation;
+        sample.serial = slot->serial;
+        sample.name = read_field(slot->name, sizeof(slot->name));
+        sample.id = read_field(slot->id, sizeof(slot->id));
+        sample.processed = slot->processed.load(std::memory_order_relaxed);
+        sample.handler_ns = slot->handler_ns.load(std::memory_order_relaxed);
+        sample.mailbox_depth = slot->mailbox_depth.load(std::memory_order_relaxed);
+        sample.enqueued = slot->enqueued.load(std::memory_order_relaxed);
+        sample.dropped = slot->dropped.load(std::memory_order_relaxed);
+
+        // 读取期间槽位被复用或释放时丢弃
+        std::atomic_thread_fence(std::memory_order_acquire);
+        if (slot->generation.load(std::memory_order_relaxed) != generation ||
+            slot->state.load(std::memory_order_relaxed) != SharedActorSlot::LIVE) {
+            continue;
+        }
+        snapshot.samples.push_back(std::move(sample));
+    }
+    return snapshot;
+}
@@ -0,0 +1,36 @@
+#include "termination_detector.h"
+
+TerminationDetector::TerminationDetector() {}
+
+size_t TerminationDetector::shard_index() {
+    static std::atomic<size_t> next_index{0};
+    thread_local size_t index = next_index.fetch_add(1, std::memory_order_relaxed) % kShardCount;
+    return index;
+}
+
+TerminationDetector::Totals TerminationDetector::collect() const {
+    Totals totals{0, 0};
+    for (const auto& shard : shards_) {
+        totals.completed += shard.completed.load(std::memory_order_acquire);
+    }
+    for (const auto& shard : shards_) {
+        totals.sent += shard.sent.load(std::memory_order_acquire);
+    }
+    return totals;
+}
+
+bool TerminationDetector::is_quiescent() const {
+    Totals first = collect();
+    if (first.sent != first.completed) {
+        return false;
+    }
+
+    // 第二轮汇总，确认两轮之间没有新的消息发送或完成
+    Totals second = collect();
+    return second.sent == first.sent && second.completed == first.completed;
+}
+
+uint64_t TerminationDetector::in_flight() const {
+    Totals totals = collect();
+    return totals.sent > totals.completed ? totals.sent - totals.completed : 0;
+}
@@ -0,0 +1,459 @@
+#include "trace.h"
+#include "clock.h"
+#include <algorithm>
+#include <any>
+#include <atomic>
+#include <cstring>
+#include <deque>
+#include <map>
+#include <stdexcept>
+#include <unordered_map>
+
+namespace {
+    const char kTraceMagic[8] = {'A', 'C', 'T', 'R', 'T', 'R', 'C', '2'};
+
+    // 版本1的记录没有邮箱序号，读取方仍然接受
+    const char kTraceMagicV1[8] = {'A', 'C', 'T', 'R', 'T', 'R', 'C', '1'};
+
+    // 记录标签
+    enum RecordTag : uint8_t {
+        TAG_STRING = 0,
+        TAG_DELIVERY = 1,
+        TAG_HANDLED = 2
+    };
+
+    uint64_t zigzag_encode(int64_t value) {
+        return (static_cast<uint64_t>(value) << 1) ^ static_cast<uint64_t>(value >> 63);
+    }
+
+    int64_t zigzag_decode(uint64_t value) {
+        return static_cast<int64_t>(value >> 1) ^ -static_cast<int64_t>(value & 1);
+    }
+
+    int64_t now_ns() {
+        return std::chrono::duration_cast<std::chrono::nanoseconds>(
+            Clock::current().now().time_since_epoch()).count();
+    }
+
+    std::atomic<uint64_t> next_recorder_instance{1};
+}
+
+uint32_t estimate_payload_size(const Message& message) {
+    size_t size = 0;
+    for (const auto& [key, value] : message.get_pmr_payload()) {
+        size += key.size();
+        if (const auto* str = std::any_cast<std::string>(&value)) {
+            size += str->size();
+        } else if (value.type() == typeid(bool) || value.type() == typeid(char)) {
+            size += 1;
+        } else if (value.type() == typeid(int) || value.type() == typeid(float)) {
+            size += 4;
+        } else if (value.type() == typeid(int64_t) || value.type() == typeid(uint64_t) ||
+                   value.type() == typeid(double)) {
+            size += 8;
+        } else {
+            size += sizeof(std::any);
+        }
+    }
+    return static_cast<uint32_t>(size);
+}
+
+std::vector<int64_t> pair_handler_costs(const std::vector<TraceEvent>& events) {
+    // 带序号的按(目标, 序号)配对；旧格式的轨迹没有序号，按同一目标的出现顺序配对
+    std::map<std::pair<std::string, uint64_t>, int64_t> costs_by_sequence;
+    std::unordered_map<std::string, std::deque<int64_t>> costs_by_target;
+    std::map<std::string, std::pair<int64_t, int64_t>> cost_sum_by_type;
+    for (const auto& event : events) {
+        if (event.kind == TraceEvent::Kind::HANDLED) {
+            if (event.sequence != 0) {
+                costs_by_sequence[{event.target_id, event.sequence}] = event.cost_ns;
+            } else {
+                costs_by_target[event.target_id].push_back(event.cost_ns);
+            }
+            auto& sum = cost_sum_by_type[event.type];
+            sum.first += event.cost_ns;
+            sum.second += 1;
+        }
+    }
+
+    std::vector<int64_t> costs;
+    for (const auto& event : events) {
+        if (event.kind != TraceEvent::Kind::DELIVERY) {
+            continue;
+        }
+
+        int64_t cost = 0;
+        bool paired = false;
+        if (event.sequence != 0) {
+            auto it = costs_by_sequence.find({event.target_id, event.sequence});
+            if (it != costs_by_sequence.end()) {
+                cost = it->second;
+                paired = true;
+            }
+        } else {
+            auto& queue = costs_by_target[event.target_id];
+            if (!queue.empty()) {
+                cost = queue.front();
+                queue.pop_front();
+                paired = true;
+            }
+        }
+        if (!paired) {
+            auto it = cost_sum_by_type.find(event.type);
+            if (it != cost_sum_by_type.end() && it->second.second > 0) {
+                cost = it->second.first / it->second.second;
+            }
+        }
+        costs.push_back(cost);
+    }
+    return costs;
+}
+
+// TraceRecorder Implementation
+thread_local uint64_t TraceRecorder::local_instance_ = 0;
+thread_local TraceRecorder::ThreadBuffer* TraceRecorder::local_buffer_ = nullptr;
+thread_local TraceRecorder::ThreadOwner TraceRecorder::thread_owner_;
+
+TraceRecorder::ThreadOwner::~ThreadOwner() {
+    for (auto& buffer : buffers) {
+        std::lock_guard<std::mutex> lock(buffer->mutex);
+        std::lock_guard<std::mutex> retired_lock(buffer->retired->mutex);
+        buffer->retired->records.insert(buffer->retired->records.end(), buffer->records.begin(),
+                                        buffer->records.end());
+        buffer->retired->recorded += buffer->recorded;
+        buffer->records.clear();
+        buffer->recorded = 0;
+        buffer->exited = true;
+    }
+}
+
+TraceRecorder::TraceRecorder(const std::string& path, size_t flush_threshold)
+    : out_(path, std::ios::binary | std::ios::trunc)
+    , flush_threshold_(flush_threshold)
+    , retired_(std::make_shared<Retired>())
+    , next_file_id_(0)
+    , last_timestamp_ns_(0)
+    , instance_(next_recorder_instance.fetch_add(1, std::memory_order_relaxed)) {
+    if (!out_) {
+        throw std::runtime_error("Failed to open trace file: " + path);
+    }
+    out_.write(kTraceMagic, sizeof(kTraceMagic));
+    buffer_.reserve(flush_threshold_ + 256);
+}
+
+TraceRecorder::~TraceRecorder() {
+    flush();
+}
+
+void TraceRecorder::record_delivery(const Message& message, uint64_t sequence) {
+    ThreadBuffer& buffer = local_buffer();
+    Record record{};
+    record.kind = TraceEvent::Kind::DELIVERY;
+    record.sequence = sequence;
+    record.type = string_id(buffer, message.get_type());
+    record.sender = string_id(buffer, message.get_sender_id());
+    record.target = string_id(buffer, message.get_target_id());
+    record.priority = message.get_priority();
+    record.payload_size = estimate_payload_size(message);
+    // 调用者持有目标的邮箱锁，超过阈值也留给之后的record_handled或flush写文件
+    append(buffer, record);
+}
+
+void TraceRecorder::record_handled(const std::string& actor_id, const std::string& type,
+                                   std::chrono::nanoseconds cost, uint64_t sequence) {
+    ThreadBuffer& buffer = local_buffer();
+    Record record{};
+    record.kind = TraceEvent::Kind::HANDLED;
+    record.sequence = sequence;
+    record.target = string_id(buffer, actor_id);
+    record.type = string_id(buffer, type);
+    record.cost_ns = std::max<int64_t>(0, cost.count());
+    if (append(buffer, record)) {
+        flush();
+    }
+}
+
+void TraceRecorder::flush() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    bool any_exited = false;
+    {
+        // 同时持有所有线程缓冲区的锁，取到的是一个一致的切面：之后追加的记录时间戳都不早于其中任何一条
+        std::vector<std::unique_lock<std::mutex>> locks;
+        locks.reserve(threads_.size() + 1);
+        for (auto& thread : threads_) {
+            locks.emplace_back(thread->mutex);
+        }
+        locks.emplace_back(retired_->mutex);
+        for (auto& thread : threads_) {
+            batch_.insert(batch_.end(), thread->records.begin(), thread->records.end());
+            thread->records.clear();
+            any_exited = any_exited || thread->exited;
+        }
+        batch_.insert(batch_.end(), retired_->records.begin(), retired_->records.end());
+        retired_->records.clear();
+    }
+    // 已退出线程的缓冲区已经是空的，之后也不会再有记录（在锁外释放）
+    if (any_exited) {
+        threads_.erase(std::remove_if(threads_.begin(), threads_.end(),
+                                      [](const std::shared_ptr<ThreadBuffer>& thread) { return thread->exited; }),
+                       threads_.end());
+    }
+    std::stable_sort(batch_.begin(), batch_.end(), [](const Record& a, const Record& b) {
+        return a.timestamp_ns < b.timestamp_ns;
+    });
+
+    // 文件中的字符串编号按第一次出现的顺序分配，读取方要求编号连续
+    std::unique_lock<std::mutex> strings_lock(strings_mutex_);
+    file_ids_.resize(values_.size(), 0);
+    auto file_id = [this](uint32_t id) {
+        if (file_ids_[id] == 0) {
+            file_ids_[id] = ++next_file_id_;
+            const std::string& value = values_[id];
+            buffer_.push_back(static_cast<char>(TAG_STRING));
+            put_varint(next_file_id_ - 1);
+            put_varint(value.size());
+            buffer_.insert(buffer_.end(), value.begin(), value.end());
+        }
+        return file_ids_[id] - 1;
+    };
+
+    for (const Record& record : batch_) {
+        if (record.kind == TraceEvent::Kind::DELIVERY) {
+            uint64_t type = file_id(record.type);
+            uint64_t sender = file_id(record.sender);
+            uint64_t target = file_id(record.target);
+            buffer_.push_back(static_cast<char>(TAG_DELIVERY));
+            put_varint(zigzag_encode(record.timestamp_ns - last_timestamp_ns_));
+            put_varint(type);
+            put_varint(sender);
+            put_varint(target);
+            buffer_.push_back(static_cast<char>(record.priority));
+            put_varint(record.payload_size);
+        } else {
+            uint64_t target = file_id(record.target);
+            uint64_t type = file_id(record.type);
+            buffer_.push_back(static_cast<char>(TAG_HANDLED));
+            put_varint(zigzag_encode(record.timestamp_ns - last_timestamp_ns_));
+            put_varint(target);
+            put_varint(type);
+            put_varint(static_cast<uint64_t>(record.cost_ns));
+        }
+        put_varint(record.sequence);
+        last_timestamp_ns_ = record.timestamp_ns;
+
+        if (buffer_.size() >= flush_threshold_) {
+            out_.write(buffer_.data(), static_cast<std::streamsize>(buffer_.size()));
+            buffer_.clear();
+        }
+    }
+    strings_lock.unlock();
+    batch_.clear();
+
+    if (!buffer_.empty()) {
+        out_.write(buffer_.data(), static_cast<std::streamsize>(buffer_.size()));
+        buffer_.clear();
+    }
+    out_.flush();
+}
+
+uint64_t TraceRecorder::event_count() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    uint64_t count = 0;
+    for (const auto& thread : threads_) {
+        std::lock_guard<std::mutex> thread_lock(thread->mutex);
+        count += thread->recorded;
+    }
+    std::lock_guard<std::mutex> retired_lock(retired_->mutex);
+    return count + retired_->recorded;
+}
+
+TraceRecorder::ThreadBuffer& TraceRecorder::local_buffer() {
+    if (local_instance_ == instance_) {
+        return *local_buffer_;
+    }
+
+    // 线程交替使用多个记录器时缓存会失效，在本线程的缓冲区中找回之前创建的
+    auto& buffers = thread_owner_.buffers;
+    ThreadBuffer* found = nullptr;
+    for (auto& buffer : buffers) {
+        if (buffer->instance == instance_) {
+            found = buffer.get();
+            break;
+        }
+    }
+    if (!found) {
+        // 只剩本线程持有的缓冲区属于已经销毁的记录器
+        buffers.erase(std::remove_if(buffers.begin(), buffers.end(),
+                                     [](const std::shared_ptr<ThreadBuffer>& buffer) { return buffer.use_count() == 1; }),
+                      buffers.end());
+        auto buffer = std::make_shared<ThreadBuffer>();
+        buffer->instance = instance_;
+        buffer->retired = retired_;
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            threads_.push_back(buffer);
+        }
+        found = buffer.get();
+        buffers.push_back(std::move(buffer));
+    }
+    local_instance_ = instance_;
+    local_buffer_ = found;
+    return *found;
+}
+
+uint32_t TraceRecorder::string_id(ThreadBuffer& buffer, const std::string& value) {
+    auto cached = buffer.ids.find(value);
+    if (cached != buffer.ids.end()) {
+        return cached->second;
+    }
+
+    uint32_t id;
+    {
+        std::lock_guard<std::mutex> lock(strings_mutex_);
+        auto it = strings_.find(value);
+        if (it != strings_.end()) {
+            id = it->second;
+        } else {
+            id = static_cast<uint32_t>(values_.size());
+            strings_.try_emplace(value, id);
+            values_.push_back(value);
+        }
+    }
+    buffer.ids.try_emplace(value, id);
+    return id;
+}
+
+bool TraceRecorder::append(ThreadBuffer& buffer, Record& record) {
+    std::lock_guard<std::mutex> lock(buffer.mutex);
+    // 在缓冲区锁内取时间戳，刷新时取到的切面才不会漏掉更早的记录
+    record.timestamp_ns = now_ns();
+    buffer.records.push_back(record);
+    ++buffer.recorded;
+    return buffer.records.size() * sizeof(Record) >= flush_threshold_;
+}
+
+void TraceRecorder::put_varint(uint64_t value) {
+    while (value >= 0x80) {
+        buffer_.push_back(static_cast<char>((value & 0x7f) | 0x80));
+        value >>= 7;
+    }
+    buffer_.push_back(static_cast<char>(value));
+}
+
+// TraceReader Implementation
+TraceReader::TraceReader(const std::string& path)
+    : in_(path, std::ios::binary)
+    , last_timestamp_ns_(0)
+    , version_(2) {
+    if (!in_) {
+        throw std::runtime_error("Failed to open trace file: " + path);
+    }
+
+    char magic[sizeof(kTraceMagic)];
+    if (!in_.read(magic, sizeof(magic))) {
+        throw std::runtime_error("Not an actor trace file: " + path);
+    }
+    if (std::memcmp(magic, kTraceMagicV1, sizeof(magic)) == 0) {
+        version_ = 1;
+    } else if (std::memcmp(magic, kTraceMagic, sizeof(magic)) != 0) {
+        throw std::runtime_error("Not an actor trace file: " + path);
+    }
+}
+
+bool TraceReader::next(TraceEvent& event) {
+    while (true) {
+        int tag = in_.get();
+        if (tag == std::char_traits<char>::eof()) {
+            return false;
+        }
+
+        switch (tag) {
+        case TAG_STRING: {
+            uint64_t id = require_varint();
+            uint64_t length = require_varint();
+            if (id != strings_.size()) {
+                throw std::runtime_error("Corrupted trace: unexpected string id");
+            }
+            std::string value(length, '\0');
+            if (length > 0 && !in_.read(&value[0], static_cast<std::streamsize>(length))) {
+                throw std::runtime_error("Corrupted trace: truncated string");
+            }
+            strings_.push_back(std::move(value));
+            break;
+        }
+        case TAG_DELIVERY: {
+            event = TraceEvent{};
+            event.kind = TraceEvent::Kind::DELIVERY;
+            last_timestamp_ns_ += zigzag_decode(require_varint());
+            event.timestamp_ns = last_timestamp_ns_;
+            event.type = lookup(require_varint());
+            event.sender_id = lookup(require_varint());
+            event.target_id = lookup(require_varint());
+            int priority = in_.get();
+            if (priority < 0 || priority > static_cast<int>(Message::Priority::CRITICAL)) {
+                throw std::runtime_error("Corrupted trace: invalid priority");
+            }
+            event.priority = static_cast<Message::Priority>(priority);
+            event.payload_size = static_cast<uint32_t>(require_varint());
+            if (version_ >= 2) {
+                event.sequence = require_varint();
+            }
+            return true;
+        }
+        case TAG_HANDLED: {
+            event = TraceEvent{};
+            event.kind = TraceEvent::Kind::HANDLED;
+            last_timestamp_ns_ += zigzag_decode(require_varint());
+            event.timestamp_ns = last_timestamp_ns_;
+            event.target_id = lookup(require_varint());
+            event.type = lookup(require_varint());
+            event.cost_ns = static_cast<int64_t>(require_varint());
+            if (version_ >= 2) {
+                event.sequence = require_varint();
+            }
+            return true;
+        }
+        default:
+            throw std::runtime_error("Corrupted trace: unknown record tag " + std::to_string(tag));
+        }
+    }
+}
+
+std::vector<TraceEvent> TraceReader::read_all() {
+    std::vector<TraceEvent> events;
+    TraceEvent event;
+    while (next(event)) {
+        events.push_back(event);
+    }
+    return events;
+}
+
+bool TraceReader::get_varint(uint64_t& value) {
+    value = 0;
+    for (int shift = 0; shift < 64; shift += 7) {
+        int byte = in_.get();
+        if (byte == std::char_traits<char>::eof()) {
+            return false;
+        }
+        value |= static_cast<uint64_t>(byte & 0x7f) << shift;
+        if ((byte & 0x80) == 0) {
+            return true;
+        }
+    }
+    return false;
+}
+
+uint64_t TraceReader::require_varint() {
+    uint64_t value = 0;
+    if (!get_varint(value)) {
+        throw std::runtime_error("Corrupted trace: truncated record");
+    }
+    return value;
+}
+
+const std::string& TraceReader::lookup(uint64_t id) const {
+    if (id >= strings_.size()) {
+        throw std::runtime_error("Corrupted trace: unknown string id");
+    }
+    return strings_[id];
+}
@@ -0,0 +1,147 @@
+#include "tracing.h"
+#include <algorithm>
+#include <cstdio>
+#include <fstream>
+#include <random>
+#include <sstream>
+
+namespace {
+    // 每个线程独立的随机数发生器，生成ID时不需要加锁
+    std::mt19937_64& id_engine() {
+        thread_local std::mt19937_64 engine(std::random_device{}() ^
+                                            (static_cast<uint64_t>(std::random_device{}()) << 32));
+        return engine;
+    }
+
+    uint64_t nonzero_random() {
+        uint64_t value;
+        do {
+            value = id_engine()();
+        } while (value == 0);
+        return value;
+    }
+
+    std::string hex(uint64_t value) {
+        char buffer[17];
+        std::snprintf(buffer, sizeof(buffer), "%016llx", static_cast<unsigned long long>(value));
+        return buffer;
+    }
+
+    std::string json_string(const std::string& value) {
+        std::string result = "\"";
+        for (char c : value) {
+            switch (c) {
+                case '"': result += "\\\""; break;
+                case '\\': result += "\\\\"; break;
+                case '\n': result += "\\n"; break;
+                case '\r': result += "\\r"; break;
+                case '\t': result += "\\t"; break;
+                default:
+                    if (static_cast<unsigned char>(c) < 0x20) {
+                        char buffer[7];
+                        std::snprintf(buffer, sizeof(buffer), "\\u%04x", static_cast<unsigned char>(c));
+                        result += buffer;
+                    } else {
+                        result += c;
+                    }
+            }
+        }
+        return result + "\"";
+    }
+
+    void string_attribute(std::ostringstream& out, const char* key, const std::string& value, bool first = false) {
+        out << (first ? "" : ",") << "{\"key\":\"" << key << "\",\"value\":{\"stringValue\":" << json_string(value) << "}}";
+    }
+
+    void int_attribute(std::ostringstream& out, const char* key, int64_t value) {
+        // OTLP/JSON中64位整数编码为字符串
+        out << ",{\"key\":\"" << key << "\",\"value\":{\"intValue\":\"" << value << "\"}}";
+    }
+}
+
+TraceContext start_trace(double sampling_ratio) {
+    TraceContext context;
+    context.trace_id_high = nonzero_random();
+    context.trace_id_low = nonzero_random();
+    context.sampled = sampling_ratio >= 1.0 ||
+                      (sampling_ratio > 0.0 && std::uniform_real_distribution<double>(0.0, 1.0)(id_engine()) < sampling_ratio);
+    return context;
+}
+
+uint64_t generate_span_id() {
+    return nonzero_random();
+}
+
+SpanCollector::SpanCollector(size_t capacity, std::string service_name)
+    : capacity_(std::max<size_t>(1, capacity)), service_name_(std::move(service_name)) {
+}
+
+void SpanCollector::record(Span span) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (spans_.size() == capacity_) {
+        spans_.pop_front();
+        ++dropped_;
+    }
+    spans_.push_back(std::move(span));
+}
+
+std::vector<Span> SpanCollector::spans() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return std::vector<Span>(spans_.begin(), spans_.end());
+}
+
+uint64_t SpanCollector::dropped() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return dropped_;
+}
+
+void SpanCollector::clear() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    spans_.clear();
+    dropped_ = 0;
+}
+
+std::string SpanCollector::to_otlp_json() const {
+    std::vector<Span> snapshot = spans();
+
+    std::ostringstream out;
+    out << "{\"resourceSpans\":[{\"resource\":{\"attributes\":[";
+    string_attribute(out, "service.name", service_name_, true);
+    out << "]},\"scopeSpans\":[{\"scope\":{\"name\":\"actor_cpp\"},\"spans\":[";
+    for (size_t i = 0; i < snapshot.size(); ++i) {
+        const Span& span = snapshot[i];
+        out << (i == 0 ? "" : ",") << "\n{\"traceId\":\"" << hex(span.trace_id_high) << hex(span.trace_id_low)
+            << "\",\"spanId\":\"" << hex(span.span_id) << "\"";
+        if (span.parent_span_id != 0) {
+            out << ",\"parentSpanId\":\"" << hex(span.parent_span_id) << "\"";
+        }
+        // SPAN_KIND_CONSUMER：处理从邮箱中取出的消息
+        out << ",\"name\":" << json_string(span.name) << ",\"kind\":5"
+            << ",\"startTimeUnixNano\":\"" << span.start_ns << "\""
+            << ",\"endTimeUnixNano\":\"" << span.end_ns << "\""
+            << ",\"attributes\":[";
+        string_attribute(out, "actor.name", span.actor_name, true);
+        string_attribute(out, "actor.id", span.actor_id);
+        string_attribute(out, "message.sender_id", span.sender_id);
+        int_attribute(out, "message.queue_time_ns", span.queue_ns);
+        out << "]}";
+    }
+    out << "\n]}]}]}\n";
+    return out.str();
+}
+
+bool SpanCollector::write_otlp_json(const std::string& path) const {
+    std::string text = to_otlp_json();
+    std::string temp_path = path + ".tmp";
+    {
+        std::ofstream out(temp_path, std::ios::trunc);
+        if (!out) {
+            return false;
+        }
+        out << text;
+        if (!out) {
+            return false;
+        }
+    }
+    return std::rename(temp_path.c_str(), path.c_str()) == 0;
+}
@@ -0,0 +1,232 @@
+#include "watchdog.h"
+#include "actor.h"
+#include "logging.h"
+#include "message.h"
+#include "metrics.h"
+#include <algorithm>
+#include <cerrno>
+#include <csignal>
+#include <cstdlib>
+#include <cstring>
+#include <cxxabi.h>
+#include <execinfo.h>
+#include <iostream>
+
+namespace {
+    // 复制字符串并保证以'\0'结尾（过长时截断），只用memcpy，可以在信号处理函数中调用
+    void copy_field(char* dest, size_t capacity, const std::string& value) {
+        size_t length = std::min(value.size(), capacity - 1);
+        std::memcpy(dest, value.data(), length);
+        dest[length] = '\0';
+    }
+
+    // 把backtrace_symbols的"模块(符号+偏移) [地址]"中的符号还原为C++名称
+    std::string demangle_frame(const char* frame) {
+        std::string text = frame;
+        size_t open = text.find('(');
+        size_t plus = text.find('+', open);
+        if (open == std::string::npos || plus == std::string::npos || plus == open + 1) {
+            return text;
+        }
+        std::string mangled = text.substr(open + 1, plus - open - 1);
+        int status = 0;
+        char* name = abi::__cxa_demangle(mangled.c_str(), nullptr, nullptr, &status);
+        if (status != 0 || !name) {
+            return text;
+        }
+        std::string result = text.substr(0, open + 1) + name + text.substr(plus);
+        std::free(name);
+        return result;
+    }
+}
+
+thread_local WatchdogSlot* SlowHandlerWatchdog::current_slot_ = nullptr;
+
+SlowHandlerWatchdog::SlowHandlerWatchdog(const WatchdogOptions& options, std::shared_ptr<MetricsRegistry> metrics)
+    : options_(options), signal_(options.signal > 0 ? options.signal : SIGRTMIN + 1), previous_action_(),
+      metrics_(std::move(metrics)) {
+    options_.threshold = std::max(options_.threshold, std::chrono::milliseconds(1));
+    options_.max_frames = std::min<size_t>(options_.max_frames, 64);
+
+    // backtrace第一次调用时会加载libgcc，预先调用一次，避免之后在信号处理函数中分配内存
+    void* frames[1];
+    ::backtrace(frames, 1);
+
+    // 信号处理函数是进程级的，按线程局部的槽位区分各个看门狗
+    struct sigaction action;
+    std::memset(&action, 0, sizeof(action));
+    action.sa_handler = on_sample_signal;
+    sigemptyset(&action.sa_mask);
+    action.sa_flags = SA_RESTART;
+    ::sigaction(signal_, &action, &previous_action_);
+
+    thread_ = std::thread([this]() { watch(); });
+}
+
+SlowHandlerWatchdog::~SlowHandlerWatchdog() {
+    {
+        std::lock_guard<std::mutex> lock(stop_mutex_);
+        stopping_ = true;
+    }
+    stop_cv_.notify_all();
+    thread_.join();
+    ::sigaction(signal_, &previous_action_, nullptr);
+}
+
+void SlowHandlerWatchdog::attach_current_thread(size_t worker) {
+    auto slot = std::make_shared<WatchdogSlot>();
+    slot->worker = worker;
+    slot->thread = ::pthread_self();
+    slot->max_frames = options_.capture_stack ? static_cast<int>(options_.max_frames) : 0;
+
+    std::lock_guard<std::mutex> lock(slots_mutex_);
+    current_slot_ = slot.get();
+    slots_.push_back(std::move(slot));
+}
+
+void SlowHandlerWatchdog::detach_current_thread() {
+    // 持有锁时看门狗不会向本线程发送信号
+    std::lock_guard<std::mutex> lock(slots_mutex_);
+    WatchdogSlot* slot = current_slot_;
+    current_slot_ = nullptr;
+    slots_.erase(std::remove_if(slots_.begin(), slots_.end(),
+                                [slot](const std::shared_ptr<WatchdogSlot>& s) { return s.get() == slot; }),
+                 slots_.end());
+}
+
+std::vector<SlowHandlerReport> SlowHandlerWatchdog::recent_reports() const {
+    std::lock_guard<std::mutex> lock(reports_mutex_);
+    return std::vector<SlowHandlerReport>(reports_.begin(), reports_.end());
+}
+
+void SlowHandlerWatchdog::watch() {
+    auto interval = std::max(options_.threshold / 10, std::chrono::milliseconds(1));
+    std::unique_lock<std::mutex> stop_lock(stop_mutex_);
+    struct Pending {
+        std::shared_ptr<WatchdogSlot> slot;
+        uint64_t seq;
+        std::chrono::steady_clock::duration elapsed;
+    };
+    std::vector<Pending> pending;
+    while (!stop_cv_.wait_for(stop_lock, interval, [this]() { return stopping_; })) {
+        // 持有锁时只检查序号和发送信号，等待采样和报告在释放锁之后进行
+        auto now = std::chrono::steady_clock::now();
+        {
+            std::lock_guard<std::mutex> lock(slots_mutex_);
+            for (auto& slot : slots_) {
+                std::chrono::steady_clock::duration elapsed;
+                if (check(*slot, now, elapsed) && request_sample(*slot, slot->observed_seq)) {
+                    pending.push_back({slot, slot->observed_seq, elapsed});
+                }
+            }
+        }
+        for (auto& item : pending) {
+            if (report(*item.slot, item.seq, item.elapsed)) {
+                item.slot->reported_seq = item.seq;
+            }
+        }
+        pending.clear();
+    }
+}
+
+bool SlowHandlerWatchdog::check(WatchdogSlot& slot, std::chrono::steady_clock::time_point now,
+                                std::chrono::steady_clock::duration& elapsed) {
+    uint64_t seq = slot.seq.load(std::memory_order_acquire);
+    if (seq != slot.observed_seq) {
+        slot.observed_seq = seq;
+        slot.observed_since = now;
+        return false;
+    }
+    if ((seq & 1) == 0 || seq == slot.reported_seq) {
+        return false;
+    }
+    // 第一次观察到时处理函数可能已经运行了一段时间，这里得到的是下界
+    elapsed = now - slot.observed_since;
+    return elapsed >= options_.threshold;
+}
+
+bool SlowHandlerWatchdog::request_sample(WatchdogSlot& slot, uint64_t seq) {
+    // 上一次请求的采样在超时之后才完成时不必再发送信号
+    if (slot.captured.load(std::memory_order_acquire) == seq) {
+        return true;
+    }
+    // 让worker在自己的线程上采样，处理函数已经返回时信号处理函数什么都不做
+    slot.requested.store(seq, std::memory_order_release);
+    return ::pthread_kill(slot.thread, signal_) == 0;
+}
+
+bool SlowHandlerWatchdog::report(WatchdogSlot& slot, uint64_t seq, std::chrono::steady_clock::duration elapsed) {
+    auto deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(100);
+    while (slot.captured.load(std::memory_order_acquire) != seq) {
+        if (std::chrono::steady_clock::now() >= deadline || slot.seq.load(std::memory_order_acquire) != seq) {
+            return false;
+        }
+        std::this_thread::sleep_for(std::chrono::microseconds(200));
+    }
+
+    SlowHandlerReport report;
+    report.worker = slot.worker;
+    report.actor_name = slot.actor_name;
+    report.actor_id = slot.actor_id;
+    report.message_type = slot.message_type;
+    report.elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(elapsed);
+    if (slot.frame_count > 0) {
+        if (char** symbols = ::backtrace_symbols(slot.frames, slot.frame_count)) {
+            // 跳过信号处理函数本身和内核的信号返回帧
+            for (int i = std::min(2, slot.frame_count - 1); i < slot.frame_count; ++i) {
+                report.stack.push_back(demangle_frame(symbols[i]));
+            }
+            std::free(symbols);
+        }
+    }
+
+    if (metrics_) {
+        metrics_->counter("actor_slow_handlers_total", "Message handlers that exceeded the watchdog threshold.",
+                          {{"type", report.message_type}})->inc();
+    }
+    if (log_enabled(LogLevel::WARN)) {
+        std::cerr << "Slow handler: actor " << report.actor_name << " (ID: " << report.actor_id
+                  << ") message " << report.message_type << " on worker " << report.worker
+                  << " running for " << report.elapsed.count() << " ms" << std::endl;
+        for (size_t i = 0; i < report.stack.size(); ++i) {
+            std::cerr << "  #" << i << " " << report.stack[i] << std::endl;
+        }
+    }
+    if (options_.on_report) {
+        options_.on_report(report);
+    }
+
+    report_count_.fetch_add(1);
+    std::lock_guard<std::mutex> lock(reports_mutex_);
+    reports_.push_back(std::move(report));
+    while (reports_.size() > std::max<size_t>(1, options_.max_reports)) {
+        reports_.pop_front();
+    }
+    return true;
+}
+
+void SlowHandlerWatchdog::on_sample_signal(int) {
+    WatchdogSlot* slot = current_slot_;
+    if (!slot) {
+        return;
+    }
+    uint64_t seq = slot->seq.load(std::memory_order_relaxed);
+    if (seq != slot->requested.load(std::memory_order_acquire)) {
+        return;
+    }
+
+    // 信号打断的正是这次处理，Actor和消息在处理函数返回之前都有效
+    int saved_errno = errno;
+    const Actor* actor = slot->actor.load(std::memory_order_relaxed);
+    const Message* message = slot->message.load(std::memory_order_relaxed);
+    if (actor) {
+        copy_field(slot->actor_name, sizeof(slot->actor_name), actor->get_name());
+        copy_field(slot->actor_id, sizeof(slot->actor_id), actor->get_id());
+    }
+    if (message) {
+        copy_field(slot->message_type, sizeof(slot->message_type), message->get_type());
+    }
+    slot->frame_count = slot->max_frames > 0 ? ::backtrace(slot->frames, slot->max_frames) : 0;
+    slot->captured.store(seq, std::memory_order_release);
+    errno = saved_errno;
+}
@@ -6,11 +6,27 @@
 #include <chrono>
 #include <atomic>
 #include <any>
+#include <memory_resource>
+#include <vector>
+#include <cstdio>
+#include <cstring>
+#include <stdexcept>
+#include <unistd.h>
+#include <random>
+#include <string_view>
+#include <unordered_map>
+#include <unordered_set>
 
 #include "actor.h"
+#include "buffer.h"
+#include "flat_hash_map.h"
+#include "huge_pages.h"
 #include "event_loop.h"
 #include "message.h"
 #include "scheduler.h"
+#include "termination_detector.h"
+#include "clock.h"
+#include "histogram.h"
 
 // 测试用的Actor
 class TestActor : public Actor
@@ -49,6 +65,93 @@ private:
     }
 };
 
+// 处理每条消息都需要一段时间的Actor，用于测试关闭截止时间
+class SlowActor : public Actor
+{
+public:
+    SlowActor(const std::string &name, std::weak_ptr<EventLoop> event_loop,
+              std::chrono::milliseconds cost)
+        : Actor(name, event_loop), message_count_(0)
+    {
+        register_handler("test", [this, cost](const Message &)
+                         {
+                             std::this_thread::sleep_for(cost);
+                             message_count_++; });
+    }
+
+    int get_message_count() const
+    {
+        return message_count_;
+    }
+
+private:
+    std::atomic<int> message_count_;
+};
+
+// 把令牌沿环传递指定跳数的Actor
+class RingActor : public Actor
+{
+public:
+    RingActor(const std::string &name, std::weak_ptr<EventLoop> event_loop)
+        : Actor(name, event_loop), message_count_(0)
+    {
+        register_handler("token", [this](const Message &msg)
+                         {
+                             message_count_++;
+                             int hops = msg.get_payload_value<int>("hops");
+                             if (hops > 0)
+                             {
+                                 std::map<std::string, std::any> payload;
+                                 payload["hops"] = hops - 1;
+                                 send(next_id_, Message("token", id_, next_id_, payload));
+                             } });
+    }
+
+    void set_next(const std::string &next_id) { next_id_ = next_id; }
+
+    int get_message_count() const
+    {
+        return message_count_;
+    }
+
+private:
+    std::atomic<int> message_count_;
+    std::string next_id_;
+};
+
+// 记录处理顺序和虚拟时间，并向其他Actor扩散消息的Actor
+class SimActor : public Actor
+{
+public:
+    SimActor(const std::string &name, std::weak_ptr<EventLoop> event_loop,
+             std::vector<std::string> &trace)
+        : Actor(name, event_loop), trace_(trace)
+    {
+        register_handler("work", [this](const Message &msg)
+                         {
+                             auto elapsed = Clock::current().now().time_since_epoch();
+                             trace_.push_back(name_ + "@" + std::to_string(
+                                 std::chrono::duration_cast<std::chrono::microseconds>(elapsed).count()));
+
+                             int fanout = msg.get_payload_value<int>("fanout");
+                             if (fanout > 0)
+                             {
+                                 for (const auto &peer : peers_)
+                                 {
+                                     std::map<std::string, std::any> payload;
+                                     payload["fanout"] = fanout - 1;
+                                     send(peer, Message("work", id_, peer, payload));
+                                 }
+                             } });
+    }
+
+    void set_peers(std::vector<std::string> peers) { peers_ = std::move(peers); }
+
+private:
+    std::vector<std::string> &trace_;
+    std::vector<std::string> peers_;
+};
+
 // 测试基本的Actor功能
 void test_basic_actor()
 {
@@ -182,11 +285,897 @@ void test_schedulers()
     std::cout << "Scheduler test passed!" << std::endl;
 }
 
+// 测试优雅关闭会并行排空所有邮箱
+void test_graceful_shutdown()
+{
+    std::cout << "Running graceful shutdown test..." << std::endl;
+
+    auto event_loop = std::make_shared<EventLoop>();
+    event_loop->set_shutdown_options({std::chrono::seconds(5), 4});
+
+    std::vector<std::shared_ptr<TestActor>> actors;
+    for (int i = 0; i < 8; ++i)
+    {
+        auto actor = std::make_shared<TestActor>("Actor" + std::to_string(i), event_loop);
+        event_loop->register_actor(actor);
+        actor->initialize();
+        actor->start();
+        actors.push_back(actor);
+    }
+
+    // 每个actor向下一个actor请求回复，排空期间actor之间仍然可以通信
+    for (size_t i = 0; i < actors.size(); ++i)
+    {
+        for (int j = 0; j < 3; ++j)
+        {
+            std::map<std::string, std::any> payload;
+            payload["reply"] = true;
+            const auto &target = actors[(i + 1) % actors.size()];
+            event_loop->deliver_message(Message("test", actors[i]->get_id(), target->get_id(), payload));
+        }
+    }
+
+    ShutdownReport report = event_loop->shutdown();
+
+    assert(report.actors_stopped == actors.size());
+    assert(report.actors_force_stopped == 0);
+    assert(report.messages_drained == actors.size() * 3 * 2);
+    assert(report.messages_dropped == 0);
+    assert(!report.deadline_exceeded);
+    for (const auto &actor : actors)
+    {
+        assert(actor->get_message_count() == 6);
+        assert(actor->get_state() == Actor::State::STOPPED);
+    }
+
+    std::cout << "Graceful shutdown test passed!" << std::endl;
+}
+
+// 测试关闭截止时间到达后剩余消息会被丢弃并计数
+void test_shutdown_deadline()
+{
+    std::cout << "Running shutdown deadline test..." << std::endl;
+
+    auto event_loop = std::make_shared<EventLoop>();
+    event_loop->set_shutdown_options({std::chrono::milliseconds(50), 1});
+
+    auto actor = std::make_shared<SlowActor>("SlowActor", event_loop, std::chrono::milliseconds(20));
+    event_loop->register_actor(actor);
+    actor->initialize();
+    actor->start();
+
+    for (int i = 0; i < 20; ++i)
+    {
+        event_loop->deliver_message(Message("test", "sender", actor->get_id()));
+    }
+
+    ShutdownReport report = event_loop->shutdown();
+
+    assert(report.deadline_exceeded);
+    assert(report.actors_force_stopped == 1);
+    assert(report.messages_dropped > 0);
+    assert(report.messages_drained + report.messages_dropped == 20);
+    assert(static_cast<size_t>(actor->get_message_count()) == report.messages_drained);
+    assert(actor->get_state() == Actor::State::STOPPED);
+
+    // 截止时间为0但邮箱都为空时没有消息被放弃，不算超过截止时间
+    auto idle_loop = std::make_shared<EventLoop>();
+    idle_loop->set_shutdown_options({std::chrono::milliseconds(0), 1});
+    auto idle = std::make_shared<TestActor>("IdleActor", idle_loop);
+    idle_loop->register_actor(idle);
+    idle->initialize();
+    idle->start();
+    ShutdownReport idle_report = idle_loop->shutdown();
+    assert(!idle_report.deadline_exceeded);
+    assert(idle_report.messages_dropped == 0);
+    assert(idle_report.actors_stopped == 1 && idle_report.actors_force_stopped == 0);
+
+    std::cout << "Shutdown deadline test passed!" << std::endl;
+}
+
+// 测试四计数器静默检测
+void test_termination_detector()
+{
+    std::cout << "Running termination detector test..." << std::endl;
+
+    TerminationDetector detector;
+    assert(detector.is_quiescent());
+
+    detector.on_enqueued();
+    detector.on_enqueued();
+    assert(!detector.is_quiescent());
+    assert(detector.in_flight() == 2);
+
+    // 在另一个线程上完成，计数落在不同的分片
+    std::thread worker([&detector]()
+                       { detector.on_completed(2); });
+    worker.join();
+    assert(detector.is_quiescent());
+    assert(detector.in_flight() == 0);
+
+    std::cout << "Termination detector test passed!" << std::endl;
+}
+
+// 测试多worker下run_until_idle在系统静默时可靠返回
+void test_run_until_idle()
+{
+    std::cout << "Running run_until_idle test..." << std::endl;
+
+    const int ring_size = 16;
+    const int tokens = 8;
+    const int hops = 200;
+
+    auto event_loop = std::make_shared<EventLoop>();
+    event_loop->set_worker_count(4);
+
+    std::vector<std::shared_ptr<RingActor>> ring;
+    for (int i = 0; i < ring_size; ++i)
+    {
+        auto actor = std::make_shared<RingActor>("Ring" + std::to_string(i), event_loop);
+        event_loop->register_actor(actor);
+        ring.push_back(actor);
+    }
+    for (int i = 0; i < ring_size; ++i)
+    {
+        ring[i]->set_next(ring[(i + 1) % ring_size]->get_id());
+    }
+
+    // run_until_idle会初始化并启动Actor；没有消息时立即返回
+    assert(event_loop->run_until_idle() == 0);
+
+    for (int t = 0; t < tokens; ++t)
+    {
+        std::map<std::string, std::any> payload;
+        payload["hops"] = hops;
+        const auto &target = ring[(t * 2) % ring_size];
+        event_loop->deliver_message(Message("token", "sender", target->get_id(), payload));
+    }
+
+    size_t processed = event_loop->run_until_idle();
+    assert(processed == static_cast<size_t>(tokens * (hops + 1)));
+    assert(!event_loop->has_work());
+    assert(event_loop->in_flight_messages() == 0);
+
+    int total = 0;
+    for (const auto &actor : ring)
+    {
+        total += actor->get_message_count();
+        assert(actor->is_running());
+    }
+    assert(total == tokens * (hops + 1));
+
+    std::cout << "run_until_idle test passed!" << std::endl;
+}
+
+// 在仿真模式下运行一个扩散负载，返回处理顺序
+std::vector<std::string> run_simulated_workload(uint64_t seed)
+{
+    std::vector<std::string> trace;
+
+    auto event_loop = std::make_shared<EventLoop>();
+    SimulationOptions options;
+    options.seed = seed;
+    options.cost_model = [](const Actor &actor, const Message &)
+    {
+        return std::chrono::microseconds(10 * static_cast<int>(actor.get_name().back() - '0' + 1));
+    };
+    event_loop->enable_simulation(options);
+
+    std::vector<std::shared_ptr<SimActor>> actors;
+    for (int i = 0; i < 5; ++i)
+    {
+        auto actor = std::make_shared<SimActor>("Sim" + std::to_string(i), event_loop, trace);
+        event_loop->register_actor(actor);
+        actors.push_back(actor);
+    }
+    for (size_t i = 0; i < actors.size(); ++i)
+    {
+        actors[i]->set_peers({actors[(i + 1) % actors.size()]->get_id(),
+                              actors[(i + 2) % actors.size()]->get_id()});
+    }
+
+    event_loop->run_until_idle();
+    for (const auto &actor : actors)
+    {
+        std::map<std::string, std::any> payload;
+        payload["fanout"] = 4;
+        event_loop->deliver_message(Message("work", "sender", actor->get_id(), payload));
+    }
+    size_t processed = event_loop->run_until_idle();
+    assert(processed == trace.size());
+    assert(processed == 5 * 31);
+
+    return trace;
+}
+
+// 测试仿真模式的调度顺序和虚拟时间可复现
+void test_deterministic_simulation()
+{
+    std::cout << "Running deterministic simulation test..." << std::endl;
+
+    auto first = run_simulated_workload(42);
+    auto second = run_simulated_workload(42);
+    auto other_seed = run_simulated_workload(7);
+
+    assert(first == second);
+    assert(first != other_seed);
+
+    std::cout << "Deterministic simulation test passed!" << std::endl;
+}
+
+// 测试定时器在仿真模式下使用虚拟时间，不需要真实等待
+void test_virtual_time_timers()
+{
+    std::cout << "Running virtual time timer test..." << std::endl;
+
+    std::vector<std::string> trace;
+    auto event_loop = std::make_shared<EventLoop>();
+    SimulationOptions options;
+    options.cost_model = [](const Actor &, const Message &)
+    { return std::chrono::milliseconds(1); };
+    event_loop->enable_simulation(options);
+
+    auto actor = std::make_shared<SimActor>("Timer0", event_loop, trace);
+    event_loop->register_actor(actor);
+    event_loop->run_until_idle();
+
+    // 虚拟时钟只在事件循环的线程上安装，在其他线程上创建消息时需要显式安装
+    assert(&Clock::current() == &Clock::system());
+    ClockScope clock_scope(event_loop->clock());
+    std::map<std::string, std::any> payload;
+    payload["fanout"] = 0;
+    Message msg("work", "sender", actor->get_id(), payload);
+    assert(msg.get_created_at() == Clock::time_point{});
+
+    auto wall_start = std::chrono::steady_clock::now();
+    event_loop->deliver_after(msg, std::chrono::hours(1));
+    event_loop->deliver_after(msg, std::chrono::seconds(10));
+    assert(event_loop->has_work());
+
+    assert(event_loop->run_until_idle() == 2);
+    assert(std::chrono::steady_clock::now() - wall_start < std::chrono::seconds(1));
+
+    // 处理时刻为定时器到期时刻，之后按耗时模型推进1ms
+    assert(trace.size() == 2);
+    assert(trace[0] == "Timer0@10000000");
+    assert(trace[1] == "Timer0@3600000000");
+    assert(event_loop->virtual_clock()->now() ==
+           Clock::time_point{} + std::chrono::hours(1) + std::chrono::milliseconds(1));
+
+    // 同时存在的普通事件循环不受仿真的影响，处理函数看到的是真实时间
+    std::vector<std::string> real_trace;
+    auto real_loop = std::make_shared<EventLoop>();
+    auto real_actor = std::make_shared<SimActor>("Real0", real_loop, real_trace);
+    real_loop->register_actor(real_actor);
+    real_loop->run_until_idle();
+    real_loop->deliver_message(Message("work", "sender", real_actor->get_id(), payload));
+    size_t processed = real_loop->run_until_idle();
+    assert(processed == 1);
+    assert(real_trace.size() == 1);
+    auto real_us = std::stoll(real_trace[0].substr(real_trace[0].find('@') + 1));
+    assert(real_us > std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::hours(24 * 365 * 30)).count());
+
+    std::cout << "Virtual time timer test passed!" << std::endl;
+}
+
+void test_latency_histogram()
+{
+    std::cout << "Running latency histogram test..." << std::endl;
+
+    LatencyHistogram histogram;
+    assert(histogram.count() == 0);
+    assert(histogram.value_at_percentile(99) == 0);
+
+    for (int64_t value = 1; value <= 100000; ++value)
+    {
+        histogram.record(value);
+    }
+    assert(histogram.count() == 100000);
+    assert(histogram.min() == 1);
+    assert(histogram.max() == 100000);
+
+    // 相对误差不超过1/64
+    auto p50 = histogram.value_at_percentile(50);
+    auto p99 = histogram.value_at_percentile(99);
+    assert(p50 >= 50000 && p50 <= 50000 + 50000 / 64);
+    assert(p99 >= 99000 && p99 <= 99000 + 99000 / 64);
+    assert(histogram.value_at_percentile(100) >= 100000);
+
+    LatencyHistogram other;
+    other.record(1000000000, 10);
+    histogram.merge(other);
+    assert(histogram.count() == 100010);
+    assert(histogram.max() == 1000000000);
+
+    histogram.reset();
+    assert(histogram.count() == 0);
+
+    std::cout << "Latency histogram test passed!" << std::endl;
+}
+
+void test_keep_alive()
+{
+    std::cout << "Running keep-alive test..." << std::endl;
+
+    auto event_loop = std::make_shared<EventLoop>();
+    event_loop->set_worker_count(2);
+    auto actor = std::make_shared<TestActor>("KeepAlive", event_loop);
+    event_loop->register_actor(actor);
+    event_loop->run_until_idle();
+
+    // 常驻模式下没有消息时事件循环也不退出，投递会唤醒空闲worker
+    event_loop->set_keep_alive(true);
+    std::thread loop_thread([&event_loop]()
+                            { event_loop->run(); });
+    std::this_thread::sleep_for(std::chrono::milliseconds(20));
+    assert(event_loop->is_running());
+
+    Message msg("test", "sender", actor->get_id());
+    event_loop->deliver_message(msg);
+    auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(5);
+    while (actor->get_message_count() < 1 && std::chrono::steady_clock::now() < deadline)
+    {
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    assert(actor->get_message_count() == 1);
+
+    event_loop->stop();
+    loop_thread.join();
+    assert(!event_loop->is_running());
+
+    std::cout << "Keep-alive test passed!" << std::endl;
+}
+
+// 统计分配次数的内存资源（转发给new/delete）
+class CountingResource : public std::pmr::memory_resource
+{
+public:
+    size_t allocations() const { return allocations_; }
+    size_t outstanding() const { return outstanding_; }
+
+private:
+    std::atomic<size_t> allocations_{0};
+    std::atomic<size_t> outstanding_{0};
+
+    void *do_allocate(size_t bytes, size_t alignment) override
+    {
+        ++allocations_;
+        ++outstanding_;
+        return std::pmr::new_delete_resource()->allocate(bytes, alignment);
+    }
+
+    void do_deallocate(void *p, size_t bytes, size_t alignment) override
+    {
+        --outstanding_;
+        std::pmr::new_delete_resource()->deallocate(p, bytes, alignment);
+    }
+
+    bool do_is_equal(const std::pmr::memory_resource &other) const noexcept override
+    {
+        return this == &other;
+    }
+};
+
+// 以std::map接收负载的旧用法
+size_t count_payload_keys(std::map<std::string, std::any> payload)
+{
+    return payload.size();
+}
+
+// 测试get_payload()仍可以绑定到std::map，get_pmr_payload()返回负载本身
+void test_payload_compatibility()
+{
+    std::cout << "Running payload compatibility test..." << std::endl;
+
+    std::map<std::string, std::any> payload;
+    payload["value"] = 42;
+    payload["name"] = std::string("compat");
+    Message message("test", "sender", "target", payload);
+
+    const std::map<std::string, std::any> &bound = message.get_payload();
+    assert(bound.size() == 2);
+    assert(std::any_cast<int>(bound.at("value")) == 42);
+    assert(count_payload_keys(message.get_payload()) == 2);
+    std::map<std::string, std::any> copied = message.get_payload();
+    copied.erase("value");
+    assert(message.has_payload_key("value"));
+
+    const Message::Payload &pmr_payload = message.get_pmr_payload();
+    assert(&pmr_payload == &message.get_pmr_payload());
+    assert(std::any_cast<std::string>(pmr_payload.at("name")) == "compat");
+
+    std::cout << "Payload compatibility test passed!" << std::endl;
+}
+
+// 测试邮箱和进入邮箱的负载从Actor所在worker的内存资源分配
+void test_memory_resources()
+{
+    std::cout << "Running memory resources test..." << std::endl;
+
+    // 复制回到默认资源，带分配器的复制和移动使用指定的资源
+    CountingResource local;
+    Message::Payload payload(&local);
+    payload["value"] = 42;
+    Message original("test", "sender", "target", std::move(payload));
+    assert(original.get_allocator().resource() == &local);
+    Message copied = original;
+    assert(copied.get_allocator().resource() == std::pmr::get_default_resource());
+    Message rehomed(copied, Message::allocator_type(&local));
+    assert(rehomed.get_allocator().resource() == &local);
+    assert(rehomed.get_payload_value<int>("value") == 42);
+
+    auto first = std::make_shared<CountingResource>();
+    auto second = std::make_shared<CountingResource>();
+    auto event_loop = std::make_shared<EventLoop>();
+    event_loop->set_worker_count(2);
+    event_loop->set_memory_resources({first, second});
+    std::vector<std::shared_ptr<TestActor>> actors;
+    for (int i = 0; i < 2; ++i)
+    {
+        auto actor = std::make_shared<TestActor>("Pooled" + std::to_string(i), event_loop);
+        event_loop->register_actor(actor);
+        actors.push_back(actor);
+    }
+    for (const auto &actor : actors)
+    {
+        auto *expected = actor->get_serial() % 2 == 0 ? first.get() : second.get();
+        assert(actor->mailbox_resource() == expected);
+    }
+    event_loop->run_until_idle();
+
+    size_t before = first->allocations() + second->allocations();
+    for (int i = 0; i < 100; ++i)
+    {
+        for (const auto &actor : actors)
+        {
+            event_loop->deliver_message(Message("test", "sender", actor->get_id(), {{"index", i}}));
+        }
+    }
+    assert(first->allocations() + second->allocations() >= before + 200);
+    event_loop->run_until_idle();
+    for (const auto &actor : actors)
+    {
+        assert(actor->get_message_count() == 100);
+    }
+
+    // 销毁Actor之后所有分配都已归还
+    actors.clear();
+    event_loop.reset();
+    assert(first->outstanding() == 0);
+    assert(second->outstanding() == 0);
+
+    std::cout << "Memory resources test passed!" << std::endl;
+}
+
+// 在临时内存区上构造临时容器，并记录处理函数开始和结束时临时内存区的用量
+class ScratchUser : public Actor
+{
+public:
+    ScratchUser(const std::string &name, std::weak_ptr<EventLoop> event_loop, std::string peer)
+        : Actor(name, event_loop), peer_(std::move(peer))
+    {
+        register_handler("work", [this](const Message &)
+                         {
+                             ScratchArena &arena = Actor::scratch_arena();
+                             size_t at_entry = arena.used();
+                             std::pmr::vector<int> values(&arena);
+                             for (int i = 0; i < 1000; ++i)
+                             {
+                                 values.push_back(i);
+                             }
+                             std::pmr::string text("scratch text longer than the small string buffer", &arena);
+                             Message::Payload payload(&arena);
+                             payload["sum"] = static_cast<int>(values.size());
+                             send(peer_, Message("test", id_, peer_, std::move(payload)));
+                             usage_.emplace_back(at_entry, arena.used()); });
+    }
+
+    std::vector<std::pair<size_t, size_t>> usage_;
+
+private:
+    std::string peer_;
+};
+
+// 测试临时内存区的分配、重置后复用，以及每次处理后自动重置
+void test_scratch_arena()
+{
+    std::cout << "Running scratch arena test..." << std::endl;
+
+    ScratchArena arena(1024, 4096);
+    void *first = arena.allocate(100, 8);
+    void *aligned = arena.allocate(10, 64);
+    assert(reinterpret_cast<uintptr_t>(aligned) % 64 == 0);
+    assert(arena.used() >= 110);
+    arena.reset();
+    assert(arena.used() == 0);
+    assert(arena.allocate(100, 8) == first);
+
+    // 超过保留上限的大块在重置时归还
+    void *large = arena.allocate(10000, 16);
+    assert(large != nullptr);
+    assert(arena.capacity() > 10000);
+    arena.reset();
+    assert(arena.capacity() == 1024);
+
+    auto event_loop = std::make_shared<EventLoop>();
+    auto sink = std::make_shared<TestActor>("ScratchSink", event_loop);
+    auto user = std::make_shared<ScratchUser>("ScratchUser", event_loop, sink->get_id());
+    event_loop->register_actor(sink);
+    event_loop->register_actor(user);
+    event_loop->run_until_idle();
+    for (int i = 0; i < 5; ++i)
+    {
+        event_loop->deliver_message(Message("work", "sender", user->get_id()));
+    }
+    event_loop->run_until_idle();
+
+    assert(user->usage_.size() == 5);
+    for (const auto &[at_entry, at_exit] : user->usage_)
+    {
+        assert(at_entry == 0);
+        assert(at_exit > 1000 * sizeof(int));
+    }
+    assert(sink->get_message_count() == 5);
+
+    std::cout << "Scratch arena test passed!" << std::endl;
+}
+
+// 测试大页区域的分配和对齐，以及没有预留大页时MAP_HUGETLB退回透明大页
+void test_huge_page_arena()
+{
+    std::cout << "Running huge page arena test..." << std::endl;
+
+    for (HugePageMode mode : {HugePageMode::OFF, HugePageMode::TRANSPARENT, HugePageMode::EXPLICIT})
+    {
+        HugePageArena arena(mode, 1);
+        char *first = static_cast<char *>(arena.allocate(100, 8));
+        assert(mode == HugePageMode::OFF || reinterpret_cast<uintptr_t>(first) % HugePageArena::kHugePageBytes == 0);
+        std::memset(first, 1, 100);
+        void *aligned = arena.allocate(64, 64);
+        assert(reinterpret_cast<uintptr_t>(aligned) % 64 == 0);
+        assert(arena.mapped_bytes() == HugePageArena::kHugePageBytes);
+
+        // 放不下的分配单独映射，之后的小分配继续使用原来的区域
+        char *large = static_cast<char *>(arena.allocate(5 * 1024 * 1024, 16));
+        large[5 * 1024 * 1024 - 1] = 1;
+        assert(arena.mapped_bytes() == 8 * 1024 * 1024);
+        char *next = static_cast<char *>(arena.allocate(16, 16));
+        assert(next > first && next < first + HugePageArena::kHugePageBytes);
+        if (mode == HugePageMode::OFF)
+        {
+            assert(arena.huge_bytes() == 0);
+        }
+    }
+
+    // 池资源可以直接作为worker的内存资源
+    auto event_loop = std::make_shared<EventLoop>();
+    event_loop->set_memory_resources({make_huge_page_pool(HugePageMode::TRANSPARENT, 4 * 1024 * 1024)});
+    auto actor = std::make_shared<TestActor>("HugePages", event_loop);
+    event_loop->register_actor(actor);
+    event_loop->run_until_idle();
+    for (int i = 0; i < 1000; ++i)
+    {
+        event_loop->deliver_message(Message("test", "sender", actor->get_id(), {{"index", i}}));
+    }
+    event_loop->run_until_idle();
+    assert(actor->get_message_count() == 1000);
+
+    std::cout << "Huge page arena test passed!" << std::endl;
+}
+
+void test_buffer()
+{
+    std::cout << "Running buffer test..." << std::endl;
+
+    // 释放的块回到池中，同一级别的下一次分配复用它
+    BufferPool pool;
+    const char *first_block = nullptr;
+    {
+        Buffer buffer = pool.allocate(5000);
+        assert(buffer.size() == 5000);
+        first_block = buffer.data();
+        std::memset(buffer.mutable_data(), 'a', buffer.size());
+    }
+    assert(pool.cached_bytes() == 8192);
+    Buffer reused = pool.allocate(6000);
+    assert(reused.data() == first_block);
+    assert(pool.cached_bytes() == 0);
+
+    // 子范围共享同一块内存，越界时抛出异常
+    std::memcpy(reused.mutable_data(), "hello world", 11);
+    Buffer world = reused.slice(6, 5);
+    assert(world.to_string() == "world");
+    assert(world.data() == reused.data() + 6);
+    assert(reused.use_count() == 2);
+    bool out_of_range = false;
+    try
+    {
+        reused.slice(5990, 20);
+    }
+    catch (const std::out_of_range &)
+    {
+        out_of_range = true;
+    }
+    assert(out_of_range);
+
+    // 消息的复制只增加引用计数
+    Message message("blob", "sender", "target", {{"data", world}});
+    Message copy = message;
+    Buffer carried = copy.get_payload_value<Buffer>("data");
+    assert(carried.data() == world.data());
+    assert(world.use_count() == 5);
+
+    // 映射的文件只读，记录描述符和偏移
+    char path[] = "/tmp/actor_cpp_buffer_XXXXXX";
+    int fd = mkstemp(path);
+    assert(fd >= 0);
+    std::string content(100000, 'x');
+    content.replace(50000, 5, "mark!");
+    ssize_t written = write(fd, content.data(), content.size());
+    assert(written == static_cast<ssize_t>(content.size()));
+    close(fd);
+    Buffer mapped = Buffer::map_file(path);
+    std::remove(path);
+    assert(mapped.size() == content.size());
+    assert(mapped.file_descriptor() >= 0);
+    Buffer mark = mapped.slice(50000, 5);
+    assert(mark.to_string() == "mark!");
+    assert(mark.file_offset() == 50000);
+    bool read_only = false;
+    try
+    {
+        mapped.mutable_data();
+    }
+    catch (const std::logic_error &)
+    {
+        read_only = true;
+    }
+    assert(read_only);
+
+    std::cout << "Buffer test passed!" << std::endl;
+}
+
+// 随机插入、删除和查找，与std::unordered_map的结果对照；字符串键用string_view查找
+void test_flat_hash_map()
+{
+    std::cout << "Running flat hash map test..." << std::endl;
+
+    FlatHashMap<uint64_t, int> numbers;
+    std::unordered_map<uint64_t, int> expected;
+    std::mt19937_64 rng(42);
+    for (int i = 0; i < 20000; ++i)
+    {
+        uint64_t key = rng() % 2000;
+        if (rng() % 3 == 0)
+        {
+            size_t erased = numbers.erase(key);
+            size_t expected_erased = expected.erase(key);
+            assert(erased == expected_erased);
+        }
+        else
+        {
+            numbers[key] = i;
+            expected[key] = i;
+        }
+    }
+    assert(numbers.size() == expected.size());
+    for (uint64_t key = 0; key < 2000; ++key)
+    {
+        auto it = numbers.find(key);
+        auto found = expected.find(key);
+        assert((it == numbers.end()) == (found == expected.end()));
+        assert(it == numbers.end() || it->second == found->second);
+    }
+    size_t visited = 0;
+    for (const auto &[key, value] : numbers)
+    {
+        assert(expected.at(key) == value);
+        ++visited;
+    }
+    assert(visited == expected.size());
+
+    // 表已满到扩容阈值时插入已有的键不扩容，迭代器和引用保持有效
+    FlatHashMap<int, int> full;
+    for (int i = 0; i < 14; ++i)
+    {
+        full.try_emplace(i, i);
+    }
+    auto first = full.find(0);
+    const int *first_value = &first->second;
+    auto existing = full.try_emplace(0, 100);
+    assert(!existing.second);
+    assert(existing.first == first);
+    assert(&full.find(0)->second == first_value && *first_value == 0);
+    full[5] = 50;
+    assert(&full.find(0)->second == first_value);
+    assert(full.try_emplace(14, 14).second);
+    assert(full.size() == 15 && full.find(5)->second == 50);
+
+    FlatHashMap<std::string, int, StringHash, std::equal_to<>> names;
+    bool inserted = names.try_emplace("alpha", 1).second;
+    assert(inserted);
+    inserted = names.try_emplace(std::string("alpha"), 2).second;
+    assert(!inserted);
+    names["beta"] = 3;
+    std::string_view beta = "beta-suffix";
+    assert(names.find(beta.substr(0, 4))->second == 3);
+    assert(names.contains("alpha"));
+    assert(!names.contains(std::string_view("gamma")));
+    size_t erased = names.erase(std::string_view("alpha"));
+    assert(erased == 1);
+    assert(names.size() == 1);
+
+    // 事件循环按ID（string_view）和序号查找Actor
+    auto event_loop = std::make_shared<EventLoop>();
+    auto actor = std::make_shared<TestActor>("Lookup", event_loop);
+    event_loop->register_actor(actor);
+    std::string_view id = actor->get_id();
+    assert(event_loop->find_actor(id) == actor);
+    assert(event_loop->find_actor(id.data()) == actor);
+    assert(event_loop->find_actor_by_serial(actor->get_serial()) == actor);
+    std::string removed_id = actor->get_id();
+    event_loop->remove_actor(removed_id);
+    assert(event_loop->find_actor(removed_id) == nullptr);
+    assert(event_loop->find_actor_by_serial(actor->get_serial()) == nullptr);
+
+    std::cout << "Flat hash map test passed!" << std::endl;
+}
+
+// 多个线程并发创建Actor，ID都是合法的UUID v4且互不相同
+void test_actor_ids()
+{
+    std::cout << "Running actor id test..." << std::endl;
+
+    auto event_loop = std::make_shared<EventLoop>();
+    std::vector<std::vector<std::string>> ids(4);
+    std::vector<std::thread> threads;
+    for (auto &thread_ids : ids)
+    {
+        threads.emplace_back([&event_loop, &thread_ids]()
+                             {
+            for (int i = 0; i < 5000; ++i)
+            {
+                TestActor actor("Id", event_loop);
+                thread_ids.push_back(actor.get_id());
+            } });
+    }
+    for (auto &thread : threads)
+    {
+        thread.join();
+    }
+
+    std::unordered_set<std::string> unique;
+    for (const auto &thread_ids : ids)
+    {
+        for (const auto &id : thread_ids)
+        {
+            assert(id.size() == 36);
+            for (size_t i = 0; i < id.size(); ++i)
+            {
+                bool dash = i == 8 || i == 13 || i == 18 || i == 23;
+                assert(dash ? id[i] == '-' : std::strchr("0123456789abcdef", id[i]) != nullptr);
+            }
+            assert(id[14] == '4');
+            assert(std::strchr("89ab", id[19]) != nullptr);
+            unique.insert(id);
+        }
+    }
+    assert(unique.size() == 4 * 5000);
+
+    std::cout << "Actor id test passed!" << std::endl;
+}
+
+// 延迟启动：只有收到消息的Actor被启动，并且在处理第一条消息之前已经初始化
+void test_lazy_start()
+{
+    std::cout << "Running lazy start test..." << std::endl;
+
+    auto event_loop = std::make_shared<EventLoop>();
+    event_loop->set_worker_count(2);
+    event_loop->set_lazy_start(true);
+    std::vector<std::shared_ptr<TestActor>> actors;
+    for (int i = 0; i < 100; ++i)
+    {
+        auto actor = std::make_shared<TestActor>("Lazy" + std::to_string(i), event_loop);
+        event_loop->register_actor(actor);
+        actors.push_back(actor);
+    }
+    event_loop->run_until_idle();
+    for (const auto &actor : actors)
+    {
+        assert(actor->get_state() == Actor::State::CREATED);
+    }
+
+    // 未启动的Actor也接收消息，回复会让发送方（同样未启动）启动
+    for (int i = 0; i < 10; ++i)
+    {
+        event_loop->deliver_message(Message("test", actors[i + 10]->get_id(), actors[i]->get_id(), {{"reply", true}}));
+    }
+    event_loop->deliver_message(Message("test", "sender", actors[0]->get_id()));
+    event_loop->run_until_idle();
+    for (int i = 0; i < 100; ++i)
+    {
+        bool active = i < 20;
+        assert(actors[i]->get_state() == (active ? Actor::State::RUNNING : Actor::State::CREATED));
+        assert(actors[i]->get_message_count() == (i == 0 ? 2 : active ? 1 : 0));
+    }
+
+    // 关闭时只停止启动过的Actor，未启动Actor邮箱中的消息计为丢弃
+    event_loop->deliver_message(Message("test", "sender", actors[50]->get_id()));
+    event_loop->set_shutdown_options({std::chrono::milliseconds(0), 1});
+    ShutdownReport report = event_loop->shutdown();
+    assert(report.actors_stopped == 20);
+    assert(report.messages_dropped == 1);
+    assert(event_loop->in_flight_messages() == 0);
+    assert(actors[50]->get_state() == Actor::State::CREATED);
+
+    std::cout << "Lazy start test passed!" << std::endl;
+}
+
+// 就绪队列：只有收到消息的Actor进入所在worker的队列，worker数量变化后重新分配，移除的Actor不再被队列引用
+void test_run_queues()
+{
+    std::cout << "Running run queue test..." << std::endl;
+
+    auto event_loop = std::make_shared<EventLoop>();
+    event_loop->set_worker_count(3);
+    std::vector<std::shared_ptr<TestActor>> actors;
+    for (int i = 0; i < 300; ++i)
+    {
+        auto actor = std::make_shared<TestActor>("Ready" + std::to_string(i), event_loop);
+        event_loop->register_actor(actor);
+        actors.push_back(actor);
+    }
+    event_loop->run_until_idle();
+
+    // 在3个worker的划分下入队，以2个worker运行
+    event_loop->set_worker_count(2);
+    for (int i = 0; i < 10; ++i)
+    {
+        event_loop->deliver_message(Message("test", "sender", actors[i * 7]->get_id()));
+    }
+    size_t processed = event_loop->run_until_idle();
+    assert(processed == 10);
+    for (int i = 0; i < 300; ++i)
+    {
+        assert(actors[i]->get_message_count() == (i % 7 == 0 && i < 70 ? 1 : 0));
+    }
+
+    // 移除邮箱中还有消息的Actor，就绪队列不再持有它
+    event_loop->deliver_message(Message("test", "sender", actors[20]->get_id()));
+    std::weak_ptr<TestActor> removed = actors[20];
+    event_loop->remove_actor(actors[20]->get_id());
+    actors[20].reset();
+    assert(removed.expired());
+    processed = event_loop->run_until_idle();
+    assert(processed == 0);
+    assert(event_loop->in_flight_messages() == 0);
+
+    std::cout << "Run queue test passed!" << std::endl;
+}
+
 int main()
 {
     test_basic_actor();
     test_actor_communication();
     test_schedulers();
+    test_graceful_shutdown();
+    test_shutdown_deadline();
+    test_termination_detector();
+    test_run_until_idle();
+    test_deterministic_simulation();
+    test_virtual_time_timers();
+    test_latency_histogram();
+    test_keep_alive();
+    test_buffer();
+    test_payload_compatibility();
+    test_memory_resources();
+    test_scratch_arena();
+    test_huge_page_arena();
+    test_flat_hash_map();
+    test_actor_ids();
+    test_lazy_start();
+    test_run_queues();
 
     std::cout << "All tests passed!" << std::endl;
     return 0;
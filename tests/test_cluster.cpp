@@ -0,0 +1,942 @@
+#include <iostream>
+#include <cassert>
+#include <chrono>
+#include <condition_variable>
+#include <cstdio>
+#include <cstring>
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <random>
+#include <set>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+#include <unistd.h>
+
+#include "actor.h"
+#include "buffer.h"
+#include "compression.h"
+#include "event_loop.h"
+#include "logging.h"
+#include "membership.h"
+#include "message.h"
+#include "remote.h"
+#include "sharding.h"
+
+// 记录收到的成员变化的Actor
+class MemberRecorder : public Actor
+{
+public:
+    MemberRecorder(const std::string &name, std::weak_ptr<EventLoop> event_loop)
+        : Actor(name, event_loop)
+    {
+        for (const char *type : {Membership::kMemberUp, Membership::kMemberSuspect, Membership::kMemberDown,
+                                 Membership::kMemberLeft})
+        {
+            register_handler(type, [this](const Message &msg)
+                             {
+                                 std::lock_guard<std::mutex> lock(mutex_);
+                                 events_.push_back(msg.get_type() + " " + msg.get_payload_value<std::string>("address")); });
+        }
+    }
+
+    bool has_event(const std::string &type, const std::string &address)
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        for (const auto &event : events_)
+        {
+            if (event == type + " " + address)
+            {
+                return true;
+            }
+        }
+        return false;
+    }
+
+private:
+    std::mutex mutex_;
+    std::vector<std::string> events_;
+};
+
+// 轮询直到条件成立或超时
+bool wait_until(const std::function<bool()> &condition, std::chrono::milliseconds timeout)
+{
+    auto deadline = std::chrono::steady_clock::now() + timeout;
+    while (std::chrono::steady_clock::now() < deadline)
+    {
+        if (condition())
+        {
+            return true;
+        }
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+    return condition();
+}
+
+MemberStatus status_of(const Membership &membership, const std::string &address)
+{
+    for (const auto &member : membership.members())
+    {
+        if (member.address == address)
+        {
+            return member.status;
+        }
+    }
+    return MemberStatus::DEAD;
+}
+
+// 测试phi随距上次心跳的时间增长，心跳规律时很快超过阈值
+void test_phi_accrual_detector()
+{
+    std::cout << "Running phi accrual detector test..." << std::endl;
+
+    PhiAccrualDetector detector(100, std::chrono::milliseconds(10));
+    auto now = std::chrono::steady_clock::now();
+    assert(detector.phi(now) == 0.0);
+    for (int i = 0; i < 20; ++i)
+    {
+        detector.heartbeat(now);
+        now += std::chrono::milliseconds(i % 2 ? 90 : 110);
+    }
+    assert(detector.samples() == 19);
+
+    auto last = now - std::chrono::milliseconds(110);
+    double on_time = detector.phi(last + std::chrono::milliseconds(100));
+    double late = detector.phi(last + std::chrono::milliseconds(150));
+    double very_late = detector.phi(last + std::chrono::milliseconds(300));
+    assert(on_time < 1.0);
+    assert(late > on_time);
+    assert(very_late > 8.0);
+
+    std::cout << "Phi accrual detector test passed!" << std::endl;
+}
+
+// 测试节点通过种子加入、崩溃的节点被判定为DEAD、主动离开的节点被标记为LEFT，
+// 以及订阅的Actor收到对应的消息
+void test_membership_gossip()
+{
+    std::cout << "Running membership gossip test..." << std::endl;
+
+    MembershipOptions options;
+    options.protocol_period = std::chrono::milliseconds(50);
+    options.ack_timeout = std::chrono::milliseconds(15);
+    options.suspicion_multiplier = 3;
+
+    std::vector<std::unique_ptr<Membership>> nodes;
+    options.name = "node0";
+    nodes.push_back(std::make_unique<Membership>(options));
+    options.seeds = {nodes[0]->address()};
+    for (int i = 1; i < 5; ++i)
+    {
+        options.name = "node" + std::to_string(i);
+        nodes.push_back(std::make_unique<Membership>(options));
+    }
+
+    bool converged = wait_until([&nodes]()
+                                {
+        for (const auto &node : nodes)
+        {
+            if (node->alive_count() != nodes.size())
+            {
+                return false;
+            }
+        }
+        return true; },
+                                std::chrono::seconds(5));
+    assert(converged);
+    auto members = nodes[3]->members();
+    assert(members.size() == 5);
+    assert(members[0].name.rfind("node", 0) == 0);
+
+    auto event_loop = std::make_shared<EventLoop>();
+    auto recorder = std::make_shared<MemberRecorder>("recorder", event_loop);
+    event_loop->register_actor(recorder);
+    event_loop->run_until_idle();
+    nodes[1]->subscribe(event_loop, recorder->get_id());
+    event_loop->run_until_idle();
+    for (const auto &node : nodes)
+    {
+        assert(recorder->has_event(Membership::kMemberUp, node->address()));
+    }
+
+    // 直接停止node4，相当于进程崩溃
+    std::string crashed = nodes[4]->address();
+    nodes[4]->stop();
+    bool detected = wait_until([&nodes, &crashed]()
+                               {
+        for (int i = 0; i < 4; ++i)
+        {
+            if (status_of(*nodes[i], crashed) != MemberStatus::DEAD)
+            {
+                return false;
+            }
+        }
+        return true; },
+                               std::chrono::seconds(5));
+    assert(detected);
+    event_loop->run_until_idle();
+    assert(recorder->has_event(Membership::kMemberDown, crashed));
+
+    // node3主动离开，其他节点不需要等待故障检测
+    std::string departed = nodes[3]->address();
+    nodes[3]->leave();
+    bool left = wait_until([&nodes, &departed]()
+                           {
+        for (int i = 0; i < 3; ++i)
+        {
+            if (status_of(*nodes[i], departed) != MemberStatus::LEFT)
+            {
+                return false;
+            }
+        }
+        return true; },
+                           std::chrono::seconds(2));
+    assert(left);
+    event_loop->run_until_idle();
+    assert(recorder->has_event(Membership::kMemberLeft, departed));
+    assert(nodes[0]->alive_count() == 3);
+
+    // 协议包应当很小
+    uint64_t packets = nodes[0]->packets_sent();
+    assert(packets > 0);
+    assert(nodes[0]->bytes_sent() / packets < 128);
+
+    for (auto &node : nodes)
+    {
+        node->stop();
+    }
+    std::cout << "Membership gossip test passed!" << std::endl;
+}
+
+// 测试消息编码的往返和错误处理
+void test_message_codec()
+{
+    std::cout << "Running message codec test..." << std::endl;
+
+    Message message("order", "sender-1", "target-2",
+                    {{"text", std::string("hello")},
+                     {"literal", "world"},
+                     {"flag", true},
+                     {"small", -42},
+                     {"large", int64_t(-5000000000)},
+                     {"count", uint32_t(7)},
+                     {"total", uint64_t(1) << 60},
+                     {"price", 19.25}},
+                    Message::Priority::HIGH);
+    TraceContext context;
+    context.trace_id_high = 1;
+    context.trace_id_low = 2;
+    context.span_id = 3;
+    context.sampled = true;
+    message.set_trace_context(context);
+
+    std::string encoded = encode_message(message);
+    Message decoded = decode_message(encoded.data(), encoded.size());
+    assert(decoded.get_type() == "order");
+    assert(decoded.get_sender_id() == "sender-1");
+    assert(decoded.get_target_id() == "target-2");
+    assert(decoded.get_priority() == Message::Priority::HIGH);
+    assert(decoded.get_trace_context().trace_id_low == 2);
+    assert(decoded.get_trace_context().span_id == 3);
+    assert(decoded.get_trace_context().sampled);
+    assert(decoded.get_payload_value<std::string>("text") == "hello");
+    assert(decoded.get_payload_value<std::string>("literal") == "world");
+    assert(decoded.get_payload_value<bool>("flag"));
+    assert(decoded.get_payload_value<int>("small") == -42);
+    assert(decoded.get_payload_value<int64_t>("large") == -5000000000);
+    assert(decoded.get_payload_value<uint32_t>("count") == 7);
+    assert(decoded.get_payload_value<uint64_t>("total") == uint64_t(1) << 60);
+    assert(decoded.get_payload_value<double>("price") == 19.25);
+
+    bool truncated_rejected = false;
+    try
+    {
+        decode_message(encoded.data(), encoded.size() - 1);
+    }
+    catch (const std::runtime_error &)
+    {
+        truncated_rejected = true;
+    }
+    assert(truncated_rejected);
+
+    bool unsupported_rejected = false;
+    try
+    {
+        encode_message(Message("bad", "", "", {{"values", std::vector<int>{1, 2}}}));
+    }
+    catch (const std::runtime_error &)
+    {
+        unsupported_rejected = true;
+    }
+    assert(unsupported_rejected);
+
+    std::cout << "Message codec test passed!" << std::endl;
+}
+
+// 记录收到的消息序号的Actor
+class SequenceRecorder : public Actor
+{
+public:
+    SequenceRecorder(const std::string &name, std::weak_ptr<EventLoop> event_loop)
+        : Actor(name, event_loop)
+    {
+        register_handler("seq", [this](const Message &msg)
+                         {
+                             std::lock_guard<std::mutex> lock(mutex_);
+                             values_.push_back(msg.get_payload_value<int>("n")); });
+    }
+
+    std::vector<int> values()
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        return values_;
+    }
+
+private:
+    std::mutex mutex_;
+    std::vector<int> values_;
+};
+
+// 测试节点之间的消息按顺序到达，以及按名称注册的端点
+void test_remote_transport()
+{
+    std::cout << "Running remote transport test..." << std::endl;
+
+    auto receiver_loop = std::make_shared<EventLoop>();
+    auto recorder = std::make_shared<SequenceRecorder>("recorder", receiver_loop);
+    receiver_loop->register_actor(recorder);
+    receiver_loop->set_keep_alive(true);
+    std::thread loop_thread([&receiver_loop]()
+                            { receiver_loop->run(); });
+    bool started = wait_until([&]()
+                              { return recorder->is_running(); },
+                              std::chrono::seconds(5));
+    assert(started);
+
+    RemoteTransport receiver(receiver_loop);
+    RemoteTransport sender(std::weak_ptr<EventLoop>{});
+    assert(receiver.address() == "127.0.0.1:" + std::to_string(receiver.port()));
+
+    std::mutex endpoint_mutex;
+    std::vector<std::string> endpoint_senders;
+    receiver.add_endpoint("service", [&](const Message &msg)
+                          {
+                              std::lock_guard<std::mutex> lock(endpoint_mutex);
+                              endpoint_senders.push_back(msg.get_sender_id()); });
+
+    const int count = 2000;
+    for (int i = 0; i < count; ++i)
+    {
+        bool queued = sender.send(receiver.address(), Message("seq", "remote", recorder->get_id(), {{"n", i}}));
+        assert(queued);
+    }
+    bool queued = sender.send(receiver.address(), Message("call", "caller", "service"));
+    assert(queued);
+
+    bool arrived = wait_until([&]()
+                              { return recorder->values().size() == count; },
+                              std::chrono::seconds(5));
+    assert(arrived);
+    auto values = recorder->values();
+    for (int i = 0; i < count; ++i)
+    {
+        assert(values[i] == i);
+    }
+    bool called = wait_until([&]()
+                             {
+        std::lock_guard<std::mutex> lock(endpoint_mutex);
+        return endpoint_senders.size() == 1; },
+                             std::chrono::seconds(2));
+    assert(called);
+    assert(sender.messages_sent() == count + 1);
+    assert(receiver.messages_received() == count + 1);
+
+    // 发往不可达节点的消息被丢弃
+    RemoteTransport unreachable_peer(std::weak_ptr<EventLoop>{});
+    std::string unreachable = unreachable_peer.address();
+    unreachable_peer.stop();
+    sender.send(unreachable, Message("seq", "remote", "nobody", {{"n", 0}}));
+    bool dropped = wait_until([&sender]()
+                              { return sender.messages_dropped() == 1; },
+                              std::chrono::seconds(2));
+    assert(dropped);
+
+    sender.stop();
+    receiver.stop();
+    receiver_loop->stop();
+    loop_thread.join();
+    std::cout << "Remote transport test passed!" << std::endl;
+}
+
+// 测试LZ4块压缩的往返、可压缩数据变小，以及拒绝损坏的数据
+void test_lz4_block()
+{
+    std::cout << "Running LZ4 block test..." << std::endl;
+
+    std::mt19937 rng(42);
+    std::vector<std::string> inputs = {"", "a", "abcdefghijkl", std::string(100000, 'x')};
+    std::string text;
+    for (int i = 0; i < 2000; ++i)
+    {
+        text += "deposit account-" + std::to_string(i % 37) + " amount " + std::to_string(i) + "\n";
+    }
+    inputs.push_back(text);
+    std::string noise(70000, '\0');
+    for (auto &c : noise)
+    {
+        c = static_cast<char>(rng());
+    }
+    inputs.push_back(noise);
+
+    for (const auto &input : inputs)
+    {
+        std::string block = lz4_compress(input.data(), input.size());
+        std::string output;
+        bool ok = lz4_decompress(block.data(), block.size(), input.size(), output);
+        assert(ok);
+        assert(output == input);
+    }
+    std::string block = lz4_compress(text.data(), text.size());
+    assert(block.size() * 3 < text.size());
+
+    // 长度不符、截断和越界的偏移都被拒绝
+    std::string output;
+    assert(!lz4_decompress(block.data(), block.size(), text.size() + 1, output));
+    assert(!lz4_decompress(block.data(), block.size() / 2, text.size(), output));
+    const char bad_offset[] = {0x10, 'a', 0x05, 0x00};
+    assert(!lz4_decompress(bad_offset, sizeof(bad_offset), 10, output));
+
+    std::cout << "LZ4 block test passed!" << std::endl;
+}
+
+// 测试批量发送合并系统调用、压缩后消息仍按顺序到达
+void test_remote_batching()
+{
+    std::cout << "Running remote batching test..." << std::endl;
+
+    auto receiver_loop = std::make_shared<EventLoop>();
+    auto recorder = std::make_shared<SequenceRecorder>("recorder", receiver_loop);
+    receiver_loop->register_actor(recorder);
+    receiver_loop->set_keep_alive(true);
+    std::thread loop_thread([&receiver_loop]()
+                            { receiver_loop->run(); });
+    bool started = wait_until([&]()
+                              { return recorder->is_running(); },
+                              std::chrono::seconds(5));
+    assert(started);
+
+    RemoteTransport receiver(receiver_loop);
+    RemoteOptions options;
+    options.batch_window = std::chrono::microseconds(2000);
+    options.batch_bytes = 16 * 1024;
+    options.compress_bytes = 1024;
+    RemoteTransport sender(std::weak_ptr<EventLoop>{}, options);
+
+    const int count = 3000;
+    std::string note = "transfer between accounts of the same customer";
+    for (int i = 0; i < count; ++i)
+    {
+        bool queued = sender.send(receiver.address(),
+                                  Message("seq", "remote", recorder->get_id(), {{"n", i}, {"note", note}}));
+        assert(queued);
+    }
+    bool arrived = wait_until([&]()
+                              { return recorder->values().size() == count; },
+                              std::chrono::seconds(5));
+    assert(arrived);
+    auto values = recorder->values();
+    for (int i = 0; i < count; ++i)
+    {
+        assert(values[i] == i);
+    }
+    assert(sender.messages_sent() == count);
+    assert(receiver.messages_received() == count);
+    assert(sender.write_calls() * 10 < count);
+    assert(sender.bytes_saved() > 0);
+
+    // 单条消息在批次窗口到期后发出
+    bool queued = sender.send(receiver.address(), Message("seq", "remote", recorder->get_id(), {{"n", count}}));
+    assert(queued);
+    arrived = wait_until([&]()
+                         { return recorder->values().size() == count + 1; },
+                         std::chrono::seconds(2));
+    assert(arrived);
+
+    sender.stop();
+    receiver.stop();
+    receiver_loop->stop();
+    loop_thread.join();
+    std::cout << "Remote batching test passed!" << std::endl;
+}
+
+// 测试Buffer负载：编码时作为附件，解码时引用接收到的字节，经过远程传输内容不变
+void test_remote_zero_copy()
+{
+    std::cout << "Running remote zero-copy test..." << std::endl;
+
+    Buffer small = Buffer::copy("attached bytes", 14);
+    Message message("blob", "sender", "target", {{"small", small}, {"note", std::string("text")}});
+    std::string encoded = encode_message(message);
+    Buffer backing = Buffer::copy(encoded.data(), encoded.size());
+    Message decoded = decode_message(backing);
+    Buffer view = decoded.get_payload_value<Buffer>("small");
+    assert(view.to_string() == "attached bytes");
+    assert(view.data() >= backing.data() && view.data() + view.size() <= backing.data() + backing.size());
+    assert(decoded.get_payload_value<std::string>("note") == "text");
+    Message copied = decode_message(encoded.data(), encoded.size());
+    assert(copied.get_payload_value<Buffer>("small").to_string() == "attached bytes");
+
+    // 映射的文件大到走sendfile，分配的Buffer走writev，接收方直接读入池中的块
+    char path[] = "/tmp/actor_cpp_remote_XXXXXX";
+    int fd = mkstemp(path);
+    assert(fd >= 0);
+    std::string content;
+    for (int i = 0; content.size() < 3 * 1024 * 1024; ++i)
+    {
+        content += "line " + std::to_string(i) + "\n";
+    }
+    ssize_t written = write(fd, content.data(), content.size());
+    assert(written == static_cast<ssize_t>(content.size()));
+    close(fd);
+    Buffer file = Buffer::map_file(path);
+    std::remove(path);
+    Buffer block = Buffer::allocate(200000);
+    for (size_t i = 0; i < block.size(); ++i)
+    {
+        block.mutable_data()[i] = static_cast<char>(i * 31);
+    }
+
+    RemoteTransport receiver(std::weak_ptr<EventLoop>{});
+    std::mutex mutex;
+    std::vector<Message> received;
+    receiver.add_endpoint("sink", [&](const Message &msg)
+                          {
+                              std::lock_guard<std::mutex> lock(mutex);
+                              received.push_back(msg); });
+    RemoteTransport sender(std::weak_ptr<EventLoop>{});
+    for (int i = 0; i < 3; ++i)
+    {
+        bool queued = sender.send(receiver.address(),
+                                  Message("blob", "sender", "sink",
+                                          {{"n", i}, {"file", file}, {"block", block.slice(i, 1000 + i)}}));
+        assert(queued);
+    }
+    bool arrived = wait_until([&]()
+                              {
+                                  std::lock_guard<std::mutex> lock(mutex);
+                                  return received.size() == 3; },
+                              std::chrono::seconds(10));
+    assert(arrived);
+    for (int i = 0; i < 3; ++i)
+    {
+        const Message &msg = received[i];
+        assert(msg.get_payload_value<int>("n") == i);
+        Buffer body = msg.get_payload_value<Buffer>("file");
+        assert(body.size() == content.size());
+        assert(std::memcmp(body.data(), content.data(), content.size()) == 0);
+        Buffer part = msg.get_payload_value<Buffer>("block");
+        assert(part.size() == static_cast<size_t>(1000 + i));
+        assert(std::memcmp(part.data(), block.data() + i, part.size()) == 0);
+    }
+    assert(sender.messages_sent() == 3);
+
+    sender.stop();
+    receiver.stop();
+    std::cout << "Remote zero-copy test passed!" << std::endl;
+}
+
+// 放行之前阻塞在处理函数中的Actor（模拟很慢的接收者）
+class GatedRecorder : public Actor
+{
+public:
+    GatedRecorder(const std::string &name, std::weak_ptr<EventLoop> event_loop)
+        : Actor(name, event_loop)
+    {
+        register_handler("seq", [this](const Message &msg)
+                         {
+                             std::unique_lock<std::mutex> lock(mutex_);
+                             opened_.wait(lock, [this]() { return open_; });
+                             values_.push_back(msg.get_payload_value<int>("n")); });
+    }
+
+    void open()
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        open_ = true;
+        opened_.notify_all();
+    }
+
+    std::vector<int> values()
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        return values_;
+    }
+
+private:
+    std::mutex mutex_;
+    std::condition_variable opened_;
+    bool open_ = false;
+    std::vector<int> values_;
+};
+
+// 测试额度用完时消息在发送方排队、接收方邮箱不超过窗口，慢目标不阻塞同一连接上的其他目标，
+// 以及本地队列满时send()返回false
+void test_remote_flow_control()
+{
+    std::cout << "Running remote flow control test..." << std::endl;
+
+    // 两个worker按序号分配Actor，阻塞的慢接收者不影响另一个
+    auto receiver_loop = std::make_shared<EventLoop>();
+    receiver_loop->set_worker_count(2);
+    receiver_loop->set_keep_alive(true);
+    auto slow = std::make_shared<GatedRecorder>("slow", receiver_loop);
+    auto fast = std::make_shared<SequenceRecorder>("fast", receiver_loop);
+    receiver_loop->register_actor(slow);
+    receiver_loop->register_actor(fast);
+    std::thread loop_thread([&receiver_loop]()
+                            { receiver_loop->run(); });
+    bool started = wait_until([&]()
+                              { return slow->is_running() && fast->is_running(); },
+                              std::chrono::seconds(5));
+    assert(started);
+
+    RemoteTransport receiver(receiver_loop);
+    RemoteOptions options;
+    options.link_credits = 64;
+    options.target_credits = 16;
+    options.max_queued_bytes = 16 * 1024;
+    RemoteTransport sender(std::weak_ptr<EventLoop>{}, options);
+
+    int accepted = 0;
+    for (; accepted < 200; ++accepted)
+    {
+        bool queued = sender.send(receiver.address(), Message("seq", "remote", slow->get_id(), {{"n", accepted}}));
+        assert(queued);
+    }
+
+    // 慢接收者的邮箱最多积压一个窗口，其余消息在发送方排队
+    bool filled = wait_until([&]()
+                             { return slow->message_count() >= 15; },
+                             std::chrono::seconds(5));
+    assert(filled);
+    std::this_thread::sleep_for(std::chrono::milliseconds(100));
+    assert(slow->message_count() <= 16);
+    assert(sender.messages_sent() <= 17);
+    assert(sender.messages_deferred() >= 200 - 17);
+
+    // 同一连接上发给其他目标的消息不受影响
+    const int count = 50;
+    for (int i = 0; i < count; ++i)
+    {
+        bool queued = sender.send(receiver.address(), Message("seq", "remote", fast->get_id(), {{"n", i}}));
+        assert(queued);
+    }
+    bool arrived = wait_until([&]()
+                              { return fast->values().size() == count; },
+                              std::chrono::seconds(5));
+    assert(arrived);
+
+    // 发送方排队的字节数到达上限后拒绝新消息
+    while (accepted < 100000 &&
+           sender.send(receiver.address(), Message("seq", "remote", slow->get_id(), {{"n", accepted}})))
+    {
+        ++accepted;
+    }
+    assert(accepted < 100000);
+    assert(sender.messages_dropped() == 1);
+
+    // 放行后额度随邮箱排空返还，排队的消息按顺序全部到达
+    slow->open();
+    arrived = wait_until([&]()
+                         { return slow->values().size() == static_cast<size_t>(accepted); },
+                         std::chrono::seconds(10));
+    assert(arrived);
+    auto values = slow->values();
+    for (int i = 0; i < accepted; ++i)
+    {
+        assert(values[i] == i);
+    }
+    assert(sender.messages_dropped() == 1);
+
+    sender.stop();
+    receiver.stop();
+    receiver_loop->stop();
+    loop_thread.join();
+    std::cout << "Remote flow control test passed!" << std::endl;
+}
+
+// 测试一致性哈希的均衡性，以及增加节点时只有移到新节点的键改变归属
+void test_hash_ring()
+{
+    std::cout << "Running hash ring test..." << std::endl;
+
+    HashRing ring(100);
+    assert(ring.node_for(1).empty());
+    ring.set_nodes({"10.0.0.3:7000", "10.0.0.1:7000", "10.0.0.2:7000", "10.0.0.1:7000"});
+    assert(ring.nodes().size() == 3);
+    assert(ring.nodes()[0] == "10.0.0.1:7000");
+
+    const int keys = 30000;
+    std::map<std::string, int> counts;
+    std::vector<std::string> before;
+    for (int i = 0; i < keys; ++i)
+    {
+        before.push_back(ring.node_for(shard_hash("key-" + std::to_string(i))));
+        ++counts[before.back()];
+    }
+    for (const auto &[node, count] : counts)
+    {
+        assert(count > keys / 5 && count < keys / 2);
+    }
+
+    ring.set_nodes({"10.0.0.1:7000", "10.0.0.2:7000", "10.0.0.3:7000", "10.0.0.4:7000"});
+    int moved = 0;
+    for (int i = 0; i < keys; ++i)
+    {
+        const std::string &after = ring.node_for(shard_hash("key-" + std::to_string(i)));
+        if (after != before[i])
+        {
+            assert(after == "10.0.0.4:7000");
+            ++moved;
+        }
+    }
+    assert(moved > keys / 8 && moved < keys * 2 / 5);
+
+    std::cout << "Hash ring test passed!" << std::endl;
+}
+
+// 所有实体收到的消息：键 -> (节点, 序号)
+struct EntityLog
+{
+    std::mutex mutex;
+    std::map<std::string, std::vector<std::pair<std::string, int>>> received;
+
+    size_t total()
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        size_t count = 0;
+        for (const auto &[key, values] : received)
+        {
+            count += values.size();
+        }
+        return count;
+    }
+};
+
+class Account : public Actor
+{
+public:
+    Account(const std::string &key, const std::string &node, std::weak_ptr<EventLoop> event_loop,
+            std::shared_ptr<EntityLog> log)
+        : Actor("account-" + key, event_loop)
+    {
+        register_handler("deposit", [key, node, log](const Message &msg)
+                         {
+                             std::lock_guard<std::mutex> lock(log->mutex);
+                             log->received[key].emplace_back(node, msg.get_payload_value<int>("seq")); });
+    }
+};
+
+// 一个完整的节点：事件循环、远程传输、成员协议和分片区域
+struct ShardNode
+{
+    std::shared_ptr<EventLoop> event_loop;
+    std::shared_ptr<RemoteTransport> transport;
+    std::unique_ptr<Membership> membership;
+    std::shared_ptr<ShardRegion> region;
+    std::thread loop_thread;
+
+    ShardNode(const std::vector<std::string> &seeds, std::shared_ptr<EntityLog> log)
+    {
+        event_loop = std::make_shared<EventLoop>();
+        event_loop->set_keep_alive(true);
+        transport = std::make_shared<RemoteTransport>(event_loop);
+
+        ShardingOptions options;
+        options.type_name = "account";
+        options.shard_count = 64;
+        options.handoff_timeout = std::chrono::milliseconds(1000);
+        std::string node = transport->address();
+        region = std::make_shared<ShardRegion>(
+            options,
+            [node, log](const std::string &key, std::weak_ptr<EventLoop> loop)
+            { return std::make_shared<Account>(key, node, loop, log); },
+            event_loop, transport);
+        event_loop->register_actor(region);
+        loop_thread = std::thread([this]()
+                                  { event_loop->run(); });
+        // 区域启动之前投递的成员变化会被丢弃
+        bool started = wait_until([this]()
+                                  { return region->is_running(); },
+                                  std::chrono::seconds(5));
+        assert(started);
+
+        MembershipOptions membership_options;
+        membership_options.name = node;
+        membership_options.seeds = seeds;
+        membership_options.protocol_period = std::chrono::milliseconds(50);
+        membership_options.ack_timeout = std::chrono::milliseconds(15);
+        membership = std::make_unique<Membership>(membership_options);
+        membership->subscribe(event_loop, region->get_id());
+    }
+
+    void shutdown()
+    {
+        membership->stop();
+        transport->stop();
+        event_loop->stop();
+        loop_thread.join();
+    }
+};
+
+// 等待所有节点对每个键的路由一致（没有进行中的交接）
+bool routes_settled(const std::vector<std::unique_ptr<ShardNode>> &nodes, const std::vector<std::string> &keys)
+{
+    for (const auto &key : keys)
+    {
+        std::string owner = nodes[0]->region->route_of(key);
+        if (owner.empty())
+        {
+            return false;
+        }
+        for (const auto &node : nodes)
+        {
+            if (node->region->route_of(key) != owner)
+            {
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
+// 测试实体按需创建在所属节点上，以及加入节点时缓冲交接不丢失、不打乱消息
+void test_sharding()
+{
+    std::cout << "Running sharding test..." << std::endl;
+
+    auto log = std::make_shared<EntityLog>();
+    std::vector<std::unique_ptr<ShardNode>> nodes;
+    nodes.push_back(std::make_unique<ShardNode>(std::vector<std::string>{}, log));
+    std::string seed = nodes[0]->membership->address();
+    for (int i = 0; i < 2; ++i)
+    {
+        nodes.push_back(std::make_unique<ShardNode>(std::vector<std::string>{seed}, log));
+    }
+
+    std::vector<std::string> keys;
+    for (int i = 0; i < 60; ++i)
+    {
+        keys.push_back("acct-" + std::to_string(i));
+    }
+    bool settled = wait_until([&]()
+                              { return routes_settled(nodes, keys); },
+                              std::chrono::seconds(10));
+    assert(settled);
+
+    std::map<std::string, int> next_seq;
+    size_t sent = 0;
+    auto send_round = [&](ShardRegion &region)
+    {
+        for (const auto &key : keys)
+        {
+            region.tell(Message("deposit", "", "", {{"entity_key", key}, {"seq", next_seq[key]++}}));
+            ++sent;
+        }
+    };
+
+    // 从各个节点发送，实体只在所属节点上创建一次（只保证同一发送者的顺序，每轮之后等待处理完）
+    bool delivered = false;
+    for (int round = 0; round < 3; ++round)
+    {
+        send_round(*nodes[round]->region);
+        delivered = wait_until([&]()
+                               { return log->total() == sent; },
+                               std::chrono::seconds(5));
+        assert(delivered);
+    }
+    size_t spawned = 0;
+    for (const auto &node : nodes)
+    {
+        assert(node->region->local_entities() > 0);
+        spawned += node->region->stats().spawned;
+    }
+    assert(spawned == keys.size());
+    {
+        std::lock_guard<std::mutex> lock(log->mutex);
+        for (const auto &key : keys)
+        {
+            for (const auto &[node, seq] : log->received[key])
+            {
+                assert(node == nodes[0]->region->route_of(key));
+            }
+        }
+    }
+
+    // node1持续发送时加入第四个节点：部分分片交接给它
+    nodes.push_back(std::make_unique<ShardNode>(std::vector<std::string>{seed}, log));
+    auto started = std::chrono::steady_clock::now();
+    while (std::chrono::steady_clock::now() - started < std::chrono::milliseconds(1500))
+    {
+        send_round(*nodes[1]->region);
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+    settled = wait_until([&]()
+                         { return routes_settled(nodes, keys) && log->total() == sent; },
+                         std::chrono::seconds(10));
+    assert(settled);
+    send_round(*nodes[3]->region);
+
+    delivered = wait_until([&]()
+                           { return log->total() == sent; },
+                           std::chrono::seconds(5));
+    assert(delivered);
+    assert(nodes[3]->region->local_entities() > 0);
+    uint64_t handoffs = 0;
+    for (const auto &node : nodes)
+    {
+        handoffs += node->region->stats().handoffs;
+    }
+    assert(handoffs > 0);
+    {
+        // 每个键的消息都按发送顺序处理，最后一轮在新的所属节点上
+        std::lock_guard<std::mutex> lock(log->mutex);
+        for (const auto &key : keys)
+        {
+            const auto &received = log->received[key];
+            for (size_t i = 0; i < received.size(); ++i)
+            {
+                assert(received[i].second == static_cast<int>(i));
+            }
+            assert(received.back().first == nodes[3]->region->route_of(key));
+        }
+    }
+
+    for (auto &node : nodes)
+    {
+        node->shutdown();
+    }
+    std::cout << "Sharding test passed!" << std::endl;
+}
+
+int main()
+{
+    set_log_level(LogLevel::OFF);
+
+    test_phi_accrual_detector();
+    test_membership_gossip();
+    test_message_codec();
+    test_remote_transport();
+    test_remote_flow_control();
+    test_lz4_block();
+    test_remote_batching();
+    test_remote_zero_copy();
+    test_hash_ring();
+    test_sharding();
+
+    std::cout << "All tests passed!" << std::endl;
+    return 0;
+}
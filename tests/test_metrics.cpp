@@ -0,0 +1,612 @@
+#include <iostream>
+#include <cassert>
+#include <cstdio>
+#include <csignal>
+#include <fstream>
+#include <memory>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <chrono>
+#include <stdexcept>
+
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include "actor.h"
+#include "event_loop.h"
+#include "introspection.h"
+#include "logging.h"
+#include "message.h"
+#include "metrics.h"
+#include "metrics_exporter.h"
+#include "shared_metrics.h"
+#include "watchdog.h"
+
+// 处理"work"消息的Actor
+class WorkActor : public Actor
+{
+public:
+    WorkActor(const std::string &name, std::weak_ptr<EventLoop> event_loop)
+        : Actor(name, event_loop)
+    {
+        register_handler("work", [](const Message &)
+                         { std::this_thread::sleep_for(std::chrono::microseconds(50)); });
+    }
+};
+
+bool contains(const std::string &text, const std::string &needle)
+{
+    return text.find(needle) != std::string::npos;
+}
+
+// 向本机端口发送一个HTTP GET请求并返回完整响应
+std::string http_get(uint16_t port, const std::string &path)
+{
+    int fd = ::socket(AF_INET, SOCK_STREAM, 0);
+    assert(fd >= 0);
+    sockaddr_in addr{};
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons(port);
+    ::inet_pton(AF_INET, "127.0.0.1", &addr.sin_addr);
+    int connected = ::connect(fd, reinterpret_cast<sockaddr *>(&addr), sizeof(addr));
+    assert(connected == 0);
+
+    std::string request = "GET " + path + " HTTP/1.1\r\nHost: localhost\r\n\r\n";
+    ::send(fd, request.data(), request.size(), 0);
+
+    std::string response;
+    char buffer[4096];
+    ssize_t n;
+    while ((n = ::recv(fd, buffer, sizeof(buffer), 0)) > 0)
+    {
+        response.append(buffer, static_cast<size_t>(n));
+    }
+    ::close(fd);
+    return response;
+}
+
+void test_registry_rendering()
+{
+    std::cout << "Running registry rendering test..." << std::endl;
+
+    MetricsRegistry registry;
+    auto requests = registry.counter("requests_total", "Requests served.", {{"path", "/a\"b"}});
+    requests->inc(3);
+    auto busy = registry.counter("busy_seconds_total", "Busy time.", {}, 1e-9);
+    busy->inc(1500000000);
+    auto depth = registry.gauge("queue_depth", "Queue depth.");
+    depth->set(7);
+    depth->add(-2);
+    auto latency = registry.summary("latency_seconds", "Latency.", {}, 1e-9);
+    for (int i = 1; i <= 100; ++i)
+    {
+        latency->observe(i * 1000);
+    }
+
+    // 同名指标返回同一个时间序列
+    assert(registry.counter("requests_total", "Requests served.", {{"path", "/a\"b"}}) == requests);
+    assert(registry.series_count() == 4);
+
+    std::string text = registry.render();
+    assert(contains(text, "# HELP requests_total Requests served.\n# TYPE requests_total counter\n"));
+    assert(contains(text, "requests_total{path=\"/a\\\"b\"} 3\n"));
+    assert(contains(text, "busy_seconds_total 1.5\n"));
+    assert(contains(text, "# TYPE queue_depth gauge\nqueue_depth 5\n"));
+    assert(contains(text, "# TYPE latency_seconds summary\n"));
+    assert(contains(text, "latency_seconds{quantile=\"0.5\"} 5."));
+    assert(contains(text, "latency_seconds_count 100\n"));
+
+    // 类型冲突
+    bool threw = false;
+    try
+    {
+        registry.gauge("requests_total", "Requests served.");
+    }
+    catch (const std::invalid_argument &)
+    {
+        threw = true;
+    }
+    assert(threw);
+
+    // 移除后不再输出
+    registry.remove("requests_total", {{"path", "/a\"b"}});
+    assert(!contains(registry.render(), "requests_total{"));
+
+    // 收集回调在渲染前运行，注销后不再运行
+    int calls = 0;
+    auto id = registry.add_collector([&calls]()
+                                     { ++calls; });
+    registry.render();
+    registry.remove_collector(id);
+    registry.render();
+    assert(calls == 1);
+
+    std::cout << "Registry rendering test passed!" << std::endl;
+}
+
+void test_event_loop_metrics()
+{
+    std::cout << "Running event loop metrics test..." << std::endl;
+
+    auto registry = std::make_shared<MetricsRegistry>();
+    auto event_loop = std::make_shared<EventLoop>();
+    event_loop->set_worker_count(2);
+
+    MetricsOptions options;
+    options.max_actor_series = 2;
+    event_loop->set_metrics(registry, options);
+
+    // 三个不同名称但上限为2，第三个计入_other；同名Actor共享时间序列
+    auto alpha1 = std::make_shared<WorkActor>("alpha", event_loop);
+    auto alpha2 = std::make_shared<WorkActor>("alpha", event_loop);
+    auto beta = std::make_shared<WorkActor>("beta", event_loop);
+    auto gamma = std::make_shared<WorkActor>("gamma", event_loop);
+    for (const auto &actor : {alpha1, alpha2, beta, gamma})
+    {
+        event_loop->register_actor(actor);
+    }
+    event_loop->run_until_idle();
+
+    for (int i = 0; i < 5; ++i)
+    {
+        for (const auto &actor : {alpha1, alpha2, beta, gamma})
+        {
+            event_loop->deliver_message(Message("work", "sender", actor->get_id()));
+        }
+    }
+
+    // 处理前邮箱深度按时间序列求和
+    std::string before = registry->render();
+    assert(contains(before, "actor_mailbox_depth{actor=\"alpha\"} 10\n"));
+    assert(contains(before, "actor_mailbox_depth{actor=\"_other\"} 5\n"));
+    assert(contains(before, "actor_loop_in_flight_messages 20\n"));
+
+    event_loop->run_until_idle();
+    event_loop->deliver_message(Message("work", "sender", "missing"));
+
+    std::string text = registry->render();
+    assert(contains(text, "actor_messages_processed_total{actor=\"alpha\"} 10\n"));
+    assert(contains(text, "actor_messages_processed_total{actor=\"beta\"} 5\n"));
+    assert(contains(text, "actor_messages_processed_total{actor=\"_other\"} 5\n"));
+    assert(!contains(text, "actor=\"gamma\""));
+    assert(contains(text, "actor_metrics_series_overflow_total 1\n"));
+    assert(contains(text, "actor_mailbox_depth{actor=\"alpha\"} 0\n"));
+    assert(contains(text, "actor_handler_latency_seconds_count{actor=\"beta\"} 5\n"));
+    assert(contains(text, "actor_messages_undeliverable_total{reason=\"not_found\"} 1\n"));
+    assert(contains(text, "actor_scheduler_picks_total{worker=\"0\"}"));
+    assert(contains(text, "actor_scheduler_picks_total{worker=\"1\"}"));
+    assert(contains(text, "actor_worker_utilization{worker=\"1\"}"));
+    assert(contains(text, "actor_loop_idle_ratio"));
+    assert(contains(text, "actor_loop_actors 4\n"));
+
+    // 关闭时被丢弃的消息计入dropped
+    ShutdownOptions shutdown_options;
+    shutdown_options.drain_deadline = std::chrono::milliseconds(0);
+    event_loop->set_shutdown_options(shutdown_options);
+    for (int i = 0; i < 3; ++i)
+    {
+        event_loop->deliver_message(Message("work", "sender", beta->get_id()));
+    }
+    event_loop->shutdown();
+    assert(contains(registry->render(), "actor_messages_dropped_total{actor=\"beta\"} 3\n"));
+
+    std::cout << "Event loop metrics test passed!" << std::endl;
+}
+
+void test_actor_id_labels()
+{
+    std::cout << "Running actor ID label test..." << std::endl;
+
+    auto registry = std::make_shared<MetricsRegistry>();
+    auto event_loop = std::make_shared<EventLoop>();
+    MetricsOptions options;
+    options.actor_label = MetricsOptions::ActorLabel::ID;
+    options.handler_latency = false;
+    event_loop->set_metrics(registry, options);
+
+    auto actor = std::make_shared<WorkActor>("worker", event_loop);
+    event_loop->register_actor(actor);
+    event_loop->run_until_idle();
+    event_loop->deliver_message(Message("work", "sender", actor->get_id()));
+    event_loop->run_until_idle();
+
+    std::string text = registry->render();
+    assert(contains(text, "actor_messages_processed_total{actor="));
+    assert(!contains(text, "actor_handler_latency_seconds"));
+
+    // 按ID标注时移除Actor会移除它的时间序列
+    event_loop->remove_actor(actor->get_id());
+    assert(!contains(registry->render(), "actor_messages_processed_total{"));
+
+    std::cout << "Actor ID label test passed!" << std::endl;
+}
+
+void test_http_exporter()
+{
+    std::cout << "Running HTTP exporter test..." << std::endl;
+
+    auto registry = std::make_shared<MetricsRegistry>();
+    registry->counter("scrapes_total", "Test counter.")->inc(42);
+
+    MetricsHttpServer server(registry);
+    assert(server.port() != 0);
+
+    std::string response = http_get(server.port(), "/metrics");
+    assert(contains(response, "HTTP/1.1 200 OK\r\n"));
+    assert(contains(response, "text/plain; version=0.0.4"));
+    assert(contains(response, "scrapes_total 42\n"));
+
+    assert(contains(http_get(server.port(), "/other"), "HTTP/1.1 404"));
+
+    server.stop();
+    std::cout << "HTTP exporter test passed!" << std::endl;
+}
+
+void test_file_dumper()
+{
+    std::cout << "Running file dumper test..." << std::endl;
+
+    auto registry = std::make_shared<MetricsRegistry>();
+    auto counter = registry->counter("dumps_total", "Test counter.");
+    counter->inc(1);
+
+    std::string path = "test_metrics_dump.prom";
+    std::remove(path.c_str());
+    {
+        MetricsFileDumper dumper(registry, path, std::chrono::milliseconds(5));
+        std::this_thread::sleep_for(std::chrono::milliseconds(30));
+        counter->inc(1);
+        dumper.stop();
+        assert(dumper.dump_count() >= 2);
+    }
+
+    // 停止时会写入最终值
+    std::ifstream in(path);
+    std::stringstream content;
+    content << in.rdbuf();
+    assert(contains(content.str(), "dumps_total 2\n"));
+    std::remove(path.c_str());
+
+    std::cout << "File dumper test passed!" << std::endl;
+}
+
+void test_shared_metrics_segment()
+{
+    std::cout << "Running shared metrics segment test..." << std::endl;
+
+    std::string path = "test_shared_metrics.seg";
+    auto segment = std::make_shared<SharedMetricsSegment>(path, 2);
+    auto event_loop = std::make_shared<EventLoop>();
+    event_loop->set_worker_count(2);
+    event_loop->set_shared_metrics(segment);
+
+    auto first = std::make_shared<WorkActor>("first", event_loop);
+    auto second = std::make_shared<WorkActor>("second", event_loop);
+    auto third = std::make_shared<WorkActor>("third", event_loop);
+    event_loop->register_actor(first);
+    event_loop->register_actor(second);
+    event_loop->register_actor(third);
+    event_loop->run_until_idle();
+
+    for (int i = 0; i < 4; ++i)
+    {
+        event_loop->deliver_message(Message("work", "sender", first->get_id()));
+    }
+    event_loop->deliver_message(Message("work", "sender", second->get_id()));
+
+    // 读取方只读映射文件，不需要事件循环配合
+    SharedMetricsReader reader(path);
+    auto before = reader.snapshot();
+    assert(before.actors == 3);
+    assert(before.worker_count == 2);
+    assert(before.overflow_actors == 1);
+    assert(before.samples.size() == 2);
+    assert(before.samples[0].name == "first");
+    assert(before.samples[0].mailbox_depth == 4);
+    assert(before.samples[0].enqueued == 4);
+    assert(before.samples[1].name == "second");
+
+    event_loop->run_until_idle();
+    auto after = reader.snapshot();
+    assert(after.samples[0].processed == 4);
+    assert(after.samples[0].mailbox_depth == 0);
+    assert(after.samples[0].handler_ns > 0);
+    assert(after.samples[1].processed == 1);
+
+    // 移除后槽位被释放，新Actor复用槽位时代数递增
+    uint32_t generation = after.samples[0].generation;
+    event_loop->remove_actor(first->get_id());
+    assert(reader.snapshot().samples.size() == 1);
+    auto fourth = std::make_shared<WorkActor>("fourth", event_loop);
+    event_loop->register_actor(fourth);
+    auto reused = reader.snapshot();
+    assert(reused.samples.size() == 2);
+    assert(reused.samples[0].name == "fourth");
+    assert(reused.samples[0].generation == generation + 1);
+    assert(reused.samples[0].processed == 0);
+
+    // 事件循环销毁时释放全部槽位
+    event_loop.reset();
+    first.reset();
+    second.reset();
+    third.reset();
+    fourth.reset();
+    assert(reader.snapshot().samples.empty());
+
+    // 段销毁时删除文件；不是指标段的文件会被拒绝
+    segment.reset();
+    assert(std::ifstream(path).fail());
+    {
+        std::ofstream bogus(path);
+        bogus << std::string(256, 'x');
+    }
+    bool threw = false;
+    try
+    {
+        SharedMetricsReader bad(path);
+    }
+    catch (const std::runtime_error &)
+    {
+        threw = true;
+    }
+    assert(threw);
+    std::remove(path.c_str());
+
+    std::cout << "Shared metrics segment test passed!" << std::endl;
+}
+
+// 慢处理函数：函数名会出现在看门狗采样的调用栈中
+void slow_handler_for_watchdog_test()
+{
+    std::this_thread::sleep_for(std::chrono::milliseconds(150));
+}
+
+// 测试看门狗报告慢处理函数的Actor、消息类型和调用栈，快的处理函数不会被报告
+void test_slow_handler_watchdog()
+{
+    std::cout << "Running slow handler watchdog test..." << std::endl;
+
+    struct sigaction original;
+    sigaction(SIGRTMIN + 1, nullptr, &original);
+
+    auto registry = std::make_shared<MetricsRegistry>();
+    WatchdogOptions options;
+    options.threshold = std::chrono::milliseconds(40);
+    std::atomic<int> callbacks{0};
+    options.on_report = [&callbacks](const SlowHandlerReport &) { ++callbacks; };
+    auto watchdog = std::make_shared<SlowHandlerWatchdog>(options, registry);
+
+    auto event_loop = std::make_shared<EventLoop>();
+    event_loop->set_watchdog(watchdog);
+    auto actor = std::make_shared<WorkActor>("sleeper", event_loop);
+    actor->register_handler("slow", [](const Message &)
+                            { slow_handler_for_watchdog_test(); });
+    event_loop->register_actor(actor);
+    event_loop->run_until_idle();
+
+    for (int i = 0; i < 100; ++i)
+    {
+        event_loop->deliver_message(Message("work", "", actor->get_id()));
+    }
+    event_loop->deliver_message(Message("slow", "", actor->get_id()));
+    size_t processed = event_loop->run_until_idle();
+    assert(processed == 101);
+
+    assert(watchdog->report_count() == 1);
+    assert(callbacks == 1);
+    auto reports = watchdog->recent_reports();
+    assert(reports.size() == 1);
+    assert(reports[0].actor_name == "sleeper");
+    assert(reports[0].actor_id == actor->get_id());
+    assert(reports[0].message_type == "slow");
+    assert(reports[0].worker == 0);
+    assert(reports[0].elapsed >= std::chrono::milliseconds(40));
+
+    bool found = false;
+    for (const auto &frame : reports[0].stack)
+    {
+        found = found || contains(frame, "slow_handler_for_watchdog_test");
+    }
+    assert(found);
+    assert(contains(registry->render(), "actor_slow_handlers_total{type=\"slow\"} 1"));
+
+    // 看门狗销毁后恢复原来的信号处理方式
+    event_loop->set_watchdog(nullptr);
+    watchdog.reset();
+    struct sigaction restored;
+    sigaction(SIGRTMIN + 1, nullptr, &restored);
+    assert(restored.sa_handler == original.sa_handler);
+
+    std::cout << "Slow handler watchdog test passed!" << std::endl;
+}
+
+// 测试处理函数抛出异常后worker的槽位回到空闲状态，消息计为完成，看门狗不会报告空闲的worker
+void test_watchdog_after_throwing_handler()
+{
+    std::cout << "Running watchdog throwing handler test..." << std::endl;
+
+    WatchdogOptions options;
+    options.threshold = std::chrono::milliseconds(20);
+    auto watchdog = std::make_shared<SlowHandlerWatchdog>(options);
+
+    auto event_loop = std::make_shared<EventLoop>();
+    event_loop->set_watchdog(watchdog);
+    auto actor = std::make_shared<WorkActor>("thrower", event_loop);
+    actor->register_handler("throw", [](const Message &)
+                            { throw std::runtime_error("handler failed"); });
+    event_loop->register_actor(actor);
+    event_loop->run_until_idle();
+
+    // 在登记过的线程上直接处理
+    watchdog->attach_current_thread(0);
+    event_loop->deliver_message(Message("throw", "", actor->get_id()));
+    bool threw = false;
+    try
+    {
+        actor->process_next_message();
+    }
+    catch (const std::runtime_error &)
+    {
+        threw = true;
+    }
+    assert(threw);
+    assert(event_loop->in_flight_messages() == 0);
+    std::this_thread::sleep_for(std::chrono::milliseconds(100));
+    assert(watchdog->report_count() == 0);
+    watchdog->detach_current_thread();
+
+    // 通过事件循环处理：异常穿出worker时取消登记
+    event_loop->deliver_message(Message("throw", "", actor->get_id()));
+    threw = false;
+    try
+    {
+        event_loop->run_until_idle();
+    }
+    catch (const std::runtime_error &)
+    {
+        threw = true;
+    }
+    assert(threw);
+    assert(event_loop->in_flight_messages() == 0);
+    std::this_thread::sleep_for(std::chrono::milliseconds(100));
+    assert(watchdog->report_count() == 0);
+
+    event_loop->set_watchdog(nullptr);
+    std::cout << "Watchdog throwing handler test passed!" << std::endl;
+}
+
+// 测试快照中的邮箱深度、最高待处理优先级和处理统计，以及文本格式和HTTP端点
+void test_actor_snapshot()
+{
+    std::cout << "Running actor snapshot test..." << std::endl;
+
+    auto event_loop = std::make_shared<EventLoop>();
+    event_loop->set_handler_timing(true);
+    auto busy = std::make_shared<WorkActor>("busy", event_loop);
+    auto backlogged = std::make_shared<WorkActor>("backlogged", event_loop);
+    auto odd = std::make_shared<WorkActor>("odd\tname", event_loop);
+    event_loop->register_actor(busy);
+    event_loop->register_actor(backlogged);
+    event_loop->register_actor(odd);
+    event_loop->run_until_idle();
+
+    for (int i = 0; i < 5; ++i)
+    {
+        event_loop->deliver_message(Message("work", "", busy->get_id()));
+    }
+    size_t processed = event_loop->run_until_idle();
+    assert(processed == 5);
+
+    ActorStats stats = busy->read_stats();
+    assert(stats.processed == 5);
+    assert(stats.mailbox_depth == 0);
+    assert(stats.top_priority == -1);
+    assert(stats.handler_ns_total >= 5 * 50000);
+    assert(stats.handler_ns_max >= 50000 && stats.handler_ns_max <= stats.handler_ns_total);
+    assert(stats.last_run_ns > 0);
+
+    // 事件循环没有运行，投递的消息留在邮箱中
+    event_loop->deliver_message(Message("work", "", backlogged->get_id(), {}, Message::Priority::LOW));
+    event_loop->deliver_message(Message("work", "", backlogged->get_id(), {}, Message::Priority::HIGH));
+    event_loop->deliver_message(Message("work", "", backlogged->get_id()));
+    event_loop->deliver_message(Message("work", "", odd->get_id(), {}, Message::Priority::CRITICAL));
+
+    SystemSnapshot snapshot = event_loop->snapshot(2, SnapshotOrder::BACKLOG);
+    assert(snapshot.actor_count == 3);
+    assert(snapshot.total_backlog == 4);
+    assert(snapshot.in_flight == 4);
+    assert(snapshot.actors.size() == 2);
+    assert(snapshot.actors[0].id == backlogged->get_id());
+    assert(snapshot.actors[0].name == "backlogged");
+    assert(snapshot.actors[0].state == Actor::State::RUNNING);
+    assert(snapshot.actors[0].stats.mailbox_depth == 3);
+    assert(snapshot.actors[0].stats.top_priority == static_cast<int>(Message::Priority::HIGH));
+    assert(snapshot.actors[1].id == odd->get_id());
+    assert(snapshot.actors[1].stats.top_priority == static_cast<int>(Message::Priority::CRITICAL));
+
+    SystemSnapshot by_processed = event_loop->snapshot(0, SnapshotOrder::PROCESSED);
+    assert(by_processed.actors.size() == 3);
+    assert(by_processed.actors[0].id == busy->get_id());
+    assert(by_processed.actors[0].stats.processed == 5);
+
+    // 文本格式往返，名称中的制表符需要转义
+    SystemSnapshot parsed = parse_snapshot(format_snapshot(by_processed));
+    assert(parsed.actor_count == 3);
+    assert(parsed.total_backlog == 4);
+    assert(parsed.actors.size() == 3);
+    for (size_t i = 0; i < parsed.actors.size(); ++i)
+    {
+        assert(parsed.actors[i].id == by_processed.actors[i].id);
+        assert(parsed.actors[i].name == by_processed.actors[i].name);
+        assert(parsed.actors[i].stats.handler_ns_total == by_processed.actors[i].stats.handler_ns_total);
+        assert(parsed.actors[i].stats.top_priority == by_processed.actors[i].stats.top_priority);
+    }
+    bool rejected = false;
+    try
+    {
+        parse_snapshot("not a snapshot\n");
+    }
+    catch (const std::runtime_error &)
+    {
+        rejected = true;
+    }
+    assert(rejected);
+
+    MetricsHttpServer server(std::make_shared<MetricsRegistry>());
+    server.add_endpoint("/actors", [event_loop](const std::string &query)
+                        { return handle_snapshot_request(*event_loop, query); });
+    std::string response = http_get(server.port(), "/actors?top=1&sort=backlog");
+    assert(contains(response, "HTTP/1.1 200 OK\r\n"));
+    SystemSnapshot remote = parse_snapshot(response.substr(response.find("\r\n\r\n") + 4));
+    assert(remote.actors.size() == 1);
+    assert(remote.actors[0].id == backlogged->get_id());
+    server.stop();
+
+    // worker运行期间拍摄快照不需要暂停worker
+    for (int i = 0; i < 200; ++i)
+    {
+        event_loop->deliver_message(Message("work", "", i % 2 ? busy->get_id() : odd->get_id()));
+    }
+    event_loop->set_worker_count(2);
+    std::atomic<bool> done{false};
+    std::thread reader([&event_loop, &done]()
+                       {
+        while (!done)
+        {
+            SystemSnapshot concurrent = event_loop->snapshot(3, SnapshotOrder::BACKLOG);
+            assert(concurrent.actor_count == 3);
+            assert(concurrent.actors.size() == 3);
+        } });
+    processed = event_loop->run_until_idle();
+    done = true;
+    reader.join();
+    assert(processed == 204);
+
+    snapshot = event_loop->snapshot(0, SnapshotOrder::BACKLOG);
+    assert(snapshot.total_backlog == 0);
+    assert(busy->read_stats().processed == 105);
+    assert(odd->read_stats().processed == 101);
+
+    std::cout << "Actor snapshot test passed!" << std::endl;
+}
+
+int main()
+{
+    set_log_level(LogLevel::OFF);
+
+    test_registry_rendering();
+    test_event_loop_metrics();
+    test_actor_id_labels();
+    test_http_exporter();
+    test_file_dumper();
+    test_shared_metrics_segment();
+    test_slow_handler_watchdog();
+    test_watchdog_after_throwing_handler();
+    test_actor_snapshot();
+
+    std::cout << "All tests passed!" << std::endl;
+    return 0;
+}
@@ -0,0 +1,605 @@
+#include <iostream>
+#include <cassert>
+#include <cstdio>
+#include <memory>
+#include <string>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <chrono>
+#include <any>
+#include <map>
+#include <vector>
+#include <stdexcept>
+#include <csignal>
+#include <sys/resource.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include "actor.h"
+#include "event_loop.h"
+#include "flight_recorder.h"
+#include "message.h"
+#include "trace.h"
+#include "tracing.h"
+#include "scheduler.h"
+#include "scheduler_simulator.h"
+
+// 收到ping后回复pong的Actor
+class EchoActor : public Actor
+{
+public:
+    EchoActor(const std::string &name, std::weak_ptr<EventLoop> event_loop)
+        : Actor(name, event_loop)
+    {
+        register_handler("ping", [this](const Message &msg)
+                         {
+                             std::this_thread::sleep_for(std::chrono::milliseconds(2));
+                             send(msg.get_sender_id(), Message("pong", id_, msg.get_sender_id())); });
+        register_handler("pong", [](const Message &) {});
+    }
+};
+
+// 测试录制的轨迹可以完整读回
+void test_record_round_trip()
+{
+    std::cout << "Running trace round trip test..." << std::endl;
+
+    const std::string path = "test_trace_round_trip.bin";
+    auto recorder = std::make_shared<TraceRecorder>(path, 64);
+
+    auto event_loop = std::make_shared<EventLoop>();
+    event_loop->set_trace_recorder(recorder);
+
+    auto a = std::make_shared<EchoActor>("A", event_loop);
+    auto b = std::make_shared<EchoActor>("B", event_loop);
+    event_loop->register_actor(a);
+    event_loop->register_actor(b);
+    event_loop->run_until_idle();
+
+    Message::Payload payload;
+    payload["text"] = std::string("hello");
+    payload["count"] = 3;
+    for (int i = 0; i < 5; ++i)
+    {
+        event_loop->deliver_message(Message("ping", a->get_id(), b->get_id(), payload, Message::Priority::HIGH));
+    }
+    size_t processed = event_loop->run_until_idle();
+    assert(processed == 10);
+    recorder->flush();
+    assert(recorder->event_count() == 20);
+
+    TraceReader reader(path);
+    auto events = reader.read_all();
+    assert(events.size() == 20);
+
+    int pings = 0;
+    int pongs = 0;
+    int handled = 0;
+    uint64_t last_ping_sequence = 0;
+    int64_t last_timestamp = 0;
+    for (const auto &event : events)
+    {
+        assert(event.timestamp_ns >= last_timestamp);
+        last_timestamp = event.timestamp_ns;
+
+        if (event.kind == TraceEvent::Kind::DELIVERY && event.type == "ping")
+        {
+            ++pings;
+            assert(event.sender_id == a->get_id());
+            assert(event.target_id == b->get_id());
+            assert(event.priority == Message::Priority::HIGH);
+            assert(event.payload_size == std::string("text").size() + 5 + std::string("count").size() + 4);
+            assert(event.sequence == ++last_ping_sequence);
+        }
+        else if (event.kind == TraceEvent::Kind::DELIVERY && event.type == "pong")
+        {
+            ++pongs;
+            assert(event.target_id == a->get_id());
+        }
+        else if (event.kind == TraceEvent::Kind::HANDLED)
+        {
+            ++handled;
+            if (event.type == "ping")
+            {
+                assert(event.target_id == b->get_id());
+                assert(event.cost_ns >= 2000000);
+            }
+        }
+    }
+    assert(pings == 5 && pongs == 5 && handled == 10);
+
+    std::remove(path.c_str());
+    std::cout << "Trace round trip test passed!" << std::endl;
+}
+
+// 处理slow消息时多睡一会儿的Actor
+class SlowFastActor : public Actor
+{
+public:
+    SlowFastActor(const std::string &name, std::weak_ptr<EventLoop> event_loop)
+        : Actor(name, event_loop)
+    {
+        register_handler("work", [](const Message &msg)
+                         {
+                             if (msg.has_payload_key("slow"))
+                             {
+                                 std::this_thread::sleep_for(std::chrono::milliseconds(1));
+                             } });
+    }
+};
+
+// 测试多个线程并发投递给同一个Actor时，每条投递记录都按邮箱序号配对到自己的处理记录
+void test_concurrent_senders()
+{
+    std::cout << "Running concurrent senders trace test..." << std::endl;
+
+    const std::string path = "test_trace_concurrent.bin";
+    auto recorder = std::make_shared<TraceRecorder>(path, 256);
+
+    auto event_loop = std::make_shared<EventLoop>();
+    event_loop->set_trace_recorder(recorder);
+    auto target = std::make_shared<SlowFastActor>("target", event_loop);
+    event_loop->register_actor(target);
+    event_loop->run_until_idle();
+
+    const int threads = 4;
+    const int per_thread = 25;
+    std::vector<std::thread> senders;
+    for (int t = 0; t < threads; ++t)
+    {
+        senders.emplace_back([&, t]()
+                             {
+                                 for (int i = 0; i < per_thread; ++i)
+                                 {
+                                     Message::Payload payload;
+                                     if (i % 5 == t % 5)
+                                     {
+                                         payload["slow"] = true;
+                                     }
+                                     event_loop->deliver_message(Message("work", "sender", target->get_id(), payload));
+                                 } });
+    }
+    for (auto &sender : senders)
+    {
+        sender.join();
+    }
+    size_t processed = event_loop->run_until_idle();
+    assert(processed == threads * per_thread);
+    recorder->flush();
+
+    auto events = TraceReader(path).read_all();
+    assert(events.size() == 2 * threads * per_thread);
+    std::vector<bool> seen(threads * per_thread + 1, false);
+    std::vector<TraceEvent> deliveries;
+    for (const auto &event : events)
+    {
+        if (event.kind == TraceEvent::Kind::DELIVERY)
+        {
+            assert(event.sequence >= 1 && event.sequence <= seen.size() - 1 && !seen[event.sequence]);
+            seen[event.sequence] = true;
+            deliveries.push_back(event);
+        }
+    }
+
+    // slow消息带一个bool负载，配对到的耗时必须来自它自己的处理记录
+    auto costs = pair_handler_costs(events);
+    assert(costs.size() == deliveries.size());
+    for (size_t i = 0; i < deliveries.size(); ++i)
+    {
+        if (deliveries[i].payload_size > 0)
+        {
+            assert(costs[i] >= 1000000);
+        }
+    }
+
+    std::remove(path.c_str());
+    std::cout << "Concurrent senders trace test passed!" << std::endl;
+}
+
+// 测试线程退出后它记录的事件仍会被刷新，记录器先于线程销毁也是安全的
+void test_short_lived_threads()
+{
+    std::cout << "Running short-lived threads trace test..." << std::endl;
+
+    const std::string path = "test_trace_threads.bin";
+    auto recorder = std::make_shared<TraceRecorder>(path, 1 << 20);
+
+    const int rounds = 3;
+    const int threads = 8;
+    const int per_thread = 10;
+    for (int round = 0; round < rounds; ++round)
+    {
+        std::vector<std::thread> workers;
+        for (int t = 0; t < threads; ++t)
+        {
+            workers.emplace_back([&, t]()
+                                 {
+                                     for (int i = 0; i < per_thread; ++i)
+                                     {
+                                         uint64_t sequence = static_cast<uint64_t>(t * per_thread + i + 1);
+                                         recorder->record_delivery(Message("work", "sender", "target"), sequence);
+                                     } });
+        }
+        for (auto &worker : workers)
+        {
+            worker.join();
+        }
+        // 退出线程的记录既要计数也要在刷新时写出
+        assert(recorder->event_count() == static_cast<uint64_t>((round + 1) * threads * per_thread));
+        recorder->flush();
+    }
+    assert(TraceReader(path).read_all().size() == static_cast<size_t>(rounds * threads * per_thread));
+
+    // 线程仍持有缓冲区时销毁记录器
+    std::mutex mutex;
+    std::condition_variable cv;
+    bool recorded = false;
+    bool released = false;
+    std::thread holder([&]()
+                       {
+                           recorder->record_delivery(Message("work", "sender", "target"), 1);
+                           std::unique_lock<std::mutex> lock(mutex);
+                           recorded = true;
+                           cv.notify_all();
+                           cv.wait(lock, [&]() { return released; }); });
+    {
+        std::unique_lock<std::mutex> lock(mutex);
+        cv.wait(lock, [&]() { return recorded; });
+    }
+    recorder.reset();
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        released = true;
+    }
+    cv.notify_all();
+    holder.join();
+
+    std::remove(path.c_str());
+    std::cout << "Short-lived threads trace test passed!" << std::endl;
+}
+
+// 测试非轨迹文件会被拒绝
+void test_reject_bad_trace()
+{
+    std::cout << "Running bad trace test..." << std::endl;
+
+    const std::string path = "test_trace_bad.bin";
+    {
+        std::FILE *file = std::fopen(path.c_str(), "wb");
+        std::fputs("not a trace", file);
+        std::fclose(file);
+    }
+
+    bool rejected = false;
+    try
+    {
+        TraceReader reader(path);
+    }
+    catch (const std::runtime_error &)
+    {
+        rejected = true;
+    }
+    assert(rejected);
+
+    std::remove(path.c_str());
+    std::cout << "Bad trace test passed!" << std::endl;
+}
+
+// 构造一条投递记录
+TraceEvent make_delivery(const std::string &target, int64_t timestamp_ns, Message::Priority priority)
+{
+    TraceEvent event;
+    event.kind = TraceEvent::Kind::DELIVERY;
+    event.timestamp_ns = timestamp_ns;
+    event.type = "work";
+    event.sender_id = "client";
+    event.target_id = target;
+    event.priority = priority;
+    return event;
+}
+
+// 找到指定Actor的统计
+const ActorLatencyStats &find_stats(const SchedulerSimulationReport &report, const std::string &actor_id)
+{
+    for (const auto &stats : report.actors)
+    {
+        if (stats.actor_id == actor_id)
+        {
+            return stats;
+        }
+    }
+    throw std::runtime_error("actor not in report: " + actor_id);
+}
+
+// 测试离线调度仿真器在仿真时间中比较不同调度策略
+void test_scheduler_simulator()
+{
+    std::cout << "Running scheduler simulator test..." << std::endl;
+
+    // 10个批量Actor各有10条普通消息，1us后到达一条紧急消息
+    const int64_t base = 1000000000;
+    std::vector<TraceEvent> events;
+    for (int i = 0; i < 10; ++i)
+    {
+        for (int j = 0; j < 10; ++j)
+        {
+            events.push_back(make_delivery("bulk" + std::to_string(i), base, Message::Priority::NORMAL));
+        }
+    }
+    events.push_back(make_delivery("urgent", base + 1000, Message::Priority::CRITICAL));
+
+    SchedulerSimulator::Options options;
+    options.starvation_threshold = std::chrono::microseconds(500);
+    options.cost_model = [](const TraceEvent &, int64_t)
+    { return int64_t(10000); };
+    SchedulerSimulator simulator(events, options);
+
+    auto round_robin = simulator.run("round-robin", std::make_shared<RoundRobinScheduler>());
+    auto by_priority = simulator.run("message-priority", std::make_shared<MessagePriorityScheduler>());
+
+    assert(round_robin.messages == 101);
+    assert(by_priority.messages == 101);
+    assert(round_robin.makespan_ns == 101 * 10000);
+
+    // 紧急消息只需要等待正在处理的那条消息结束
+    const auto &urgent = find_stats(by_priority, "urgent");
+    assert(urgent.wait_max_ns == 9000);
+    assert(find_stats(round_robin, "urgent").wait_max_ns > urgent.wait_max_ns);
+
+    // 单worker下总有消息排队超过500us
+    assert(round_robin.starved_messages > 0);
+    assert(round_robin.jain_fairness > 0.0 && round_robin.jain_fairness <= 1.0);
+
+    // 仿真是确定的
+    auto again = simulator.run("round-robin", std::make_shared<RoundRobinScheduler>());
+    assert(again.wait_p99_ns == round_robin.wait_p99_ns);
+    assert(again.jain_fairness == round_robin.jain_fairness);
+
+    // 两个worker时总时长减半
+    options.worker_count = 2;
+    SchedulerSimulator parallel(events, options);
+    auto two_workers = parallel.run("round-robin", std::make_shared<RoundRobinScheduler>());
+    assert(two_workers.messages == 101);
+    assert(two_workers.makespan_ns == 51 * 10000);
+
+    std::cout << "Scheduler simulator test passed!" << std::endl;
+}
+
+// 把"hop"消息转发给下一个Actor，记录处理时看到的追踪上下文
+class HopActor : public Actor
+{
+public:
+    HopActor(const std::string &name, std::weak_ptr<EventLoop> event_loop)
+        : Actor(name, event_loop)
+    {
+        register_handler("hop", [this](const Message &)
+                         {
+                             seen.push_back(Actor::current_trace_context());
+                             if (!next.empty())
+                             {
+                                 send(next, Message("hop", "", next));
+                             } });
+        register_handler("fail", [](const Message &)
+                         { throw std::runtime_error("handler failed"); });
+    }
+
+    std::string next;
+    std::vector<TraceContext> seen;
+};
+
+// 测试追踪上下文沿send自动传播，采样的追踪生成父子相连的span并导出为OTLP JSON
+void test_trace_context_propagation()
+{
+    std::cout << "Running trace context propagation test..." << std::endl;
+
+    auto event_loop = std::make_shared<EventLoop>();
+    auto spans = std::make_shared<SpanCollector>(16, "test-service");
+    event_loop->set_span_collector(spans);
+
+    auto a = std::make_shared<HopActor>("A", event_loop);
+    auto b = std::make_shared<HopActor>("B", event_loop);
+    auto c = std::make_shared<HopActor>("C", event_loop);
+    a->next = b->get_id();
+    b->next = c->get_id();
+    for (const auto &actor : {a, b, c})
+    {
+        event_loop->register_actor(actor);
+    }
+    event_loop->run_until_idle();
+
+    // 没有上下文的消息不会被追踪
+    event_loop->deliver_message(Message("hop", "", a->get_id()));
+    size_t processed = event_loop->run_until_idle();
+    assert(processed == 3);
+    assert(!c->seen.back().valid());
+    assert(spans->spans().empty());
+    assert(!Actor::current_trace_context().valid());
+
+    // 未采样的追踪只传播上下文，不产生span
+    TraceContext unsampled = start_trace(0.0);
+    assert(unsampled.valid() && !unsampled.sampled);
+    Message untraced("hop", "", a->get_id());
+    untraced.set_trace_context(unsampled);
+    event_loop->deliver_message(untraced);
+    processed = event_loop->run_until_idle();
+    assert(processed == 3);
+    assert(c->seen.back().trace_id_low == unsampled.trace_id_low && !c->seen.back().sampled);
+    assert(spans->spans().empty());
+
+    // 采样的追踪：A是根span，B、C依次以前一跳的span为父span
+    TraceContext root = start_trace();
+    assert(root.sampled && root.span_id == 0);
+    Message traced("hop", "", a->get_id());
+    traced.set_trace_context(root);
+    event_loop->deliver_message(traced);
+    processed = event_loop->run_until_idle();
+    assert(processed == 3);
+
+    auto recorded = spans->spans();
+    assert(recorded.size() == 3);
+    assert(recorded[0].actor_name == "A" && recorded[1].actor_name == "B" && recorded[2].actor_name == "C");
+    assert(recorded[0].parent_span_id == 0);
+    assert(recorded[1].parent_span_id == recorded[0].span_id);
+    assert(recorded[2].parent_span_id == recorded[1].span_id);
+    assert(recorded[2].sender_id == b->get_id());
+    for (const auto &span : recorded)
+    {
+        assert(span.trace_id_high == root.trace_id_high && span.trace_id_low == root.trace_id_low);
+        assert(span.name == "hop");
+        assert(span.end_ns >= span.start_ns && span.queue_ns >= 0);
+    }
+    assert(c->seen.back().span_id == recorded[2].span_id);
+
+    std::string json = spans->to_otlp_json();
+    char trace_id[33];
+    std::snprintf(trace_id, sizeof(trace_id), "%016llx%016llx", static_cast<unsigned long long>(root.trace_id_high),
+                  static_cast<unsigned long long>(root.trace_id_low));
+    assert(json.find(std::string("\"traceId\":\"") + trace_id + "\"") != std::string::npos);
+    assert(json.find("\"stringValue\":\"test-service\"") != std::string::npos);
+    char parent[17];
+    std::snprintf(parent, sizeof(parent), "%016llx", static_cast<unsigned long long>(recorded[0].span_id));
+    assert(json.find(std::string("\"parentSpanId\":\"") + parent + "\"") != std::string::npos);
+
+    const std::string path = "test_trace_spans.json";
+    bool written = spans->write_otlp_json(path);
+    assert(written);
+    std::remove(path.c_str());
+
+    // 处理函数抛出异常时也要恢复线程的追踪上下文
+    Message failing("fail", "", c->get_id());
+    failing.set_trace_context(root);
+    event_loop->deliver_message(failing);
+    bool thrown = false;
+    try
+    {
+        c->process_next_message();
+    }
+    catch (const std::runtime_error &)
+    {
+        thrown = true;
+    }
+    assert(thrown);
+    assert(!Actor::current_trace_context().valid());
+
+    std::cout << "Trace context propagation test passed!" << std::endl;
+}
+
+// 测试飞行记录器的转储：按需、信号触发和崩溃时转储都能被解码
+void test_flight_recorder()
+{
+    std::cout << "Running flight recorder test..." << std::endl;
+
+    const std::string path = "test_flight.bin";
+    FlightRecorderOptions options;
+    options.events_per_thread = 64;
+    options.dump_path = path;
+    options.dump_signal = SIGUSR2;
+    bool installed = FlightRecorder::install(options);
+    bool installed_again = FlightRecorder::install(options);
+    assert(installed && !installed_again);
+
+    auto event_loop = std::make_shared<EventLoop>();
+    auto a = std::make_shared<EchoActor>("A", event_loop);
+    auto b = std::make_shared<EchoActor>("B", event_loop);
+    event_loop->register_actor(a);
+    event_loop->register_actor(b);
+    event_loop->run_until_idle();
+
+    for (int i = 0; i < 3; ++i)
+    {
+        event_loop->deliver_message(Message("ping", a->get_id(), b->get_id()));
+    }
+    size_t processed = event_loop->run_until_idle();
+    assert(processed == 6);
+    bool dumped = FlightRecorder::dump(path);
+    assert(dumped);
+
+    FlightDump dump = read_flight_dump(path);
+    assert(dump.reason == 0);
+    assert(dump.capacity == 64);
+    bool named = false;
+    for (const auto &actor : dump.actors)
+    {
+        named = named || (actor.first == b->get_serial() && actor.second.first == "B" && actor.second.second == b->get_id());
+    }
+    assert(named);
+
+    std::map<FlightRecorder::EventType, int> counts;
+    int64_t previous = INT64_MAX;
+    for (const auto &event : dump.events)
+    {
+        assert(event.ns_before_dump <= previous);
+        previous = event.ns_before_dump;
+        if (event.actor != b->get_serial())
+        {
+            continue;
+        }
+        ++counts[event.type];
+        if (event.type == FlightRecorder::EventType::HANDLED)
+        {
+            // 处理ping要睡眠2ms，允许换算有少量误差
+            assert(event.value >= 1900000);
+        }
+        if (event.type == FlightRecorder::EventType::PICK)
+        {
+            assert(event.aux == 0 && event.value >= 1);
+        }
+    }
+    assert(counts[FlightRecorder::EventType::ENQUEUE] == 3);
+    assert(counts[FlightRecorder::EventType::DEQUEUE] == 3);
+    assert(counts[FlightRecorder::EventType::HANDLED] == 3);
+    assert(counts[FlightRecorder::EventType::PICK] == 3);
+    assert(counts[FlightRecorder::EventType::STATE] == 2);
+
+    // 环形缓冲区只保留最近的64个事件
+    for (int i = 0; i < 100; ++i)
+    {
+        event_loop->deliver_message(Message("pong", b->get_id(), a->get_id()));
+    }
+    processed = event_loop->run_until_idle();
+    assert(processed == 100);
+    raise(SIGUSR2);
+    dump = read_flight_dump(path);
+    assert(dump.reason == SIGUSR2);
+    assert(dump.events.size() <= 64 && dump.events.size() >= 60);
+    assert(dump.events.back().type == FlightRecorder::EventType::HANDLED);
+    assert(dump.events.back().actor == a->get_serial());
+
+    // 崩溃的子进程留下转储后仍以原信号退出
+    pid_t child = fork();
+    if (child == 0)
+    {
+        struct rlimit no_core = {0, 0};
+        setrlimit(RLIMIT_CORE, &no_core);
+        FlightRecorder::record(FlightRecorder::EventType::DROPPED, 424242, 7);
+        raise(SIGSEGV);
+        _exit(0);
+    }
+    int status = 0;
+    pid_t waited = waitpid(child, &status, 0);
+    assert(waited == child);
+    assert(WIFSIGNALED(status) && WTERMSIG(status) == SIGSEGV);
+    dump = read_flight_dump(path + ".crash");
+    assert(dump.reason == SIGSEGV);
+    assert(dump.pid == static_cast<uint32_t>(child));
+    assert(dump.events.back().actor == 424242 && dump.events.back().value == 7);
+
+    std::remove(path.c_str());
+    std::remove((path + ".crash").c_str());
+    std::cout << "Flight recorder test passed!" << std::endl;
+}
+
+int main()
+{
+    test_record_round_trip();
+    test_concurrent_senders();
+    test_short_lived_threads();
+    test_reject_bad_trace();
+    test_scheduler_simulator();
+    test_trace_context_propagation();
+    test_flight_recorder();
+
+    std::cout << "All tests passed!" << std::endl;
+    return 0;
+}
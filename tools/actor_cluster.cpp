@@ -0,0 +1,138 @@
+#include <atomic>
+#include <chrono>
+#include <csignal>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "actor.h"
+#include "event_loop.h"
+#include "logging.h"
+#include "membership.h"
+#include "message.h"
+#include "tool_util.h"
+
+/**
+ * actor_cluster - 运行一个只参与成员协议的节点，打印收到的成员变化
+ *
+ * 在本机启动多个进程即可观察加入、故障检测和离开，例如：
+ *   actor_cluster --port 7000 --name n0
+ *   actor_cluster --port 7001 --name n1 --seeds 127.0.0.1:7000
+ *   actor_cluster --port 7002 --name n2 --seeds 127.0.0.1:7000,127.0.0.1:7001
+ * kill -9其中一个进程可以观察suspect -> down；Ctrl-C（SIGINT/SIGTERM）会主动离开（left）。
+ *
+ * 用法：actor_cluster [--bind IP] [--port N] [--name NAME] [--seeds ip:port,...]
+ *                     [--period MS] [--status 秒] [--duration 秒]
+ */
+
+namespace {
+
+std::atomic<bool> interrupted{false};
+
+void on_signal(int) {
+    interrupted = true;
+}
+
+// 把成员变化打印到标准输出的Actor
+class MemberWatcher : public Actor {
+public:
+    MemberWatcher(std::weak_ptr<EventLoop> event_loop) : Actor("member-watcher", event_loop) {
+        for (const char* type : {Membership::kMemberUp, Membership::kMemberSuspect, Membership::kMemberDown,
+                                 Membership::kMemberLeft}) {
+            register_handler(type, [](const Message& message) {
+                auto now = std::chrono::system_clock::to_time_t(std::chrono::system_clock::now());
+                std::cout << std::put_time(std::localtime(&now), "%H:%M:%S") << "  " << std::left << std::setw(16)
+                          << message.get_type() << message.get_payload_value<std::string>("node") << " ("
+                          << message.get_payload_value<std::string>("address") << ", incarnation "
+                          << message.get_payload_value<uint64_t>("incarnation") << ")" << std::endl;
+            });
+        }
+    }
+};
+
+void print_members(const Membership& membership) {
+    std::cout << "\n" << std::left << std::setw(24) << "NODE" << std::setw(24) << "ADDRESS" << std::setw(10)
+              << "STATUS" << std::right << std::setw(12) << "INCARNATION" << std::setw(10) << "PHI" << "\n";
+    for (const auto& member : membership.members()) {
+        std::cout << std::left << std::setw(24) << member.name << std::setw(24) << member.address << std::setw(10)
+                  << member_status_name(member.status) << std::right << std::setw(12) << member.incarnation
+                  << std::setw(10) << std::fixed << std::setprecision(2) << member.phi << "\n";
+    }
+    std::cout << "sent " << membership.packets_sent() << " packets, " << membership.bytes_sent() << " bytes\n"
+              << std::endl;
+}
+
+void print_usage() {
+    std::cerr << "usage: actor_cluster [--bind IP] [--port N] [--name NAME] [--seeds ip:port,...]\n"
+                 "                     [--period MS] [--status S] [--duration S]" << std::endl;
+}
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+    auto options = tool_util::parse_options(argc, argv, {"help"});
+    if (options.has("help") || !options.positional.empty()) {
+        print_usage();
+        return options.has("help") ? 0 : 1;
+    }
+
+    MembershipOptions membership_options;
+    membership_options.name = options.get("name", "");
+    membership_options.bind_address = options.get("bind", "127.0.0.1");
+    membership_options.port = static_cast<uint16_t>(options.get_int("port", 0));
+    membership_options.protocol_period = std::chrono::milliseconds(std::max<int64_t>(10, options.get_int("period", 200)));
+    membership_options.ack_timeout = membership_options.protocol_period * 3 / 10;
+    std::stringstream seeds(options.get("seeds", ""));
+    std::string seed;
+    while (std::getline(seeds, seed, ',')) {
+        if (!seed.empty()) {
+            membership_options.seeds.push_back(seed);
+        }
+    }
+    double status_s = options.get_double("status", 10.0);
+    double duration_s = options.get_double("duration", 0.0);
+
+    set_log_level(LogLevel::WARN);
+    std::signal(SIGINT, on_signal);
+    std::signal(SIGTERM, on_signal);
+
+    try {
+        Membership membership(membership_options);
+        std::cout << "node " << membership.name() << " listening on " << membership.address() << std::endl;
+
+        auto event_loop = std::make_shared<EventLoop>();
+        auto watcher = std::make_shared<MemberWatcher>(event_loop);
+        event_loop->register_actor(watcher);
+        event_loop->run_until_idle();
+        event_loop->set_keep_alive(true);
+        std::thread loop_thread([&event_loop]() { event_loop->run(); });
+        membership.subscribe(event_loop, watcher->get_id());
+
+        auto started = std::chrono::steady_clock::now();
+        auto next_status = started + std::chrono::duration<double>(status_s);
+        while (!interrupted) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(50));
+            auto now = std::chrono::steady_clock::now();
+            if (duration_s > 0 && now - started > std::chrono::duration<double>(duration_s)) {
+                break;
+            }
+            if (status_s > 0 && now >= next_status) {
+                print_members(membership);
+                next_status = now + std::chrono::duration<double>(status_s);
+            }
+        }
+
+        std::cout << "leaving" << std::endl;
+        membership.leave();
+        event_loop->stop();
+        loop_thread.join();
+    } catch (const std::exception& e) {
+        std::cerr << e.what() << std::endl;
+        return 1;
+    }
+    return 0;
+}
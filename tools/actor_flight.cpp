@@ -0,0 +1,191 @@
+#include <algorithm>
+#include <cctype>
+#include <csignal>
+#include <cstring>
+#include <iomanip>
+#include <iostream>
+#include <map>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "flight_recorder.h"
+#include "tool_util.h"
+
+/**
+ * actor_flight - 解码飞行记录器的转储文件
+ *
+ * 默认按时间顺序列出所有线程的事件，时间为相对转储时刻的毫秒数（负数表示在转储之前）。
+ * --summary输出每个线程的事件数和每个Actor的处理统计，适合先定位可疑的Actor再看事件明细。
+ *
+ * 用法：actor_flight <转储文件> [--last 毫秒] [--actor 名称|序号] [--thread 编号]
+ *                    [--limit 事件数] [--summary]
+ */
+
+namespace {
+
+using EventType = FlightRecorder::EventType;
+
+void print_usage() {
+    std::cerr << "usage: actor_flight <dump> [--last MS] [--actor NAME|SERIAL] [--thread N]\n"
+                 "                    [--limit N] [--summary]" << std::endl;
+}
+
+std::string describe_reason(int reason) {
+    if (reason == 0) {
+        return "on demand";
+    }
+    const char* name = ::strsignal(reason);
+    return std::string("signal ") + std::to_string(reason) + (name ? std::string(" (") + name + ")" : "");
+}
+
+const char* state_name(uint64_t state) {
+    static const char* names[] = {"CREATED", "INITIALIZED", "RUNNING", "STOPPING", "STOPPED"};
+    return state < sizeof(names) / sizeof(names[0]) ? names[state] : "?";
+}
+
+std::string details(const FlightEvent& event) {
+    switch (event.type) {
+        case EventType::PICK:
+            return "worker=" + std::to_string(event.aux) + " candidates=" + std::to_string(event.value);
+        case EventType::ENQUEUE:
+        case EventType::DEQUEUE:
+            return "depth=" + std::to_string(event.value);
+        case EventType::HANDLED:
+            return "duration=" + std::to_string(event.value) + "ns";
+        case EventType::STATE:
+            return std::string(state_name(event.value)) + " -> " + state_name(event.aux);
+        case EventType::DROPPED:
+            return "count=" + std::to_string(event.value);
+    }
+    return "value=" + std::to_string(event.value) + " aux=" + std::to_string(event.aux);
+}
+
+struct ActorSummary {
+    uint64_t handled = 0;
+    uint64_t total_ns = 0;
+    uint64_t max_ns = 0;
+    uint64_t max_depth = 0;
+    uint64_t dropped = 0;
+};
+
+void print_summary(const FlightDump& dump, const std::vector<const FlightEvent*>& events,
+                   const std::unordered_map<uint64_t, std::string>& names) {
+    std::map<uint32_t, std::pair<uint64_t, uint64_t>> threads;
+    std::map<uint32_t, int64_t> oldest;
+    std::unordered_map<uint64_t, ActorSummary> actors;
+    for (const FlightEvent* event : events) {
+        threads[event->thread] = {event->tid, threads[event->thread].second + 1};
+        oldest[event->thread] = std::max(oldest[event->thread], event->ns_before_dump);
+
+        ActorSummary& actor = actors[event->actor];
+        if (event->type == EventType::HANDLED) {
+            ++actor.handled;
+            actor.total_ns += event->value;
+            actor.max_ns = std::max(actor.max_ns, event->value);
+        } else if (event->type == EventType::ENQUEUE) {
+            actor.max_depth = std::max(actor.max_depth, event->value);
+        } else if (event->type == EventType::DROPPED) {
+            actor.dropped += event->value;
+        }
+    }
+
+    std::cout << "threads:\n";
+    for (const auto& [index, thread] : threads) {
+        std::cout << "  t" << index << " (tid " << thread.first << "): " << thread.second << " events covering "
+                  << std::fixed << std::setprecision(3) << static_cast<double>(oldest[index]) / 1e6 << " ms"
+                  << (thread.second >= dump.capacity ? " (ring full)" : "") << "\n";
+    }
+
+    std::vector<std::pair<uint64_t, ActorSummary>> rows(actors.begin(), actors.end());
+    std::sort(rows.begin(), rows.end(), [](const auto& a, const auto& b) {
+        return a.second.total_ns > b.second.total_ns;
+    });
+    std::cout << "\n" << std::left << std::setw(32) << "ACTOR" << std::right << std::setw(10) << "HANDLED"
+              << std::setw(14) << "TOTAL_US" << std::setw(12) << "MEAN_NS" << std::setw(12) << "MAX_NS"
+              << std::setw(10) << "MAXDEPTH" << std::setw(9) << "DROPPED" << "\n";
+    for (const auto& [serial, actor] : rows) {
+        auto it = names.find(serial);
+        std::string name = (it != names.end() ? it->second : "?") + "#" + std::to_string(serial);
+        std::cout << std::left << std::setw(32) << name.substr(0, 31) << std::right
+                  << std::setw(10) << actor.handled
+                  << std::setw(14) << std::setprecision(1) << static_cast<double>(actor.total_ns) / 1e3
+                  << std::setw(12) << (actor.handled ? actor.total_ns / actor.handled : 0)
+                  << std::setw(12) << actor.max_ns
+                  << std::setw(10) << actor.max_depth
+                  << std::setw(9) << actor.dropped << "\n";
+    }
+}
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+    auto options = tool_util::parse_options(argc, argv, {"summary", "help"});
+    if (options.has("help") || options.positional.size() != 1) {
+        print_usage();
+        return options.has("help") ? 0 : 1;
+    }
+
+    FlightDump dump;
+    try {
+        dump = read_flight_dump(options.positional.front());
+    } catch (const std::exception& e) {
+        std::cerr << e.what() << std::endl;
+        return 1;
+    }
+
+    std::unordered_map<uint64_t, std::string> names;
+    for (const auto& [serial, actor] : dump.actors) {
+        names[serial] = actor.first;
+    }
+
+    // 过滤条件
+    int64_t last_ns = options.has("last") ? static_cast<int64_t>(options.get_double("last", 0) * 1e6) : -1;
+    std::string actor_filter = options.get("actor", "");
+    bool actor_is_serial = !actor_filter.empty() &&
+                           std::all_of(actor_filter.begin(), actor_filter.end(), ::isdigit);
+    int64_t thread_filter = options.get_int("thread", -1);
+
+    std::vector<const FlightEvent*> events;
+    for (const auto& event : dump.events) {
+        if (last_ns >= 0 && event.ns_before_dump > last_ns) {
+            continue;
+        }
+        if (thread_filter >= 0 && event.thread != static_cast<uint32_t>(thread_filter)) {
+            continue;
+        }
+        if (!actor_filter.empty()) {
+            auto it = names.find(event.actor);
+            bool matches = actor_is_serial ? std::to_string(event.actor) == actor_filter
+                                           : it != names.end() && it->second == actor_filter;
+            if (!matches) {
+                continue;
+            }
+        }
+        events.push_back(&event);
+    }
+
+    std::cout << "flight recorder dump of pid " << dump.pid << " (" << describe_reason(dump.reason) << "), "
+              << dump.events.size() << " events, " << dump.capacity << " per thread"
+              << (dump.torn_events ? ", " + std::to_string(dump.torn_events) + " overwritten during dump" : "")
+              << "\n\n";
+
+    if (options.has("summary")) {
+        print_summary(dump, events, names);
+        return 0;
+    }
+
+    // 默认只显示最近的事件
+    size_t limit = static_cast<size_t>(std::max<int64_t>(0, options.get_int("limit", 1000)));
+    size_t begin = limit > 0 && events.size() > limit ? events.size() - limit : 0;
+    for (size_t i = begin; i < events.size(); ++i) {
+        const FlightEvent& event = *events[i];
+        auto it = names.find(event.actor);
+        std::string name = (it != names.end() ? it->second : "?") + "#" + std::to_string(event.actor);
+        std::cout << std::fixed << std::setprecision(6) << std::right << std::setw(14)
+                  << -static_cast<double>(event.ns_before_dump) / 1e6 << " ms  t" << std::left << std::setw(4)
+                  << event.thread << std::setw(9) << flight_event_name(event.type) << std::setw(28) << name
+                  << details(event) << "\n";
+    }
+    return 0;
+}
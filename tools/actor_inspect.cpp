@@ -0,0 +1,212 @@
+#include <algorithm>
+#include <arpa/inet.h>
+#include <cctype>
+#include <cerrno>
+#include <chrono>
+#include <cstring>
+#include <iomanip>
+#include <iostream>
+#include <netinet/in.h>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <sys/socket.h>
+#include <sys/time.h>
+#include <thread>
+#include <unistd.h>
+
+#include "introspection.h"
+#include "tool_util.h"
+
+/**
+ * actor_inspect - 通过HTTP端点获取另一个进程的Actor快照，按积压（或耗时、处理量）列出前N个Actor
+ *
+ * 目标进程需要在MetricsHttpServer上注册快照端点：
+ *   server.add_endpoint("/actors", [loop](const std::string& query) { return handle_snapshot_request(*loop, query); });
+ * （actor_loadgen用--inspect-port开启）。快照由目标进程在不暂停worker的情况下拍摄。
+ *
+ * 用法：actor_inspect [host:]port [--top N] [--sort backlog|busy|processed] [--path /actors]
+ *                     [--interval 毫秒] [--count 刷新次数]
+ * 不带--interval时只打印一次。
+ */
+
+namespace {
+
+int64_t system_now_ns() {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::system_clock::now().time_since_epoch()).count();
+}
+
+// 发送GET请求并返回响应体，失败时抛出std::runtime_error
+std::string http_get(const std::string& host, uint16_t port, const std::string& target) {
+    sockaddr_in addr{};
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons(port);
+    if (::inet_pton(AF_INET, host.c_str(), &addr.sin_addr) != 1) {
+        throw std::runtime_error("Invalid address: " + host);
+    }
+
+    int fd = ::socket(AF_INET, SOCK_STREAM, 0);
+    if (fd < 0) {
+        throw std::runtime_error(std::string("Cannot create socket: ") + std::strerror(errno));
+    }
+    timeval timeout{5, 0};
+    ::setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+    ::setsockopt(fd, SOL_SOCKET, SO_SNDTIMEO, &timeout, sizeof(timeout));
+    if (::connect(fd, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) < 0) {
+        std::string error = std::strerror(errno);
+        ::close(fd);
+        throw std::runtime_error("Cannot connect to " + host + ":" + std::to_string(port) + ": " + error);
+    }
+
+    std::string request = "GET " + target + " HTTP/1.1\r\nHost: " + host + "\r\nConnection: close\r\n\r\n";
+    if (::send(fd, request.data(), request.size(), MSG_NOSIGNAL) != static_cast<ssize_t>(request.size())) {
+        ::close(fd);
+        throw std::runtime_error("Cannot send request");
+    }
+
+    // 服务端每个响应后关闭连接，读到EOF即可
+    std::string response;
+    char buffer[65536];
+    for (;;) {
+        ssize_t n = ::recv(fd, buffer, sizeof(buffer), 0);
+        if (n < 0 && errno == EINTR) {
+            continue;
+        }
+        if (n <= 0) {
+            break;
+        }
+        response.append(buffer, static_cast<size_t>(n));
+    }
+    ::close(fd);
+
+    size_t body = response.find("\r\n\r\n");
+    if (body == std::string::npos) {
+        throw std::runtime_error("Invalid HTTP response");
+    }
+    std::string status = response.substr(0, response.find("\r\n"));
+    if (status.find(" 200 ") == std::string::npos) {
+        throw std::runtime_error("Request failed: " + status);
+    }
+    return response.substr(body + 4);
+}
+
+// 把不可打印字符替换为'?'
+std::string printable(const std::string& text, size_t width) {
+    std::string result;
+    for (char c : text) {
+        result += std::isprint(static_cast<unsigned char>(c)) ? c : '?';
+    }
+    if (result.size() > width) {
+        result = result.substr(0, width - 1) + "~";
+    }
+    return result;
+}
+
+const char* priority_name(int priority) {
+    static const char* const names[] = {"LOW", "NORMAL", "HIGH", "CRITICAL"};
+    return priority >= 0 && priority < 4 ? names[priority] : "-";
+}
+
+// 距现在的时间，例如"12ms"、"3.4s"
+std::string age(int64_t then_ns, int64_t now_ns) {
+    if (then_ns <= 0) {
+        return "never";
+    }
+    double seconds = static_cast<double>(std::max<int64_t>(0, now_ns - then_ns)) / 1e9;
+    std::ostringstream out;
+    out << std::fixed;
+    if (seconds < 1.0) {
+        out << std::setprecision(0) << seconds * 1000 << "ms";
+    } else if (seconds < 600) {
+        out << std::setprecision(1) << seconds << "s";
+    } else {
+        out << std::setprecision(0) << seconds / 60 << "m";
+    }
+    return out.str();
+}
+
+void print_snapshot(const SystemSnapshot& snapshot, SnapshotOrder order) {
+    int64_t now_ns = system_now_ns();
+    std::cout << std::fixed << std::setprecision(2)
+              << "actors " << snapshot.actor_count << ", backlog " << snapshot.total_backlog << ", in-flight "
+              << snapshot.in_flight << ", snapshot took " << static_cast<double>(snapshot.scan_ns) / 1e6
+              << " ms, sorted by " << snapshot_order_name(order) << "\n\n"
+              << std::left << std::setw(24) << "NAME" << std::setw(38) << "ID" << std::setw(12) << "STATE"
+              << std::right << std::setw(10) << "BACKLOG" << std::setw(10) << "TOP-PRIO" << std::setw(12)
+              << "PROCESSED" << std::setw(12) << "AVG(us)" << std::setw(12) << "MAX(us)" << std::setw(10)
+              << "LAST-RUN" << "\n";
+
+    for (const auto& actor : snapshot.actors) {
+        const ActorStats& stats = actor.stats;
+        double average_us = stats.processed > 0 ? static_cast<double>(stats.handler_ns_total) /
+                                                      static_cast<double>(stats.processed) / 1000.0
+                                                : 0.0;
+        std::cout << std::left << std::setw(24) << printable(actor.name, 23) << std::setw(38)
+                  << printable(actor.id, 37) << std::setw(12) << actor_state_name(actor.state) << std::right
+                  << std::setw(10) << stats.mailbox_depth << std::setw(10) << priority_name(stats.top_priority)
+                  << std::setw(12) << stats.processed << std::setw(12) << average_us << std::setw(12)
+                  << static_cast<double>(stats.handler_ns_max) / 1000.0 << std::setw(10)
+                  << age(stats.last_run_ns, now_ns) << "\n";
+    }
+    std::cout << std::flush;
+}
+
+void print_usage() {
+    std::cerr << "usage: actor_inspect [host:]port [--top N] [--sort backlog|busy|processed] [--path /actors]\n"
+                 "                     [--interval MS] [--count N]" << std::endl;
+}
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+    auto options = tool_util::parse_options(argc, argv, {"help"});
+    if (options.has("help") || options.positional.size() != 1) {
+        print_usage();
+        return options.has("help") ? 0 : 1;
+    }
+
+    std::string target = options.positional.front();
+    std::string host = "127.0.0.1";
+    size_t colon = target.rfind(':');
+    if (colon != std::string::npos) {
+        host = target.substr(0, colon);
+        target = target.substr(colon + 1);
+    }
+    int64_t port = std::strtoll(target.c_str(), nullptr, 10);
+    if (port <= 0 || port > 65535) {
+        print_usage();
+        return 1;
+    }
+
+    SnapshotOrder order = SnapshotOrder::BACKLOG;
+    if (!parse_snapshot_order(options.get("sort", "backlog"), order)) {
+        std::cerr << "Unknown sort key: " << options.get("sort", "") << std::endl;
+        return 1;
+    }
+    int64_t top = std::max<int64_t>(1, options.get_int("top", 20));
+    std::string request = options.get("path", "/actors") + "?top=" + std::to_string(top) + "&sort=" +
+                          snapshot_order_name(order);
+
+    bool repeat = options.has("interval");
+    auto interval = std::chrono::milliseconds(std::max<int64_t>(10, options.get_int("interval", 1000)));
+    int64_t count = repeat ? options.get_int("count", 0) : 1;
+    bool clear_screen = repeat && ::isatty(STDOUT_FILENO);
+
+    try {
+        for (int64_t refresh = 0; count <= 0 || refresh < count; ++refresh) {
+            if (refresh > 0) {
+                std::this_thread::sleep_for(interval);
+            }
+            SystemSnapshot snapshot = parse_snapshot(http_get(host, static_cast<uint16_t>(port), request));
+            if (clear_screen) {
+                std::cout << "\033[H\033[2J";
+            }
+            print_snapshot(snapshot, order);
+        }
+    } catch (const std::exception& e) {
+        std::cerr << e.what() << std::endl;
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,547 @@
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <csignal>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <random>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+#include "actor.h"
+#include "event_loop.h"
+#include "flight_recorder.h"
+#include "histogram.h"
+#include "introspection.h"
+#include "logging.h"
+#include "message.h"
+#include "metrics.h"
+#include "metrics_exporter.h"
+#include "scheduler.h"
+#include "shared_metrics.h"
+#include "tool_util.h"
+
+/**
+ * actor_loadgen - 开环负载生成器
+ *
+ * 按固定到达率向选定的拓扑注入请求，不等待上一个请求完成（开环），
+ * 延迟从请求的"预定发送时间"开始计算，因此生成器自身落后时的排队时间也会计入，
+ * 避免协同遗漏（coordinated omission）低估尾延迟。同时给出从实际发送时间开始计算的延迟作对比。
+ *
+ * 拓扑：
+ *   pipeline  请求依次经过--stages个阶段
+ *   fanout    根节点把请求分发给--width个叶子，汇聚节点收齐后完成
+ *   reqreply  --clients个客户端向--servers个服务端发请求，收到回复后完成
+ *   random    --nodes个节点、每个节点--degree条出边的随机图，请求走--hops跳后完成
+ *
+ * 用法：actor_loadgen [--topology NAME] [--rate N | --sweep r1,r2,...] [--duration 秒]
+ *                     [--workers N] [--scheduler NAME] [--work-ns N] [--seed N]
+ *                     [--hgrm 前缀] [--drain-timeout 秒] [--shared-metrics] [--flight 文件]
+ *                     [--inspect-port 端口]
+ *
+ * --shared-metrics把各Actor的计数器发布到共享内存指标段，运行期间可以用actor_top观察。
+ * --flight打开飞行记录器，结束时（或收到SIGUSR2时）把最近的调度事件转储到文件，用actor_flight解码。
+ * --inspect-port在该端口的/actors上提供Actor快照，运行期间可以用actor_inspect查看积压最多的Actor。
+ */
+
+namespace {
+
+int64_t steady_ns() {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+// 模拟处理函数的计算开销
+void spin_for(int64_t ns) {
+    if (ns <= 0) {
+        return;
+    }
+    int64_t until = steady_ns() + ns;
+    while (steady_ns() < until) {
+    }
+}
+
+// 一次运行中所有Actor共享的完成统计
+struct RunStats {
+    LatencyHistogram corrected;    // 从预定发送时间开始
+    LatencyHistogram uncorrected;  // 从实际发送时间开始
+    std::atomic<uint64_t> completed{0};
+    std::atomic<int64_t> last_completion_ns{0};
+
+    void complete(const Message& msg) {
+        int64_t now = steady_ns();
+        corrected.record(now - msg.get_payload_value<int64_t>("intended_ns"));
+        uncorrected.record(now - msg.get_payload_value<int64_t>("sent_ns"));
+
+        int64_t last = last_completion_ns.load(std::memory_order_relaxed);
+        while (now > last && !last_completion_ns.compare_exchange_weak(last, now, std::memory_order_relaxed)) {
+        }
+        completed.fetch_add(1, std::memory_order_release);
+    }
+};
+
+// 负载Actor的公共部分：空转work_ns后执行具体逻辑
+class LoadActor : public Actor {
+public:
+    LoadActor(const std::string& name, std::weak_ptr<EventLoop> event_loop, RunStats& stats, int64_t work_ns)
+        : Actor(name, event_loop), stats_(stats), work_ns_(work_ns) {}
+
+protected:
+    void forward(const std::string& type, const std::string& target, const Message& msg) {
+        send(target, Message(type, id_, target, msg.get_pmr_payload(), msg.get_priority()));
+    }
+
+    RunStats& stats_;
+    int64_t work_ns_;
+};
+
+// pipeline阶段：转发给下一阶段，最后一个阶段完成请求
+class StageActor : public LoadActor {
+public:
+    StageActor(const std::string& name, std::weak_ptr<EventLoop> event_loop, RunStats& stats, int64_t work_ns)
+        : LoadActor(name, event_loop, stats, work_ns) {
+        register_handler("request", [this](const Message& msg) {
+            spin_for(work_ns_);
+            if (next_.empty()) {
+                stats_.complete(msg);
+            } else {
+                forward("request", next_, msg);
+            }
+        });
+    }
+
+    void set_next(const std::string& next) { next_ = next; }
+
+private:
+    std::string next_;
+};
+
+// fanout根节点：把请求分发给所有叶子
+class ScatterActor : public LoadActor {
+public:
+    ScatterActor(const std::string& name, std::weak_ptr<EventLoop> event_loop, RunStats& stats, int64_t work_ns)
+        : LoadActor(name, event_loop, stats, work_ns) {
+        register_handler("request", [this](const Message& msg) {
+            spin_for(work_ns_);
+            for (const auto& leaf : leaves_) {
+                forward("part", leaf, msg);
+            }
+        });
+    }
+
+    void set_leaves(std::vector<std::string> leaves) { leaves_ = std::move(leaves); }
+
+private:
+    std::vector<std::string> leaves_;
+};
+
+// fanout叶子：处理后交给汇聚节点
+class LeafActor : public LoadActor {
+public:
+    LeafActor(const std::string& name, std::weak_ptr<EventLoop> event_loop, RunStats& stats, int64_t work_ns,
+              const std::string& gather)
+        : LoadActor(name, event_loop, stats, work_ns), gather_(gather) {
+        register_handler("part", [this](const Message& msg) {
+            spin_for(work_ns_);
+            forward("done", gather_, msg);
+        });
+    }
+
+private:
+    std::string gather_;
+};
+
+// fanout汇聚节点：同一请求收齐width个结果后完成
+class GatherActor : public LoadActor {
+public:
+    GatherActor(const std::string& name, std::weak_ptr<EventLoop> event_loop, RunStats& stats, size_t width)
+        : LoadActor(name, event_loop, stats, 0), width_(width) {
+        register_handler("done", [this](const Message& msg) {
+            auto request = msg.get_payload_value<uint64_t>("request");
+            if (++received_[request] == width_) {
+                received_.erase(request);
+                stats_.complete(msg);
+            }
+        });
+    }
+
+private:
+    size_t width_;
+    std::unordered_map<uint64_t, size_t> received_;
+};
+
+// reqreply服务端：处理后回复给请求中的客户端
+class ServerActor : public LoadActor {
+public:
+    ServerActor(const std::string& name, std::weak_ptr<EventLoop> event_loop, RunStats& stats, int64_t work_ns)
+        : LoadActor(name, event_loop, stats, work_ns) {
+        register_handler("request", [this](const Message& msg) {
+            spin_for(work_ns_);
+            forward("reply", msg.get_payload_value<std::string>("client"), msg);
+        });
+    }
+};
+
+// reqreply客户端：收到回复即完成
+class ClientActor : public LoadActor {
+public:
+    ClientActor(const std::string& name, std::weak_ptr<EventLoop> event_loop, RunStats& stats)
+        : LoadActor(name, event_loop, stats, 0) {
+        register_handler("reply", [this](const Message& msg) {
+            stats_.complete(msg);
+        });
+    }
+};
+
+// random图节点：剩余跳数为0时完成，否则沿一条由请求编号决定的出边转发
+class GraphActor : public LoadActor {
+public:
+    GraphActor(const std::string& name, std::weak_ptr<EventLoop> event_loop, RunStats& stats, int64_t work_ns)
+        : LoadActor(name, event_loop, stats, work_ns) {
+        register_handler("request", [this](const Message& msg) {
+            spin_for(work_ns_);
+            auto ttl = msg.get_payload_value<int64_t>("ttl");
+            if (ttl <= 0 || edges_.empty()) {
+                stats_.complete(msg);
+                return;
+            }
+
+            auto payload = msg.get_pmr_payload();
+            payload["ttl"] = ttl - 1;
+            uint64_t hop = msg.get_payload_value<uint64_t>("request") * 0x9E3779B97F4A7C15ULL + static_cast<uint64_t>(ttl);
+            const auto& next = edges_[(hop >> 32) % edges_.size()];
+            send(next, Message("request", id_, next, payload, msg.get_priority()));
+        });
+    }
+
+    void set_edges(std::vector<std::string> edges) { edges_ = std::move(edges); }
+
+private:
+    std::vector<std::string> edges_;
+};
+
+struct LoadConfig {
+    std::string topology = "pipeline";
+    std::string scheduler = "round-robin";
+    size_t workers = 1;
+    double duration_s = 2.0;
+    double drain_timeout_s = 10.0;
+    int64_t work_ns = 0;
+    uint64_t seed = 0;
+    size_t stages = 4;
+    size_t width = 4;
+    size_t clients = 4;
+    size_t servers = 4;
+    size_t nodes = 16;
+    size_t degree = 3;
+    int64_t hops = 4;
+    std::shared_ptr<SharedMetricsSegment> shared_metrics;
+    std::shared_ptr<MetricsHttpServer> inspect_server;
+};
+
+// 拓扑入口：请求发送目标和额外负载
+struct Topology {
+    std::vector<std::string> entries;
+    std::vector<std::string> clients;  // 仅reqreply
+};
+
+Topology build_topology(const LoadConfig& config, const std::shared_ptr<EventLoop>& event_loop, RunStats& stats) {
+    Topology topology;
+    auto add = [&](std::shared_ptr<Actor> actor) {
+        event_loop->register_actor(actor);
+        return actor->get_id();
+    };
+
+    if (config.topology == "pipeline") {
+        std::vector<std::shared_ptr<StageActor>> stages;
+        for (size_t i = 0; i < std::max<size_t>(1, config.stages); ++i) {
+            stages.push_back(std::make_shared<StageActor>("stage" + std::to_string(i), event_loop, stats, config.work_ns));
+        }
+        for (size_t i = 0; i + 1 < stages.size(); ++i) {
+            stages[i]->set_next(stages[i + 1]->get_id());
+        }
+        for (auto& stage : stages) {
+            add(stage);
+        }
+        topology.entries.push_back(stages.front()->get_id());
+    } else if (config.topology == "fanout") {
+        auto gather = std::make_shared<GatherActor>("gather", event_loop, stats, std::max<size_t>(1, config.width));
+        auto scatter = std::make_shared<ScatterActor>("scatter", event_loop, stats, config.work_ns);
+        std::vector<std::string> leaves;
+        for (size_t i = 0; i < std::max<size_t>(1, config.width); ++i) {
+            leaves.push_back(add(std::make_shared<LeafActor>("leaf" + std::to_string(i), event_loop, stats,
+                                                             config.work_ns, gather->get_id())));
+        }
+        scatter->set_leaves(leaves);
+        add(gather);
+        topology.entries.push_back(add(scatter));
+    } else if (config.topology == "reqreply") {
+        for (size_t i = 0; i < std::max<size_t>(1, config.servers); ++i) {
+            topology.entries.push_back(add(std::make_shared<ServerActor>("server" + std::to_string(i), event_loop,
+                                                                         stats, config.work_ns)));
+        }
+        for (size_t i = 0; i < std::max<size_t>(1, config.clients); ++i) {
+            topology.clients.push_back(add(std::make_shared<ClientActor>("client" + std::to_string(i), event_loop, stats)));
+        }
+    } else if (config.topology == "random") {
+        std::vector<std::shared_ptr<GraphActor>> nodes;
+        for (size_t i = 0; i < std::max<size_t>(1, config.nodes); ++i) {
+            nodes.push_back(std::make_shared<GraphActor>("node" + std::to_string(i), event_loop, stats, config.work_ns));
+        }
+        std::mt19937_64 rng(config.seed);
+        for (auto& node : nodes) {
+            std::vector<std::string> edges;
+            for (size_t e = 0; e < config.degree; ++e) {
+                edges.push_back(nodes[rng() % nodes.size()]->get_id());
+            }
+            node->set_edges(std::move(edges));
+        }
+        for (auto& node : nodes) {
+            topology.entries.push_back(add(node));
+        }
+    }
+    return topology;
+}
+
+struct RunResult {
+    double rate = 0;
+    uint64_t sent = 0;
+    uint64_t completed = 0;
+    double achieved = 0;
+    int64_t p50 = 0;
+    int64_t p99 = 0;
+    int64_t p999 = 0;
+    int64_t max = 0;
+    int64_t uncorrected_p99 = 0;
+    bool drained = true;
+};
+
+RunResult run_at_rate(const LoadConfig& config, double rate, const std::string& hgrm_prefix) {
+    RunResult result;
+    result.rate = rate;
+
+    RunStats stats;
+    auto event_loop = std::make_shared<EventLoop>();
+    event_loop->set_worker_count(config.workers);
+    event_loop->set_scheduler(create_scheduler(config.scheduler, config.seed));
+    if (config.shared_metrics) {
+        event_loop->set_shared_metrics(config.shared_metrics);
+    }
+    if (config.inspect_server) {
+        event_loop->set_handler_timing(true);
+        std::weak_ptr<EventLoop> weak_loop = event_loop;
+        config.inspect_server->add_endpoint("/actors", [weak_loop](const std::string& query) {
+            auto loop = weak_loop.lock();
+            return loop ? handle_snapshot_request(*loop, query) : format_snapshot(SystemSnapshot());
+        });
+    }
+    Topology topology = build_topology(config, event_loop, stats);
+
+    // 先启动所有Actor，再以常驻模式运行，空闲worker会在投递时被唤醒
+    event_loop->run_until_idle();
+    event_loop->set_keep_alive(true);
+    std::thread loop_thread([&event_loop]() { event_loop->run(); });
+    while (!event_loop->is_running()) {
+        std::this_thread::yield();
+    }
+
+    const uint64_t total = static_cast<uint64_t>(rate * config.duration_s);
+    const int64_t period_ns = static_cast<int64_t>(1e9 / rate);
+    const int64_t start_ns = steady_ns() + 1000000;
+
+    for (uint64_t i = 0; i < total; ++i) {
+        int64_t intended = start_ns + static_cast<int64_t>(i) * period_ns;
+
+        // 距离预定时间较远时睡眠，最后一小段忙等以减小发送抖动；落后时立即发送
+        int64_t now = steady_ns();
+        if (intended - now > 200000) {
+            std::this_thread::sleep_for(std::chrono::nanoseconds(intended - now - 100000));
+        }
+        while (steady_ns() < intended) {
+        }
+
+        Message::Payload payload;
+        payload["request"] = i;
+        payload["intended_ns"] = intended;
+        payload["sent_ns"] = steady_ns();
+        if (!topology.clients.empty()) {
+            payload["client"] = topology.clients[i % topology.clients.size()];
+        }
+        if (config.topology == "random") {
+            payload["ttl"] = config.hops;
+        }
+
+        const auto& target = topology.entries[i % topology.entries.size()];
+        event_loop->deliver_message(Message("request", "loadgen", target, payload));
+    }
+    result.sent = total;
+
+    // 等待全部请求完成或超时
+    auto deadline = std::chrono::steady_clock::now() +
+                    std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::duration<double>(config.drain_timeout_s));
+    while (stats.completed.load(std::memory_order_acquire) < total) {
+        if (std::chrono::steady_clock::now() > deadline) {
+            result.drained = false;
+            break;
+        }
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+
+    event_loop->stop();
+    loop_thread.join();
+
+    result.completed = stats.completed.load();
+    int64_t elapsed = stats.last_completion_ns.load() - start_ns;
+    result.achieved = elapsed > 0 ? static_cast<double>(result.completed) * 1e9 / static_cast<double>(elapsed) : 0;
+    result.p50 = stats.corrected.value_at_percentile(50);
+    result.p99 = stats.corrected.value_at_percentile(99);
+    result.p999 = stats.corrected.value_at_percentile(99.9);
+    result.max = stats.corrected.max();
+    result.uncorrected_p99 = stats.uncorrected.value_at_percentile(99);
+
+    if (!hgrm_prefix.empty()) {
+        std::ofstream out(hgrm_prefix + "_" + std::to_string(static_cast<int64_t>(rate)) + ".hgrm");
+        stats.corrected.write_percentile_distribution(out, 1000.0);
+    }
+    return result;
+}
+
+std::vector<double> parse_rates(const std::string& list) {
+    std::vector<double> rates;
+    std::stringstream stream(list);
+    std::string item;
+    while (std::getline(stream, item, ',')) {
+        double rate = std::strtod(item.c_str(), nullptr);
+        if (rate > 0) {
+            rates.push_back(rate);
+        }
+    }
+    return rates;
+}
+
+void print_usage() {
+    std::cerr << "usage: actor_loadgen [--topology pipeline|fanout|reqreply|random] [--rate N | --sweep r1,r2,...]\n"
+                 "                     [--duration S] [--workers N] [--scheduler NAME] [--work-ns N] [--seed N]\n"
+                 "                     [--stages N] [--width N] [--clients N] [--servers N]\n"
+                 "                     [--nodes N] [--degree N] [--hops N] [--hgrm PREFIX] [--drain-timeout S]\n"
+                 "                     [--shared-metrics] [--flight FILE] [--inspect-port PORT]"
+              << std::endl;
+}
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+    auto options = tool_util::parse_options(argc, argv, {"help", "shared-metrics"});
+    if (options.has("help") || !options.positional.empty()) {
+        print_usage();
+        return options.has("help") ? 0 : 1;
+    }
+
+    LoadConfig config;
+    config.topology = options.get("topology", config.topology);
+    config.scheduler = options.get("scheduler", config.scheduler);
+    config.workers = static_cast<size_t>(std::max<int64_t>(1, options.get_int("workers", 1)));
+    config.duration_s = options.get_double("duration", config.duration_s);
+    config.drain_timeout_s = options.get_double("drain-timeout", config.drain_timeout_s);
+    config.work_ns = options.get_int("work-ns", config.work_ns);
+    config.seed = static_cast<uint64_t>(options.get_int("seed", 0));
+    config.stages = static_cast<size_t>(options.get_int("stages", 4));
+    config.width = static_cast<size_t>(options.get_int("width", 4));
+    config.clients = static_cast<size_t>(options.get_int("clients", 4));
+    config.servers = static_cast<size_t>(options.get_int("servers", 4));
+    config.nodes = static_cast<size_t>(options.get_int("nodes", 16));
+    config.degree = static_cast<size_t>(options.get_int("degree", 3));
+    config.hops = options.get_int("hops", 4);
+
+    if (config.topology != "pipeline" && config.topology != "fanout" &&
+        config.topology != "reqreply" && config.topology != "random") {
+        std::cerr << "Unknown topology: " << config.topology << std::endl;
+        return 1;
+    }
+    if (!create_scheduler(config.scheduler)) {
+        std::cerr << "Unknown scheduler: " << config.scheduler << std::endl;
+        return 1;
+    }
+
+    std::vector<double> rates = options.has("sweep") ? parse_rates(options.get("sweep", ""))
+                                                     : std::vector<double>{options.get_double("rate", 10000)};
+    if (rates.empty() || rates.front() <= 0) {
+        print_usage();
+        return 1;
+    }
+
+    if (options.has("shared-metrics")) {
+        try {
+            config.shared_metrics = std::make_shared<SharedMetricsSegment>(SharedMetricsSegment::default_path());
+        } catch (const std::exception& e) {
+            std::cerr << e.what() << std::endl;
+            return 1;
+        }
+        std::cerr << "shared metrics: " << config.shared_metrics->path() << std::endl;
+    }
+
+    if (options.has("inspect-port")) {
+        try {
+            config.inspect_server = std::make_shared<MetricsHttpServer>(
+                std::make_shared<MetricsRegistry>(), static_cast<uint16_t>(options.get_int("inspect-port", 0)));
+        } catch (const std::exception& e) {
+            std::cerr << e.what() << std::endl;
+            return 1;
+        }
+        std::cerr << "actor snapshots: http://127.0.0.1:" << config.inspect_server->port() << "/actors" << std::endl;
+    }
+
+    std::string flight_path = options.get("flight", "");
+    if (!flight_path.empty()) {
+        FlightRecorderOptions flight_options;
+        flight_options.dump_path = flight_path;
+        flight_options.dump_signal = SIGUSR2;
+        FlightRecorder::install(flight_options);
+    }
+
+    // 生命周期日志会干扰测量
+    set_log_level(LogLevel::WARN);
+
+    std::cout << "topology " << config.topology << ", scheduler " << config.scheduler
+              << ", workers " << config.workers << ", work " << config.work_ns << " ns/hop\n"
+              << "latency in us, measured from the intended send time (coordinated-omission corrected)\n\n";
+    std::cout << std::setw(10) << "rate" << std::setw(10) << "sent" << std::setw(10) << "done"
+              << std::setw(12) << "achieved" << std::setw(10) << "p50" << std::setw(10) << "p99"
+              << std::setw(10) << "p99.9" << std::setw(10) << "max" << std::setw(14) << "p99(uncorr)" << "\n";
+
+    std::string hgrm_prefix = options.get("hgrm", "");
+    std::vector<RunResult> results;
+    for (double rate : rates) {
+        RunResult r = run_at_rate(config, rate, hgrm_prefix);
+        results.push_back(r);
+        std::cout << std::fixed << std::setprecision(0)
+                  << std::setw(10) << r.rate << std::setw(10) << r.sent << std::setw(10) << r.completed
+                  << std::setw(12) << r.achieved << std::setprecision(1)
+                  << std::setw(10) << r.p50 / 1000.0 << std::setw(10) << r.p99 / 1000.0
+                  << std::setw(10) << r.p999 / 1000.0 << std::setw(10) << r.max / 1000.0
+                  << std::setw(14) << r.uncorrected_p99 / 1000.0
+                  << (r.drained ? "" : "  (drain timeout)") << std::endl;
+    }
+
+    if (!flight_path.empty() && !FlightRecorder::dump(flight_path)) {
+        std::cerr << "Cannot write flight recorder dump " << flight_path << std::endl;
+    }
+
+    // 饱和拐点：吞吐跟不上到达率，或p99比最低负载时恶化10倍以上
+    if (results.size() > 1) {
+        int64_t baseline_p99 = std::max<int64_t>(results.front().p99, 1000);
+        for (const auto& r : results) {
+            if (r.achieved < 0.95 * r.rate || r.p99 > 10 * baseline_p99) {
+                std::cout << "\nsaturation knee at ~" << std::setprecision(0) << r.rate << " req/s" << std::endl;
+                return 0;
+            }
+        }
+        std::cout << "\nno saturation up to " << std::setprecision(0) << results.back().rate << " req/s" << std::endl;
+    }
+    return 0;
+}
@@ -0,0 +1,184 @@
+#include <algorithm>
+#include <chrono>
+#include <iostream>
+#include <map>
+#include <memory>
+#include <set>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "actor.h"
+#include "clock.h"
+#include "event_loop.h"
+#include "message.h"
+#include "scheduler.h"
+#include "trace.h"
+#include "tool_util.h"
+
+/**
+ * actor_replay - 把录制的消息轨迹按原始到达节奏回放到本地EventLoop
+ *
+ * 每个被录制的目标Actor对应一个合成Actor，处理函数按录制的耗时空转（仿真模式下只推进虚拟时间），
+ * 从而可以在真实流量上比较不同的Scheduler实现。
+ *
+ * 用法：actor_replay <trace文件> [--scheduler round-robin|priority|message-priority|fair|random]
+ *                    [--workers N] [--speed 倍数] [--simulate] [--seed N]
+ */
+
+namespace {
+
+int64_t now_ns() {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+        Clock::current().now().time_since_epoch()).count();
+}
+
+// 回放用的合成Actor：记录每条消息从预定到达到开始处理的延迟
+class ReplayActor : public Actor {
+public:
+    ReplayActor(const std::string& name, std::weak_ptr<EventLoop> event_loop,
+                const std::set<std::string>& types, bool spin)
+        : Actor(name, event_loop) {
+        for (const auto& type : types) {
+            register_handler(type, [this, spin](const Message& msg) {
+                handle(msg, spin);
+            });
+        }
+    }
+
+    const std::vector<int64_t>& latencies() const { return latencies_; }
+
+private:
+    void handle(const Message& msg, bool spin) {
+        int64_t started = now_ns();
+        latencies_.push_back(started - msg.get_payload_value<int64_t>("arrival_ns"));
+
+        // 按录制的耗时空转，模拟处理函数占用worker的时间
+        if (spin) {
+            int64_t cost = msg.get_payload_value<int64_t>("cost_ns");
+            auto until = std::chrono::steady_clock::now() + std::chrono::nanoseconds(cost);
+            while (std::chrono::steady_clock::now() < until) {
+            }
+        }
+    }
+
+    std::vector<int64_t> latencies_;
+};
+
+void print_usage() {
+    std::cerr << "usage: actor_replay <trace> [--scheduler NAME] [--workers N] "
+                 "[--speed X] [--simulate] [--seed N]" << std::endl;
+}
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+    auto options = tool_util::parse_options(argc, argv, {"simulate"});
+    if (options.positional.size() != 1) {
+        print_usage();
+        return 1;
+    }
+
+    std::string scheduler_name = options.get("scheduler", "round-robin");
+    bool simulate = options.has("simulate");
+    double speed = options.get_double("speed", 1.0);
+    uint64_t seed = static_cast<uint64_t>(options.get_int("seed", 0));
+
+    std::vector<TraceEvent> events;
+    try {
+        TraceReader reader(options.positional[0]);
+        events = reader.read_all();
+    } catch (const std::exception& e) {
+        std::cerr << e.what() << std::endl;
+        return 1;
+    }
+
+    // 按(目标, 邮箱序号)把HANDLED的耗时配对到对应的DELIVERY
+    std::vector<int64_t> costs = pair_handler_costs(events);
+    std::map<std::string, std::set<std::string>> types_by_target;
+    std::vector<const TraceEvent*> deliveries;
+    for (const auto& event : events) {
+        if (event.kind == TraceEvent::Kind::DELIVERY) {
+            deliveries.push_back(&event);
+            types_by_target[event.target_id].insert(event.type);
+        }
+    }
+    if (deliveries.empty()) {
+        std::cerr << "Trace contains no deliveries" << std::endl;
+        return 1;
+    }
+
+    auto event_loop = std::make_shared<EventLoop>();
+    event_loop->set_worker_count(static_cast<size_t>(options.get_int("workers", 1)));
+    if (simulate) {
+        SimulationOptions sim;
+        sim.seed = seed;
+        sim.cost_model = [](const Actor&, const Message& msg) {
+            return std::chrono::nanoseconds(msg.get_payload_value_or<int64_t>("cost_ns", 0));
+        };
+        event_loop->enable_simulation(sim);
+    }
+    // 主线程安排投递的时间线也使用事件循环的时钟（仿真模式下为虚拟时间）
+    ClockScope clock_scope(event_loop->clock());
+
+    auto scheduler = create_scheduler(scheduler_name, seed);
+    if (!scheduler) {
+        std::cerr << "Unknown scheduler: " << scheduler_name << std::endl;
+        return 1;
+    }
+    event_loop->set_scheduler(scheduler);
+
+    // 为每个录制的目标创建合成Actor
+    std::unordered_map<std::string, std::shared_ptr<ReplayActor>> actors;
+    for (const auto& [target, types] : types_by_target) {
+        auto actor = std::make_shared<ReplayActor>(target, event_loop, types, !simulate);
+        event_loop->register_actor(actor);
+        actors[target] = actor;
+    }
+    event_loop->run_until_idle();
+
+    // 按录制的相对到达时间安排投递
+    int64_t base_ns = deliveries.front()->timestamp_ns;
+    int64_t start_ns = now_ns();
+    for (size_t i = 0; i < deliveries.size(); ++i) {
+        const auto* delivery = deliveries[i];
+        int64_t cost = costs[i];
+
+        auto offset = static_cast<int64_t>(static_cast<double>(delivery->timestamp_ns - base_ns) / speed);
+        auto sender = actors.find(delivery->sender_id);
+        const auto& target = actors[delivery->target_id];
+
+        Message::Payload payload;
+        payload["cost_ns"] = cost;
+        payload["arrival_ns"] = start_ns + offset;
+        Message msg(delivery->type,
+                    sender != actors.end() ? sender->second->get_id() : delivery->sender_id,
+                    target->get_id(), payload, delivery->priority);
+        event_loop->deliver_after(msg, std::chrono::nanoseconds(offset));
+    }
+
+    auto wall_start = std::chrono::steady_clock::now();
+    size_t processed = event_loop->run_until_idle();
+    auto wall_elapsed = std::chrono::steady_clock::now() - wall_start;
+    int64_t timeline_ns = now_ns() - start_ns;
+
+    std::vector<int64_t> all;
+    for (const auto& [_, actor] : actors) {
+        all.insert(all.end(), actor->latencies().begin(), actor->latencies().end());
+    }
+    std::sort(all.begin(), all.end());
+
+    std::cout << "scheduler:      " << scheduler_name << (simulate ? " (simulated)" : "") << "\n"
+              << "actors:         " << actors.size() << "\n"
+              << "deliveries:     " << deliveries.size() << "\n"
+              << "processed:      " << processed << "\n"
+              << "timeline:       " << timeline_ns / 1000 << " us\n"
+              << "wall time:      "
+              << std::chrono::duration_cast<std::chrono::microseconds>(wall_elapsed).count() << " us\n"
+              << "latency p50:    " << tool_util::percentile(all, 0.50) / 1000 << " us\n"
+              << "latency p90:    " << tool_util::percentile(all, 0.90) / 1000 << " us\n"
+              << "latency p99:    " << tool_util::percentile(all, 0.99) / 1000 << " us\n"
+              << "latency max:    " << (all.empty() ? 0 : all.back() / 1000) << " us" << std::endl;
+
+    return 0;
+}
@@ -0,0 +1,112 @@
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "scheduler.h"
+#include "scheduler_simulator.h"
+#include "trace.h"
+#include "tool_util.h"
+
+/**
+ * actor_sim - 用录制的消息轨迹离线比较调度策略
+ *
+ * 在仿真时间中把轨迹依次送入每个调度器的决策逻辑，输出延迟分布、公平性指数和饥饿情况。
+ *
+ * 用法：actor_sim <trace文件> [--schedulers round-robin,fair,...] [--workers N]
+ *                 [--starvation-ms N] [--cost-scale 倍数] [--fixed-cost-us N] [--top N] [--seed N]
+ */
+
+namespace {
+
+std::vector<std::string> split(const std::string& text, char separator) {
+    std::vector<std::string> parts;
+    std::stringstream stream(text);
+    std::string part;
+    while (std::getline(stream, part, separator)) {
+        if (!part.empty()) {
+            parts.push_back(part);
+        }
+    }
+    return parts;
+}
+
+double to_us(int64_t ns) {
+    return static_cast<double>(ns) / 1000.0;
+}
+
+void print_report(const SchedulerSimulationReport& report, size_t top) {
+    std::cout << std::fixed << std::setprecision(1)
+              << "== " << report.scheduler << " ==\n"
+              << "  messages:        " << report.messages << "\n"
+              << "  makespan:        " << to_us(report.makespan_ns) << " us\n"
+              << "  wait p50/p90/p99/max: " << to_us(report.wait_p50_ns) << " / "
+              << to_us(report.wait_p90_ns) << " / " << to_us(report.wait_p99_ns) << " / "
+              << to_us(report.wait_max_ns) << " us\n"
+              << std::setprecision(3)
+              << "  jain fairness:   " << report.jain_fairness << "\n"
+              << "  starvation:      " << report.starved_messages << " messages in "
+              << report.starved_actors << " actors\n";
+
+    std::cout << std::setprecision(1);
+    for (size_t i = 0; i < report.actors.size() && i < top; ++i) {
+        const auto& actor = report.actors[i];
+        std::cout << "    " << std::left << std::setw(40) << actor.actor_id << std::right
+                  << " n=" << std::setw(6) << actor.messages
+                  << " p50=" << std::setw(10) << to_us(actor.wait_p50_ns)
+                  << " p99=" << std::setw(10) << to_us(actor.wait_p99_ns)
+                  << " max=" << std::setw(10) << to_us(actor.wait_max_ns)
+                  << " stretch=" << std::setprecision(2) << actor.stretch_mean << std::setprecision(1)
+                  << " starved=" << actor.starved_messages << "\n";
+    }
+    std::cout << std::endl;
+}
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+    auto options = tool_util::parse_options(argc, argv);
+    if (options.positional.size() != 1) {
+        std::cerr << "usage: actor_sim <trace> [--schedulers a,b,...] [--workers N] [--starvation-ms N] "
+                     "[--cost-scale X] [--fixed-cost-us N] [--top N] [--seed N]" << std::endl;
+        return 1;
+    }
+
+    std::vector<TraceEvent> events;
+    try {
+        TraceReader reader(options.positional[0]);
+        events = reader.read_all();
+    } catch (const std::exception& e) {
+        std::cerr << e.what() << std::endl;
+        return 1;
+    }
+
+    SchedulerSimulator::Options sim_options;
+    sim_options.worker_count = static_cast<size_t>(options.get_int("workers", 1));
+    sim_options.starvation_threshold = std::chrono::milliseconds(options.get_int("starvation-ms", 100));
+
+    double cost_scale = options.get_double("cost-scale", 1.0);
+    int64_t fixed_cost_ns = options.get_int("fixed-cost-us", -1) * 1000;
+    if (fixed_cost_ns >= 0 || cost_scale != 1.0) {
+        sim_options.cost_model = [cost_scale, fixed_cost_ns](const TraceEvent&, int64_t recorded) {
+            int64_t cost = fixed_cost_ns >= 0 ? fixed_cost_ns : recorded;
+            return static_cast<int64_t>(static_cast<double>(cost) * cost_scale);
+        };
+    }
+
+    SchedulerSimulator simulator(std::move(events), sim_options);
+    auto names = split(options.get("schedulers", "round-robin,priority,message-priority,fair,random"), ',');
+    size_t top = static_cast<size_t>(options.get_int("top", 5));
+    uint64_t seed = static_cast<uint64_t>(options.get_int("seed", 0));
+
+    for (const auto& name : names) {
+        auto scheduler = create_scheduler(name, seed);
+        if (!scheduler) {
+            std::cerr << "Unknown scheduler: " << name << std::endl;
+            return 1;
+        }
+        print_report(simulator.run(name, scheduler), top);
+    }
+    return 0;
+}
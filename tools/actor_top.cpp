@@ -0,0 +1,195 @@
+#include <algorithm>
+#include <cctype>
+#include <chrono>
+#include <dirent.h>
+#include <iomanip>
+#include <iostream>
+#include <map>
+#include <string>
+#include <thread>
+#include <unistd.h>
+#include <utility>
+#include <vector>
+
+#include "shared_metrics.h"
+#include "tool_util.h"
+
+/**
+ * actor_top - 从共享内存指标段实时查看另一个进程中各Actor的邮箱深度和吞吐
+ *
+ * 只读映射目标进程的指标文件，不与目标进程通信，也不会打扰它的事件循环。
+ * 目标可以是进程ID（在默认目录中查找）或指标文件路径；省略时使用默认目录中唯一的文件。
+ *
+ * 用法：actor_top [pid|路径] [--interval 毫秒] [--top N] [--sort depth|rate|processed|busy]
+ *                 [--count 刷新次数] [--once]
+ */
+
+namespace {
+
+int64_t system_now_ns() {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::system_clock::now().time_since_epoch()).count();
+}
+
+std::string default_directory() {
+    const char* tmp = std::getenv("TMPDIR");
+    return std::string(tmp && *tmp ? tmp : "/tmp") + "/actor_cpp_metrics";
+}
+
+std::vector<std::string> list_segments(const std::string& directory) {
+    std::vector<std::string> names;
+    if (DIR* dir = ::opendir(directory.c_str())) {
+        while (dirent* entry = ::readdir(dir)) {
+            std::string name = entry->d_name;
+            if (!name.empty() && std::all_of(name.begin(), name.end(), ::isdigit)) {
+                names.push_back(name);
+            }
+        }
+        ::closedir(dir);
+    }
+    std::sort(names.begin(), names.end());
+    return names;
+}
+
+// 把不可打印字符替换为'?'
+std::string printable(const std::string& text, size_t width) {
+    std::string result;
+    for (char c : text) {
+        result += std::isprint(static_cast<unsigned char>(c)) ? c : '?';
+    }
+    if (result.size() > width) {
+        result = result.substr(0, width - 1) + "~";
+    }
+    return result;
+}
+
+struct Row {
+    const SharedActorSample* sample;
+    double rate;
+    double busy;
+};
+
+void print_usage() {
+    std::cerr << "usage: actor_top [pid|path] [--interval MS] [--top N] [--sort depth|rate|processed|busy]\n"
+                 "                 [--count N] [--once]" << std::endl;
+}
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+    auto options = tool_util::parse_options(argc, argv, {"once", "help"});
+    if (options.has("help") || options.positional.size() > 1) {
+        print_usage();
+        return options.has("help") ? 0 : 1;
+    }
+
+    std::string path;
+    if (options.positional.empty()) {
+        auto segments = list_segments(default_directory());
+        if (segments.size() != 1) {
+            std::cerr << (segments.empty() ? "No actor metrics segments in " : "Several metrics segments in ")
+                      << default_directory() << ", choose a pid:";
+            for (const auto& name : segments) {
+                std::cerr << " " << name;
+            }
+            std::cerr << std::endl;
+            return 1;
+        }
+        path = default_directory() + "/" + segments.front();
+    } else {
+        const std::string& target = options.positional.front();
+        bool is_pid = std::all_of(target.begin(), target.end(), ::isdigit);
+        path = is_pid ? default_directory() + "/" + target : target;
+    }
+
+    auto interval = std::chrono::milliseconds(std::max<int64_t>(10, options.get_int("interval", 1000)));
+    size_t top = static_cast<size_t>(std::max<int64_t>(1, options.get_int("top", 20)));
+    std::string sort_key = options.get("sort", "depth");
+    int64_t count = options.has("once") ? 1 : options.get_int("count", 0);
+    bool clear_screen = !options.has("once") && ::isatty(STDOUT_FILENO);
+
+    try {
+        SharedMetricsReader reader(path);
+
+        // 以(槽位, 代数)标识Actor，槽位复用后不会和旧Actor混在一起计算速率
+        std::map<std::pair<uint32_t, uint32_t>, SharedActorSample> previous;
+        for (const auto& sample : reader.snapshot().samples) {
+            previous[{sample.slot, sample.generation}] = sample;
+        }
+        int64_t previous_ns = system_now_ns();
+
+        for (int64_t refresh = 0; count <= 0 || refresh < count; ++refresh) {
+            std::this_thread::sleep_for(interval);
+            auto snapshot = reader.snapshot();
+            int64_t now_ns = system_now_ns();
+            double elapsed = static_cast<double>(now_ns - previous_ns) / 1e9;
+
+            std::vector<Row> rows;
+            for (const auto& sample : snapshot.samples) {
+                Row row{&sample, 0.0, 0.0};
+                auto it = previous.find({sample.slot, sample.generation});
+                if (it != previous.end() && elapsed > 0) {
+                    row.rate = static_cast<double>(sample.processed - it->second.processed) / elapsed;
+                    row.busy = static_cast<double>(sample.handler_ns - it->second.handler_ns) / (elapsed * 1e9) * 100.0;
+                }
+                rows.push_back(row);
+            }
+
+            std::sort(rows.begin(), rows.end(), [&sort_key](const Row& a, const Row& b) {
+                if (sort_key == "rate") {
+                    return a.rate > b.rate;
+                }
+                if (sort_key == "processed") {
+                    return a.sample->processed > b.sample->processed;
+                }
+                if (sort_key == "busy") {
+                    return a.busy > b.busy;
+                }
+                return a.sample->mailbox_depth > b.sample->mailbox_depth;
+            });
+
+            double total_rate = 0;
+            for (const auto& row : rows) {
+                total_rate += row.rate;
+            }
+
+            if (clear_screen) {
+                std::cout << "\033[H\033[2J";
+            }
+            double uptime = static_cast<double>(now_ns - snapshot.created_ns) / 1e9;
+            double heartbeat_age = static_cast<double>(now_ns - snapshot.heartbeat_ns) / 1e9;
+            std::cout << std::fixed << std::setprecision(1)
+                      << "actor_top - pid " << snapshot.pid << ", up " << uptime << "s, workers "
+                      << snapshot.worker_count << ", actors " << snapshot.actors << ", in-flight "
+                      << snapshot.in_flight << ", " << static_cast<int64_t>(total_rate) << " msg/s"
+                      << (heartbeat_age > 5.0 ? "  (no heartbeat for " + std::to_string(static_cast<int64_t>(heartbeat_age)) + "s)" : "")
+                      << (snapshot.overflow_actors > 0 ? ", " + std::to_string(snapshot.overflow_actors) + " actors untracked" : "")
+                      << "\n\n"
+                      << std::left << std::setw(24) << "NAME" << std::setw(38) << "ID" << std::right
+                      << std::setw(10) << "DEPTH" << std::setw(12) << "MSG/S" << std::setw(14) << "PROCESSED"
+                      << std::setw(10) << "DROPPED" << std::setw(8) << "BUSY%" << "\n";
+
+            for (size_t i = 0; i < rows.size() && i < top; ++i) {
+                const auto& sample = *rows[i].sample;
+                std::cout << std::left << std::setw(24) << printable(sample.name, 23)
+                          << std::setw(38) << printable(sample.id, 37) << std::right
+                          << std::setw(10) << sample.mailbox_depth
+                          << std::setw(12) << std::setprecision(0) << rows[i].rate
+                          << std::setw(14) << sample.processed
+                          << std::setw(10) << sample.dropped
+                          << std::setw(8) << std::setprecision(1) << rows[i].busy << "\n";
+            }
+            std::cout << std::flush;
+
+            previous.clear();
+            for (const auto& sample : snapshot.samples) {
+                previous[{sample.slot, sample.generation}] = sample;
+            }
+            previous_ns = now_ns;
+        }
+    } catch (const std::exception& e) {
+        std::cerr << e.what() << std::endl;
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,69 @@
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdlib>
+#include <iostream>
+#include <map>
+#include <string>
+#include <vector>
+
+/**
+ * @brief 命令行工具共用的小工具：参数解析和分位数计算
+ */
+namespace tool_util {
+
+// 解析"--key value"和"--flag"形式的参数，其余参数按顺序放入positional
+struct Options {
+    std::map<std::string, std::string> values;
+    std::vector<std::string> positional;
+
+    bool has(const std::string& key) const { return values.count(key) > 0; }
+
+    std::string get(const std::string& key, const std::string& default_value) const {
+        auto it = values.find(key);
+        return it != values.end() ? it->second : default_value;
+    }
+
+    int64_t get_int(const std::string& key, int64_t default_value) const {
+        auto it = values.find(key);
+        return it != values.end() ? std::strtoll(it->second.c_str(), nullptr, 10) : default_value;
+    }
+
+    double get_double(const std::string& key, double default_value) const {
+        auto it = values.find(key);
+        return it != values.end() ? std::strtod(it->second.c_str(), nullptr) : default_value;
+    }
+};
+
+// flags中列出的参数不带值
+inline Options parse_options(int argc, char* argv[], const std::vector<std::string>& flags = {}) {
+    Options options;
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (arg.rfind("--", 0) != 0) {
+            options.positional.push_back(arg);
+            continue;
+        }
+
+        std::string key = arg.substr(2);
+        bool is_flag = std::find(flags.begin(), flags.end(), key) != flags.end();
+        if (is_flag || i + 1 >= argc) {
+            options.values[key] = "1";
+        } else {
+            options.values[key] = argv[++i];
+        }
+    }
+    return options;
+}
+
+// 计算已排序样本的分位数（q取0~1），样本为空时返回0
+inline int64_t percentile(const std::vector<int64_t>& sorted, double q) {
+    if (sorted.empty()) {
+        return 0;
+    }
+    size_t index = static_cast<size_t>(q * static_cast<double>(sorted.size() - 1) + 0.5);
+    return sorted[std::min(index, sorted.size() - 1)];
+}
+
+} // namespace tool_util